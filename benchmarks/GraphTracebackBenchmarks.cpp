@@ -0,0 +1,356 @@
+#include "core/reference/FastaReference.h"
+#include "core/vcf/Variant.h"
+#include "core/graph/Graph.h"
+#include "core/graph/GraphTraceback.hpp"
+#include "core/alignment/Alignment.h"
+#include "core/sample/Sample.h"
+#include "core/util/ClusterArena.hpp"
+
+#include "htslib/hts.h"
+
+#include "benchmark/benchmark.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+/*
+ * Microbenchmarks of GraphTraceback::processGraph, the alignment kernel
+ * every read goes through, on synthetic graphs of the shapes graphite
+ * meets in practice. Each case builds its graph the way GraphProcessor
+ * does (the graph spacing is the read length) and aligns one read drawn
+ * from the alternate haplotype, so the graph and read setup is not timed.
+ * Besides the time per read, every case reports reads_per_second and
+ * GCUPS, the billions of dynamic programming cells (read length times
+ * the graph's sequence length) filled per second, which compare across
+ * read lengths and graph shapes.
+ *
+ * BM_BuildCluster times the rest of a cluster's life: building its graph,
+ * making its reads and releasing them, with the nodes and reads from the
+ * heap (malloc) or from a ClusterArena (arena). It reports the heap
+ * allocations per cluster, counted by the operator new and new[] below.
+ * Only the nodes and reads themselves come from the arena, so the count
+ * left under it is the strings, sets and alleles they own.
+ *
+ *   graphite_bench --benchmark_filter=snp
+ *   graphite_bench --benchmark_filter=BuildCluster
+ */
+
+static std::atomic< uint64_t > s_heap_allocation_count(0);
+
+void* operator new(size_t byteCount)
+{
+	s_heap_allocation_count.fetch_add(1, std::memory_order_relaxed);
+	void* ptr = malloc(byteCount == 0 ? 1 : byteCount);
+	if (ptr == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new[](size_t byteCount)
+{
+	return operator new(byteCount);
+}
+
+void* operator new(size_t byteCount, const std::nothrow_t&) noexcept
+{
+	s_heap_allocation_count.fetch_add(1, std::memory_order_relaxed);
+	return malloc(byteCount == 0 ? 1 : byteCount);
+}
+
+void* operator new[](size_t byteCount, const std::nothrow_t& nothrow) noexcept
+{
+	return operator new(byteCount, nothrow);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+	free(ptr);
+}
+
+namespace graphite
+{
+namespace
+{
+	enum class GRAPH_SHAPE { SNP, INDEL, MULTI_ALLELIC, DENSE_CLUSTER, LARGE_INSERTION };
+
+	static const std::string CHROMOSOME = "bench";
+	static const uint32_t REFERENCE_LENGTH = 60000;
+	static const uint32_t VARIANT_POSITION = 25001; // leaves room for a 10k graph spacing on both sides
+	static const uint32_t MATCH_VALUE = 1;
+	static const uint32_t MISMATCH_VALUE = 4;
+	static const uint32_t GAP_OPEN_VALUE = 6;
+	static const uint32_t GAP_EXTENSION_VALUE = 1;
+
+	std::string randomSequence(std::mt19937& generator, uint32_t length)
+	{
+		static const char BASES[] = "ACGT";
+		std::uniform_int_distribution< int > baseDistribution(0, 3);
+		std::string sequence(length, 'A');
+		for (auto& base : sequence)
+		{
+			base = BASES[baseDistribution(generator)];
+		}
+		return sequence;
+	}
+
+	char otherBase(char base, uint32_t offset)
+	{
+		static const std::string BASES = "ACGT";
+		return BASES[(BASES.find(base) + offset) % BASES.size()];
+	}
+
+	// one random contig written as a FASTA with its index, removed at exit
+	class SyntheticReference
+	{
+	public:
+		SyntheticReference()
+		{
+			char pathTemplate[] = "/tmp/graphite_bench_XXXXXX";
+			int fileDescriptor = mkstemp(pathTemplate);
+			if (fileDescriptor < 0)
+			{
+				std::cout << "Unable to create the benchmark reference" << std::endl;
+				exit(EXIT_FAILURE);
+			}
+			::close(fileDescriptor);
+			this->m_path = pathTemplate;
+			std::mt19937 generator(42);
+			this->m_sequence = randomSequence(generator, REFERENCE_LENGTH);
+			std::string header = ">" + CHROMOSOME + "\n";
+			std::ofstream fastaFile(this->m_path);
+			fastaFile << header << this->m_sequence << "\n";
+			fastaFile.close();
+			std::ofstream indexFile(this->m_path + ".fai"); // one line sequence, so fastahack doesn't index it
+			indexFile << CHROMOSOME << "\t" << this->m_sequence.size() << "\t" << header.size() << "\t" << this->m_sequence.size() << "\t" << this->m_sequence.size() + 1 << "\n";
+			indexFile.close();
+			this->m_fasta_reference_ptr = std::make_shared< FastaReference >(this->m_path);
+		}
+
+		~SyntheticReference()
+		{
+			this->m_fasta_reference_ptr = nullptr;
+			std::remove((this->m_path + ".fai").c_str());
+			std::remove(this->m_path.c_str());
+		}
+
+		FastaReference::SharedPtr getFastaReferencePtr() { return this->m_fasta_reference_ptr; }
+		std::string getSequence(uint32_t position, uint32_t length) { return this->m_sequence.substr(position - 1, length); } // one based
+
+	private:
+		std::string m_path;
+		std::string m_sequence;
+		FastaReference::SharedPtr m_fasta_reference_ptr;
+	};
+
+	SyntheticReference& getReference()
+	{
+		static SyntheticReference reference;
+		return reference;
+	}
+
+	struct SyntheticVariant
+	{
+		uint32_t position;
+		std::string reference;
+		std::vector< std::string > alternates;
+	};
+
+	std::vector< SyntheticVariant > getSyntheticVariants(GRAPH_SHAPE shape)
+	{
+		auto& reference = getReference();
+		std::mt19937 generator(7);
+		std::vector< SyntheticVariant > variants;
+		switch (shape)
+		{
+		case GRAPH_SHAPE::SNP:
+			{
+				std::string referenceBase = reference.getSequence(VARIANT_POSITION, 1);
+				variants.push_back({ VARIANT_POSITION, referenceBase, { std::string(1, otherBase(referenceBase[0], 1)) } });
+				break;
+			}
+		case GRAPH_SHAPE::INDEL: // a 10bp deletion and a 10bp insertion 50bp apart
+			{
+				variants.push_back({ VARIANT_POSITION, reference.getSequence(VARIANT_POSITION, 11), { reference.getSequence(VARIANT_POSITION, 1) } });
+				std::string insertionBase = reference.getSequence(VARIANT_POSITION + 50, 1);
+				variants.push_back({ VARIANT_POSITION + 50, insertionBase, { insertionBase + randomSequence(generator, 10) } });
+				break;
+			}
+		case GRAPH_SHAPE::MULTI_ALLELIC: // the three other bases and a deletion at one site
+			{
+				std::string referenceSequence = reference.getSequence(VARIANT_POSITION, 4);
+				char referenceBase = referenceSequence[0];
+				variants.push_back({ VARIANT_POSITION, referenceSequence, { otherBase(referenceBase, 1) + referenceSequence.substr(1), otherBase(referenceBase, 2) + referenceSequence.substr(1), otherBase(referenceBase, 3) + referenceSequence.substr(1), std::string(1, referenceBase) } });
+				break;
+			}
+		case GRAPH_SHAPE::DENSE_CLUSTER: // 20 SNPs, one every 10bp
+			for (uint32_t i = 0; i < 20; ++i)
+			{
+				uint32_t position = VARIANT_POSITION + (i * 10);
+				std::string referenceBase = reference.getSequence(position, 1);
+				variants.push_back({ position, referenceBase, { std::string(1, otherBase(referenceBase[0], 1 + (i % 3))) } });
+			}
+			break;
+		case GRAPH_SHAPE::LARGE_INSERTION: // 1kb
+			{
+				std::string referenceBase = reference.getSequence(VARIANT_POSITION, 1);
+				variants.push_back({ VARIANT_POSITION, referenceBase, { referenceBase + randomSequence(generator, 1000) } });
+				break;
+			}
+		}
+		return variants;
+	}
+
+	// a read centered on the first variant of the haplotype that carries every first alternate
+	std::string getAlternateRead(const std::vector< SyntheticVariant >& variants, uint32_t readLength)
+	{
+		auto& reference = getReference();
+		uint32_t haplotypeStart = variants.front().position - readLength;
+		std::string haplotype = reference.getSequence(haplotypeStart, readLength);
+		uint32_t referencePosition = variants.front().position;
+		for (auto& variant : variants)
+		{
+			haplotype += reference.getSequence(referencePosition, variant.position - referencePosition);
+			haplotype += variant.alternates.front();
+			referencePosition = variant.position + variant.reference.size();
+		}
+		haplotype += reference.getSequence(referencePosition, readLength);
+		return haplotype.substr(readLength - (readLength / 2), readLength);
+	}
+
+	// packs bases the way htslib stores them in a bam1_t, which is what Alignment decodes
+	std::vector< char > getHTSLibSequence(const std::string& sequence)
+	{
+		std::vector< char > packedSequence((sequence.size() + 1) / 2, 0);
+		for (size_t i = 0; i < sequence.size(); ++i)
+		{
+			packedSequence[i / 2] |= seq_nt16_table[static_cast< unsigned char >(sequence[i])] << ((i % 2 == 0) ? 4 : 0);
+		}
+		return packedSequence;
+	}
+
+	void BM_ProcessGraph(benchmark::State& state, GRAPH_SHAPE shape)
+	{
+		uint32_t readLength = state.range(0);
+		auto variants = getSyntheticVariants(shape);
+		std::vector< Variant::SharedPtr > variantPtrs;
+		for (auto& variant : variants)
+		{
+			variantPtrs.emplace_back(std::make_shared< Variant >(CHROMOSOME, variant.position, variant.reference, variant.alternates));
+		}
+		auto graphPtr = std::make_shared< Graph >(getReference().getFastaReferencePtr(), variantPtrs, readLength, false);
+		uint64_t graphSequenceLength = 0;
+		for (auto& nodeIter : graphPtr->getNodePtrsMap())
+		{
+			graphSequenceLength += nodeIter.second->getSequence().size();
+		}
+
+		std::string read = getAlternateRead(variants, readLength);
+		auto htslibSequence = getHTSLibSequence(read);
+		std::string readName = "read";
+		auto samplePtr = std::make_shared< Sample >("sample", "sample", "sample.bam");
+		auto alignmentPtr = std::make_shared< Alignment >(htslibSequence.data(), read.size(), readName, true, true, 60, samplePtr);
+
+		for (auto _ : state)
+		{
+			GraphTraceback graphTraceback(graphPtr, MATCH_VALUE, MISMATCH_VALUE, GAP_OPEN_VALUE, GAP_EXTENSION_VALUE);
+			graphTraceback.processGraph(alignmentPtr);
+			benchmark::DoNotOptimize(graphTraceback.getTotalScore());
+		}
+
+		double cellCount = static_cast< double >(read.size()) * graphSequenceLength;
+		state.counters["reads_per_second"] = benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+		state.counters["GCUPS"] = benchmark::Counter(state.iterations() * cellCount / 1e9, benchmark::Counter::kIsRate);
+		state.counters["graph_bases"] = graphSequenceLength;
+		graphPtr->clearResources();
+	}
+
+	// a dense cluster's graph and read_count reads of it, made and released the way GraphProcessor does
+	void BM_BuildCluster(benchmark::State& state, bool useArena)
+	{
+		uint32_t readCount = state.range(0);
+		uint32_t readLength = 150;
+		auto variants = getSyntheticVariants(GRAPH_SHAPE::DENSE_CLUSTER);
+		std::vector< Variant::SharedPtr > variantPtrs;
+		for (auto& variant : variants)
+		{
+			variantPtrs.emplace_back(std::make_shared< Variant >(CHROMOSOME, variant.position, variant.reference, variant.alternates));
+		}
+		std::string read = getAlternateRead(variants, readLength);
+		auto htslibSequence = getHTSLibSequence(read);
+		auto samplePtr = std::make_shared< Sample >("sample", "sample", "sample.bam");
+		std::vector< std::string > readNames;
+		for (uint32_t i = 0; i < readCount; ++i)
+		{
+			readNames.emplace_back("read" + std::to_string(i));
+		}
+
+		uint64_t heapAllocationCount = 0;
+		for (auto _ : state)
+		{
+			uint64_t startHeapAllocationCount = s_heap_allocation_count.load(std::memory_order_relaxed);
+			auto arenaPtr = useArena ? std::make_shared< ClusterArena >() : nullptr;
+			auto graphPtr = std::make_shared< Graph >(getReference().getFastaReferencePtr(), variantPtrs, readLength, false, arenaPtr);
+			std::vector< Alignment::SharedPtr > alignmentPtrs;
+			alignmentPtrs.reserve(readCount);
+			for (auto& readName : readNames)
+			{
+				alignmentPtrs.emplace_back(ClusterArena::makeShared< Alignment >(arenaPtr, htslibSequence.data(), read.size(), readName, true, true, 60, samplePtr));
+			}
+			benchmark::DoNotOptimize(alignmentPtrs.data());
+			alignmentPtrs.clear();
+			graphPtr->clearResources();
+			graphPtr = nullptr;
+			arenaPtr = nullptr;
+			heapAllocationCount += s_heap_allocation_count.load(std::memory_order_relaxed) - startHeapAllocationCount;
+		}
+
+		state.counters["heap_allocations"] = static_cast< double >(heapAllocationCount) / state.iterations(); // per cluster
+		state.counters["clusters_per_second"] = benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+	}
+
+	void ReadLengths(benchmark::internal::Benchmark* benchmarkPtr)
+	{
+		for (auto readLength : { 100, 250, 1000, 5000, 10000 })
+		{
+			benchmarkPtr->Arg(readLength);
+		}
+		benchmarkPtr->ArgName("read_length")->Unit(benchmark::kMicrosecond);
+	}
+
+	BENCHMARK_CAPTURE(BM_ProcessGraph, snp, GRAPH_SHAPE::SNP)->Apply(ReadLengths);
+	BENCHMARK_CAPTURE(BM_ProcessGraph, indel, GRAPH_SHAPE::INDEL)->Apply(ReadLengths);
+	BENCHMARK_CAPTURE(BM_ProcessGraph, multi_allelic, GRAPH_SHAPE::MULTI_ALLELIC)->Apply(ReadLengths);
+	BENCHMARK_CAPTURE(BM_ProcessGraph, dense_cluster, GRAPH_SHAPE::DENSE_CLUSTER)->Apply(ReadLengths);
+	BENCHMARK_CAPTURE(BM_ProcessGraph, large_insertion, GRAPH_SHAPE::LARGE_INSERTION)->Apply(ReadLengths);
+	BENCHMARK_CAPTURE(BM_BuildCluster, malloc, false)->Arg(100)->Arg(1000)->ArgName("read_count")->Unit(benchmark::kMicrosecond);
+	BENCHMARK_CAPTURE(BM_BuildCluster, arena, true)->Arg(100)->Arg(1000)->ArgName("read_count")->Unit(benchmark::kMicrosecond);
+}
+}
+
+BENCHMARK_MAIN();
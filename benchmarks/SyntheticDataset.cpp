@@ -0,0 +1,381 @@
+#include "SyntheticDataset.h"
+
+#include "htslib/hts.h"
+#include "htslib/sam.h"
+#include "htslib/kstring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <sys/stat.h>
+
+namespace graphite
+{
+	static const std::string BASES = "ACGT";
+	static const uint32_t FASTA_LINE_WIDTH = 60;
+
+	SyntheticDataset::SyntheticDataset(const Options& options) :
+		m_options(options),
+		m_generator(options.seed),
+		m_variant_count(0),
+		m_read_count(0)
+	{
+	}
+
+	SyntheticDataset::~SyntheticDataset()
+	{
+	}
+
+	bool SyntheticDataset::write(const std::string& directory)
+	{
+		if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+		{
+			std::cout << "Unable to create the output directory: " << directory << std::endl;
+			return false;
+		}
+		std::vector< std::string > contigSequences;
+		std::vector< std::vector< SyntheticVariant > > contigVariants;
+		for (uint32_t contigIndex = 0; contigIndex < this->m_options.contigCount; ++contigIndex)
+		{
+			contigSequences.emplace_back(randomSequence(this->m_options.contigLength));
+			contigVariants.emplace_back(generateVariants(contigSequences.back()));
+		}
+		return writeReference(directory + "/reference.fa", contigSequences) &&
+			writeVariants(directory + "/variants.vcf", contigSequences, contigVariants) &&
+			writeAlignments(directory + "/" + this->m_options.sampleName + ".bam", contigSequences, contigVariants);
+	}
+
+	std::string SyntheticDataset::getContigName(uint32_t contigIndex)
+	{
+		return std::to_string(contigIndex + 1);
+	}
+
+	std::string SyntheticDataset::randomSequence(uint32_t length)
+	{
+		std::uniform_int_distribution< int > baseDistribution(0, 3);
+		std::string sequence(length, 'A');
+		for (auto& base : sequence)
+		{
+			base = BASES[baseDistribution(this->m_generator)];
+		}
+		return sequence;
+	}
+
+	// variants are at least a base apart so none of them overlap
+	std::vector< SyntheticDataset::SyntheticVariant > SyntheticDataset::generateVariants(const std::string& contigSequence)
+	{
+		std::vector< SyntheticVariant > variants;
+		if (this->m_options.variantsPerKilobase <= 0.0)
+		{
+			return variants;
+		}
+		std::exponential_distribution< double > gapDistribution(this->m_options.variantsPerKilobase / 1000.0);
+		std::uniform_real_distribution< double > unitDistribution(0.0, 1.0);
+		std::uniform_int_distribution< uint32_t > indelLengthDistribution(1, std::max< uint32_t >(1, this->m_options.maxIndelLength));
+		std::uniform_int_distribution< uint32_t > svLengthDistribution(this->m_options.minSVLength, std::max(this->m_options.minSVLength, this->m_options.maxSVLength));
+		std::uniform_int_distribution< int > otherBaseDistribution(1, 3);
+		uint64_t nextPosition = 2; // the first base is left as an anchor
+		while (true)
+		{
+			SyntheticVariant variant;
+			uint64_t position = nextPosition + static_cast< uint64_t >(gapDistribution(this->m_generator));
+			double typeValue = unitDistribution(this->m_generator);
+			uint32_t length = 1;
+			if (typeValue < this->m_options.svFraction)
+			{
+				variant.type = "SV";
+				length = svLengthDistribution(this->m_generator);
+			}
+			else if (typeValue < this->m_options.svFraction + this->m_options.indelFraction)
+			{
+				variant.type = "INDEL";
+				length = indelLengthDistribution(this->m_generator);
+			}
+			else
+			{
+				variant.type = "SNV";
+			}
+			bool isDeletion = (variant.type != "SNV") && unitDistribution(this->m_generator) < 0.5;
+			uint32_t referenceLength = (isDeletion) ? length + 1 : 1;
+			if (position + referenceLength > contigSequence.size())
+			{
+				break;
+			}
+			variant.position = position;
+			variant.reference = contigSequence.substr(position - 1, referenceLength);
+			if (variant.type == "SNV")
+			{
+				variant.alternate = std::string(1, BASES[(BASES.find(variant.reference[0]) + otherBaseDistribution(this->m_generator)) % BASES.size()]);
+			}
+			else
+			{
+				variant.alternate = (isDeletion) ? variant.reference.substr(0, 1) : variant.reference + randomSequence(length);
+			}
+			// a third of the variants are homozygous, the rest are on one of the haplotypes
+			double genotypeValue = unitDistribution(this->m_generator);
+			variant.isOnHaplotype[0] = genotypeValue < (2.0 / 3.0);
+			variant.isOnHaplotype[1] = genotypeValue >= (1.0 / 3.0);
+			variants.emplace_back(variant);
+			nextPosition = position + referenceLength + 1;
+		}
+		return variants;
+	}
+
+	SyntheticDataset::Haplotype SyntheticDataset::buildHaplotype(const std::string& contigSequence, const std::vector< SyntheticVariant >& variants, uint32_t haplotypeIndex)
+	{
+		Haplotype haplotype;
+		auto appendSegment = [&haplotype](uint32_t referenceStart, const std::string& sequence, bool isInserted)
+			{
+				if (sequence.size() == 0)
+				{
+					return;
+				}
+				auto& segments = haplotype.segments;
+				if (!isInserted && segments.size() > 0 && !segments.back().isInserted && segments.back().referenceStart + segments.back().length == referenceStart)
+				{
+					segments.back().length += sequence.size();
+				}
+				else
+				{
+					segments.push_back({ haplotype.sequence.size(), referenceStart, static_cast< uint32_t >(sequence.size()), isInserted });
+				}
+				haplotype.sequence += sequence;
+			};
+		uint32_t referencePosition = 0;
+		for (auto& variant : variants)
+		{
+			if (!variant.isOnHaplotype[haplotypeIndex])
+			{
+				continue;
+			}
+			uint32_t variantStart = variant.position - 1;
+			appendSegment(referencePosition, contigSequence.substr(referencePosition, variantStart - referencePosition), false);
+			appendSegment(variantStart, variant.alternate.substr(0, 1), false); // the SNV's base or the indel's anchor
+			appendSegment(variantStart + variant.reference.size(), variant.alternate.substr(1), true);
+			referencePosition = variantStart + variant.reference.size();
+		}
+		appendSegment(referencePosition, contigSequence.substr(referencePosition), false);
+		return haplotype;
+	}
+
+	// false when the read lies within inserted bases and has no reference position
+	bool SyntheticDataset::getRead(const Haplotype& haplotype, uint64_t haplotypeStart, Read& read)
+	{
+		std::vector< std::pair< char, uint32_t > > cigarOperations;
+		auto addOperation = [&cigarOperations](char operation, uint32_t length)
+			{
+				if (cigarOperations.size() > 0 && cigarOperations.back().first == operation)
+				{
+					cigarOperations.back().second += length;
+				}
+				else
+				{
+					cigarOperations.emplace_back(operation, length);
+				}
+			};
+		auto segmentIter = std::upper_bound(haplotype.segments.begin(), haplotype.segments.end(), haplotypeStart, [](uint64_t position, const Segment& segment) { return position < segment.haplotypeStart; });
+		--segmentIter;
+		uint64_t haplotypePosition = haplotypeStart;
+		uint32_t remainingLength = this->m_options.readLength;
+		uint32_t nextReferencePosition = 0;
+		bool isAligned = false;
+		for (; remainingLength > 0 && segmentIter != haplotype.segments.end(); ++segmentIter)
+		{
+			uint32_t offset = haplotypePosition - segmentIter->haplotypeStart;
+			uint32_t length = std::min(segmentIter->length - offset, remainingLength);
+			if (segmentIter->isInserted)
+			{
+				addOperation((isAligned) ? 'I' : 'S', length);
+			}
+			else
+			{
+				uint32_t referencePosition = segmentIter->referenceStart + offset;
+				if (!isAligned)
+				{
+					read.referenceStart = referencePosition;
+					isAligned = true;
+				}
+				else if (referencePosition > nextReferencePosition)
+				{
+					addOperation('D', referencePosition - nextReferencePosition);
+				}
+				addOperation('M', length);
+				nextReferencePosition = referencePosition + length;
+			}
+			haplotypePosition += length;
+			remainingLength -= length;
+		}
+		if (!isAligned)
+		{
+			return false;
+		}
+		if (cigarOperations.back().first == 'I')
+		{
+			cigarOperations.back().first = 'S';
+		}
+		read.cigar = "";
+		for (auto& cigarOperation : cigarOperations)
+		{
+			read.cigar += std::to_string(cigarOperation.second) + cigarOperation.first;
+		}
+		read.sequence = haplotype.sequence.substr(haplotypeStart, this->m_options.readLength);
+		if (this->m_options.errorRate > 0.0)
+		{
+			std::geometric_distribution< uint32_t > errorDistanceDistribution(std::min(this->m_options.errorRate, 1.0));
+			std::uniform_int_distribution< int > otherBaseDistribution(1, 3);
+			for (uint32_t i = errorDistanceDistribution(this->m_generator); i < read.sequence.size(); i += 1 + errorDistanceDistribution(this->m_generator))
+			{
+				read.sequence[i] = BASES[(BASES.find(read.sequence[i]) + otherBaseDistribution(this->m_generator)) % BASES.size()];
+			}
+		}
+		read.isReverseStrand = std::uniform_int_distribution< int >(0, 1)(this->m_generator) == 1;
+		return true;
+	}
+
+	bool SyntheticDataset::writeReference(const std::string& path, const std::vector< std::string >& contigSequences)
+	{
+		std::ofstream fastaFile(path);
+		std::ofstream indexFile(path + ".fai");
+		uint64_t byteOffset = 0;
+		for (uint32_t contigIndex = 0; contigIndex < contigSequences.size(); ++contigIndex)
+		{
+			auto& contigSequence = contigSequences[contigIndex];
+			std::string header = ">" + getContigName(contigIndex) + "\n";
+			fastaFile << header;
+			byteOffset += header.size();
+			indexFile << getContigName(contigIndex) << "\t" << contigSequence.size() << "\t" << byteOffset << "\t" << FASTA_LINE_WIDTH << "\t" << FASTA_LINE_WIDTH + 1 << "\n";
+			for (size_t i = 0; i < contigSequence.size(); i += FASTA_LINE_WIDTH)
+			{
+				std::string line = contigSequence.substr(i, FASTA_LINE_WIDTH);
+				fastaFile << line << "\n";
+				byteOffset += line.size() + 1;
+			}
+		}
+		fastaFile.close();
+		indexFile.close();
+		if (!fastaFile || !indexFile)
+		{
+			std::cout << "Unable to write the reference: " << path << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	bool SyntheticDataset::writeVariants(const std::string& path, const std::vector< std::string >& contigSequences, const std::vector< std::vector< SyntheticVariant > >& contigVariants)
+	{
+		std::ofstream vcfFile(path);
+		vcfFile << "##fileformat=VCFv4.2\n";
+		vcfFile << "##source=graphite_simulate\n";
+		vcfFile << "##reference=reference.fa\n";
+		for (uint32_t contigIndex = 0; contigIndex < contigSequences.size(); ++contigIndex)
+		{
+			vcfFile << "##contig=<ID=" << getContigName(contigIndex) << ",length=" << contigSequences[contigIndex].size() << ">\n";
+		}
+		vcfFile << "##INFO=<ID=SIMTYPE,Number=1,Type=String,Description=\"Simulated variant type: SNV, INDEL or SV\">\n";
+		vcfFile << "##INFO=<ID=SIMGT,Number=1,Type=String,Description=\"Genotype of the simulated sample\">\n";
+		vcfFile << "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\n";
+		for (uint32_t contigIndex = 0; contigIndex < contigVariants.size(); ++contigIndex)
+		{
+			for (auto& variant : contigVariants[contigIndex])
+			{
+				std::string genotype = std::string((variant.isOnHaplotype[0]) ? "1" : "0") + "|" + ((variant.isOnHaplotype[1]) ? "1" : "0");
+				vcfFile << getContigName(contigIndex) << "\t" << variant.position << "\t.\t" << variant.reference << "\t" << variant.alternate << "\t.\tPASS\tSIMTYPE=" << variant.type << ";SIMGT=" << genotype << "\n";
+				++this->m_variant_count;
+			}
+		}
+		vcfFile.close();
+		if (!vcfFile)
+		{
+			std::cout << "Unable to write the variants: " << path << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// reads are drawn from each haplotype in position order and the two are merged, so they never have to be sorted
+	bool SyntheticDataset::writeAlignments(const std::string& path, const std::vector< std::string >& contigSequences, const std::vector< std::vector< SyntheticVariant > >& contigVariants)
+	{
+		std::string headerText = "@HD\tVN:1.4\tSO:coordinate\n";
+		for (uint32_t contigIndex = 0; contigIndex < contigSequences.size(); ++contigIndex)
+		{
+			headerText += "@SQ\tSN:" + getContigName(contigIndex) + "\tLN:" + std::to_string(contigSequences[contigIndex].size()) + "\n";
+		}
+		headerText += "@RG\tID:" + this->m_options.sampleName + "\tSM:" + this->m_options.sampleName + "\n";
+		headerText += "@PG\tID:graphite_simulate\tPN:graphite_simulate\n";
+
+		htsFile* outFile = hts_open(path.c_str(), "wb");
+		if (outFile == nullptr)
+		{
+			std::cout << "Unable to write the alignments: " << path << std::endl;
+			return false;
+		}
+		bam_hdr_t* header = sam_hdr_parse(headerText.size(), headerText.c_str());
+		if (header->text == nullptr) // older htslib leaves the text to the caller
+		{
+			header->l_text = headerText.size();
+			header->text = strdup(headerText.c_str());
+		}
+		bool isWritten = sam_hdr_write(outFile, header) >= 0;
+		bam1_t* alignmentPtr = bam_init1();
+		std::string quality(this->m_options.readLength, '?'); // Q30
+		double meanReadSpacing = (2.0 * this->m_options.readLength) / std::max(this->m_options.coverage, 1e-9); // each haplotype holds half the coverage
+		std::exponential_distribution< double > readSpacingDistribution(1.0 / meanReadSpacing);
+		for (uint32_t contigIndex = 0; isWritten && contigIndex < contigSequences.size(); ++contigIndex)
+		{
+			std::string contigName = getContigName(contigIndex);
+			Haplotype haplotypes[2] = { buildHaplotype(contigSequences[contigIndex], contigVariants[contigIndex], 0), buildHaplotype(contigSequences[contigIndex], contigVariants[contigIndex], 1) };
+			double nextStarts[2] = { readSpacingDistribution(this->m_generator), readSpacingDistribution(this->m_generator) };
+			Read pendingReads[2];
+			bool hasPendingRead[2] = { false, false };
+			auto drawRead = [&](uint32_t haplotypeIndex)
+				{
+					auto& haplotype = haplotypes[haplotypeIndex];
+					while (haplotype.sequence.size() >= this->m_options.readLength && nextStarts[haplotypeIndex] <= haplotype.sequence.size() - this->m_options.readLength)
+					{
+						uint64_t haplotypeStart = static_cast< uint64_t >(nextStarts[haplotypeIndex]);
+						nextStarts[haplotypeIndex] += readSpacingDistribution(this->m_generator);
+						if (getRead(haplotype, haplotypeStart, pendingReads[haplotypeIndex]))
+						{
+							return true;
+						}
+					}
+					return false;
+				};
+			hasPendingRead[0] = drawRead(0);
+			hasPendingRead[1] = drawRead(1);
+			uint64_t contigReadCount = 0;
+			while (isWritten && (hasPendingRead[0] || hasPendingRead[1]))
+			{
+				uint32_t haplotypeIndex = (!hasPendingRead[1] || (hasPendingRead[0] && pendingReads[0].referenceStart <= pendingReads[1].referenceStart)) ? 0 : 1;
+				auto& read = pendingReads[haplotypeIndex];
+				std::string samLine = contigName + "_" + std::to_string(++contigReadCount) + "\t" + ((read.isReverseStrand) ? "16" : "0") + "\t" + contigName + "\t" + std::to_string(read.referenceStart + 1) + "\t60\t" + read.cigar + "\t*\t0\t0\t" + read.sequence + "\t" + quality + "\tRG:Z:" + this->m_options.sampleName;
+				kstring_t samString;
+				samString.l = samLine.size();
+				samString.m = samLine.size() + 1;
+				samString.s = &samLine[0];
+				isWritten = sam_parse1(&samString, header, alignmentPtr) >= 0 && sam_write1(outFile, header, alignmentPtr) >= 0;
+				++this->m_read_count;
+				hasPendingRead[haplotypeIndex] = drawRead(haplotypeIndex);
+			}
+		}
+		bam_destroy1(alignmentPtr);
+		bam_hdr_destroy(header);
+		isWritten = (hts_close(outFile) == 0) && isWritten;
+		if (!isWritten)
+		{
+			std::cout << "Unable to write the alignments: " << path << std::endl;
+			return false;
+		}
+		if (sam_index_build(path.c_str(), 0) != 0)
+		{
+			std::cout << "Unable to index the alignments: " << path << std::endl;
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,104 @@
+#ifndef GRAPHITE_SYNTHETICDATASET_H
+#define GRAPHITE_SYNTHETICDATASET_H
+
+#include "core/util/Noncopyable.hpp"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace graphite
+{
+	/*
+	 * Writes a reproducible graphite input that doesn't depend on real data:
+	 * a random reference (reference.fa and its .fai), a sites VCF of SNVs,
+	 * indels and SVs (variants.vcf) and a coordinate sorted, indexed BAM
+	 * of one sample (sample.bam and its .bai). The sample carries every
+	 * variant on one or both of its haplotypes, the truth is in the SIMGT
+	 * INFO field. Reads are single ended, drawn uniformly from the two
+	 * haplotypes and placed where they came from on the reference with a
+	 * CIGAR that spells out the variants they cross, so graphite fetches
+	 * them as it would reads from an aligner. The same options and seed
+	 * always write the same files.
+	 */
+	class SyntheticDataset : private Noncopyable
+	{
+	public:
+		typedef std::shared_ptr< SyntheticDataset > SharedPtr;
+
+		struct Options
+		{
+			uint32_t contigCount = 1;
+			uint32_t contigLength = 1000000;
+			double variantsPerKilobase = 1.0;
+			double indelFraction = 0.15; // of the variants, the rest that aren't SVs are SNVs
+			double svFraction = 0.05;
+			uint32_t maxIndelLength = 10;
+			uint32_t minSVLength = 50;
+			uint32_t maxSVLength = 1000;
+			double coverage = 30.0;
+			uint32_t readLength = 150;
+			double errorRate = 0.001; // substitutions per base
+			uint32_t seed = 1;
+			std::string sampleName = "sample";
+		};
+
+		SyntheticDataset(const Options& options);
+		~SyntheticDataset();
+
+		bool write(const std::string& directory);
+
+		uint64_t getVariantCount() { return this->m_variant_count; }
+		uint64_t getReadCount() { return this->m_read_count; }
+
+	private:
+		struct SyntheticVariant
+		{
+			uint32_t position; // one based
+			std::string reference;
+			std::string alternate;
+			std::string type;
+			bool isOnHaplotype[2];
+		};
+
+		// a stretch of a haplotype, either reference bases or bases a variant inserted
+		struct Segment
+		{
+			uint64_t haplotypeStart;
+			uint32_t referenceStart; // zero based, the reference base that follows for inserted bases
+			uint32_t length;
+			bool isInserted;
+		};
+
+		struct Haplotype
+		{
+			std::string sequence;
+			std::vector< Segment > segments;
+		};
+
+		struct Read
+		{
+			uint32_t referenceStart; // zero based
+			std::string cigar;
+			std::string sequence;
+			bool isReverseStrand;
+		};
+
+		std::string getContigName(uint32_t contigIndex);
+		std::string randomSequence(uint32_t length);
+		std::vector< SyntheticVariant > generateVariants(const std::string& contigSequence);
+		Haplotype buildHaplotype(const std::string& contigSequence, const std::vector< SyntheticVariant >& variants, uint32_t haplotypeIndex);
+		bool getRead(const Haplotype& haplotype, uint64_t haplotypeStart, Read& read);
+		bool writeReference(const std::string& path, const std::vector< std::string >& contigSequences);
+		bool writeVariants(const std::string& path, const std::vector< std::string >& contigSequences, const std::vector< std::vector< SyntheticVariant > >& contigVariants);
+		bool writeAlignments(const std::string& path, const std::vector< std::string >& contigSequences, const std::vector< std::vector< SyntheticVariant > >& contigVariants);
+
+		Options m_options;
+		std::mt19937_64 m_generator;
+		uint64_t m_variant_count;
+		uint64_t m_read_count;
+	};
+}
+
+#endif //GRAPHITE_SYNTHETICDATASET_H
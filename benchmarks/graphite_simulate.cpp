@@ -0,0 +1,60 @@
+#include "SyntheticDataset.h"
+
+#include <cxxopts.hpp>
+
+#include <iostream>
+
+int main(int argc, char** argv)
+{
+	cxxopts::Options options("graphite_simulate", "Writes a synthetic reference, VCF and BAM for benchmarking graphite");
+	options.add_options()
+		("h,help", "Print help message")
+		("o,output_directory", "Directory the reference.fa, variants.vcf and <sample>.bam are written to", cxxopts::value< std::string >())
+		("contigs", "Number of contigs [optional - default is 1]", cxxopts::value< uint32_t >()->default_value("1"))
+		("contig_length", "Length of every contig [optional - default is 1000000]", cxxopts::value< uint32_t >()->default_value("1000000"))
+		("density", "Variants per kilobase [optional - default is 1]", cxxopts::value< double >()->default_value("1"))
+		("indel_fraction", "Fraction of the variants that are indels [optional - default is 0.15]", cxxopts::value< double >()->default_value("0.15"))
+		("sv_fraction", "Fraction of the variants that are SVs, the rest are SNVs [optional - default is 0.05]", cxxopts::value< double >()->default_value("0.05"))
+		("max_indel_length", "Longest indel [optional - default is 10]", cxxopts::value< uint32_t >()->default_value("10"))
+		("min_sv_length", "Shortest SV [optional - default is 50]", cxxopts::value< uint32_t >()->default_value("50"))
+		("max_sv_length", "Longest SV [optional - default is 1000]", cxxopts::value< uint32_t >()->default_value("1000"))
+		("coverage", "Read coverage of the sample [optional - default is 30]", cxxopts::value< double >()->default_value("30"))
+		("read_length", "Read length [optional - default is 150]", cxxopts::value< uint32_t >()->default_value("150"))
+		("error_rate", "Substitution errors per read base [optional - default is 0.001]", cxxopts::value< double >()->default_value("0.001"))
+		("sample", "Sample name [optional - default is sample]", cxxopts::value< std::string >()->default_value("sample"))
+		("seed", "Random seed, the same seed and options write the same files [optional - default is 1]", cxxopts::value< uint32_t >()->default_value("1"));
+	options.parse(argc, argv);
+	if (options.count("h") || !options.count("o"))
+	{
+		std::cout << options.help() << std::endl;
+		return options.count("h") ? 0 : 1;
+	}
+
+	graphite::SyntheticDataset::Options datasetOptions;
+	datasetOptions.contigCount = options["contigs"].as< uint32_t >();
+	datasetOptions.contigLength = options["contig_length"].as< uint32_t >();
+	datasetOptions.variantsPerKilobase = options["density"].as< double >();
+	datasetOptions.indelFraction = options["indel_fraction"].as< double >();
+	datasetOptions.svFraction = options["sv_fraction"].as< double >();
+	datasetOptions.maxIndelLength = options["max_indel_length"].as< uint32_t >();
+	datasetOptions.minSVLength = options["min_sv_length"].as< uint32_t >();
+	datasetOptions.maxSVLength = options["max_sv_length"].as< uint32_t >();
+	datasetOptions.coverage = options["coverage"].as< double >();
+	datasetOptions.readLength = options["read_length"].as< uint32_t >();
+	datasetOptions.errorRate = options["error_rate"].as< double >();
+	datasetOptions.sampleName = options["sample"].as< std::string >();
+	datasetOptions.seed = options["seed"].as< uint32_t >();
+	if (datasetOptions.readLength == 0 || datasetOptions.readLength > datasetOptions.contigLength)
+	{
+		std::cout << "The read length must be between 1 and the contig length" << std::endl;
+		return 1;
+	}
+
+	graphite::SyntheticDataset dataset(datasetOptions);
+	if (!dataset.write(options["o"].as< std::string >()))
+	{
+		return 1;
+	}
+	std::cout << "Wrote " << dataset.getVariantCount() << " variants and " << dataset.getReadCount() << " reads to " << options["o"].as< std::string >() << std::endl;
+	return 0;
+}
@@ -2,11 +2,14 @@
 
 #include "htslib/sam.h"
 
+#include <cstring>
+
 namespace graphite
 {
-	Alignment::Alignment(char* htslibSeq, uint32_t len, std::string& readName, bool forwardStrand, bool firstMate, uint16_t mapQuality, Sample::SharedPtr samplePtr) : m_len(len), m_read_name(readName), m_is_forward_strand(forwardStrand), m_is_first_mate(firstMate), m_map_quality(mapQuality), m_sample_ptr(samplePtr)
+	Alignment::Alignment(char* htslibSeq, uint32_t len, std::string& readName, bool forwardStrand, bool firstMate, uint16_t mapQuality, Sample::SharedPtr samplePtr) : m_len(len), m_read_name(readName), m_is_forward_strand(forwardStrand), m_is_first_mate(firstMate), m_map_quality(mapQuality), m_sample_ptr(samplePtr), m_memory_tally(MemoryAccounting::SUBSYSTEM::ALIGNMENTS)
 	{
 		m_unique_read_name = (m_read_name) + std::to_string(firstMate);
+		m_memory_tally.add(sizeof(Alignment) + m_len + 1 + m_read_name.size() + m_unique_read_name.size());
 
 		this->m_seq = (char*)malloc(len+1);
 		int n;
@@ -17,6 +20,15 @@ namespace graphite
 		this->m_seq[n] = 0;
 	}
 
+	Alignment::Alignment(const std::string& sequence, const std::string& readName, bool forwardStrand, bool firstMate, uint16_t mapQuality, Sample::SharedPtr samplePtr) : m_len(sequence.size()), m_read_name(readName), m_is_forward_strand(forwardStrand), m_is_first_mate(firstMate), m_map_quality(mapQuality), m_sample_ptr(samplePtr), m_memory_tally(MemoryAccounting::SUBSYSTEM::ALIGNMENTS)
+	{
+		m_unique_read_name = (m_read_name) + std::to_string(firstMate);
+		m_memory_tally.add(sizeof(Alignment) + m_len + 1 + m_read_name.size() + m_unique_read_name.size());
+
+		this->m_seq = (char*)malloc(m_len+1);
+		memcpy(this->m_seq, sequence.c_str(), m_len + 1);
+	}
+
 	Alignment::~Alignment()
 	{
 		free(this->m_seq);
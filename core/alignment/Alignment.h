@@ -2,6 +2,7 @@
 
 #include "core/util/Noncopyable.hpp"
 #include "core/sample/Sample.h"
+#include "core/util/MemoryAccounting.h"
 
 #include <string>
 #include <memory>
@@ -13,6 +14,7 @@ namespace graphite
 	public:
 		typedef std::shared_ptr< Alignment > SharedPtr;
 		Alignment(char* htslibSeq, uint32_t len, std::string& readName, bool isForwardStrand, bool isFirstMate, uint16_t mapQuality, Sample::SharedPtr samplePtr);
+		Alignment(const std::string& sequence, const std::string& readName, bool isForwardStrand, bool isFirstMate, uint16_t mapQuality, Sample::SharedPtr samplePtr); // for reads that don't come from htslib
 		~Alignment();
 
 		char* getSequence() { return this->m_seq; }
@@ -33,5 +35,6 @@ namespace graphite
 		bool m_is_first_mate;
 		uint16_t m_map_quality;
 		Sample::SharedPtr m_sample_ptr;
+		MemoryAccounting::Tally m_memory_tally;
 	};
 }
@@ -5,27 +5,122 @@
 #include "cram/cram.h"
 #include "cram/cram_io.h"
 
+#include <algorithm>
+#include <cstdlib>
+
 namespace graphite
 {
+	static const size_t OPEN_FILE_RESERVE = 256; // files that aren't alignments (VCFs, outputs, the reference) when the handle limit is derived
+
+	std::mutex AlignmentReader::s_open_readers_mutex;
+	std::condition_variable AlignmentReader::s_reader_released_condition;
+	std::list< AlignmentReader* > AlignmentReader::s_open_reader_ptrs;
+	size_t AlignmentReader::s_max_open_reader_count = 512;
+
 	// Example from here: https://www.biostars.org/p/151053/
-	AlignmentReader::AlignmentReader(const std::string& filename, const std::string& refPath) : m_path(filename), m_overwrite_sample("")
+	AlignmentReader::AlignmentReader(const std::string& filename, const std::string& refPath) :
+		m_in(nullptr),
+		m_header(nullptr),
+		m_idx(nullptr),
+		m_ref_path(refPath),
+		m_has_handle(false),
+		m_in_use(false),
+		m_overwrite_sample(""),
+		m_path(filename)
+	{
+		acquireHandle();
+		this->init();
+		releaseHandle();
+	}
+
+	AlignmentReader::~AlignmentReader()
+	{
+		std::lock_guard< std::mutex > lock(s_open_readers_mutex);
+		if (this->m_has_handle)
+		{
+			s_open_reader_ptrs.erase(this->m_open_reader_iter);
+			closeHandle();
+			s_reader_released_condition.notify_all();
+		}
+	}
+
+	void AlignmentReader::setMaxOpenReaderCount(size_t maxOpenReaderCount)
+	{
+		std::lock_guard< std::mutex > lock(s_open_readers_mutex);
+		s_max_open_reader_count = (maxOpenReaderCount > 0) ? maxOpenReaderCount : 1;
+	}
+
+	// as many handles as the open file limit leaves room for, after raising it as far as we are allowed
+	size_t AlignmentReader::getDefaultMaxOpenReaderCount()
+	{
+		uint64_t openFileLimit = raiseOpenFileLimit(1 << 20);
+		return (openFileLimit > 2 * OPEN_FILE_RESERVE) ? openFileLimit - OPEN_FILE_RESERVE : openFileLimit / 2;
+	}
+
+	// makes sure this reader has an open handle, closing the least recently used idle reader when we are at the limit
+	void AlignmentReader::acquireHandle()
+	{
+		std::unique_lock< std::mutex > lock(s_open_readers_mutex);
+		if (this->m_has_handle)
+		{
+			s_open_reader_ptrs.splice(s_open_reader_ptrs.begin(), s_open_reader_ptrs, this->m_open_reader_iter);
+			this->m_in_use = true;
+			return;
+		}
+		while (s_open_reader_ptrs.size() >= s_max_open_reader_count)
+		{
+			auto idleReaderIter = std::find_if(s_open_reader_ptrs.rbegin(), s_open_reader_ptrs.rend(), [](AlignmentReader* readerPtr) { return !readerPtr->m_in_use; });
+			if (idleReaderIter == s_open_reader_ptrs.rend())
+			{
+				s_reader_released_condition.wait(lock); // every handle is fetching
+				continue;
+			}
+			AlignmentReader* idleReaderPtr = *idleReaderIter;
+			s_open_reader_ptrs.erase(idleReaderPtr->m_open_reader_iter);
+			idleReaderPtr->m_has_handle = false;
+			idleReaderPtr->closeHandle();
+		}
+		s_open_reader_ptrs.emplace_front(this);
+		this->m_open_reader_iter = s_open_reader_ptrs.begin();
+		this->m_has_handle = true;
+		this->m_in_use = true; // nobody closes the handle while it is opened
+		lock.unlock();
+		openHandle();
+	}
+
+	void AlignmentReader::releaseHandle()
+	{
+		std::lock_guard< std::mutex > lock(s_open_readers_mutex);
+		this->m_in_use = false;
+		s_reader_released_condition.notify_all();
+	}
+
+	void AlignmentReader::openHandle()
 	{
 		m_in = hts_open(m_path.c_str(), "r");
+		if (m_in == NULL)
+		{
+			std::cout << "Unable to open alignment file: " << m_path << std::endl;
+			exit(EXIT_FAILURE);
+		}
 		m_header = sam_hdr_read(m_in);
-		hts_set_fai_filename(m_in, refPath.c_str());
+		hts_set_fai_filename(m_in, m_ref_path.c_str());
 		this->m_idx = sam_index_load(m_in, this->m_path.c_str());
 		if (this->m_idx == NULL)
 		{
 			std::cout << "An error occurred while attempting to load sam/bam/cram index file. Please check to make sure index exists and is valid" << std::endl;
 			exit(0);
 		}
-		this->init();
 	}
 
-	AlignmentReader::~AlignmentReader()
+	void AlignmentReader::closeHandle()
 	{
-		bam_hdr_destroy(m_header);
-		hts_close(m_in);
+		hts_idx_destroy(this->m_idx);
+		bam_hdr_destroy(this->m_header);
+		hts_close(this->m_in);
+		this->m_idx = nullptr;
+		this->m_header = nullptr;
+		this->m_in = nullptr;
 	}
 
 	void AlignmentReader::init()
@@ -90,6 +185,7 @@ namespace graphite
 		{
 			hts_itr_t* iter = sam_itr_querys(m_idx, m_header, region.c_str());
 			auto isSet = sam_itr_next(m_in, iter, alignmentPtr);
+			sam_itr_destroy(iter);
 			if (isSet > 0)
 			{
 				this->m_read_length = alignmentPtr->core.l_qseq;
@@ -104,8 +200,9 @@ namespace graphite
 		bam_destroy1(alignmentPtr);
 	}
 
-	void AlignmentReader::fetchAlignmentPtrsInRegion(std::vector< std::shared_ptr< Alignment > >& alignmentPtrs, Region::SharedPtr regionPtr, bool unmappedOnly, bool includeDuplicateReads, int32_t mappingQuality)
+	void AlignmentReader::fetchAlignmentPtrsInRegion(std::vector< std::shared_ptr< Alignment > >& alignmentPtrs, Region::SharedPtr regionPtr, bool unmappedOnly, bool includeDuplicateReads, int32_t mappingQuality, ClusterArena::SharedPtr arenaPtr)
 	{
+		acquireHandle();
 		bam1_t* htsAlignmentPtr = bam_init1();
 		hts_itr_t* iter = sam_itr_querys(this->m_idx, m_header, regionPtr->getRegionString().c_str());
 
@@ -136,13 +233,13 @@ namespace graphite
 				continue;
 			}
 
-			auto alignmentPtr = std::make_shared< Alignment >((char*)bam_get_seq(htsAlignmentPtr), htsAlignmentPtr->core.l_qseq, readName, forwardStrand, firstMate, mapQuality, iter->second);
+			auto alignmentPtr = ClusterArena::makeShared< Alignment >(arenaPtr, (char*)bam_get_seq(htsAlignmentPtr), htsAlignmentPtr->core.l_qseq, readName, forwardStrand, firstMate, mapQuality, iter->second);
 			alignmentPtrs.emplace_back(alignmentPtr);
 		}
 
 		sam_itr_destroy(iter);
 		bam_destroy1(htsAlignmentPtr);
-
+		releaseHandle();
 	}
 
 	void AlignmentReader::overwriteSample(Sample::SharedPtr samplePtr)
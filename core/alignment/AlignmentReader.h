@@ -3,6 +3,7 @@
 #include "core/util/Noncopyable.hpp"
 #include "core/region/Region.h"
 #include "core/sample/Sample.h"
+#include "core/util/ClusterArena.hpp"
 #include "Alignment.h"
 
 #include "htslib/sam.h"
@@ -12,6 +13,9 @@
 
 #include <string>
 #include <unordered_map>
+#include <list>
+#include <mutex>
+#include <condition_variable>
 
 namespace graphite
 {
@@ -24,21 +28,38 @@ namespace graphite
 
 		void overwriteSample(Sample::SharedPtr samplePtr);
         bool shouldOverwriteSample() { return m_overwrite_sample.size() > 0; }
-        void fetchAlignmentPtrsInRegion(std::vector< std::shared_ptr< Alignment > >& alignmentPtrs, Region::SharedPtr regionPtr, bool unmappedOnly, bool includeDuplicateReads, int32_t mappingQuality);
+        void fetchAlignmentPtrsInRegion(std::vector< std::shared_ptr< Alignment > >& alignmentPtrs, Region::SharedPtr regionPtr, bool unmappedOnly, bool includeDuplicateReads, int32_t mappingQuality, ClusterArena::SharedPtr arenaPtr = nullptr);
 		std::unordered_map< std::string, Sample::SharedPtr > getSamplePtrs() { return this->m_sample_ptrs; }
 		uint32_t getReadLength() { return this->m_read_length; }
 
+		static void setMaxOpenReaderCount(size_t maxOpenReaderCount);
+		static size_t getDefaultMaxOpenReaderCount();
+
 	private:
 		void init();
 		void setReadLength();
+		void acquireHandle();
+		void releaseHandle();
+		void openHandle();
+		void closeHandle();
 
 		htsFile* m_in;
 		bam_hdr_t* m_header;
 		hts_idx_t* m_idx;
+		std::string m_ref_path;
+		bool m_has_handle; // holds a place in s_open_reader_ptrs
+		bool m_in_use;
+		std::list< AlignmentReader* >::iterator m_open_reader_iter;
 		uint32_t m_read_length;
 		std::string m_overwrite_sample;
 		std::string m_path;
 		std::unordered_map< std::string, Sample::SharedPtr > m_sample_ptrs;
 		std::vector< std::string > m_available_regions;
+
+		// the handles of all readers are shared out least recently used first so thousands of BAMs stay under the open file limit
+		static std::mutex s_open_readers_mutex;
+		static std::condition_variable s_reader_released_condition;
+		static std::list< AlignmentReader* > s_open_reader_ptrs; // most recently used first
+		static size_t s_max_open_reader_count;
     };
 }
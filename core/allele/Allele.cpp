@@ -4,8 +4,11 @@
 
 namespace graphite
 {
+	static const size_t TABLE_ENTRY_BYTES = 32; // a hash table node's pointer and hash and its share of the buckets
+
 	Allele::Allele(const std::string& sequence) :
-		m_sequence(sequence)
+		m_sequence(sequence),
+		m_memory_tally(MemoryAccounting::SUBSYSTEM::ALLELES, sizeof(Allele) + sequence.size())
 	{
 	}
 
@@ -16,55 +19,43 @@ namespace graphite
 	void Allele::incrementScoreCount(Alignment::SharedPtr alignmentPtr, int score)
 	{
 		bool isForwardStrand = alignmentPtr->getIsForwardStrand();
-		// static std::mutex slock;
-		// std::lock_guard< std::mutex > lg(slock);
 		size_t alleleCountType = (size_t)scoreToAlleleCountType(score);
 		if (score < 0)
 		{
 			alleleCountType = (size_t)AlleleCountType::Ambiguous;
 		}
-		auto samplePtr = alignmentPtr->getSample();
+		size_t countIndex = (2 * alleleCountType) + ((isForwardStrand) ? 0 : 1);
+		uint32_t sampleIndex = alignmentPtr->getSample()->getIndex();
 		std::lock_guard< std::mutex > l(m_counts_lock);
-		std::unordered_map< std::string, std::vector< std::unordered_set< std::string > > >* counts = (isForwardStrand) ? &this->m_forward_counts : &this->m_reverse_counts;
 		for (auto allelePtr : this->m_paired_allele_ptrs)
 		{
 			allelePtr->incrementScoreCount(alignmentPtr, score);
 		}
 
-		auto sampleName = samplePtr->getName();
-		auto iter = counts->find(sampleName);
-		if (iter == counts->end())
+		// we are using readname so reads aren't counted more than once when we do the traceback and trackback through more than one reference node
+		// (we actually want to double-count an alignment if it spans 2 breakpoints (forward-revers strand))
+		std::string countedRead = alignmentPtr->getReadName();
+		countedRead.push_back('\0');
+		countedRead.push_back((char)countIndex);
+		countedRead.append(reinterpret_cast< const char* >(&sampleIndex), sizeof(sampleIndex));
+		size_t countedReadByteCount = TABLE_ENTRY_BYTES + sizeof(std::string) + countedRead.size();
+		if (!this->m_counted_reads.emplace(std::move(countedRead)).second)
 		{
-			std::vector< std::unordered_set< std::string > > sampleCounts((uint32_t)AlleleCountType::EndEnum);
-			counts->emplace(sampleName, sampleCounts);
-			iter = counts->find(sampleName);
+			return;
 		}
-		auto alignmentName = alignmentPtr->getReadName(); // we actually want to double-count an alignment if it spans 2 breakpoints (forward-revers strand)
-		// std::string alignmentName = alignmentPtr->getUniqueReadName();
-		auto readCounts = iter->second;
-		(*counts)[sampleName][alleleCountType].emplace(alignmentName); // we are using readname so reads aren't counted more than once when we do the traceback and trackback through more than one reference node
+		size_t sampleCount = this->m_sample_counts.size();
+		++this->m_sample_counts[sampleIndex][countIndex]; // a new entry starts at zero
+		this->m_memory_tally.add(countedReadByteCount + ((this->m_sample_counts.size() > sampleCount) ? TABLE_ENTRY_BYTES + sizeof(SampleCounts) : 0));
 	}
 
-	std::unordered_set< std::string > Allele::getScoreCountFromAlleleCountType(const std::string& sampleName, AlleleCountType alleleCountType, bool forwardCount)
+	uint32_t Allele::getScoreCount(uint32_t sampleIndex, AlleleCountType alleleCountType, bool forwardCount)
 	{
-		if (forwardCount)
-		{
-			auto iter = this->m_forward_counts.find(sampleName);
-			if (iter != this->m_forward_counts.end())
-			{
-				return (iter->second)[(size_t)alleleCountType];
-			}
-		}
-		else
+		auto iter = this->m_sample_counts.find(sampleIndex);
+		if (iter == this->m_sample_counts.end())
 		{
-			auto iter = this->m_reverse_counts.find(sampleName);
-			if (iter != this->m_reverse_counts.end())
-			{
-				return this->m_reverse_counts[sampleName][(size_t)alleleCountType];
-			}
+			return 0;
 		}
-		std::unordered_set< std::string > emptyValue;
-		return emptyValue;
+		return iter->second[(2 * (size_t)alleleCountType) + ((forwardCount) ? 0 : 1)];
 	}
 
 	void Allele::pairAllele(Allele::SharedPtr allelePtr)
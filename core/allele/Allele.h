@@ -4,9 +4,11 @@
 #include "core/util/Noncopyable.hpp"
 #include "core/sample/Sample.h"
 #include "core/util/Types.h"
+#include "core/util/MemoryAccounting.h"
 #include "core/alignment/Alignment.h"
 
 #include <memory>
+#include <array>
 #include <mutex>
 #include <unordered_map>
 #include <unordered_set>
@@ -19,7 +21,8 @@ namespace graphite
 	public:
 		typedef std::shared_ptr< SupportingReadInfo > SharedPtr;
 	    SupportingReadInfo(const std::string& sampleName, const std::string& readName, const std::string& mateReadName, const std::string& cigarString, int nodeScore, int tracebackScore) :
-    		m_sample_name(sampleName), m_read_name(readName), m_mate_read_name(mateReadName), m_cigar_string(cigarString), m_node_score(nodeScore), m_traceback_score(tracebackScore)
+    		m_sample_name(sampleName), m_read_name(readName), m_mate_read_name(mateReadName), m_cigar_string(cigarString), m_node_score(nodeScore), m_traceback_score(tracebackScore),
+			m_memory_tally(MemoryAccounting::SUBSYSTEM::SUPPORTING_READS, sizeof(SupportingReadInfo) + sampleName.size() + readName.size() + mateReadName.size() + cigarString.size())
 		{
 		}
 
@@ -33,6 +36,7 @@ namespace graphite
 		std::string m_cigar_string;
 		int m_node_score;
 		int m_traceback_score;
+		MemoryAccounting::Tally m_memory_tally;
 	};
 
 	class Allele : private Noncopyable
@@ -46,13 +50,13 @@ namespace graphite
 		/* void registerNodePtr(std::shared_ptr< Node > nodePtr); */
 		/* std::shared_ptr< Node > getNodePtr(); */
         void incrementScoreCount(Alignment::SharedPtr, int score);
-        std::unordered_set< std::string > getScoreCountFromAlleleCountType(const std::string& sampleName, AlleleCountType alleleCountType, bool forwardCount);
+		uint32_t getScoreCount(uint32_t sampleIndex, AlleleCountType alleleCountType, bool forwardCount);
 		void registerNodePtr(std::shared_ptr< Node > nodePtr) { this->m_node_ptrs.emplace(nodePtr); }
 		std::unordered_set< std::shared_ptr< Node > > getNodePtrs() { return this->m_node_ptrs; }
 		void clearNodePtrs() { this->m_node_ptrs.clear(); }
 		void pairAllele(Allele::SharedPtr allelePtr);
 		void addSemanticLoci(position pos, const std::string& refSequence, const std::string& altSequence);
-		std::unordered_map< position, std::unordered_set< std::string > > getSemanticLocations() { return this->m_semantic_locations; }
+		const std::unordered_map< position, std::unordered_set< std::string > >& getSemanticLocations() { return this->m_semantic_locations; }
 		void registerSupportingReadInformation(SupportingReadInfo::SharedPtr supportingReadInfo);
 		std::vector< SupportingReadInfo::SharedPtr > getSupportingReadInfoPtrs();
 
@@ -62,12 +66,14 @@ namespace graphite
 		std::unordered_map< position, std::unordered_set< std::string > > m_semantic_locations;
 		std::unordered_set< Allele::SharedPtr > m_paired_allele_ptrs;
 		/* std::shared_ptr< Node > m_node_ptr; */
-        std::unordered_map< std::string, std::vector< std::unordered_set< std::string > > > m_forward_counts; // map keyed by read SampleName then they are indexed via the AlleleCountType enum value, then add readName to the the unordered set so we are properly counting the reads
-        std::unordered_map< std::string, std::vector< std::unordered_set< std::string > > > m_reverse_counts; // map keyed by read SampleName then they are indexed via the AlleleCountType enum value, then add readName to the the unordered set so we are properly counting the reads
+		typedef std::array< uint32_t, 2 * (size_t)AlleleCountType::EndEnum > SampleCounts; // forward and reverse count for every AlleleCountType
+		std::unordered_map< uint32_t, SampleCounts > m_sample_counts; // keyed by sample index, only samples with reads on this allele have an entry
+		std::unordered_set< std::string > m_counted_reads; // read name, count type, strand and sample index so a read is only counted once per count
 		std::mutex m_counts_lock;
 		std::unordered_set< std::shared_ptr< Node > > m_node_ptrs; // you have to make sure to clear this otherwise you will have hanging shared ptrs
 		std::mutex m_supporting_read_info_mutex;
 		std::vector< SupportingReadInfo::SharedPtr > m_supporting_read_info_list;
+		MemoryAccounting::Tally m_memory_tally; // grows with the counts, under m_counts_lock
 	};
 }
 
@@ -0,0 +1,296 @@
+#include "AdjudicationServer.h"
+#include "GraphProcessor.h"
+#include "core/vcf/VCFReader.h"
+#include "core/vcf/VCFWriter.h"
+#include "core/region/Region.h"
+#include "core/util/AsyncFileWriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace graphite
+{
+	static const std::string REGION_REQUEST_PREFIX = "region ";
+	static const std::string MINIMAL_VCF_HEADER = "##fileformat=VCFv4.2\n#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\n";
+	static const int CONNECTION_TIMEOUT_SECONDS = 30; // a client that neither sends nor reads for this long is dropped
+	static const size_t CONNECTION_BUFFER_SIZE = 64 * 1024;
+
+	static volatile sig_atomic_t s_stop_requested = 0;
+
+	static void requestStop(int)
+	{
+		s_stop_requested = 1;
+	}
+
+	static bool sendBytes(int connection, const char* bytes, size_t length)
+	{
+		size_t sentCount = 0;
+		while (sentCount < length)
+		{
+			ssize_t byteCount = send(connection, bytes + sentCount, length - sentCount, 0);
+			if (byteCount < 0 && errno != EINTR)
+			{
+				return false;
+			}
+			sentCount += (byteCount > 0) ? byteCount : 0;
+		}
+		return true;
+	}
+
+	static bool sendBytes(int connection, const std::string& bytes)
+	{
+		return sendBytes(connection, bytes.c_str(), bytes.size());
+	}
+
+	/*
+	 * The output of a request, its blocks are sent to the client instead of
+	 * written to a file. The connection is owned by the server.
+	 */
+	class ConnectionWriter : public AsyncFileWriter
+	{
+	public:
+		typedef std::shared_ptr< ConnectionWriter > SharedPtr;
+		ConnectionWriter(int connection, const std::string& name) :
+			AsyncFileWriter(name, CONNECTION_BUFFER_SIZE),
+			m_connection(connection)
+		{
+		}
+
+		~ConnectionWriter()
+		{
+			close();
+		}
+
+	protected:
+		virtual bool openFile(const std::string& path) { return true; }
+		virtual bool writeBlock(const std::string& block) { return sendBytes(this->m_connection, block.c_str(), block.size()); }
+		virtual bool flushFile() { return true; }
+		virtual bool closeFile() { return true; }
+
+	private:
+		int m_connection;
+	};
+
+	AdjudicationServer::AdjudicationServer(const std::string& socketPath, FastaReference::SharedPtr fastaReferencePtr, const std::vector< AlignmentReader::SharedPtr >& alignmentReaderPtrs, const std::vector< Sample::SharedPtr >& samplePtrs, const std::vector< std::string >& vcfPaths, uint32_t matchValue, uint32_t mismatchValue, uint32_t gapOpenValue, uint32_t gapExtensionValue, int32_t mappingQuality, int32_t readSampleLimit, uint32_t threadCount, size_t clusterBufferByteCount) :
+		m_socket_path(socketPath),
+		m_fasta_reference_ptr(fastaReferencePtr),
+		m_alignment_reader_ptrs(alignmentReaderPtrs),
+		m_sample_ptrs(samplePtrs),
+		m_vcf_paths(vcfPaths),
+		m_match_value(matchValue),
+		m_mismatch_value(mismatchValue),
+		m_gap_open_value(gapOpenValue),
+		m_gap_extension_value(gapExtensionValue),
+		m_mapping_quality(mappingQuality),
+		m_read_sample_limit(readSampleLimit),
+		m_thread_pool_ptr(std::make_shared< ThreadPool >(threadCount)),
+		m_cluster_buffer_byte_count(clusterBufferByteCount),
+		m_genotyper_ptr(nullptr),
+		m_request_count(0)
+	{
+	}
+
+	AdjudicationServer::~AdjudicationServer()
+	{
+	}
+
+	// accepts connections until SIGINT or SIGTERM, false when the socket can't be set up
+	bool AdjudicationServer::serve()
+	{
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if (this->m_socket_path.size() >= sizeof(address.sun_path))
+		{
+			std::cout << "The socket path is too long: " << this->m_socket_path << std::endl;
+			return false;
+		}
+		strncpy(address.sun_path, this->m_socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+		int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+		unlink(this->m_socket_path.c_str()); // left behind by a server that was killed
+		if (listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 16) != 0)
+		{
+			std::cout << "Unable to listen on " << this->m_socket_path << ": " << strerror(errno) << std::endl;
+			if (listener >= 0)
+			{
+				::close(listener);
+			}
+			return false;
+		}
+
+		// without SA_RESTART accept returns when a signal arrives so the loop sees the flag
+		struct sigaction stopAction;
+		memset(&stopAction, 0, sizeof(stopAction));
+		stopAction.sa_handler = requestStop;
+		sigemptyset(&stopAction.sa_mask);
+		sigaction(SIGINT, &stopAction, nullptr);
+		sigaction(SIGTERM, &stopAction, nullptr);
+		signal(SIGPIPE, SIG_IGN); // a client that hangs up early fails its send instead of ending the server
+
+		std::cout << "Serving adjudication requests on " << this->m_socket_path << std::endl;
+		while (!s_stop_requested)
+		{
+			int connection = accept(listener, nullptr, nullptr);
+			if (connection < 0)
+			{
+				continue;
+			}
+			struct timeval timeout;
+			timeout.tv_sec = CONNECTION_TIMEOUT_SECONDS;
+			timeout.tv_usec = 0;
+			setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+			setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+			serveRequest(connection);
+			::close(connection);
+		}
+		::close(listener);
+		unlink(this->m_socket_path.c_str());
+		std::cout << "Served " << this->m_request_count << " requests" << std::endl;
+		return true;
+	}
+
+	void AdjudicationServer::serveRequest(int connection)
+	{
+		auto startTime = std::chrono::steady_clock::now();
+		uint64_t requestID = ++this->m_request_count;
+		std::string request;
+		if (!readRequest(connection, request))
+		{
+			bool isTimedOut = (errno == EAGAIN || errno == EWOULDBLOCK);
+			std::cout << "Request " << requestID << ": unable to read the request" << ((isTimedOut) ? ", the client timed out" : "") << std::endl;
+			return;
+		}
+
+		uint64_t recordCount = 0;
+		std::string error;
+		bool isAdjudicated = adjudicate(request, connection, recordCount, error);
+		auto milliseconds = std::chrono::duration_cast< std::chrono::milliseconds >(std::chrono::steady_clock::now() - startTime).count();
+		bool isSent = false;
+		if (isAdjudicated)
+		{
+			isSent = sendBytes(connection, "##graphite_request=records:" + std::to_string(recordCount) + ";milliseconds:" + std::to_string(milliseconds) + "\n");
+		}
+		else
+		{
+			sendBytes(connection, "##graphite_error=" + error + "\n");
+		}
+		std::cout << "Request " << requestID << ": " << recordCount << " records in " << milliseconds << " ms" << ((isAdjudicated) ? "" : ", failed: " + error) << ((isAdjudicated && !isSent) ? ", the client hung up" : "") << std::endl;
+	}
+
+	// streams the annotated records of a request to the client, each cluster is sent as soon as it is adjudicated
+	bool AdjudicationServer::adjudicate(const std::string& request, int connection, uint64_t& recordCount, std::string& error)
+	{
+		std::vector< std::string > vcfPaths;
+		Region::SharedPtr regionPtr = nullptr;
+		std::shared_ptr< std::istream > requestStreamPtr = nullptr;
+		if (request.compare(0, REGION_REQUEST_PREFIX.size(), REGION_REQUEST_PREFIX) == 0)
+		{
+			std::string regionString = request.substr(REGION_REQUEST_PREFIX.size());
+			regionString = regionString.substr(0, regionString.find_first_of("\r\n"));
+			if (this->m_vcf_paths.size() == 0)
+			{
+				error = "region requests need a server started with -v";
+				return false;
+			}
+			if (regionString.find(':') == std::string::npos)
+			{
+				error = "the region must be chr:start-end";
+				return false;
+			}
+			try
+			{
+				regionPtr = std::make_shared< Region >(regionString, Region::BASED::ONE);
+			}
+			catch (const std::exception& e)
+			{
+				error = "the region must be chr:start-end";
+				return false;
+			}
+			vcfPaths = this->m_vcf_paths; // a bgzipped VCF with an index is sought to the region, see VCFReader::seekRegion
+		}
+		else
+		{
+			// records without a header get a minimal one
+			bool hasHeader = request.compare(0, 6, "#CHROM") == 0 || request.find("\n#CHROM") != std::string::npos;
+			requestStreamPtr = std::make_shared< std::istringstream >((hasHeader) ? request : MINIMAL_VCF_HEADER + request);
+		}
+
+		// each VCF is streamed whole, header first, so several VCFs are adjudicated one after another
+		size_t vcfCount = (requestStreamPtr != nullptr) ? 1 : vcfPaths.size();
+		for (size_t i = 0; i < vcfCount; ++i)
+		{
+			auto connectionWriterPtr = std::make_shared< ConnectionWriter >(connection, this->m_socket_path);
+			if (!connectionWriterPtr->open())
+			{
+				error = "unable to write the output";
+				return false;
+			}
+			std::vector< Sample::SharedPtr > samplePtrs = this->m_sample_ptrs;
+			auto vcfWriterPtr = std::make_shared< VCFWriter >(connectionWriterPtr, samplePtrs);
+			vcfWriterPtr->setGenotyper(this->m_genotyper_ptr);
+			std::vector< VCFReader::SharedPtr > vcfReaderPtrs;
+			if (requestStreamPtr != nullptr)
+			{
+				vcfReaderPtrs.emplace_back(std::make_shared< VCFReader >(requestStreamPtr, samplePtrs, vcfWriterPtr));
+			}
+			else
+			{
+				vcfReaderPtrs.emplace_back(std::make_shared< VCFReader >(vcfPaths[i], samplePtrs, regionPtr, vcfWriterPtr));
+			}
+			auto graphProcessorPtr = std::make_shared< GraphProcessor >(this->m_fasta_reference_ptr, this->m_alignment_reader_ptrs, vcfReaderPtrs, this->m_match_value, this->m_mismatch_value, this->m_gap_open_value, this->m_gap_extension_value, false, this->m_mapping_quality, this->m_read_sample_limit, this->m_thread_pool_ptr, this->m_cluster_buffer_byte_count);
+			graphProcessorPtr->setClusterCallback([connectionWriterPtr](const std::vector< Variant::SharedPtr >& variantPtrs)
+				{
+					for (auto& variantPtr : variantPtrs)
+					{
+						variantPtr->writeVariant();
+					}
+					connectionWriterPtr->flush(); // the client has the cluster before the next one is written
+				});
+			graphProcessorPtr->processVariants();
+			bool isSent = vcfWriterPtr->close();
+			recordCount += vcfWriterPtr->getRecordCount();
+			if (!isSent)
+			{
+				error = "unable to send the output";
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// the request ends when the client shuts down its side of the connection
+	bool AdjudicationServer::readRequest(int connection, std::string& request)
+	{
+		char buffer[64 * 1024];
+		while (true)
+		{
+			ssize_t byteCount = recv(connection, buffer, sizeof(buffer), 0);
+			if (byteCount == 0)
+			{
+				return true;
+			}
+			if (byteCount < 0 && errno != EINTR)
+			{
+				return false;
+			}
+			if (byteCount > 0)
+			{
+				request.append(buffer, byteCount);
+			}
+		}
+	}
+}
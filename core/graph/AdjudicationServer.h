@@ -0,0 +1,65 @@
+#ifndef GRAPHITE_ADJUDICATIONSERVER_H
+#define GRAPHITE_ADJUDICATIONSERVER_H
+
+#include "core/util/Noncopyable.hpp"
+#include "core/util/ThreadPool.hpp"
+#include "core/reference/FastaReference.h"
+#include "core/alignment/AlignmentReader.h"
+#include "core/sample/Sample.h"
+#include "core/vcf/Genotyper.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace graphite
+{
+	/*
+	 * Serves adjudication requests over a UNIX domain socket so the FASTA,
+	 * the alignment indexes and the thread pool are loaded once instead of
+	 * once per run. A client connects, writes VCF records (with or without
+	 * a header) or a single "region chr:start-end" line, which adjudicates
+	 * that region of the server's -v VCFs, and shuts down its side of the
+	 * connection. The annotated VCF is streamed back as its clusters are
+	 * adjudicated, nothing is written to disk, followed by a
+	 * "##graphite_request=records:N;milliseconds:M" trailer line or, when
+	 * the request can't be served, a "##graphite_error=..." line. The -v
+	 * VCFs of a region request are adjudicated and streamed one after
+	 * another. Requests are served one at a time since they share the
+	 * readers, a client that stops sending or reading is dropped after a
+	 * timeout so it can't hold up the others.
+	 */
+	class AdjudicationServer : private Noncopyable
+	{
+	public:
+		typedef std::shared_ptr< AdjudicationServer > SharedPtr;
+		AdjudicationServer(const std::string& socketPath, FastaReference::SharedPtr fastaReferencePtr, const std::vector< AlignmentReader::SharedPtr >& alignmentReaderPtrs, const std::vector< Sample::SharedPtr >& samplePtrs, const std::vector< std::string >& vcfPaths, uint32_t matchValue, uint32_t mismatchValue, uint32_t gapOpenValue, uint32_t gapExtensionValue, int32_t mappingQuality, int32_t readSampleLimit, uint32_t threadCount, size_t clusterBufferByteCount);
+		~AdjudicationServer();
+
+		void setGenotyper(Genotyper::SharedPtr genotyperPtr) { this->m_genotyper_ptr = genotyperPtr; }
+		bool serve();
+
+	private:
+		void serveRequest(int connection);
+		bool adjudicate(const std::string& request, int connection, uint64_t& recordCount, std::string& error);
+		static bool readRequest(int connection, std::string& request);
+
+		std::string m_socket_path;
+		FastaReference::SharedPtr m_fasta_reference_ptr;
+		std::vector< AlignmentReader::SharedPtr > m_alignment_reader_ptrs;
+		std::vector< Sample::SharedPtr > m_sample_ptrs;
+		std::vector< std::string > m_vcf_paths; // adjudicated by region requests
+		uint32_t m_match_value;
+		uint32_t m_mismatch_value;
+		uint32_t m_gap_open_value;
+		uint32_t m_gap_extension_value;
+		int32_t m_mapping_quality;
+		int32_t m_read_sample_limit;
+		std::shared_ptr< ThreadPool > m_thread_pool_ptr; // kept warm between requests
+		size_t m_cluster_buffer_byte_count;
+		Genotyper::SharedPtr m_genotyper_ptr; // set when records carry genotypes
+		uint64_t m_request_count;
+	};
+}
+
+#endif //GRAPHITE_ADJUDICATIONSERVER_H
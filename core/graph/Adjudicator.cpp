@@ -0,0 +1,53 @@
+#include "Adjudicator.h"
+
+namespace graphite
+{
+	Adjudicator::Adjudicator(FastaReference::SharedPtr fastaReferencePtr, const std::vector< AlignmentReader::SharedPtr >& alignmentReaderPtrs, uint32_t matchValue, uint32_t mismatchValue, uint32_t gapOpenValue, uint32_t gapExtensionValue, int32_t mappingQuality, int32_t readSampleLimit, uint32_t threadCount, size_t clusterBufferByteCount) :
+		m_fasta_reference_ptr(fastaReferencePtr),
+		m_alignment_reader_ptrs(alignmentReaderPtrs),
+		m_match_value(matchValue),
+		m_mismatch_value(mismatchValue),
+		m_gap_open_value(gapOpenValue),
+		m_gap_extension_value(gapExtensionValue),
+		m_mapping_quality(mappingQuality),
+		m_read_sample_limit(readSampleLimit),
+		m_thread_pool_ptr(std::make_shared< ThreadPool >(threadCount)),
+		m_cluster_buffer_byte_count(clusterBufferByteCount)
+	{
+	}
+
+	Adjudicator::~Adjudicator()
+	{
+	}
+
+	void Adjudicator::adjudicate(const std::vector< Variant::SharedPtr >& variantPtrs, ClusterCallback clusterCallback)
+	{
+		size_t variantIndex = 0;
+		adjudicate([&variantPtrs, &variantIndex]() { return (variantIndex < variantPtrs.size()) ? variantPtrs[variantIndex++] : nullptr; }, clusterCallback);
+	}
+
+	// returns once every cluster has been handed to the callback
+	void Adjudicator::adjudicate(VariantIterator variantIterator, ClusterCallback clusterCallback)
+	{
+		// variants closer than the graph spacing share a graph, as VCFReader::getNextVariants clusters them
+		Variant::SharedPtr nextVariantPtr = variantIterator();
+		auto clusterSource = [&variantIterator, &nextVariantPtr](std::vector< Variant::SharedPtr >& variantPtrs, uint32_t graphSpacing)
+			{
+				while (nextVariantPtr != nullptr)
+				{
+					if (variantPtrs.size() > 0 && (nextVariantPtr->getChromosome() != variantPtrs.back()->getChromosome() || (nextVariantPtr->getPosition() - variantPtrs.back()->getPosition()) >= graphSpacing))
+					{
+						break;
+					}
+					variantPtrs.emplace_back(nextVariantPtr);
+					nextVariantPtr = variantIterator();
+				}
+				return variantPtrs.size() > 0;
+			};
+		std::vector< VCFReader::SharedPtr > noVCFReaderPtrs;
+		GraphProcessor graphProcessor(this->m_fasta_reference_ptr, this->m_alignment_reader_ptrs, noVCFReaderPtrs, this->m_match_value, this->m_mismatch_value, this->m_gap_open_value, this->m_gap_extension_value, false, this->m_mapping_quality, this->m_read_sample_limit, this->m_thread_pool_ptr, this->m_cluster_buffer_byte_count);
+		graphProcessor.setClusterSource(clusterSource);
+		graphProcessor.setClusterCallback(clusterCallback);
+		graphProcessor.processVariants();
+	}
+}
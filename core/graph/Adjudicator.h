@@ -0,0 +1,57 @@
+#ifndef GRAPHITE_ADJUDICATOR_H
+#define GRAPHITE_ADJUDICATOR_H
+
+#include "core/util/Noncopyable.hpp"
+#include "core/util/ThreadPool.hpp"
+#include "core/reference/FastaReference.h"
+#include "core/alignment/AlignmentReader.h"
+#include "core/vcf/Variant.h"
+#include "GraphProcessor.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace graphite
+{
+	/*
+	 * Adjudicates variants in process, for programs that embed graphite
+	 * instead of running it on files. The variants are built with
+	 * Variant(chromosome, position, reference, alternates) and passed as a
+	 * list or through an iterator, in position order. They are clustered
+	 * as a graphite run would cluster them and every cluster is handed to
+	 * the callback once its reads are counted. The callback is called in
+	 * position order, one cluster at a time, and reads the counts with
+	 * Allele::getScoreCount using the sample indices of the alignment
+	 * readers' samples. Nothing is read from or written to VCFs. The
+	 * thread pool is kept between calls, the alignment readers are not
+	 * shared between threads so calls must not overlap.
+	 */
+	class Adjudicator : private Noncopyable
+	{
+	public:
+		typedef std::shared_ptr< Adjudicator > SharedPtr;
+		typedef std::function< Variant::SharedPtr () > VariantIterator; // the next variant in position order, nullptr after the last
+		typedef GraphProcessor::ClusterCallback ClusterCallback;
+
+		Adjudicator(FastaReference::SharedPtr fastaReferencePtr, const std::vector< AlignmentReader::SharedPtr >& alignmentReaderPtrs, uint32_t matchValue, uint32_t mismatchValue, uint32_t gapOpenValue, uint32_t gapExtensionValue, int32_t mappingQuality, int32_t readSampleLimit, uint32_t threadCount, size_t clusterBufferByteCount);
+		~Adjudicator();
+
+		void adjudicate(const std::vector< Variant::SharedPtr >& variantPtrs, ClusterCallback clusterCallback);
+		void adjudicate(VariantIterator variantIterator, ClusterCallback clusterCallback);
+
+	private:
+		FastaReference::SharedPtr m_fasta_reference_ptr;
+		std::vector< AlignmentReader::SharedPtr > m_alignment_reader_ptrs;
+		uint32_t m_match_value;
+		uint32_t m_mismatch_value;
+		uint32_t m_gap_open_value;
+		uint32_t m_gap_extension_value;
+		int32_t m_mapping_quality;
+		int32_t m_read_sample_limit;
+		std::shared_ptr< ThreadPool > m_thread_pool_ptr; // kept between calls
+		size_t m_cluster_buffer_byte_count;
+	};
+}
+
+#endif //GRAPHITE_ADJUDICATOR_H
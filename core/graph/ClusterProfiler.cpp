@@ -0,0 +1,62 @@
+#include "ClusterProfiler.h"
+#include "core/util/Utility.h"
+
+#include <iostream>
+
+namespace graphite
+{
+	static const std::string CLUSTER_PROFILE_HEADER = "contig\tstart\tend\tspan\tvariants\tnodes\tgraph_sequence_length\treads_fetched\treads_aligned\treads_cached\trealignments\tgraph_seconds\tfetch_seconds\talignment_seconds\trealignment_seconds\tcounting_seconds\toutput_seconds";
+
+	ClusterProfiler::ClusterProfiler(const std::string& path) :
+		m_out_file(path)
+	{
+	}
+
+	ClusterProfiler::~ClusterProfiler()
+	{
+		close();
+	}
+
+	bool ClusterProfiler::open()
+	{
+		if (!this->m_out_file.open())
+		{
+			std::cout << "Unable to write the cluster profile: " << this->m_out_file.getPath() << std::endl;
+			return false;
+		}
+		this->m_out_file.writeLine(CLUSTER_PROFILE_HEADER);
+		return true;
+	}
+
+	static void appendSeconds(std::string& row, const std::atomic< uint64_t >& nanoseconds)
+	{
+		uint64_t microseconds = nanoseconds.load() / 1000;
+		row.push_back('\t');
+		appendUnsignedInteger(row, microseconds / 1000000);
+		row.push_back('.');
+		std::string fraction = std::to_string(1000000 + microseconds % 1000000); // keeps the leading zeros
+		row.append(fraction, 1, std::string::npos);
+	}
+
+	void ClusterProfiler::write(const ClusterProfile& clusterProfile)
+	{
+		std::string row = clusterProfile.m_contig;
+		for (uint64_t value : {static_cast< uint64_t >(clusterProfile.m_start_position), static_cast< uint64_t >(clusterProfile.m_end_position), static_cast< uint64_t >(clusterProfile.m_end_position - clusterProfile.m_start_position + 1), clusterProfile.m_variant_count, clusterProfile.m_node_count, clusterProfile.m_graph_sequence_length, clusterProfile.m_fetched_read_count, clusterProfile.m_aligned_read_count.load(), clusterProfile.m_cached_read_count.load(), clusterProfile.m_realignment_count.load()})
+		{
+			row.push_back('\t');
+			appendUnsignedInteger(row, value);
+		}
+		appendSeconds(row, clusterProfile.m_graph_nanoseconds);
+		appendSeconds(row, clusterProfile.m_fetch_nanoseconds);
+		appendSeconds(row, clusterProfile.m_alignment_nanoseconds);
+		appendSeconds(row, clusterProfile.m_realignment_nanoseconds);
+		appendSeconds(row, clusterProfile.m_counting_nanoseconds);
+		appendSeconds(row, clusterProfile.m_output_nanoseconds);
+		this->m_out_file.writeLine(row);
+	}
+
+	bool ClusterProfiler::close()
+	{
+		return this->m_out_file.close();
+	}
+}
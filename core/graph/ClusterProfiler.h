@@ -0,0 +1,71 @@
+#ifndef GRAPHITE_CLUSTERPROFILER_H
+#define GRAPHITE_CLUSTERPROFILER_H
+
+#include "core/util/Noncopyable.hpp"
+#include "core/util/AsyncFileWriter.h"
+#include "core/util/Types.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace graphite
+{
+	// what one cluster cost, the read tasks add to the atomics side by side
+	struct ClusterProfile : private Noncopyable
+	{
+		typedef std::shared_ptr< ClusterProfile > SharedPtr;
+		ClusterProfile() :
+			m_start_position(0), m_end_position(0), m_variant_count(0), m_node_count(0), m_graph_sequence_length(0), m_fetched_read_count(0),
+			m_aligned_read_count(0), m_cached_read_count(0), m_realignment_count(0),
+			m_graph_nanoseconds(0), m_fetch_nanoseconds(0), m_alignment_nanoseconds(0), m_realignment_nanoseconds(0), m_counting_nanoseconds(0), m_output_nanoseconds(0)
+		{
+		}
+
+		// everything but the output, summed over the threads
+		uint64_t getAdjudicationNanoseconds() const { return m_graph_nanoseconds + m_fetch_nanoseconds + m_alignment_nanoseconds + m_realignment_nanoseconds + m_counting_nanoseconds; }
+
+		std::string m_contig;
+		position m_start_position; // of the graph's regions
+		position m_end_position;
+		uint64_t m_variant_count;
+		uint64_t m_node_count;
+		uint64_t m_graph_sequence_length; // the bases of all of the graph's nodes
+		uint64_t m_fetched_read_count;
+		std::atomic< uint64_t > m_aligned_read_count;
+		std::atomic< uint64_t > m_cached_read_count; // counted from the result cache instead of aligned
+		std::atomic< uint64_t > m_realignment_count; // leave-one-out re-alignments to tell ambiguous reads apart
+		std::atomic< uint64_t > m_graph_nanoseconds;
+		std::atomic< uint64_t > m_fetch_nanoseconds;
+		std::atomic< uint64_t > m_alignment_nanoseconds;
+		std::atomic< uint64_t > m_realignment_nanoseconds;
+		std::atomic< uint64_t > m_counting_nanoseconds;
+		std::atomic< uint64_t > m_output_nanoseconds;
+	};
+
+	/*
+	 * Writes a TSV with one row per cluster (--cluster_profile): where the
+	 * cluster is, how large its graph is, how many reads it fetched and
+	 * aligned and the time each stage spent on it. Times of stages that run
+	 * on several threads are summed over the threads. The rows are handed to
+	 * an AsyncFileWriter so the disk is written by its own thread. Clusters
+	 * are written in VCF order, except that the shards of a sharded run
+	 * interleave.
+	 */
+	class ClusterProfiler : private Noncopyable
+	{
+	public:
+		typedef std::shared_ptr< ClusterProfiler > SharedPtr;
+		ClusterProfiler(const std::string& path);
+		~ClusterProfiler();
+
+		bool open();
+		void write(const ClusterProfile& clusterProfile);
+		bool close();
+
+	private:
+		AsyncFileWriter m_out_file; // takes lines from several shards at once
+	};
+}
+
+#endif //GRAPHITE_CLUSTERPROFILER_H
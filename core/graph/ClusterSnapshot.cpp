@@ -0,0 +1,217 @@
+#include "ClusterSnapshot.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+namespace graphite
+{
+	static const char CLUSTER_SNAPSHOT_MAGIC[8] = { 'G', 'R', 'A', 'P', 'H', 'C', 'L', 'S' };
+	static const uint32_t CLUSTER_SNAPSHOT_VERSION = 1;
+
+	template < typename T >
+	static void appendValue(std::string& buffer, T value)
+	{
+		buffer.append(reinterpret_cast< const char* >(&value), sizeof(T));
+	}
+
+	static void appendSequence(std::string& buffer, const std::string& sequence)
+	{
+		appendValue< uint32_t >(buffer, sequence.size());
+		buffer += sequence;
+	}
+
+	// reads are bounds checked so a damaged snapshot is rejected instead of read past
+	template < typename T >
+	static bool readValue(const char*& data, const char* end, T& value)
+	{
+		if (static_cast< size_t >(end - data) < sizeof(T))
+		{
+			return false;
+		}
+		memcpy(&value, data, sizeof(T));
+		data += sizeof(T);
+		return true;
+	}
+
+	static bool readSequence(const char*& data, const char* end, std::string& sequence)
+	{
+		uint32_t length;
+		if (!readValue(data, end, length) || static_cast< size_t >(end - data) < length)
+		{
+			return false;
+		}
+		sequence.assign(data, length);
+		data += length;
+		return true;
+	}
+
+	// the variants are copied, the alignments are kept until the snapshot is written
+	ClusterSnapshot::ClusterSnapshot(const std::vector< Variant::SharedPtr >& variantPtrs, Region::SharedPtr referenceRegionPtr, const std::string& referenceSequence, uint32_t graphSpacing, uint32_t matchValue, uint32_t mismatchValue, uint32_t gapOpenValue, uint32_t gapExtensionValue) :
+		m_reference_id(referenceRegionPtr->getReferenceID()),
+		m_reference_start_position((referenceRegionPtr->getBased() == Region::BASED::ONE) ? referenceRegionPtr->getStartPosition() : referenceRegionPtr->getStartPosition() + 1),
+		m_reference_sequence(referenceSequence),
+		m_graph_spacing(graphSpacing),
+		m_match_value(matchValue),
+		m_mismatch_value(mismatchValue),
+		m_gap_open_value(gapOpenValue),
+		m_gap_extension_value(gapExtensionValue),
+		m_captured_nanoseconds(0)
+	{
+		for (auto& variantPtr : variantPtrs)
+		{
+			SnapshotVariant variant;
+			variant.m_chromosome = variantPtr->getChromosome();
+			variant.m_position = variantPtr->getPosition();
+			variant.m_reference_sequence = variantPtr->getReferenceAllelePtr()->getSequence();
+			for (auto& allelePtr : variantPtr->getAlternateAllelePtrs())
+			{
+				variant.m_alternate_sequences.emplace_back(allelePtr->getSequence());
+			}
+			this->m_variants.emplace_back(variant);
+		}
+	}
+
+	ClusterSnapshot::~ClusterSnapshot()
+	{
+	}
+
+	bool ClusterSnapshot::write(const std::string& path)
+	{
+		std::string buffer(CLUSTER_SNAPSHOT_MAGIC, sizeof(CLUSTER_SNAPSHOT_MAGIC));
+		appendValue< uint32_t >(buffer, CLUSTER_SNAPSHOT_VERSION);
+		appendValue< uint32_t >(buffer, this->m_graph_spacing);
+		appendValue< uint32_t >(buffer, this->m_match_value);
+		appendValue< uint32_t >(buffer, this->m_mismatch_value);
+		appendValue< uint32_t >(buffer, this->m_gap_open_value);
+		appendValue< uint32_t >(buffer, this->m_gap_extension_value);
+		appendValue< uint64_t >(buffer, this->m_captured_nanoseconds);
+		appendSequence(buffer, this->m_reference_id);
+		appendValue< uint32_t >(buffer, this->m_reference_start_position);
+		appendSequence(buffer, this->m_reference_sequence);
+		appendValue< uint32_t >(buffer, this->m_variants.size());
+		for (auto& variant : this->m_variants)
+		{
+			appendSequence(buffer, variant.m_chromosome);
+			appendValue< uint32_t >(buffer, variant.m_position);
+			appendSequence(buffer, variant.m_reference_sequence);
+			appendValue< uint32_t >(buffer, variant.m_alternate_sequences.size());
+			for (auto& alternateSequence : variant.m_alternate_sequences)
+			{
+				appendSequence(buffer, alternateSequence);
+			}
+		}
+		appendValue< uint32_t >(buffer, this->m_alignment_ptrs.size());
+		for (auto& alignmentPtr : this->m_alignment_ptrs)
+		{
+			appendSequence(buffer, std::string(alignmentPtr->getSequence(), alignmentPtr->getLength()));
+			appendSequence(buffer, alignmentPtr->getReadName());
+			appendSequence(buffer, alignmentPtr->getSample()->getName());
+			appendValue< uint16_t >(buffer, alignmentPtr->getMapQuality());
+			appendValue< uint8_t >(buffer, alignmentPtr->getIsForwardStrand());
+			appendValue< uint8_t >(buffer, alignmentPtr->getIsFirstMate());
+		}
+
+		std::ofstream outFile(path, std::ios::binary | std::ios::trunc);
+		outFile.write(buffer.c_str(), buffer.size());
+		outFile.close();
+		if (!outFile)
+		{
+			std::cout << "Unable to write cluster snapshot: " << path << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// nullptr when the file can't be read or isn't a snapshot of this version
+	ClusterSnapshot::SharedPtr ClusterSnapshot::read(const std::string& path)
+	{
+		std::ifstream inFile(path, std::ios::binary | std::ios::ate);
+		if (!inFile.is_open())
+		{
+			std::cout << "Unable to open cluster snapshot: " << path << std::endl;
+			return nullptr;
+		}
+		std::string data(static_cast< size_t >(inFile.tellg()), '\0');
+		inFile.seekg(0);
+		inFile.read(&data[0], data.size());
+
+		auto snapshotPtr = ClusterSnapshot::SharedPtr(new ClusterSnapshot());
+		const char* dataPtr = data.c_str();
+		const char* end = dataPtr + data.size();
+		uint32_t version = 0;
+		uint32_t variantCount = 0;
+		uint32_t alignmentCount = 0;
+		bool isValid = inFile && data.size() >= sizeof(CLUSTER_SNAPSHOT_MAGIC) && memcmp(dataPtr, CLUSTER_SNAPSHOT_MAGIC, sizeof(CLUSTER_SNAPSHOT_MAGIC)) == 0;
+		dataPtr += (isValid) ? sizeof(CLUSTER_SNAPSHOT_MAGIC) : 0;
+		isValid = isValid && readValue(dataPtr, end, version) && version == CLUSTER_SNAPSHOT_VERSION &&
+			readValue(dataPtr, end, snapshotPtr->m_graph_spacing) && readValue(dataPtr, end, snapshotPtr->m_match_value) &&
+			readValue(dataPtr, end, snapshotPtr->m_mismatch_value) && readValue(dataPtr, end, snapshotPtr->m_gap_open_value) &&
+			readValue(dataPtr, end, snapshotPtr->m_gap_extension_value) && readValue(dataPtr, end, snapshotPtr->m_captured_nanoseconds) &&
+			readSequence(dataPtr, end, snapshotPtr->m_reference_id) && readValue(dataPtr, end, snapshotPtr->m_reference_start_position) &&
+			readSequence(dataPtr, end, snapshotPtr->m_reference_sequence) && readValue(dataPtr, end, variantCount);
+		for (uint32_t i = 0; isValid && i < variantCount; ++i)
+		{
+			SnapshotVariant variant;
+			uint32_t alternateCount = 0;
+			isValid = readSequence(dataPtr, end, variant.m_chromosome) && readValue(dataPtr, end, variant.m_position) &&
+				readSequence(dataPtr, end, variant.m_reference_sequence) && readValue(dataPtr, end, alternateCount);
+			for (uint32_t j = 0; isValid && j < alternateCount; ++j)
+			{
+				std::string alternateSequence;
+				isValid = readSequence(dataPtr, end, alternateSequence);
+				variant.m_alternate_sequences.emplace_back(alternateSequence);
+			}
+			snapshotPtr->m_variants.emplace_back(variant);
+		}
+		isValid = isValid && readValue(dataPtr, end, alignmentCount);
+		std::unordered_map< std::string, Sample::SharedPtr > samplePtrs; // one per sample name, as a run has one per read group
+		for (uint32_t i = 0; isValid && i < alignmentCount; ++i)
+		{
+			std::string sequence;
+			std::string readName;
+			std::string sampleName;
+			uint16_t mapQuality;
+			uint8_t isForwardStrand;
+			uint8_t isFirstMate;
+			isValid = readSequence(dataPtr, end, sequence) && readSequence(dataPtr, end, readName) && readSequence(dataPtr, end, sampleName) &&
+				readValue(dataPtr, end, mapQuality) && readValue(dataPtr, end, isForwardStrand) && readValue(dataPtr, end, isFirstMate);
+			if (isValid)
+			{
+				auto sampleIter = samplePtrs.find(sampleName);
+				if (sampleIter == samplePtrs.end())
+				{
+					sampleIter = samplePtrs.emplace(sampleName, std::make_shared< Sample >(sampleName, sampleName, path)).first;
+				}
+				snapshotPtr->m_alignment_ptrs.emplace_back(std::make_shared< Alignment >(sequence, readName, isForwardStrand != 0, isFirstMate != 0, mapQuality, sampleIter->second));
+			}
+		}
+		if (!isValid || snapshotPtr->m_variants.size() == 0)
+		{
+			std::cout << "Not a valid cluster snapshot: " << path << std::endl;
+			return nullptr;
+		}
+		return snapshotPtr;
+	}
+
+	std::vector< Variant::SharedPtr > ClusterSnapshot::createVariantPtrs()
+	{
+		std::vector< Variant::SharedPtr > variantPtrs;
+		for (auto& variant : this->m_variants)
+		{
+			variantPtrs.emplace_back(std::make_shared< Variant >(variant.m_chromosome, variant.m_position, variant.m_reference_sequence, variant.m_alternate_sequences));
+		}
+		return variantPtrs;
+	}
+
+	FastaReference::SharedPtr ClusterSnapshot::createFastaReference()
+	{
+		return std::make_shared< FastaReference >(this->m_reference_id, this->m_reference_start_position, this->m_reference_sequence);
+	}
+
+	std::string ClusterSnapshot::getRegionString()
+	{
+		return this->m_reference_id + ":" + std::to_string(this->m_reference_start_position) + "-" + std::to_string(this->m_reference_start_position + this->m_reference_sequence.size() - 1);
+	}
+}
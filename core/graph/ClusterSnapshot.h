@@ -0,0 +1,74 @@
+#ifndef GRAPHITE_CLUSTERSNAPSHOT_H
+#define GRAPHITE_CLUSTERSNAPSHOT_H
+
+#include "core/util/Noncopyable.hpp"
+#include "core/region/Region.h"
+#include "core/reference/FastaReference.h"
+#include "core/vcf/Variant.h"
+#include "core/alignment/Alignment.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace graphite
+{
+	/*
+	 * Everything graphite needs to adjudicate one cluster again without the
+	 * BAMs, the VCFs or the FASTA: the cluster's variants, the reference
+	 * window its graph is built from, the reads fetched for it and the graph
+	 * spacing and scoring values of the run. A run with --capture writes one
+	 * for every cluster that took longer than a threshold and graphite
+	 * replay adjudicates it again, so slow clusters can be reproduced and
+	 * profiled on their own. A snapshot is a small binary file that is
+	 * read and written whole.
+	 */
+	class ClusterSnapshot : private Noncopyable
+	{
+	public:
+		typedef std::shared_ptr< ClusterSnapshot > SharedPtr;
+		ClusterSnapshot(const std::vector< Variant::SharedPtr >& variantPtrs, Region::SharedPtr referenceRegionPtr, const std::string& referenceSequence, uint32_t graphSpacing, uint32_t matchValue, uint32_t mismatchValue, uint32_t gapOpenValue, uint32_t gapExtensionValue);
+		~ClusterSnapshot();
+
+		void setAlignmentPtrs(const std::vector< Alignment::SharedPtr >& alignmentPtrs) { this->m_alignment_ptrs = alignmentPtrs; }
+		void setCapturedNanoseconds(uint64_t capturedNanoseconds) { this->m_captured_nanoseconds = capturedNanoseconds; }
+		bool write(const std::string& path);
+		static ClusterSnapshot::SharedPtr read(const std::string& path);
+
+		std::vector< Variant::SharedPtr > createVariantPtrs(); // new variants without counts on every call
+		FastaReference::SharedPtr createFastaReference(); // holds only the window
+		std::vector< Alignment::SharedPtr > getAlignmentPtrs() { return this->m_alignment_ptrs; }
+		std::string getRegionString();
+		uint32_t getGraphSpacing() { return this->m_graph_spacing; }
+		uint32_t getMatchValue() { return this->m_match_value; }
+		uint32_t getMismatchValue() { return this->m_mismatch_value; }
+		uint32_t getGapOpenValue() { return this->m_gap_open_value; }
+		uint32_t getGapExtensionValue() { return this->m_gap_extension_value; }
+		uint64_t getCapturedNanoseconds() { return this->m_captured_nanoseconds; }
+
+	private:
+		struct SnapshotVariant
+		{
+			std::string m_chromosome;
+			position m_position;
+			std::string m_reference_sequence;
+			std::vector< std::string > m_alternate_sequences;
+		};
+
+		ClusterSnapshot() {}
+
+		std::vector< SnapshotVariant > m_variants;
+		std::string m_reference_id;
+		position m_reference_start_position; // one based
+		std::string m_reference_sequence;
+		std::vector< Alignment::SharedPtr > m_alignment_ptrs;
+		uint32_t m_graph_spacing;
+		uint32_t m_match_value;
+		uint32_t m_mismatch_value;
+		uint32_t m_gap_open_value;
+		uint32_t m_gap_extension_value;
+		uint64_t m_captured_nanoseconds; // what the cluster took in the run that captured it, summed over the threads
+	};
+}
+
+#endif //GRAPHITE_CLUSTERSNAPSHOT_H
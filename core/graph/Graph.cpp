@@ -3,12 +3,15 @@
 #include "GraphTraceback.hpp"
 
 #include "core/util/Types.h"
+#include <algorithm>
 #include <deque>
+#include <cstring>
 
 namespace graphite
 {
-	Graph::Graph(FastaReference::SharedPtr fastaReferencePtr, std::vector< Variant::SharedPtr > variantPtrs, uint32_t graphSpacing, bool printGraph) :
+	Graph::Graph(FastaReference::SharedPtr fastaReferencePtr, std::vector< Variant::SharedPtr > variantPtrs, uint32_t graphSpacing, bool printGraph, ClusterArena::SharedPtr arenaPtr) :
 		m_fasta_reference_ptr(fastaReferencePtr),
+		m_arena_ptr(arenaPtr),
 		// m_variant_ptrs(variantPtrs),
 		m_graph_spacing(graphSpacing),
 		m_score_threshold(70),
@@ -62,38 +65,33 @@ namespace graphite
 		std::string referenceSequence;
 		Region::SharedPtr referenceRegionPtr;
 		getGraphReference(referenceSequence, referenceRegionPtr, variantPtrs);
+		this->m_reference_region_ptr = referenceRegionPtr; // spans all of the cluster's variants, the graph's own reference lies within it
 
-		std::unordered_map< std::string, Allele::SharedPtr > variantSequenceMap;
-		std::unordered_map< std::string, Variant::SharedPtr > variantPtrMap;
+		std::unordered_map< std::string, std::pair< uint32_t, uint32_t > > variantSequenceMap; // the variant and alt allele index of the first allele with the sequence
 		std::unordered_set< Variant::SharedPtr > variantPtrSet;
+		this->m_semantic_pairs.clear();
 		// variantSequences.emplace_back(referenceSequence); // we aren't putting in the reference allele because there are many ref alleles and they all have the same equence so they will be over counted
-		for (auto variantPtr : variantPtrs)
+		for (uint32_t variantIndex = 0; variantIndex < variantPtrs.size(); ++variantIndex)
 		{
+			auto variantPtr = variantPtrs[variantIndex];
 			int prefixSize = variantPtr->getPosition() - referenceRegionPtr->getStartPosition();
 			int suffixSize = (prefixSize + variantPtr->getReferenceAllelePtr()->getSequence().size());
 			std::string prefix = referenceSequence.substr(0, prefixSize);
 			std::string suffix = referenceSequence.substr(suffixSize);
-			Allele::SharedPtr refAllelePtr = variantPtr->getReferenceAllelePtr();
-			for (auto altAllelePtr : variantPtr->getAlternateAllelePtrs())
+			auto altAllelePtrs = variantPtr->getAlternateAllelePtrs();
+			for (uint32_t altIndex = 0; altIndex < altAllelePtrs.size(); ++altIndex)
 			{
-				std::string sequence = prefix + altAllelePtr->getSequence() + suffix;
+				std::string sequence = prefix + altAllelePtrs[altIndex]->getSequence() + suffix;
 				auto variantIter = variantSequenceMap.find(sequence);
 				if (variantIter != variantSequenceMap.end()) // if there is a dup sequence that means there is a semantic sequence match so pair the alleles
 				{
-					auto variantPtrIter = variantPtrMap.find(sequence);
-					if (variantPtrIter == variantPtrMap.end()) { std::cout << "there was a problem in Graph.cpp." << std::endl; }
-					Variant::SharedPtr queryVariantPtr = variantPtrIter->second;
-					Allele::SharedPtr allelePtr = variantIter->second;
-					Allele::SharedPtr queryRefAllelePtr = queryVariantPtr->getReferenceAllelePtr();
-					queryRefAllelePtr->pairAllele(refAllelePtr); // pair the ref allele so they are both counted when there is a SW match
-					allelePtr->pairAllele(altAllelePtr); // pair the allele so they are both counted when there is a SW match
-					allelePtr->addSemanticLoci(variantPtr->getPosition(), refAllelePtr->getSequence(), altAllelePtr->getSequence());
-					altAllelePtr->addSemanticLoci(queryVariantPtr->getPosition(), queryRefAllelePtr->getSequence(), allelePtr->getSequence());
+					SemanticPair semanticPair = {{ variantIter->second.first, variantIter->second.second, variantIndex, altIndex }};
+					pairSemanticAlleles(variantPtrs, semanticPair);
+					this->m_semantic_pairs.emplace_back(semanticPair); // kept so a stored graph can pair the alleles of a later run
 				}
 				else
 				{
-					variantPtrMap.emplace(sequence, variantPtr);
-					variantSequenceMap.emplace(sequence, altAllelePtr);
+					variantSequenceMap.emplace(sequence, std::make_pair(variantIndex, altIndex));
 					if (variantPtrSet.find(variantPtr) == variantPtrSet.end()) // we don't want to add the variant more than once on multi-allelics
 					{
 						uniqueVariantPtrs.emplace_back(variantPtr);
@@ -104,6 +102,20 @@ namespace graphite
 		return uniqueVariantPtrs;
 	}
 
+	void Graph::pairSemanticAlleles(const std::vector< Variant::SharedPtr >& variantPtrs, const SemanticPair& semanticPair)
+	{
+		Variant::SharedPtr queryVariantPtr = variantPtrs[semanticPair[0]];
+		Allele::SharedPtr allelePtr = queryVariantPtr->getAlternateAllelePtrs()[semanticPair[1]];
+		Variant::SharedPtr variantPtr = variantPtrs[semanticPair[2]];
+		Allele::SharedPtr altAllelePtr = variantPtr->getAlternateAllelePtrs()[semanticPair[3]];
+		Allele::SharedPtr refAllelePtr = variantPtr->getReferenceAllelePtr();
+		Allele::SharedPtr queryRefAllelePtr = queryVariantPtr->getReferenceAllelePtr();
+		queryRefAllelePtr->pairAllele(refAllelePtr); // pair the ref allele so they are both counted when there is a SW match
+		allelePtr->pairAllele(altAllelePtr); // pair the allele so they are both counted when there is a SW match
+		allelePtr->addSemanticLoci(variantPtr->getPosition(), refAllelePtr->getSequence(), altAllelePtr->getSequence());
+		altAllelePtr->addSemanticLoci(queryVariantPtr->getPosition(), queryRefAllelePtr->getSequence(), allelePtr->getSequence());
+	}
+
 	std::vector< Region::SharedPtr > Graph::getRegionPtrs()
 	{
 		return this->m_graph_regions;
@@ -188,7 +200,7 @@ namespace graphite
 		static bool firstTime = false;
 		for (auto i = 0; i < referenceSequence.size(); ++i)
 		{
-			Node::SharedPtr nodePtr = std::make_shared< Node >(referenceSequence.c_str() + i, 1, nodePosition, Node::ALLELE_TYPE::REF);
+			Node::SharedPtr nodePtr = ClusterArena::makeShared< Node >(this->m_arena_ptr, const_cast< char* >(referenceSequence.c_str() + i), 1, nodePosition, Node::ALLELE_TYPE::REF);
 			this->m_all_created_nodes.emplace(nodePtr);
 			if (firstNodePtr == nullptr)
 			{
@@ -257,7 +269,7 @@ namespace graphite
 				}
 				if (!duplicateVariantFound)
 				{
-					auto altNodePtr = std::make_shared< Node >(altAllelePtr->getSequence(), variantNodeStartPosition, Node::ALLELE_TYPE::ALT);
+					auto altNodePtr = ClusterArena::makeShared< Node >(this->m_arena_ptr, altAllelePtr->getSequence(), variantNodeStartPosition, Node::ALLELE_TYPE::ALT);
 					this->m_all_created_nodes.emplace(altNodePtr);
 					altNodePtr->registerAllelePtr(altAllelePtr);
 					altAllelePtr->registerNodePtr(altNodePtr);
@@ -316,7 +328,7 @@ namespace graphite
 			}
 			else
 			{
-				nodePtr = Node::mergeNodes(leftAdjacentNodePtr, nodePtr);
+				nodePtr = Node::mergeNodes(leftAdjacentNodePtr, nodePtr, this->m_arena_ptr);
 			}
 			this->m_all_created_nodes.emplace(nodePtr);
 		} while (nodePtr->getInNodes().size() > 0);
@@ -347,23 +359,25 @@ namespace graphite
 					{
 						continue;
 					}
+					std::string node1Sequence = node1Ptr->getSequence(); // getSequence returns a copy, the pointers below must outlive it
+					std::string node2Sequence = node2Ptr->getSequence();
 					const char* seq1;
 					const char* seq2;
 					size_t len1;
 					size_t len2;
-					if (node1Ptr->getSequence().size() < node2Ptr->getSequence().size())
+					if (node1Sequence.size() < node2Sequence.size())
 					{
-						seq1 = node1Ptr->getSequence().c_str();
-						seq2 = node2Ptr->getSequence().c_str();
-						len1 = node1Ptr->getSequence().size();
-						len2 = node2Ptr->getSequence().size();
+						seq1 = node1Sequence.c_str();
+						seq2 = node2Sequence.c_str();
+						len1 = node1Sequence.size();
+						len2 = node2Sequence.size();
 					}
 					else
 					{
-						seq2 = node1Ptr->getSequence().c_str();
-						seq1 = node2Ptr->getSequence().c_str();
-						len2 = node1Ptr->getSequence().size();
-						len1 = node2Ptr->getSequence().size();
+						seq2 = node1Sequence.c_str();
+						seq1 = node2Sequence.c_str();
+						len2 = node1Sequence.size();
+						len1 = node2Sequence.size();
 					}
 					// seq1 and len1 is less than seq2 and len2
 					size_t maxPrefix;
@@ -382,13 +396,10 @@ namespace graphite
 					{
 						node2Ptr->setIdenticalPrefixLength(maxPrefix);
 					}
-					size_t maxSuffix;
-					for (maxSuffix = (len1 - 1); maxSuffix >= 0; --maxSuffix)
+					size_t maxSuffix = (len1 > 0) ? len1 - 1 : 0;
+					while (maxSuffix > 0 && seq1[maxSuffix] == seq2[maxSuffix]) // stops at 0, a size_t never goes below it
 					{
-						if (seq1[maxSuffix] != seq2[maxSuffix])
-						{
-							break;
-						}
+						--maxSuffix;
 					}
 					if (node1Ptr->getIdenticalSuffixLength() < maxSuffix)
 					{
@@ -411,7 +422,7 @@ namespace graphite
 		{
 			if (iter->getID() != nodePtr->getID())
 			{
-				allCreatedNodePtrs.emplace(nodePtr);
+				allCreatedNodePtrs.emplace(iter);
 			}
 		}
 		m_all_created_nodes = allCreatedNodePtrs;
@@ -652,9 +663,69 @@ namespace graphite
 		std::cout << "}" << std::endl;
 	}
 
+	// nodes and alleles hold each other, and nodes their neighbours, so a graph's nodes, alleles, counts and supporting
+	// read info are only freed once those references are broken. Every node that can be reached from the graph's nodes
+	// or its variants' alleles is cleared, including the nodes that condensing the graph replaced.
 	void Graph::clearResources()
 	{
-		for (auto nodePtr : m_all_created_nodes)
+		if (this->m_graph_printer_ptr != nullptr)
+		{
+			this->m_graph_printer_ptr->printGraph(); // before the edges it prints are gone
+			this->m_graph_printer_ptr = nullptr;
+		}
+		std::unordered_set< Node::SharedPtr > nodePtrs;
+		std::deque< Node::SharedPtr > uncheckedNodePtrs;
+		auto addNodePtr = [&nodePtrs, &uncheckedNodePtrs](Node::SharedPtr nodePtr)
+			{
+				if (nodePtr != nullptr && nodePtrs.emplace(nodePtr).second)
+				{
+					uncheckedNodePtrs.emplace_back(nodePtr);
+				}
+			};
+		addNodePtr(this->m_first_node);
+		for (auto nodePtr : this->m_all_created_nodes)
+		{
+			addNodePtr(nodePtr);
+		}
+		for (auto& nodeIter : this->m_node_ptrs_map)
+		{
+			addNodePtr(nodeIter.second);
+		}
+		for (auto variantPtr : this->m_variant_ptrs)
+		{
+			std::vector< Allele::SharedPtr > allelePtrs = variantPtr->getAlternateAllelePtrs();
+			allelePtrs.emplace_back(variantPtr->getReferenceAllelePtr());
+			for (auto allelePtr : allelePtrs)
+			{
+				for (auto nodePtr : allelePtr->getNodePtrs())
+				{
+					addNodePtr(nodePtr);
+				}
+			}
+		}
+		while (!uncheckedNodePtrs.empty())
+		{
+			auto nodePtr = uncheckedNodePtrs.front();
+			uncheckedNodePtrs.pop_front();
+			addNodePtr(nodePtr->getReferenceInNode());
+			addNodePtr(nodePtr->getReferenceOutNode());
+			for (auto adjacentNodePtr : nodePtr->getInNodes())
+			{
+				addNodePtr(adjacentNodePtr);
+			}
+			for (auto adjacentNodePtr : nodePtr->getOutNodes())
+			{
+				addNodePtr(adjacentNodePtr);
+			}
+			for (auto allelePtr : nodePtr->getAllelePtrs())
+			{
+				for (auto alleleNodePtr : allelePtr->getNodePtrs())
+				{
+					addNodePtr(alleleNodePtr);
+				}
+			}
+		}
+		for (auto nodePtr : nodePtrs)
 		{
 			for (auto allelePtr : nodePtr->getAllelePtrs())
 			{
@@ -679,4 +750,345 @@ namespace graphite
 		graphPtr->m_first_node = this->m_first_node;
 		return graphPtr;
 	}
+
+	template < typename T >
+	static void appendValue(std::string& buffer, T value)
+	{
+		buffer.append(reinterpret_cast< const char* >(&value), sizeof(T));
+	}
+
+	static void appendSequence(std::string& buffer, const std::string& sequence)
+	{
+		appendValue< uint32_t >(buffer, sequence.size());
+		buffer += sequence;
+	}
+
+	// reads are bounds checked so a damaged record is rejected instead of read past
+	template < typename T >
+	static bool readValue(const char*& data, const char* end, T& value)
+	{
+		if (static_cast< size_t >(end - data) < sizeof(T))
+		{
+			return false;
+		}
+		memcpy(&value, data, sizeof(T));
+		data += sizeof(T);
+		return true;
+	}
+
+	static bool readSequence(const char*& data, const char* end, std::string& sequence)
+	{
+		uint32_t length;
+		if (!readValue(data, end, length) || static_cast< size_t >(end - data) < length)
+		{
+			return false;
+		}
+		sequence.assign(data, length);
+		data += length;
+		return true;
+	}
+
+	static bool readIndices(const char*& data, const char* end, uint32_t indexLimit, std::vector< uint32_t >& indices)
+	{
+		uint32_t indexCount;
+		if (!readValue(data, end, indexCount) || static_cast< size_t >(end - data) / sizeof(uint32_t) < indexCount)
+		{
+			return false;
+		}
+		indices.resize(indexCount);
+		for (auto& index : indices)
+		{
+			if (!readValue(data, end, index) || index >= indexLimit)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// the nodes by position, allele type and sequence, unlike the node ids this is the same for the same graph in every run
+	std::vector< Node::SharedPtr > Graph::getOrderedNodePtrs()
+	{
+		std::vector< Node::SharedPtr > nodePtrs;
+		for (auto& nodeIter : this->m_node_ptrs_map)
+		{
+			nodePtrs.emplace_back(nodeIter.second);
+		}
+		std::sort(nodePtrs.begin(), nodePtrs.end(), [](const Node::SharedPtr& a, const Node::SharedPtr& b)
+			{
+				if (a->getPosition() != b->getPosition())
+				{
+					return a->getPosition() < b->getPosition();
+				}
+				if (a->getAlleleType() != b->getAlleleType())
+				{
+					return a->getAlleleType() < b->getAlleleType();
+				}
+				return a->getSequence() < b->getSequence();
+			});
+		return nodePtrs;
+	}
+
+	// the built graph with variants and alleles written as indices into the cluster's variants, so it can be wired to the alleles of a later run
+	// the bytes only depend on the graph, so they also identify it
+	bool Graph::serialize(std::string& buffer, const std::vector< Variant::SharedPtr >& clusterVariantPtrs)
+	{
+		std::unordered_map< Variant*, uint32_t > variantIndices;
+		std::unordered_map< Allele*, std::pair< uint32_t, uint32_t > > alleleIndices; // variant index and allele index, 0 is the reference allele
+		for (uint32_t variantIndex = 0; variantIndex < clusterVariantPtrs.size(); ++variantIndex)
+		{
+			auto variantPtr = clusterVariantPtrs[variantIndex];
+			variantIndices.emplace(variantPtr.get(), variantIndex);
+			alleleIndices.emplace(variantPtr->getReferenceAllelePtr().get(), std::make_pair(variantIndex, 0));
+			auto altAllelePtrs = variantPtr->getAlternateAllelePtrs();
+			for (uint32_t altIndex = 0; altIndex < altAllelePtrs.size(); ++altIndex)
+			{
+				alleleIndices.emplace(altAllelePtrs[altIndex].get(), std::make_pair(variantIndex, altIndex + 1));
+			}
+		}
+		std::vector< Node::SharedPtr > nodePtrs = getOrderedNodePtrs();
+		std::unordered_map< Node*, uint32_t > nodeIndices;
+		for (auto& nodePtr : nodePtrs)
+		{
+			nodeIndices.emplace(nodePtr.get(), nodeIndices.size());
+		}
+		auto firstNodeIter = nodeIndices.find(this->m_first_node.get());
+		if (clusterVariantPtrs.size() == 0 || firstNodeIter == nodeIndices.end())
+		{
+			return false;
+		}
+
+		appendValue< uint32_t >(buffer, clusterVariantPtrs.size());
+		appendValue< uint32_t >(buffer, clusterVariantPtrs[0]->getPosition());
+		appendValue< uint32_t >(buffer, this->m_variant_ptrs.size());
+		for (auto& variantPtr : this->m_variant_ptrs)
+		{
+			auto variantIter = variantIndices.find(variantPtr.get());
+			if (variantIter == variantIndices.end())
+			{
+				return false;
+			}
+			appendValue< uint32_t >(buffer, variantIter->second);
+		}
+		appendValue< uint32_t >(buffer, this->m_semantic_pairs.size());
+		for (auto& semanticPair : this->m_semantic_pairs)
+		{
+			for (auto index : semanticPair)
+			{
+				appendValue< uint32_t >(buffer, index);
+			}
+		}
+		appendValue< uint32_t >(buffer, this->m_graph_regions.size());
+		for (auto& regionPtr : this->m_graph_regions)
+		{
+			appendValue< uint32_t >(buffer, regionPtr->getStartPosition());
+			appendValue< uint32_t >(buffer, regionPtr->getEndPosition());
+		}
+		appendValue< uint32_t >(buffer, nodePtrs.size());
+		appendValue< uint32_t >(buffer, firstNodeIter->second);
+		for (auto& nodePtr : nodePtrs)
+		{
+			appendValue< uint32_t >(buffer, nodePtr->getPosition());
+			appendValue< uint8_t >(buffer, static_cast< uint8_t >(nodePtr->getAlleleType()));
+			appendValue< uint32_t >(buffer, nodePtr->getIdenticalPrefixLength());
+			appendValue< uint32_t >(buffer, nodePtr->getIdenticalSuffixLength());
+			std::string sequence = nodePtr->getSequence();
+			std::string originalSequence = nodePtr->getOriginalSequence();
+			appendSequence(buffer, sequence);
+			appendSequence(buffer, (originalSequence == sequence) ? "" : originalSequence); // only compressed nodes have an original sequence
+			for (auto& edgeNodePtrs : { nodePtr->getInNodes(), nodePtr->getOutNodes() })
+			{
+				std::vector< uint32_t > edgeNodeIndices; // sorted, the sets iterate in pointer order
+				for (auto& edgeNodePtr : edgeNodePtrs)
+				{
+					auto nodeIter = nodeIndices.find(edgeNodePtr.get());
+					if (nodeIter == nodeIndices.end())
+					{
+						return false;
+					}
+					edgeNodeIndices.emplace_back(nodeIter->second);
+				}
+				std::sort(edgeNodeIndices.begin(), edgeNodeIndices.end());
+				appendValue< uint32_t >(buffer, edgeNodeIndices.size());
+				for (auto edgeNodeIndex : edgeNodeIndices)
+				{
+					appendValue< uint32_t >(buffer, edgeNodeIndex);
+				}
+			}
+			std::vector< std::pair< uint32_t, uint32_t > > nodeAlleleIndices;
+			for (auto& allelePtr : nodePtr->getAllelePtrs())
+			{
+				auto alleleIter = alleleIndices.find(allelePtr.get());
+				if (alleleIter == alleleIndices.end())
+				{
+					return false;
+				}
+				nodeAlleleIndices.emplace_back(alleleIter->second);
+			}
+			std::sort(nodeAlleleIndices.begin(), nodeAlleleIndices.end());
+			appendValue< uint32_t >(buffer, nodeAlleleIndices.size());
+			for (auto& nodeAlleleIndex : nodeAlleleIndices)
+			{
+				appendValue< uint32_t >(buffer, nodeAlleleIndex.first);
+				appendValue< uint32_t >(buffer, nodeAlleleIndex.second);
+			}
+		}
+		return true;
+	}
+
+	// rebuilds a serialized graph on the alleles of clusterVariantPtrs, nullptr when the record doesn't belong to these variants
+	Graph::SharedPtr Graph::deserialize(const char* data, size_t byteCount, const std::vector< Variant::SharedPtr >& clusterVariantPtrs, uint32_t graphSpacing, bool printGraph)
+	{
+		struct SerializedNode
+		{
+			Node::SharedPtr m_node_ptr;
+			std::vector< uint32_t > m_in_node_indices;
+			std::vector< uint32_t > m_out_node_indices;
+			std::vector< Allele::SharedPtr > m_allele_ptrs;
+		};
+		const char* end = data + byteCount;
+		uint32_t variantCount;
+		uint32_t firstPosition;
+		if (clusterVariantPtrs.size() == 0 || !readValue(data, end, variantCount) || !readValue(data, end, firstPosition) ||
+			variantCount != clusterVariantPtrs.size() || firstPosition != clusterVariantPtrs[0]->getPosition())
+		{
+			return nullptr;
+		}
+		std::vector< std::vector< Allele::SharedPtr > > clusterAllelePtrs; // indexed like the serialized allele indices
+		for (auto& variantPtr : clusterVariantPtrs)
+		{
+			clusterAllelePtrs.emplace_back(1, variantPtr->getReferenceAllelePtr());
+			auto altAllelePtrs = variantPtr->getAlternateAllelePtrs();
+			clusterAllelePtrs.back().insert(clusterAllelePtrs.back().end(), altAllelePtrs.begin(), altAllelePtrs.end());
+		}
+
+		// everything is read before the alleles are touched so a rejected record leaves them as they were
+		auto graphPtr = std::make_shared< Graph >();
+		std::vector< uint32_t > uniqueVariantIndices;
+		if (!readIndices(data, end, variantCount, uniqueVariantIndices) || uniqueVariantIndices.size() == 0)
+		{
+			return nullptr;
+		}
+		for (auto variantIndex : uniqueVariantIndices)
+		{
+			graphPtr->m_variant_ptrs.emplace_back(clusterVariantPtrs[variantIndex]);
+		}
+		uint32_t semanticPairCount;
+		if (!readValue(data, end, semanticPairCount))
+		{
+			return nullptr;
+		}
+		graphPtr->m_semantic_pairs.resize(semanticPairCount);
+		for (auto& semanticPair : graphPtr->m_semantic_pairs)
+		{
+			for (auto& index : semanticPair)
+			{
+				if (!readValue(data, end, index))
+				{
+					return nullptr;
+				}
+			}
+			if (semanticPair[0] >= variantCount || semanticPair[2] >= variantCount ||
+				semanticPair[1] + 1 >= clusterAllelePtrs[semanticPair[0]].size() || semanticPair[3] + 1 >= clusterAllelePtrs[semanticPair[2]].size())
+			{
+				return nullptr;
+			}
+		}
+		uint32_t regionCount;
+		if (!readValue(data, end, regionCount))
+		{
+			return nullptr;
+		}
+		std::string referenceID = graphPtr->m_variant_ptrs[0]->getChromosome();
+		for (uint32_t i = 0; i < regionCount; ++i)
+		{
+			uint32_t startPosition;
+			uint32_t endPosition;
+			if (!readValue(data, end, startPosition) || !readValue(data, end, endPosition))
+			{
+				return nullptr;
+			}
+			graphPtr->m_graph_regions.emplace_back(std::make_shared< Region >(referenceID, startPosition, endPosition, Region::BASED::ONE));
+		}
+		uint32_t nodeCount;
+		uint32_t firstNodeIndex;
+		if (!readValue(data, end, nodeCount) || !readValue(data, end, firstNodeIndex) || firstNodeIndex >= nodeCount || static_cast< size_t >(end - data) < nodeCount)
+		{
+			return nullptr;
+		}
+		std::vector< SerializedNode > serializedNodes(nodeCount);
+		for (auto& serializedNode : serializedNodes)
+		{
+			uint32_t nodePosition;
+			uint8_t alleleType;
+			uint32_t prefixLength;
+			uint32_t suffixLength;
+			std::string sequence;
+			std::string originalSequence;
+			if (!readValue(data, end, nodePosition) || !readValue(data, end, alleleType) || !readValue(data, end, prefixLength) || !readValue(data, end, suffixLength) ||
+				!readSequence(data, end, sequence) || !readSequence(data, end, originalSequence) ||
+				!readIndices(data, end, nodeCount, serializedNode.m_in_node_indices) || !readIndices(data, end, nodeCount, serializedNode.m_out_node_indices))
+			{
+				return nullptr;
+			}
+			uint32_t alleleCount;
+			if (!readValue(data, end, alleleCount))
+			{
+				return nullptr;
+			}
+			for (uint32_t i = 0; i < alleleCount; ++i)
+			{
+				uint32_t variantIndex;
+				uint32_t alleleIndex;
+				if (!readValue(data, end, variantIndex) || !readValue(data, end, alleleIndex) || variantIndex >= variantCount || alleleIndex >= clusterAllelePtrs[variantIndex].size())
+				{
+					return nullptr;
+				}
+				serializedNode.m_allele_ptrs.emplace_back(clusterAllelePtrs[variantIndex][alleleIndex]);
+			}
+			if (originalSequence.size() > 0)
+			{
+				serializedNode.m_node_ptr = std::make_shared< Node >(originalSequence, nodePosition, static_cast< Node::ALLELE_TYPE >(alleleType));
+				serializedNode.m_node_ptr->setCompressedSequence(sequence);
+			}
+			else
+			{
+				serializedNode.m_node_ptr = std::make_shared< Node >(sequence, nodePosition, static_cast< Node::ALLELE_TYPE >(alleleType));
+			}
+			serializedNode.m_node_ptr->setIdenticalPrefixLength(prefixLength);
+			serializedNode.m_node_ptr->setIdenticalSuffixLength(suffixLength);
+		}
+
+		for (auto& semanticPair : graphPtr->m_semantic_pairs)
+		{
+			pairSemanticAlleles(clusterVariantPtrs, semanticPair);
+		}
+		for (auto& serializedNode : serializedNodes)
+		{
+			auto nodePtr = serializedNode.m_node_ptr;
+			for (auto nodeIndex : serializedNode.m_in_node_indices)
+			{
+				nodePtr->addInNode(serializedNodes[nodeIndex].m_node_ptr);
+			}
+			for (auto nodeIndex : serializedNode.m_out_node_indices)
+			{
+				nodePtr->addOutNode(serializedNodes[nodeIndex].m_node_ptr);
+			}
+			for (auto& allelePtr : serializedNode.m_allele_ptrs)
+			{
+				nodePtr->registerAllelePtr(allelePtr);
+				allelePtr->registerNodePtr(nodePtr);
+			}
+			graphPtr->m_all_created_nodes.emplace(nodePtr);
+			graphPtr->m_node_ptrs_map.emplace(nodePtr->getID(), nodePtr);
+		}
+		graphPtr->m_first_node = serializedNodes[firstNodeIndex].m_node_ptr;
+		graphPtr->m_graph_spacing = graphSpacing;
+		graphPtr->m_score_threshold = 70;
+		if (printGraph)
+		{
+			graphPtr->m_graph_printer_ptr = std::make_shared< GraphPrinter >(graphPtr.get());
+		}
+		return graphPtr;
+	}
 }
@@ -3,6 +3,7 @@
 
 #include "core/util/Noncopyable.hpp"
 #include "core/util/GraphPrinter.h"
+#include "core/util/ClusterArena.hpp"
 #include "core/region/Region.h"
 #include "core/reference/FastaReference.h"
 #include "core/vcf/Variant.h"
@@ -13,6 +14,7 @@
 #include "gssw.h"
 
 #include <memory>
+#include <array>
 
 namespace graphite
 {
@@ -20,7 +22,7 @@ namespace graphite
 	{
 	public:
 		typedef std::shared_ptr< Graph > SharedPtr;
-		Graph(FastaReference::SharedPtr fastaReferencePtr, std::vector< Variant::SharedPtr > variantPtrs, uint32_t graphSpacing, bool printGraph);
+		Graph(FastaReference::SharedPtr fastaReferencePtr, std::vector< Variant::SharedPtr > variantPtrs, uint32_t graphSpacing, bool printGraph, ClusterArena::SharedPtr arenaPtr = nullptr); // the nodes come from the arena when it is set
 		Graph(FastaReference::SharedPtr fastaReferencePtr, Region::SharedPtr regionPtr);
 		Graph(const Graph& graph) = delete;
 		Graph& operator=(const Graph& graph) = delete;
@@ -30,18 +32,26 @@ namespace graphite
 		std::vector< Region::SharedPtr > getRegionPtrs();
         std::vector< std::vector< Node::SharedPtr > > generateAllPaths();
 		Region::SharedPtr getGraphRegion();
+		Region::SharedPtr getReferenceRegion() { return m_reference_region_ptr; } // the reference the graph was built from, nullptr for stored graphs
 		std::string getReferenceSequence();
 		std::vector< std::string > getAllPathsAsStrings();
 
 		void printGraphVisOutput();
 		void clearResources();
 		Graph::SharedPtr createCopy();
-		std::unordered_map< uint32_t, Node::SharedPtr > getNodePtrsMap() { return m_node_ptrs_map; }
+		const std::unordered_map< uint32_t, Node::SharedPtr >& getNodePtrsMap() { return m_node_ptrs_map; }
 		Node::SharedPtr getFirstNode() { return m_first_node; }
 
 		void removeNodePtr(Node* nodePtr);
 
+		std::vector< Node::SharedPtr > getOrderedNodePtrs();
+		bool serialize(std::string& buffer, const std::vector< Variant::SharedPtr >& clusterVariantPtrs);
+		static Graph::SharedPtr deserialize(const char* data, size_t byteCount, const std::vector< Variant::SharedPtr >& clusterVariantPtrs, uint32_t graphSpacing, bool printGraph);
+
 	private:
+		typedef std::array< uint32_t, 4 > SemanticPair; // the query variant, its alt allele, the variant and its alt allele as indices into the cluster's variants
+
+		static void pairSemanticAlleles(const std::vector< Variant::SharedPtr >& variantPtrs, const SemanticPair& semanticPair);
 		std::vector< Variant::SharedPtr > reconcileVariantSemantics(std::vector< Variant::SharedPtr >& variantPtrs);
 		void addAdditionalNodeEdges();
 		void compressLargeNodes();
@@ -59,8 +69,11 @@ namespace graphite
 		bool isNodeSuffixAmbiguous(std::string& nodeSequence, Node* comparatorNode, std::unordered_set< Node::SharedPtr >& nodePtrs);
 
 		FastaReference::SharedPtr m_fasta_reference_ptr;
+		ClusterArena::SharedPtr m_arena_ptr;
 		std::vector< Variant::SharedPtr > m_variant_ptrs;
+		std::vector< SemanticPair > m_semantic_pairs;
 		std::vector< Region::SharedPtr > m_graph_regions;
+		Region::SharedPtr m_reference_region_ptr;
 		std::unordered_map< uint32_t, Node::SharedPtr > m_node_ptrs_map;
 		uint32_t m_graph_spacing;
 		Node::SharedPtr m_first_node;
@@ -1,6 +1,8 @@
 #include "GraphProcessor.h"
 #include "ReferenceGraph.h"
 #include "GraphTraceback.hpp"
+#include "core/util/StageProfiler.h"
+#include "core/util/MemoryAccounting.h"
 
 #include <unordered_set>
 #include <thread>
@@ -12,7 +14,16 @@
 
 namespace graphite
 {
-	GraphProcessor::GraphProcessor(FastaReference::SharedPtr fastaReferencePtr, const std::vector< AlignmentReader::SharedPtr >& alignmentReaderPtrs, const std::vector< VCFReader::SharedPtr >& vcfReaderPtrs,  uint32_t matchValue, uint32_t mismatchValue, uint32_t gapOpenValue, uint32_t gapExtensionValue, bool printGraph, int32_t mappingQuality, int32_t readSampleLimit, uint32_t numberOfThreads) :
+	static const size_t VARIANT_BYTE_ESTIMATE = 2048;
+	static const size_t ALIGNMENT_BYTE_ESTIMATE = 256; // the alignment, its names and its entries in the allele counts
+	static const size_t READ_BATCH_SIZE = 32; // reads per task
+
+	GraphProcessor::GraphProcessor(FastaReference::SharedPtr fastaReferencePtr, const std::vector< AlignmentReader::SharedPtr >& alignmentReaderPtrs, const std::vector< VCFReader::SharedPtr >& vcfReaderPtrs,  uint32_t matchValue, uint32_t mismatchValue, uint32_t gapOpenValue, uint32_t gapExtensionValue, bool printGraph, int32_t mappingQuality, int32_t readSampleLimit, uint32_t numberOfThreads, size_t clusterBufferByteCount) :
+		GraphProcessor(fastaReferencePtr, alignmentReaderPtrs, vcfReaderPtrs, matchValue, mismatchValue, gapOpenValue, gapExtensionValue, printGraph, mappingQuality, readSampleLimit, std::make_shared< ThreadPool >(numberOfThreads), clusterBufferByteCount)
+	{
+	}
+
+	GraphProcessor::GraphProcessor(FastaReference::SharedPtr fastaReferencePtr, const std::vector< AlignmentReader::SharedPtr >& alignmentReaderPtrs, const std::vector< VCFReader::SharedPtr >& vcfReaderPtrs,  uint32_t matchValue, uint32_t mismatchValue, uint32_t gapOpenValue, uint32_t gapExtensionValue, bool printGraph, int32_t mappingQuality, int32_t readSampleLimit, std::shared_ptr< ThreadPool > threadPoolPtr, size_t clusterBufferByteCount) :
 		m_fasta_reference_ptr(fastaReferencePtr),
 		m_alignment_reader_ptrs(alignmentReaderPtrs),
 		m_vcf_reader_ptrs(vcfReaderPtrs),
@@ -21,11 +32,19 @@ namespace graphite
 		m_mismatch_value(mismatchValue),
 		m_gap_open_value(gapOpenValue),
 		m_gap_extension_value(gapExtensionValue),
-		m_thread_pool(numberOfThreads),
+		m_thread_pool_ptr(threadPoolPtr),
+		m_reorder_buffer(clusterBufferByteCount, std::bind(&GraphProcessor::writeVariants, this, std::placeholders::_1)),
 		m_print_graphs(printGraph),
 		m_mapping_quality(mappingQuality),
 		m_read_sample_limit(readSampleLimit),
-		m_override_shared_ptr(nullptr)
+		m_override_shared_ptr(nullptr),
+		m_graph_store_ptr(nullptr),
+		m_result_cache_ptr(nullptr),
+		m_checkpoint_ptr(nullptr),
+		m_cluster_profiler_ptr(nullptr),
+		m_graph_spacing(0),
+		m_capture_minimum_nanoseconds(0),
+		m_progress_reporter_ptr(nullptr)
 	{
 	}
 
@@ -33,193 +52,397 @@ namespace graphite
 	{
 	}
 
-	void GraphProcessor::processVariants()
+	// the graph spacing is the largest read size
+	uint32_t GraphProcessor::getGraphSpacing(const std::vector< AlignmentReader::SharedPtr >& alignmentReaderPtrs)
 	{
 		uint32_t graphSpacing = 10;
-		bool overwriteSamples = false;
-		// set the graph spacing to be the largest read size
-		for (auto alignmentReaderPtr : this->m_alignment_reader_ptrs)
+		for (auto alignmentReaderPtr : alignmentReaderPtrs)
 		{
 			graphSpacing = (graphSpacing >= alignmentReaderPtr->getReadLength()) ? graphSpacing : alignmentReaderPtr->getReadLength();
 		}
-		std::vector< Variant::SharedPtr > variantPtrs;
+		return graphSpacing;
+	}
+
+	void GraphProcessor::setClusterCapture(const std::string& captureDirectory, double minimumSeconds)
+	{
+		this->m_capture_directory = captureDirectory;
+		this->m_capture_minimum_nanoseconds = static_cast< uint64_t >(minimumSeconds * 1e9);
+	}
+
+	void GraphProcessor::processVariants()
+	{
+		uint32_t graphSpacing = (this->m_graph_spacing > 0) ? this->m_graph_spacing : getGraphSpacing(this->m_alignment_reader_ptrs);
+		bool overwriteSamples = false;
 		while (true)
 		{
-			variantPtrs.clear();
+			auto variantPtrs = std::make_shared< std::vector< Variant::SharedPtr > >();
+			if (this->m_cluster_source)
+			{
+				this->m_cluster_source(*variantPtrs, graphSpacing);
+			}
 			for (auto vcfReaderPtr : this->m_vcf_reader_ptrs)
 			{
-				vcfReaderPtr->getNextVariants(variantPtrs, graphSpacing);
+				vcfReaderPtr->getNextVariants(*variantPtrs, graphSpacing);
 			}
 			// only adjudicate if there are variants to adjudicate
-			if (variantPtrs.size() > 0)
+			if (variantPtrs->size() > 0)
 			{
-				adjudicateVariants(variantPtrs, graphSpacing);
-				// for (auto variantPtr : variantPtrs)
-				for (int i = 0; i < variantPtrs.size(); ++i)
-				{
-					auto variantPtr = variantPtrs[i];
-					variantPtr->writeVariant();
-				}
+				adjudicateVariants(variantPtrs, graphSpacing); // returns once the cluster's reads are queued, the reorder buffer writes it
 			}
 			else
 			{
 				break;
 			}
 		}
+		this->m_reorder_buffer.waitForAll(); // every task belongs to a cluster so this waits out our work on a shared pool
 	}
 
-	void GraphProcessor::adjudicateVariants(std::vector< Variant::SharedPtr >& variantPtrs, uint32_t graphSpacing)
+	// runs on one thread at a time in VCF order, so between two calls the output ends on a whole cluster
+	void GraphProcessor::writeVariants(Cluster& cluster)
 	{
-		// generate graph
-		auto graphPtr = std::make_shared< Graph >(this->m_fasta_reference_ptr, variantPtrs, graphSpacing, this->m_print_graphs);
+		auto& variantPtrs = *cluster.m_variant_ptrs;
+		{
+			StageProfiler::Timer timer(StageProfiler::STAGE::OUTPUT, variantPtrs.size(), (cluster.m_profile_ptr != nullptr) ? &cluster.m_profile_ptr->m_output_nanoseconds : nullptr);
+			if (this->m_cluster_callback)
+			{
+				this->m_cluster_callback(variantPtrs);
+			}
+			else
+			{
+				for (auto& variantPtr : variantPtrs)
+				{
+					variantPtr->writeVariant();
+				}
+			}
+		}
+		if (this->m_cluster_profiler_ptr != nullptr)
+		{
+			this->m_cluster_profiler_ptr->write(*cluster.m_profile_ptr);
+		}
+		// every read task has finished so the profile holds the cluster's whole cost
+		if (cluster.m_snapshot_ptr != nullptr && cluster.m_profile_ptr->getAdjudicationNanoseconds() >= this->m_capture_minimum_nanoseconds)
+		{
+			cluster.m_snapshot_ptr->setCapturedNanoseconds(cluster.m_profile_ptr->getAdjudicationNanoseconds());
+			cluster.m_snapshot_ptr->write(this->m_capture_directory + "/" + variantPtrs.front()->getChromosome() + "_" + std::to_string(variantPtrs.front()->getPosition()) + ".graphite_cluster");
+		}
+		if (this->m_checkpoint_ptr != nullptr)
+		{
+			this->m_checkpoint_ptr->update();
+		}
+		if (this->m_progress_reporter_ptr != nullptr)
+		{
+			this->m_progress_reporter_ptr->clusterWritten(variantPtrs.front()->getChromosome(), variantPtrs.front()->getPosition(), variantPtrs.size());
+		}
+		// the cluster owns its graph, once it is written nothing uses the nodes and the alleles that hold each other
+		if (cluster.m_graph_ptr != nullptr)
+		{
+			cluster.m_graph_ptr->clearResources();
+			cluster.m_graph_ptr = nullptr;
+		}
+	}
+
+	void GraphProcessor::adjudicateVariants(std::shared_ptr< std::vector< Variant::SharedPtr > > variantPtrs, uint32_t graphSpacing)
+	{
+		// over the soft memory limit no more graphs are built or reads fetched until the clusters in flight are written
+		if (MemoryAccounting::getSoftLimit() > 0)
+		{
+			this->m_reorder_buffer.waitWhile(&MemoryAccounting::isOverSoftLimit);
+		}
+
+		Cluster cluster;
+		cluster.m_variant_ptrs = variantPtrs;
+		cluster.m_profile_ptr = (this->m_cluster_profiler_ptr != nullptr || !this->m_capture_directory.empty()) ? std::make_shared< ClusterProfile >() : nullptr;
+		auto clusterProfilePtr = cluster.m_profile_ptr;
+		if (this->m_progress_reporter_ptr != nullptr)
+		{
+			this->m_progress_reporter_ptr->clusterStarted(variantPtrs->front()->getChromosome(), variantPtrs->front()->getPosition());
+		}
+
+		// the cluster's Node and Alignment objects come from one arena, given back in one piece once the cluster is written
+		auto arenaPtr = std::make_shared< ClusterArena >();
+
+		// generate graph, unless the graph store has it
+		Graph::SharedPtr graphPtr = nullptr;
+		{
+			StageProfiler::Timer timer(StageProfiler::STAGE::GRAPH_CONSTRUCTION, variantPtrs->size(), (clusterProfilePtr != nullptr) ? &clusterProfilePtr->m_graph_nanoseconds : nullptr);
+			graphPtr = (this->m_graph_store_ptr != nullptr) ? this->m_graph_store_ptr->loadGraph(*variantPtrs, this->m_print_graphs) : nullptr;
+			if (graphPtr == nullptr)
+			{
+				graphPtr = std::make_shared< Graph >(this->m_fasta_reference_ptr, *variantPtrs, graphSpacing, this->m_print_graphs, arenaPtr);
+			}
+		}
+		cluster.m_graph_ptr = graphPtr;
 		std::vector< Region::SharedPtr > graphRegionPtrs = graphPtr->getRegionPtrs();
 
+		// stored graphs don't know their reference window so they can't be captured
+		if (!this->m_capture_directory.empty() && graphPtr->getReferenceRegion() != nullptr)
+		{
+			auto referenceRegionPtr = graphPtr->getReferenceRegion();
+			cluster.m_snapshot_ptr = std::make_shared< ClusterSnapshot >(*variantPtrs, referenceRegionPtr, this->m_fasta_reference_ptr->getSequenceStringFromRegion(referenceRegionPtr), graphSpacing, this->m_match_value, this->m_mismatch_value, this->m_gap_open_value, this->m_gap_extension_value);
+		}
+
 		// get all alignments
 		std::vector< Alignment::SharedPtr > alignmentPtrs;
 
-		getAlignmentsInRegion(alignmentPtrs, graphRegionPtrs, true);
-		for (auto alignmentPtr : alignmentPtrs)
-		{
-			std::string sampleName;
-			sampleName = alignmentPtr->getSample()->getName();
-			uint32_t matchValue = m_match_value;
-			uint32_t mismatchValue = m_mismatch_value;
-			uint32_t gapOpenValue = m_gap_open_value;
-			uint32_t gapExtensionValue = m_gap_extension_value;
-			// check if the alignment has already been processed
-			/*
+		getAlignmentsInRegion(alignmentPtrs, graphRegionPtrs, true, clusterProfilePtr, arenaPtr);
+		if (cluster.m_snapshot_ptr != nullptr)
+		{
+			cluster.m_snapshot_ptr->setAlignmentPtrs(alignmentPtrs);
+		}
+		if (this->m_progress_reporter_ptr != nullptr)
+		{
+			this->m_progress_reporter_ptr->addFetchedReads(alignmentPtrs.size());
+		}
+
+		if (clusterProfilePtr != nullptr)
+		{
+			clusterProfilePtr->m_contig = variantPtrs->front()->getChromosome();
+			clusterProfilePtr->m_start_position = (graphRegionPtrs.size() > 0) ? graphRegionPtrs.front()->getStartPosition() : variantPtrs->front()->getPosition();
+			clusterProfilePtr->m_end_position = (graphRegionPtrs.size() > 0) ? graphRegionPtrs.back()->getEndPosition() : variantPtrs->back()->getPosition();
+			clusterProfilePtr->m_variant_count = variantPtrs->size();
+			clusterProfilePtr->m_fetched_read_count = alignmentPtrs.size();
+			for (auto& nodeIter : graphPtr->getNodePtrsMap())
 			{
-				std::lock_guard< std::mutex > l(m_alignment_tracker_mutex);
-				if (m_alignment_tracker_set.find(alignmentPtr->getUniqueReadName()) != m_alignment_tracker_set.end())
+				++clusterProfilePtr->m_node_count;
+				clusterProfilePtr->m_graph_sequence_length += nodeIter.second->getSequence().size();
+			}
+		}
+
+		// a rough figure for what the cluster holds until it is written, the reads dominate
+		size_t clusterByteCount = variantPtrs->size() * VARIANT_BYTE_ESTIMATE;
+		for (auto& alignmentPtr : alignmentPtrs)
+		{
+			clusterByteCount += ALIGNMENT_BYTE_ESTIMATE + alignmentPtr->getLength();
+		}
+		uint64_t clusterSequence = this->m_reorder_buffer.reserve(clusterByteCount); // blocks while too many clusters are in flight
+		if (alignmentPtrs.size() == 0)
+		{
+			this->m_reorder_buffer.complete(clusterSequence, cluster);
+			return;
+		}
+
+		// the tasks only read the context, the graph and the reads are shared rather than captured by every task
+		auto contextPtr = std::make_shared< ClusterContext >();
+		contextPtr->m_cluster = cluster;
+		contextPtr->m_sequence = clusterSequence;
+		contextPtr->m_alignment_ptrs = std::move(alignmentPtrs);
+		contextPtr->m_match_value = this->m_match_value;
+		contextPtr->m_mismatch_value = this->m_mismatch_value;
+		contextPtr->m_gap_open_value = this->m_gap_open_value;
+		contextPtr->m_gap_extension_value = this->m_gap_extension_value;
+		contextPtr->m_result_cache_ptr = this->m_result_cache_ptr; // reads whose alignment to this graph an earlier run cached are counted from the cache
+		contextPtr->m_cached_graph_ptr = (this->m_result_cache_ptr != nullptr) ? this->m_result_cache_ptr->getCachedGraph(graphPtr, *variantPtrs) : nullptr;
+		contextPtr->m_reorder_buffer_ptr = &this->m_reorder_buffer;
+
+		// the reads go to the pool in batches that share the context, small clusters are still spread over every thread
+		size_t alignmentCount = contextPtr->m_alignment_ptrs.size();
+		size_t threadCount = std::max< size_t >(this->m_thread_pool_ptr->getThreadCount(), 1);
+		size_t batchSize = std::max< size_t >(std::min< size_t >(READ_BATCH_SIZE, (alignmentCount + threadCount - 1) / threadCount), 1);
+		contextPtr->m_remaining_batch_count = (alignmentCount + batchSize - 1) / batchSize;
+		for (size_t batchStart = 0; batchStart < alignmentCount; batchStart += batchSize)
+		{
+			size_t batchEnd = std::min(batchStart + batchSize, alignmentCount);
+			auto funct = [contextPtr, batchStart, batchEnd]()
+				{
+					const ClusterContext& context = *contextPtr;
+					for (size_t i = batchStart; i < batchEnd; ++i)
+					{
+						adjudicateAlignment(context, context.m_alignment_ptrs[i]);
+					}
+					if (--contextPtr->m_remaining_batch_count == 0)
+					{
+						context.m_reorder_buffer_ptr->complete(context.m_sequence, context.m_cluster);
+					}
+				};
+			this->m_thread_pool_ptr->enqueue(funct);
+		}
+	}
+
+	void GraphProcessor::adjudicateAlignment(const ClusterContext& context, const Alignment::SharedPtr& alignmentPtr)
+	{
+		auto clusterProfilePtr = context.m_cluster.m_profile_ptr.get();
+		bool isCached = false;
+		if (context.m_cached_graph_ptr != nullptr)
+		{
+			StageProfiler::Timer timer(StageProfiler::STAGE::COUNTING, 0, (clusterProfilePtr != nullptr) ? &clusterProfilePtr->m_counting_nanoseconds : nullptr);
+			isCached = context.m_result_cache_ptr->countCachedScores(*context.m_cached_graph_ptr, alignmentPtr);
+		}
+		if (isCached)
+		{
+			if (clusterProfilePtr != nullptr)
+			{
+				++clusterProfilePtr->m_cached_read_count;
+			}
+			return;
+		}
+		ResultCache::NodeScores nodeScores;
+		GraphTraceback graphTraceback(context.m_cluster.m_graph_ptr, context.m_match_value, context.m_mismatch_value, context.m_gap_open_value, context.m_gap_extension_value);
+		{
+			StageProfiler::Timer timer(StageProfiler::STAGE::ALIGNMENT, alignmentPtr->getLength(), (clusterProfilePtr != nullptr) ? &clusterProfilePtr->m_alignment_nanoseconds : nullptr);
+			graphTraceback.processGraph(alignmentPtr);
+		}
+		if (clusterProfilePtr != nullptr)
+		{
+			++clusterProfilePtr->m_aligned_read_count;
+		}
+		auto tracebackNodePtrs = graphTraceback.getTracebackNodePtrs();
+		auto originalGraphTracebackCigar = graphTraceback.getNormalizedCigarString();
+		int origTracebackSoftclipCount = std::count(originalGraphTracebackCigar.begin(), originalGraphTracebackCigar.end(), 'S');
+		int counter = -1;
+		if (graphTraceback.getTotalScore() >= 90)
+		{
+			for (auto nodePtr : tracebackNodePtrs)
+			{
+
+				if (!nodePtr->hasSiblings()) // if this is a reference "backbone" node that connects variants then skip it
 				{
 					continue;
 				}
-				m_alignment_tracker_set.emplace(alignmentPtr->getUniqueReadName());
-			}
-			*/
-			auto funct = [graphPtr, alignmentPtr, matchValue, mismatchValue, gapOpenValue, gapExtensionValue, variantPtrs]()
+
+				StageProfiler::Timer realignmentTimer(StageProfiler::STAGE::AMBIGUITY_REALIGNMENT, alignmentPtr->getLength(), (clusterProfilePtr != nullptr) ? &clusterProfilePtr->m_realignment_nanoseconds : nullptr);
+				GraphTraceback altGraphTraceback(context.m_cluster.m_graph_ptr, context.m_match_value, context.m_mismatch_value, context.m_gap_open_value, context.m_gap_extension_value);
+				altGraphTraceback.processGraph(alignmentPtr, nodePtr); // the graph without this node
+				realignmentTimer.stop();
+				if (clusterProfilePtr != nullptr)
 				{
-					auto graphTraceback = std::make_shared< GraphTraceback >(graphPtr, matchValue, mismatchValue, gapOpenValue, gapExtensionValue);
-					graphTraceback->processGraph(alignmentPtr);
-					auto tracebackNodePtrs = graphTraceback->getTracebackNodePtrs();
-					auto originalGraphTracebackCigar = graphTraceback->getNormalizedCigarString();
-					int origTracebackSoftclipCount = std::count(originalGraphTracebackCigar.begin(), originalGraphTracebackCigar.end(), 'S');
-					int counter = -1;
-					if (graphTraceback->getTotalScore() >= 90)
+					++clusterProfilePtr->m_realignment_count;
+				}
+				auto altGraphTracebackCigar = altGraphTraceback.getNormalizedCigarString();
+				auto nodeScorePercent = graphTraceback.getNodeScorePercent(nodePtr);
+				auto cigarComparisonEqual = originalGraphTracebackCigar.compare(altGraphTracebackCigar);
+				int altTracebackSoftclipCount = std::count(altGraphTracebackCigar.begin(), altGraphTracebackCigar.end(), 'S');
+
+				// static std::mutex l;
+				// std::lock_guard< std::mutex > lock(l);
+				// std::cout << "---------------" << std::endl;
+				// std::cout << "orig: " << graphTraceback.getTracebackAsSequence("|") << "\tscore: " << graphTraceback.getTotalScore() << std::endl;
+				// std::cout << "alt:  " << altGraphTraceback.getTracebackAsSequence("|") << "\tscore: " << altGraphTraceback.getTotalScore() << std::endl;
+				// std::cout << "\torigCig: " << originalGraphTracebackCigar << std::endl;
+				// std::cout << "\taltCig:  " << altGraphTracebackCigar << std::endl;
+				// if (cigarComparisonEqual == 0)
+				// {
+					// std::cout << "PASSED - CIGAR MATCH" << std::endl;
+				// }
+				// if (graphTraceback.getTotalScore() == altGraphTraceback.getTotalScore())
+				// {
+					// std::cout << "scores are equal" << std::endl;
+				// }
+
+				if (nodeScorePercent >= 70)
+				{
+					//if (graphTraceback.getTotalScore() == altGraphTraceback.getTotalScore()) // check the cigar here if you want to
+					bool isAmbiguous = (cigarComparisonEqual == 0 || graphTraceback.getTotalScore() == altGraphTraceback.getTotalScore()) && (origTracebackSoftclipCount == altTracebackSoftclipCount);
+					auto nodeAllelePtrs = nodePtr->getAllelePtrs();
+					StageProfiler::Timer countingTimer(StageProfiler::STAGE::COUNTING, nodeAllelePtrs.size(), (clusterProfilePtr != nullptr) ? &clusterProfilePtr->m_counting_nanoseconds : nullptr);
+					for (auto nodeAllelePtr : nodeAllelePtrs)
 					{
-						for (auto nodePtr : tracebackNodePtrs)
+						if (isAmbiguous)
 						{
-
-							if (!nodePtr->hasSiblings()) // if this is a reference "backbone" node that connects variants then skip it
+							// this is if the node with that alignment is ambiguous
+							nodeAllelePtr->incrementScoreCount(alignmentPtr, -1);
+						}
+						else
+						{
+							/*
+							if (nodePtr->getAlleleType() == Node::ALLELE_TYPE::REF)
 							{
-								continue;
-							}
+								std::cout << "---------------" << std::endl;
 
-							auto altGraphPtr = graphPtr->createCopy();
-							altGraphPtr->removeNodePtr(nodePtr);
-							auto altGraphTraceback = std::make_shared< GraphTraceback >(altGraphPtr, matchValue, mismatchValue, gapOpenValue, gapExtensionValue);
-							altGraphTraceback->processGraph(alignmentPtr);
-							auto altGraphTracebackCigar = altGraphTraceback->getNormalizedCigarString();
-							auto nodeScorePercent = graphTraceback->getNodeScorePercent(nodePtr);
-							auto cigarComparisonEqual = originalGraphTracebackCigar.compare(altGraphTracebackCigar);
-							int altTracebackSoftclipCount = std::count(altGraphTracebackCigar.begin(), altGraphTracebackCigar.end(), 'S');
-
-							// static std::mutex l;
-							// std::lock_guard< std::mutex > lock(l);
-							// std::cout << "---------------" << std::endl;
-							// std::cout << "orig: " << graphTraceback->getTracebackAsSequence("|") << "\tscore: " << graphTraceback->getTotalScore() << std::endl;
-							// std::cout << "alt:  " << altGraphTraceback->getTracebackAsSequence("|") << "\tscore: " << altGraphTraceback->getTotalScore() << std::endl;
-							// std::cout << "\torigCig: " << originalGraphTracebackCigar << std::endl;
-							// std::cout << "\taltCig:  " << altGraphTracebackCigar << std::endl;
-							// if (cigarComparisonEqual == 0)
-							// {
-								// std::cout << "PASSED - CIGAR MATCH" << std::endl;
-							// }
-							// if (graphTraceback->getTotalScore() == altGraphTraceback->getTotalScore())
-							// {
-								// std::cout << "scores are equal" << std::endl;
-							// }
-
-							if (nodeScorePercent >= 70)
-							{
-								for (auto nodeAllelePtr : nodePtr->getAllelePtrs())
+								std::cout << "all paths: " << std::endl;
+								auto paths = altGraphPtr->getAllPathsAsStrings();
+								for (auto path : paths)
 								{
-									//if (graphTraceback->getTotalScore() == altGraphTraceback->getTotalScore()) // check the cigar here if you want to
-									if ((cigarComparisonEqual == 0 || graphTraceback->getTotalScore() == altGraphTraceback->getTotalScore()) && (origTracebackSoftclipCount == altTracebackSoftclipCount))
-									{
-										// this is if the node with that alignment is ambiguous
-										nodeAllelePtr->incrementScoreCount(alignmentPtr, -1);
-									}
-									else
-									{
-										/*
-										if (nodePtr->getAlleleType() == Node::ALLELE_TYPE::REF)
-										{
-											std::cout << "---------------" << std::endl;
-
-											std::cout << "all paths: " << std::endl;
-											auto paths = altGraphPtr->getAllPathsAsStrings();
-											for (auto path : paths)
-											{
-												std::cout << "path: " << path << std::endl;
-											}
-
-											std::cout << "alignment: " << alignmentPtr->getSequence() << std::endl;
-											std::cout << "we're counting allele: " << nodeAllelePtr->getSequence() << std::endl;
-											std::cout << "orig: " << graphTraceback->getTracebackAsSequence("|") << "\tscore: " << graphTraceback->getTotalScore() << std::endl;
-											std::cout << "alt:  " << altGraphTraceback->getTracebackAsSequence("|") << "\tscore: " << altGraphTraceback->getTotalScore() << std::endl;
-											std::cout << "\torigCig: " << originalGraphTracebackCigar << std::endl;
-											std::cout << "\taltCig:  " << altGraphTracebackCigar << std::endl;
-											std::cout << "---------------" << std::endl;
-										}
-										*/
-										nodeAllelePtr->incrementScoreCount(alignmentPtr, nodeScorePercent);
-									}
+									std::cout << "path: " << path << std::endl;
 								}
+
+								std::cout << "alignment: " << alignmentPtr->getSequence() << std::endl;
+								std::cout << "we're counting allele: " << nodeAllelePtr->getSequence() << std::endl;
+								std::cout << "orig: " << graphTraceback.getTracebackAsSequence("|") << "\tscore: " << graphTraceback.getTotalScore() << std::endl;
+								std::cout << "alt:  " << altGraphTraceback.getTracebackAsSequence("|") << "\tscore: " << altGraphTraceback.getTotalScore() << std::endl;
+								std::cout << "\torigCig: " << originalGraphTracebackCigar << std::endl;
+								std::cout << "\taltCig:  " << altGraphTracebackCigar << std::endl;
+								std::cout << "---------------" << std::endl;
 							}
-							// std::cout << "---------------" << std::endl;
+							*/
+							nodeAllelePtr->incrementScoreCount(alignmentPtr, nodeScorePercent);
 						}
 					}
-				};
-			m_thread_pool.enqueue(funct);
+					nodeScores.emplace_back(nodePtr, isAmbiguous ? -1 : static_cast< int32_t >(nodeScorePercent));
+				}
+				// std::cout << "---------------" << std::endl;
+			}
+		}
+		if (context.m_cached_graph_ptr != nullptr)
+		{
+			context.m_result_cache_ptr->addScores(*context.m_cached_graph_ptr, alignmentPtr, nodeScores);
 		}
-		m_thread_pool.join();
 	}
 
-	void GraphProcessor::getAlignmentsInRegion(std::vector< Alignment::SharedPtr >& alignmentPtrs, std::vector< Region::SharedPtr > regionPtrs, bool getFlankingUnalignedReads)
+	void GraphProcessor::getAlignmentsInRegion(std::vector< Alignment::SharedPtr >& alignmentPtrs, std::vector< Region::SharedPtr > regionPtrs, bool getFlankingUnalignedReads, ClusterProfile::SharedPtr clusterProfilePtr, ClusterArena::SharedPtr arenaPtr)
 	{
-		std::vector< Alignment::SharedPtr > alignmentPtrsTmp;
-		for (auto iter = regionPtrs.begin(); iter != regionPtrs.end(); ++iter)
-		{
-			auto regionPtr = (*iter);
-			for (auto alignmentReaderPtr : this->m_alignment_reader_ptrs)
+		// every reader's reads are kept by region so the result is in the same order however the readers are scheduled
+		std::vector< std::vector< std::vector< Alignment::SharedPtr > > > readerAlignmentPtrs(this->m_alignment_reader_ptrs.size());
+		auto fetchReaderAlignments = [this, &regionPtrs, &readerAlignmentPtrs, getFlankingUnalignedReads, &clusterProfilePtr, &arenaPtr](size_t readerIndex)
 			{
-				if (iter == regionPtrs.begin() && getFlankingUnalignedReads)
+				StageProfiler::Timer timer(StageProfiler::STAGE::READ_FETCH, 0, (clusterProfilePtr != nullptr) ? &clusterProfilePtr->m_fetch_nanoseconds : nullptr);
+				auto alignmentReaderPtr = this->m_alignment_reader_ptrs[readerIndex];
+				auto& regionAlignmentPtrs = readerAlignmentPtrs[readerIndex];
+				regionAlignmentPtrs.resize(regionPtrs.size());
+				std::vector< Alignment::SharedPtr > alignmentPtrsTmp;
+				std::unordered_set< std::string > alignmentIDTracker; // make sure the reads only appear once, reads from different files are different reads
+				for (size_t i = 0; i < regionPtrs.size(); ++i)
 				{
-					auto flankingRegionPtr = std::make_shared< Region >(regionPtr->getReferenceID(), regionPtr->getStartPosition() - this->m_flanking_padding, regionPtr->getStartPosition(), regionPtr->getBased());
-					alignmentReaderPtr->fetchAlignmentPtrsInRegion(alignmentPtrsTmp, flankingRegionPtr, false, false, this->m_mapping_quality);
-				}
-				alignmentReaderPtr->fetchAlignmentPtrsInRegion(alignmentPtrsTmp, regionPtr, false, false, this->m_mapping_quality);
-				if (iter == regionPtrs.end() && getFlankingUnalignedReads)
-				{
-					auto flankingRegionPtr = std::make_shared< Region >(regionPtr->getReferenceID(), regionPtr->getEndPosition(), regionPtr->getEndPosition() + this->m_flanking_padding, regionPtr->getBased());
-					alignmentReaderPtr->fetchAlignmentPtrsInRegion(alignmentPtrsTmp, flankingRegionPtr, false, false, this->m_mapping_quality);
+					auto regionPtr = regionPtrs[i];
+					alignmentPtrsTmp.clear();
+					if (i == 0 && getFlankingUnalignedReads)
+					{
+						auto flankingRegionPtr = std::make_shared< Region >(regionPtr->getReferenceID(), regionPtr->getStartPosition() - this->m_flanking_padding, regionPtr->getStartPosition(), regionPtr->getBased());
+						alignmentReaderPtr->fetchAlignmentPtrsInRegion(alignmentPtrsTmp, flankingRegionPtr, false, false, this->m_mapping_quality, arenaPtr);
+					}
+					alignmentReaderPtr->fetchAlignmentPtrsInRegion(alignmentPtrsTmp, regionPtr, false, false, this->m_mapping_quality, arenaPtr);
+					for (auto& alignmentPtr : alignmentPtrsTmp)
+					{
+						if (alignmentIDTracker.emplace(alignmentPtr->getUniqueReadName()).second)
+						{
+							regionAlignmentPtrs[i].emplace_back(alignmentPtr);
+						}
+					}
 				}
+				timer.setItemCount(alignmentIDTracker.size());
+			};
+		if (this->m_alignment_reader_ptrs.size() > 1)
+		{
+			// one fetch per sample file side by side, each reader is only used by one thread at a time
+			std::vector< std::future< void > > fetchFutures;
+			for (size_t i = 0; i < this->m_alignment_reader_ptrs.size(); ++i)
+			{
+				fetchFutures.emplace_back(this->m_thread_pool_ptr->enqueue(fetchReaderAlignments, i));
+			}
+			for (auto& fetchFuture : fetchFutures)
+			{
+				fetchFuture.get();
 			}
 		}
+		else if (this->m_alignment_reader_ptrs.size() == 1)
+		{
+			fetchReaderAlignments(0);
+		}
 
-		// make sure the reads only appear in alignmentPtrs once
 		alignmentPtrs.clear();
-		std::unordered_set< std::string > alignmentIDTracker;
-		for (auto alignmentPtr : alignmentPtrsTmp)
+		for (size_t i = 0; i < regionPtrs.size(); ++i)
 		{
-			std::string alignmentID = alignmentPtr->getUniqueReadName();
-			if (alignmentIDTracker.find(alignmentID) == alignmentIDTracker.end())
+			for (auto& regionAlignmentPtrs : readerAlignmentPtrs)
 			{
-				alignmentPtrs.emplace_back(alignmentPtr);
-				alignmentIDTracker.emplace(alignmentID);
+				alignmentPtrs.insert(alignmentPtrs.end(), regionAlignmentPtrs[i].begin(), regionAlignmentPtrs[i].end());
 			}
 		}
+		if (this->m_alignment_source)
+		{
+			StageProfiler::Timer timer(StageProfiler::STAGE::READ_FETCH, 0, (clusterProfilePtr != nullptr) ? &clusterProfilePtr->m_fetch_nanoseconds : nullptr);
+			size_t alignmentCount = alignmentPtrs.size();
+			this->m_alignment_source(alignmentPtrs, regionPtrs);
+			timer.setItemCount(alignmentPtrs.size() - alignmentCount);
+		}
 		if (this->m_read_sample_limit < alignmentPtrs.size())
 		{
 			std::shuffle(alignmentPtrs.begin(), alignmentPtrs.end(), default_random_engine(0));
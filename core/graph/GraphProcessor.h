@@ -5,11 +5,18 @@
 #include "core/region/Region.h"
 #include "core/reference/FastaReference.h"
 #include "core/vcf/VCFReader.h"
+#include "core/vcf/Checkpoint.h"
 #include "core/alignment/AlignmentReader.h"
 #include "core/alignment/Alignment.h"
 #include "core/util/ThreadPool.hpp"
+#include "core/util/ReorderBuffer.hpp"
 #include "core/util/GraphPrinter.h"
+#include "core/util/ProgressReporter.h"
 #include "Graph.h"
+#include "GraphStore.h"
+#include "ResultCache.h"
+#include "ClusterProfiler.h"
+#include "ClusterSnapshot.h"
 
 #include <memory>
 #include <mutex>
@@ -28,14 +35,60 @@ namespace graphite
 	{
 	public:
 		typedef std::shared_ptr< GraphProcessor > SharedPtr;
-		GraphProcessor(FastaReference::SharedPtr fastaReferencePtr, const std::vector< AlignmentReader::SharedPtr >& alignmentReaderPtrs, const std::vector< VCFReader::SharedPtr >& vcfReaderPtrs, uint32_t matchValue, uint32_t mismatchValue, uint32_t gapOpenValue, uint32_t gapExtensionValue, bool printGraph, int32_t mappingQuality, int32_t readSampleLimit, uint32_t numberOfThreads);
+		typedef std::function< bool (std::vector< Variant::SharedPtr >& variantPtrs, uint32_t graphSpacing) > ClusterSource; // appends the next cluster, false once there are no more
+		typedef std::function< void (const std::vector< Variant::SharedPtr >& variantPtrs) > ClusterCallback; // called in order, one cluster at a time
+		typedef std::function< void (std::vector< Alignment::SharedPtr >& alignmentPtrs, const std::vector< Region::SharedPtr >& regionPtrs) > AlignmentSource; // appends the reads of the graph's regions
+		GraphProcessor(FastaReference::SharedPtr fastaReferencePtr, const std::vector< AlignmentReader::SharedPtr >& alignmentReaderPtrs, const std::vector< VCFReader::SharedPtr >& vcfReaderPtrs, uint32_t matchValue, uint32_t mismatchValue, uint32_t gapOpenValue, uint32_t gapExtensionValue, bool printGraph, int32_t mappingQuality, int32_t readSampleLimit, uint32_t numberOfThreads, size_t clusterBufferByteCount);
+		GraphProcessor(FastaReference::SharedPtr fastaReferencePtr, const std::vector< AlignmentReader::SharedPtr >& alignmentReaderPtrs, const std::vector< VCFReader::SharedPtr >& vcfReaderPtrs, uint32_t matchValue, uint32_t mismatchValue, uint32_t gapOpenValue, uint32_t gapExtensionValue, bool printGraph, int32_t mappingQuality, int32_t readSampleLimit, std::shared_ptr< ThreadPool > threadPoolPtr, size_t clusterBufferByteCount);
 		~GraphProcessor();
 
 		void processVariants();
+		static uint32_t getGraphSpacing(const std::vector< AlignmentReader::SharedPtr >& alignmentReaderPtrs);
+		void setGraphStore(GraphStore::SharedPtr graphStorePtr) { this->m_graph_store_ptr = graphStorePtr; }
+		void setResultCache(ResultCache::SharedPtr resultCachePtr) { this->m_result_cache_ptr = resultCachePtr; }
+		void setCheckpoint(Checkpoint::SharedPtr checkpointPtr) { this->m_checkpoint_ptr = checkpointPtr; }
+		void setClusterSource(ClusterSource clusterSource) { this->m_cluster_source = clusterSource; } // read instead of the VCF readers
+		void setClusterCallback(ClusterCallback clusterCallback) { this->m_cluster_callback = clusterCallback; } // called instead of writing the records
+		void setClusterProfiler(ClusterProfiler::SharedPtr clusterProfilerPtr) { this->m_cluster_profiler_ptr = clusterProfilerPtr; }
+		void setAlignmentSource(AlignmentSource alignmentSource) { this->m_alignment_source = alignmentSource; } // fetched instead of the alignment readers
+		void setGraphSpacing(uint32_t graphSpacing) { this->m_graph_spacing = graphSpacing; } // 0 takes it from the alignment readers
+		void setClusterCapture(const std::string& captureDirectory, double minimumSeconds); // snapshots of the clusters that took at least minimumSeconds
+		void setProgressReporter(ProgressReporter::SharedPtr progressReporterPtr) { this->m_progress_reporter_ptr = progressReporterPtr; }
+
+		size_t getMaxBufferedClusterCount() { return this->m_reorder_buffer.getMaxBufferedCount(); }
+		double getHeadOfLineStallSeconds() { return this->m_reorder_buffer.getHeadOfLineStallSeconds(); }
+		double getMemoryLimitWaitSeconds() { return this->m_reorder_buffer.getThrottleWaitSeconds(); }
 
 	private:
-		void adjudicateVariants(std::vector< Variant::SharedPtr >& variantPtrs, uint32_t graphSpacing);
-        void getAlignmentsInRegion(std::vector< Alignment::SharedPtr >& alignmentPtrs, std::vector< Region::SharedPtr > regionPtrs, bool getFlankingUnalignedReads);
+		// what the reorder buffer holds of a cluster until its records are written
+		struct Cluster
+		{
+			std::shared_ptr< std::vector< Variant::SharedPtr > > m_variant_ptrs;
+			Graph::SharedPtr m_graph_ptr; // its nodes and alleles are released once the cluster is written
+			ClusterProfile::SharedPtr m_profile_ptr; // set when clusters are profiled or captured
+			ClusterSnapshot::SharedPtr m_snapshot_ptr; // set when clusters are captured
+		};
+
+		// what the read tasks of a cluster share, only the batch count changes once they are enqueued
+		struct ClusterContext : private Noncopyable
+		{
+			Cluster m_cluster;
+			uint64_t m_sequence; // in the reorder buffer
+			std::vector< Alignment::SharedPtr > m_alignment_ptrs;
+			uint32_t m_match_value;
+			uint32_t m_mismatch_value;
+			uint32_t m_gap_open_value;
+			uint32_t m_gap_extension_value;
+			ResultCache::SharedPtr m_result_cache_ptr;
+			ResultCache::CachedGraph::SharedPtr m_cached_graph_ptr; // set when the cache has this graph
+			ReorderBuffer< Cluster >* m_reorder_buffer_ptr;
+			std::atomic< size_t > m_remaining_batch_count; // the last batch to finish hands the cluster to the reorder buffer
+		};
+
+		void adjudicateVariants(std::shared_ptr< std::vector< Variant::SharedPtr > > variantPtrs, uint32_t graphSpacing);
+		static void adjudicateAlignment(const ClusterContext& context, const Alignment::SharedPtr& alignmentPtr);
+		void writeVariants(Cluster& cluster);
+        void getAlignmentsInRegion(std::vector< Alignment::SharedPtr >& alignmentPtrs, std::vector< Region::SharedPtr > regionPtrs, bool getFlankingUnalignedReads, ClusterProfile::SharedPtr clusterProfilePtr, ClusterArena::SharedPtr arenaPtr);
 		FastaReference::SharedPtr m_fasta_reference_ptr;
 		std::vector< AlignmentReader::SharedPtr > m_alignment_reader_ptrs;
 		std::vector< VCFReader::SharedPtr > m_vcf_reader_ptrs;
@@ -45,11 +98,23 @@ namespace graphite
 		uint32_t m_mismatch_value;
 		uint32_t m_gap_open_value;
 		uint32_t m_gap_extension_value;
-		ThreadPool m_thread_pool;
+		std::shared_ptr< ThreadPool > m_thread_pool_ptr; // shared when shards of the genome are processed side by side
+		ReorderBuffer< Cluster > m_reorder_buffer; // clusters finish out of order but are written in VCF order
 		bool m_print_graphs;
 		int32_t m_mapping_quality;
 		int32_t m_read_sample_limit;
 		Sample::SharedPtr m_override_shared_ptr;
+		GraphStore::SharedPtr m_graph_store_ptr; // set when graphs are loaded instead of built
+		ResultCache::SharedPtr m_result_cache_ptr; // set when reads are counted from earlier runs' alignments
+		Checkpoint::SharedPtr m_checkpoint_ptr; // set when the run can be resumed
+		ClusterSource m_cluster_source; // set when the variants don't come from VCF readers
+		ClusterCallback m_cluster_callback; // set when the adjudicated clusters aren't written to VCFs
+		ClusterProfiler::SharedPtr m_cluster_profiler_ptr; // set when every cluster's costs are logged
+		AlignmentSource m_alignment_source; // set when the reads don't come from alignment readers
+		uint32_t m_graph_spacing;
+		std::string m_capture_directory; // set when slow clusters are captured
+		uint64_t m_capture_minimum_nanoseconds;
+		ProgressReporter::SharedPtr m_progress_reporter_ptr; // set when the run reports its progress
 		std::mutex m_alignment_tracker_mutex;
 		std::unordered_set< std::string > m_alignment_tracker_set;
 	};
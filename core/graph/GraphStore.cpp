@@ -0,0 +1,464 @@
+#include "GraphStore.h"
+#include "core/vcf/VCFReader.h"
+#include "core/util/ThreadPool.hpp"
+#include "core/util/Utility.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <mutex>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace graphite
+{
+	static const char GRAPH_STORE_MAGIC[8] = { 'G', 'R', 'A', 'P', 'H', 'S', 'T', 'R' };
+	static const uint32_t GRAPH_STORE_VERSION = 2;
+	static const size_t CLUSTER_BATCH_SIZE = 512; // clusters one build task serializes
+
+	GraphStore::GraphStore(const std::string& path) :
+		m_path(path),
+		m_data(nullptr),
+		m_byte_count(0),
+		m_index(nullptr),
+		m_cluster_count(0),
+		m_graph_spacing(0),
+		m_loaded_count(0),
+		m_missed_count(0)
+	{
+	}
+
+	GraphStore::~GraphStore()
+	{
+		if (this->m_data != nullptr)
+		{
+			munmap(const_cast< char* >(this->m_data), this->m_byte_count);
+		}
+	}
+
+	// maps the store, false when it can't be used for these inputs in which case the graphs are built as usual
+	bool GraphStore::open(const std::vector< std::string >& vcfPaths, const std::string& fastaPath, uint32_t graphSpacing)
+	{
+		int fileDescriptor = ::open(this->m_path.c_str(), O_RDONLY);
+		struct stat fileStat;
+		if (fileDescriptor < 0 || fstat(fileDescriptor, &fileStat) != 0)
+		{
+			std::cout << "Unable to open graph store: " << this->m_path << std::endl;
+			if (fileDescriptor >= 0)
+			{
+				close(fileDescriptor);
+			}
+			return false;
+		}
+		size_t byteCount = fileStat.st_size;
+		void* mapping = (byteCount >= sizeof(Header)) ? mmap(nullptr, byteCount, PROT_READ, MAP_SHARED, fileDescriptor, 0) : MAP_FAILED;
+		close(fileDescriptor); // the mapping keeps the file
+		if (mapping == MAP_FAILED)
+		{
+			std::cout << "Unable to map graph store: " << this->m_path << std::endl;
+			return false;
+		}
+		this->m_data = static_cast< const char* >(mapping);
+		this->m_byte_count = byteCount;
+
+		Header header;
+		memcpy(&header, this->m_data, sizeof(Header));
+		// the tables are 8 byte aligned so they are read in place from the mapping
+		auto isTableInFile = [byteCount](uint64_t offset, uint64_t entryCount, size_t entrySize)
+			{
+				return offset % sizeof(uint64_t) == 0 && offset <= byteCount && (byteCount - offset) / entrySize >= entryCount;
+			};
+		if (memcmp(header.m_magic, GRAPH_STORE_MAGIC, sizeof(GRAPH_STORE_MAGIC)) != 0 || header.m_version != GRAPH_STORE_VERSION ||
+			!isTableInFile(header.m_index_offset, header.m_cluster_count, sizeof(IndexEntry)) ||
+			!isTableInFile(header.m_vcf_offset, header.m_vcf_count, sizeof(VCFEntry)) ||
+			!isTableInFile(header.m_contig_offset, header.m_contig_count, sizeof(ContigEntry)))
+		{
+			std::cout << "Not a graph store (or written by another version of graphite): " << this->m_path << std::endl;
+			return false;
+		}
+		if (header.m_fasta_index_checksum != getFastaIndexChecksum(fastaPath))
+		{
+			std::cout << "The graph store " << this->m_path << " was built from another FASTA, its graphs are not used" << std::endl;
+			return false;
+		}
+
+		// a VCF with the size and modification time it had when the store was built isn't read again
+		const VCFEntry* vcfEntries = reinterpret_cast< const VCFEntry* >(this->m_data + header.m_vcf_offset);
+		bool isSameVCFs = (header.m_vcf_count == vcfPaths.size());
+		for (size_t i = 0; isSameVCFs && i < vcfPaths.size(); ++i)
+		{
+			VCFEntry vcfEntry;
+			isSameVCFs = getVCFEntry(vcfPaths[i], vcfEntry, false);
+			if (isSameVCFs && (vcfEntry.m_byte_count != vcfEntries[i].m_byte_count || vcfEntry.m_modified_time != vcfEntries[i].m_modified_time))
+			{
+				isSameVCFs = getVCFEntry(vcfPaths[i], vcfEntry, true) && vcfEntry.m_checksum == vcfEntries[i].m_checksum;
+			}
+		}
+		if (!isSameVCFs)
+		{
+			std::cout << "The graph store " << this->m_path << " was built from other VCFs, its graphs are not used" << std::endl;
+			return false;
+		}
+		if (header.m_graph_spacing != graphSpacing)
+		{
+			std::cout << "The graph store " << this->m_path << " was built with a graph spacing of " << header.m_graph_spacing << " but these reads need " << graphSpacing << ", its graphs are not used" << std::endl;
+			return false;
+		}
+
+		// the contig sequences are compared when they are first used, see hasSameSequence
+		std::vector< FastaContig > fastaContigs;
+		if (!readFastaIndex(fastaPath, fastaContigs))
+		{
+			std::cout << "Unable to read the FASTA index of " << fastaPath << ", the graphs of the graph store are not used" << std::endl;
+			return false;
+		}
+		const ContigEntry* contigEntries = reinterpret_cast< const ContigEntry* >(this->m_data + header.m_contig_offset);
+		std::unordered_map< uint64_t, uint64_t > contigChecksums;
+		for (uint64_t i = 0; i < header.m_contig_count; ++i)
+		{
+			contigChecksums.emplace(contigEntries[i].m_name_key, contigEntries[i].m_checksum);
+		}
+		for (auto& fastaContig : fastaContigs)
+		{
+			auto checksumIter = contigChecksums.find(hashBytes(fastaContig.m_name.c_str(), fastaContig.m_name.size()));
+			if (checksumIter != contigChecksums.end())
+			{
+				auto contigCheckPtr = std::make_shared< ContigCheck >();
+				contigCheckPtr->m_fasta_contig = fastaContig;
+				contigCheckPtr->m_checksum = checksumIter->second;
+				contigCheckPtr->m_is_same = false;
+				this->m_contig_checks.emplace(fastaContig.m_name, contigCheckPtr);
+			}
+		}
+		this->m_fasta_path = fastaPath;
+		this->m_index = reinterpret_cast< const IndexEntry* >(this->m_data + header.m_index_offset);
+		this->m_cluster_count = header.m_cluster_count;
+		this->m_graph_spacing = header.m_graph_spacing;
+		return true;
+	}
+
+	// hashes the contig's sequence the first time one of its graphs is loaded and compares it with the build's
+	bool GraphStore::hasSameSequence(const std::string& contig)
+	{
+		auto iter = this->m_contig_checks.find(contig);
+		if (iter == this->m_contig_checks.end())
+		{
+			return false;
+		}
+		auto& contigCheckPtr = iter->second;
+		std::call_once(contigCheckPtr->m_checked_flag, [this, &contigCheckPtr]()
+			{
+				contigCheckPtr->m_is_same = (getContigChecksum(this->m_fasta_path, contigCheckPtr->m_fasta_contig) == contigCheckPtr->m_checksum);
+				if (!contigCheckPtr->m_is_same)
+				{
+					std::cout << "The sequence of " << contigCheckPtr->m_fasta_contig.m_name << " differs from the FASTA the graph store " << this->m_path << " was built from, its graphs are built from the FASTA" << std::endl;
+				}
+			});
+		return contigCheckPtr->m_is_same;
+	}
+
+	// the cluster's stored graph wired to its alleles, nullptr when the cluster isn't stored
+	Graph::SharedPtr GraphStore::loadGraph(const std::vector< Variant::SharedPtr >& variantPtrs, bool printGraph)
+	{
+		if (variantPtrs.empty() || !hasSameSequence(variantPtrs[0]->getChromosome()))
+		{
+			++this->m_missed_count;
+			return nullptr;
+		}
+		uint64_t clusterKey = getClusterKey(variantPtrs);
+		const IndexEntry* indexEnd = this->m_index + this->m_cluster_count;
+		auto indexIter = std::lower_bound(this->m_index, indexEnd, clusterKey, [](const IndexEntry& indexEntry, uint64_t key) { return indexEntry.m_cluster_key < key; });
+		for (; indexIter != indexEnd && indexIter->m_cluster_key == clusterKey; ++indexIter)
+		{
+			if (indexIter->m_offset > this->m_byte_count || this->m_byte_count - indexIter->m_offset < indexIter->m_byte_count)
+			{
+				break;
+			}
+			auto graphPtr = Graph::deserialize(this->m_data + indexIter->m_offset, indexIter->m_byte_count, variantPtrs, this->m_graph_spacing, printGraph);
+			if (graphPtr != nullptr)
+			{
+				++this->m_loaded_count;
+				return graphPtr;
+			}
+		}
+		++this->m_missed_count;
+		return nullptr;
+	}
+
+	// clusters the VCFs the way an adjudication run does and writes the graph of every cluster
+	bool GraphStore::build(const std::string& path, const std::vector< std::string >& vcfPaths, const std::string& fastaPath, uint32_t graphSpacing, uint32_t threadCount)
+	{
+		std::vector< Sample::SharedPtr > samplePtrs; // nothing is adjudicated, the readers only need the VCF columns
+		std::vector< VCFReader::SharedPtr > vcfReaderPtrs;
+		for (auto& vcfPath : vcfPaths)
+		{
+			auto vcfWriterPtr = std::make_shared< VCFWriter >("/dev/null", samplePtrs, false); // a headerless shard writer that is never written to
+			vcfReaderPtrs.emplace_back(std::make_shared< VCFReader >(vcfPath, samplePtrs, nullptr, vcfWriterPtr));
+		}
+
+		// every fasta reader caches a chromosome so a task takes one of these instead of sharing one
+		std::mutex fastaReferenceMutex;
+		std::vector< FastaReference::SharedPtr > fastaReferencePtrs = { std::make_shared< FastaReference >(fastaPath) }; // makes sure the FASTA index exists before it is hashed
+
+		// the checksums a run compares its inputs with, the contigs are hashed side by side
+		std::vector< VCFEntry > vcfEntries(vcfPaths.size());
+		for (size_t i = 0; i < vcfPaths.size(); ++i)
+		{
+			if (!getVCFEntry(vcfPaths[i], vcfEntries[i], true))
+			{
+				std::cout << "Unable to read VCF: " << vcfPaths[i] << std::endl;
+				return false;
+			}
+		}
+		std::vector< FastaContig > fastaContigs;
+		if (!readFastaIndex(fastaPath, fastaContigs))
+		{
+			std::cout << "Unable to read the FASTA index of " << fastaPath << std::endl;
+			return false;
+		}
+		std::vector< ContigEntry > contigEntries(fastaContigs.size());
+		{
+			ThreadPool threadPool(std::max< uint32_t >(1, threadCount));
+			std::vector< std::future< void > > contigFutures;
+			for (size_t i = 0; i < fastaContigs.size(); ++i)
+			{
+				contigFutures.emplace_back(threadPool.enqueue([i, &fastaPath, &fastaContigs, &contigEntries]()
+					{
+						contigEntries[i].m_name_key = hashBytes(fastaContigs[i].m_name.c_str(), fastaContigs[i].m_name.size());
+						contigEntries[i].m_checksum = getContigChecksum(fastaPath, fastaContigs[i]);
+					}));
+			}
+			for (auto& contigFuture : contigFutures)
+			{
+				contigFuture.wait();
+			}
+		}
+
+		std::ofstream outFile(path, std::ios::binary | std::ios::trunc);
+		if (!outFile.is_open())
+		{
+			std::cout << "Unable to open graph store: " << path << std::endl;
+			return false;
+		}
+		Header header;
+		memset(&header, 0, sizeof(Header));
+		memcpy(header.m_magic, GRAPH_STORE_MAGIC, sizeof(GRAPH_STORE_MAGIC));
+		header.m_version = GRAPH_STORE_VERSION;
+		header.m_graph_spacing = graphSpacing;
+		header.m_fasta_index_checksum = getFastaIndexChecksum(fastaPath);
+		outFile.write(reinterpret_cast< const char* >(&header), sizeof(Header)); // rewritten once the index is written
+
+		typedef std::vector< std::pair< uint64_t, std::string > > SerializedClusters; // cluster key and graph
+		std::vector< IndexEntry > index;
+		uint64_t offset = sizeof(Header);
+		std::deque< std::future< std::shared_ptr< SerializedClusters > > > serializedClusterFutures;
+		auto writeSerializedClusters = [&]()
+			{
+				auto serializedClustersPtr = serializedClusterFutures.front().get();
+				serializedClusterFutures.pop_front();
+				for (auto& serializedCluster : *serializedClustersPtr)
+				{
+					if (serializedCluster.second.size() == 0)
+					{
+						continue; // the run builds it
+					}
+					index.push_back({ serializedCluster.first, offset, serializedCluster.second.size() });
+					outFile.write(serializedCluster.second.c_str(), serializedCluster.second.size());
+					offset += serializedCluster.second.size();
+				}
+			};
+		{
+			ThreadPool threadPool(std::max< uint32_t >(1, threadCount));
+			bool hasVariants = true;
+			while (hasVariants)
+			{
+				auto clustersPtr = std::make_shared< std::vector< std::vector< Variant::SharedPtr > > >();
+				while (clustersPtr->size() < CLUSTER_BATCH_SIZE)
+				{
+					std::vector< Variant::SharedPtr > variantPtrs;
+					for (auto vcfReaderPtr : vcfReaderPtrs)
+					{
+						vcfReaderPtr->getNextVariants(variantPtrs, graphSpacing); // the same clusters as GraphProcessor::processVariants
+					}
+					if (variantPtrs.size() == 0)
+					{
+						hasVariants = false;
+						break;
+					}
+					clustersPtr->emplace_back(variantPtrs);
+				}
+				if (clustersPtr->size() == 0)
+				{
+					break;
+				}
+				serializedClusterFutures.emplace_back(threadPool.enqueue([clustersPtr, graphSpacing, &fastaPath, &fastaReferenceMutex, &fastaReferencePtrs]()
+					{
+						FastaReference::SharedPtr fastaReferencePtr = nullptr;
+						{
+							std::lock_guard< std::mutex > lock(fastaReferenceMutex);
+							if (fastaReferencePtrs.size() > 0)
+							{
+								fastaReferencePtr = fastaReferencePtrs.back();
+								fastaReferencePtrs.pop_back();
+							}
+						}
+						if (fastaReferencePtr == nullptr)
+						{
+							fastaReferencePtr = std::make_shared< FastaReference >(fastaPath);
+						}
+						auto serializedClustersPtr = std::make_shared< SerializedClusters >();
+						for (auto& variantPtrs : *clustersPtr)
+						{
+							auto graphPtr = std::make_shared< Graph >(fastaReferencePtr, variantPtrs, graphSpacing, false);
+							std::string serializedGraph;
+							if (!graphPtr->serialize(serializedGraph, variantPtrs))
+							{
+								serializedGraph.clear();
+							}
+							graphPtr->clearResources();
+							serializedClustersPtr->emplace_back(getClusterKey(variantPtrs), std::move(serializedGraph));
+						}
+						std::lock_guard< std::mutex > lock(fastaReferenceMutex);
+						fastaReferencePtrs.emplace_back(fastaReferencePtr);
+						return serializedClustersPtr;
+					}));
+				while (serializedClusterFutures.size() > 2 * threadCount) // keep the clusters in memory bounded
+				{
+					writeSerializedClusters();
+				}
+			}
+			while (serializedClusterFutures.size() > 0)
+			{
+				writeSerializedClusters();
+			}
+		}
+
+		// the index is 8 byte aligned so it is read in place from the mapping
+		while (offset % sizeof(uint64_t) != 0)
+		{
+			outFile.put('\0');
+			++offset;
+		}
+		std::sort(index.begin(), index.end(), [](const IndexEntry& a, const IndexEntry& b) { return a.m_cluster_key < b.m_cluster_key; });
+		outFile.write(reinterpret_cast< const char* >(index.data()), index.size() * sizeof(IndexEntry));
+		header.m_cluster_count = index.size();
+		header.m_index_offset = offset;
+		offset += index.size() * sizeof(IndexEntry);
+		outFile.write(reinterpret_cast< const char* >(vcfEntries.data()), vcfEntries.size() * sizeof(VCFEntry));
+		header.m_vcf_count = vcfEntries.size();
+		header.m_vcf_offset = offset;
+		offset += vcfEntries.size() * sizeof(VCFEntry);
+		outFile.write(reinterpret_cast< const char* >(contigEntries.data()), contigEntries.size() * sizeof(ContigEntry));
+		header.m_contig_count = contigEntries.size();
+		header.m_contig_offset = offset;
+		outFile.seekp(0);
+		outFile.write(reinterpret_cast< const char* >(&header), sizeof(Header));
+		outFile.close();
+		if (!outFile)
+		{
+			std::cout << "Unable to write graph store: " << path << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// ties a store to the FASTA's layout, its contig names, lengths and line offsets, the sequences are checked per contig
+	uint64_t GraphStore::getFastaIndexChecksum(const std::string& fastaPath)
+	{
+		uint64_t checksum = hashFile(fastaPath + ".fai", hashBytes(GRAPH_STORE_MAGIC, sizeof(GRAPH_STORE_MAGIC)));
+		std::ifstream fastaFile(fastaPath, std::ios::binary | std::ios::ate);
+		uint64_t fastaByteCount = fastaFile.is_open() ? static_cast< uint64_t >(fastaFile.tellg()) : 0;
+		return hashBytes(reinterpret_cast< const char* >(&fastaByteCount), sizeof(fastaByteCount), checksum);
+	}
+
+	// the VCF's size and modification time, and when hashesFile is set the hash of its bytes
+	bool GraphStore::getVCFEntry(const std::string& vcfPath, VCFEntry& vcfEntry, bool hashesFile)
+	{
+		struct stat fileStat;
+		if (stat(vcfPath.c_str(), &fileStat) != 0)
+		{
+			return false;
+		}
+		vcfEntry.m_byte_count = fileStat.st_size;
+		vcfEntry.m_modified_time = fileStat.st_mtime;
+		vcfEntry.m_checksum = (hashesFile) ? hashFile(vcfPath, hashBytes(GRAPH_STORE_MAGIC, sizeof(GRAPH_STORE_MAGIC))) : 0;
+		return true;
+	}
+
+	// the .fai columns are the name, the sequence length, the offset of the first base, bases per line and bytes per line
+	bool GraphStore::readFastaIndex(const std::string& fastaPath, std::vector< FastaContig >& fastaContigs)
+	{
+		std::ifstream indexFile(fastaPath + ".fai");
+		if (!indexFile.is_open())
+		{
+			return false;
+		}
+		std::string line;
+		std::vector< std::string > columns;
+		while (std::getline(indexFile, line))
+		{
+			columns.clear(); // split appends
+			split(line, '\t', columns);
+			if (columns.size() < 5)
+			{
+				continue;
+			}
+			uint64_t sequenceLength = strtoull(columns[1].c_str(), nullptr, 10);
+			uint64_t lineBaseCount = strtoull(columns[3].c_str(), nullptr, 10);
+			uint64_t lineByteCount = strtoull(columns[4].c_str(), nullptr, 10);
+			FastaContig fastaContig;
+			fastaContig.m_name = columns[0];
+			fastaContig.m_offset = strtoull(columns[2].c_str(), nullptr, 10);
+			fastaContig.m_byte_count = (lineBaseCount > 0) ? (sequenceLength / lineBaseCount) * lineByteCount + (sequenceLength % lineBaseCount) : 0;
+			fastaContigs.emplace_back(fastaContig);
+		}
+		return true;
+	}
+
+	// the hash of the contig's lines as they are in the FASTA, so re-masked (lower cased) bases change it
+	uint64_t GraphStore::getContigChecksum(const std::string& fastaPath, const FastaContig& fastaContig)
+	{
+		std::ifstream fastaFile(fastaPath, std::ios::binary);
+		if (!fastaFile.is_open() || !fastaFile.seekg(fastaContig.m_offset))
+		{
+			return 0;
+		}
+		uint64_t checksum = hashBytes(fastaContig.m_name.c_str(), fastaContig.m_name.size());
+		std::vector< char > buffer(1 << 20);
+		uint64_t remainingByteCount = fastaContig.m_byte_count;
+		while (remainingByteCount > 0 && fastaFile)
+		{
+			fastaFile.read(buffer.data(), std::min< uint64_t >(buffer.size(), remainingByteCount));
+			checksum = hashBytes(buffer.data(), fastaFile.gcount(), checksum);
+			remainingByteCount -= fastaFile.gcount();
+		}
+		return checksum;
+	}
+
+	uint64_t GraphStore::getClusterKey(const std::vector< Variant::SharedPtr >& variantPtrs)
+	{
+		static thread_local std::string clusterColumns;
+		clusterColumns.clear();
+		for (auto& variantPtr : variantPtrs)
+		{
+			clusterColumns += variantPtr->getChromosome();
+			clusterColumns.push_back('\t');
+			appendUnsignedInteger(clusterColumns, variantPtr->getPosition());
+			clusterColumns.push_back('\t');
+			clusterColumns += variantPtr->getReferenceAllelePtr()->getSequence();
+			for (auto& altAllelePtr : variantPtr->getAlternateAllelePtrs())
+			{
+				clusterColumns.push_back('\t');
+				clusterColumns += altAllelePtr->getSequence();
+			}
+			clusterColumns.push_back('\n');
+		}
+		return hashBytes(clusterColumns.c_str(), clusterColumns.size());
+	}
+}
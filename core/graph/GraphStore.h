@@ -0,0 +1,113 @@
+#ifndef GRAPHITE_GRAPHSTORE_H
+#define GRAPHITE_GRAPHSTORE_H
+
+#include "core/util/Noncopyable.hpp"
+#include "core/vcf/Variant.h"
+#include "Graph.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace graphite
+{
+	/*
+	 * The graphs of every cluster of a set of VCFs, built once by graphite
+	 * build-graphs and memory mapped by later runs so they don't read the
+	 * FASTA or build graphs again. A record is found by a hash of its
+	 * cluster's CHROM, POS, REF and ALT columns. The store also holds the
+	 * graph spacing it was built with, a checksum of the FASTA index, a
+	 * checksum of every VCF with its size and modification time and a
+	 * checksum of every contig's sequence. A VCF is only hashed again when
+	 * its size or modification time changed. A contig's sequence is hashed
+	 * the first time a run loads one of its graphs, a contig that differs
+	 * (a re-masked reference) has its graphs built from the FASTA. So does a
+	 * cluster that isn't in the store (a run with regions that cut through a
+	 * cluster).
+	 */
+	class GraphStore : private Noncopyable
+	{
+	public:
+		typedef std::shared_ptr< GraphStore > SharedPtr;
+		GraphStore(const std::string& path);
+		~GraphStore();
+
+		bool open(const std::vector< std::string >& vcfPaths, const std::string& fastaPath, uint32_t graphSpacing);
+		Graph::SharedPtr loadGraph(const std::vector< Variant::SharedPtr >& variantPtrs, bool printGraph);
+		uint64_t getLoadedCount() { return this->m_loaded_count; }
+		uint64_t getMissedCount() { return this->m_missed_count; }
+
+		static bool build(const std::string& path, const std::vector< std::string >& vcfPaths, const std::string& fastaPath, uint32_t graphSpacing, uint32_t threadCount);
+
+	private:
+		struct Header
+		{
+			char m_magic[8];
+			uint32_t m_version;
+			uint32_t m_graph_spacing;
+			uint64_t m_fasta_index_checksum;
+			uint64_t m_cluster_count;
+			uint64_t m_index_offset;
+			uint64_t m_vcf_count;
+			uint64_t m_vcf_offset;
+			uint64_t m_contig_count;
+			uint64_t m_contig_offset;
+		};
+		struct IndexEntry
+		{
+			uint64_t m_cluster_key;
+			uint64_t m_offset;
+			uint64_t m_byte_count;
+		};
+		struct VCFEntry
+		{
+			uint64_t m_checksum;
+			uint64_t m_byte_count;
+			int64_t m_modified_time;
+		};
+		struct ContigEntry
+		{
+			uint64_t m_name_key;
+			uint64_t m_checksum;
+		};
+		// where a contig's lines are in the FASTA, from its .fai
+		struct FastaContig
+		{
+			std::string m_name;
+			uint64_t m_offset;
+			uint64_t m_byte_count;
+		};
+		// a stored contig checksum, compared with the FASTA the first time the contig is used
+		struct ContigCheck
+		{
+			FastaContig m_fasta_contig;
+			uint64_t m_checksum;
+			std::once_flag m_checked_flag;
+			bool m_is_same;
+		};
+
+		bool hasSameSequence(const std::string& contig);
+
+		static uint64_t getFastaIndexChecksum(const std::string& fastaPath);
+		static bool getVCFEntry(const std::string& vcfPath, VCFEntry& vcfEntry, bool hashesFile);
+		static bool readFastaIndex(const std::string& fastaPath, std::vector< FastaContig >& fastaContigs);
+		static uint64_t getContigChecksum(const std::string& fastaPath, const FastaContig& fastaContig);
+		static uint64_t getClusterKey(const std::vector< Variant::SharedPtr >& variantPtrs);
+
+		std::string m_path;
+		const char* m_data; // the mapped file
+		size_t m_byte_count;
+		const IndexEntry* m_index; // sorted by cluster key
+		uint64_t m_cluster_count;
+		uint32_t m_graph_spacing;
+		std::string m_fasta_path;
+		std::unordered_map< std::string, std::shared_ptr< ContigCheck > > m_contig_checks; // by contig name, not changed after open
+		std::atomic< uint64_t > m_loaded_count;
+		std::atomic< uint64_t > m_missed_count;
+	};
+}
+
+#endif //GRAPHITE_GRAPHSTORE_H
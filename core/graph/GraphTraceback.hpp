@@ -19,15 +19,17 @@ namespace graphite
 		{
 		}
 
-		void processGraph(Alignment::SharedPtr alignmentPtr)
+		// aligns to the graph without excludedNodePtr when it is set, the same as to a copy of the graph with the node removed
+		void processGraph(const Alignment::SharedPtr& alignmentPtr, const Node* excludedNodePtr = nullptr)
 		{
-			auto nodePtrsMap = m_graph_ptr->getNodePtrsMap();
+			const auto& nodePtrsMap = m_graph_ptr->getNodePtrsMap();
 			gssw_sse2_disable();
 			int8_t* nt_table = gssw_create_nt_table();
 			int8_t* mat = gssw_create_score_matrix(m_match_value, m_mismatch_value);
 			gssw_graph* graph = gssw_graph_create(nodePtrsMap.size());
 
 			unordered_map< uint32_t, gssw_node* > gsswNodePtrsMap;
+			gsswNodePtrsMap.reserve(nodePtrsMap.size());
 			Node::SharedPtr nodePtr = m_graph_ptr->getFirstNode();
 
 			// std::lock_guard< std::mutex > l(m_graph_mutex);
@@ -40,7 +42,7 @@ namespace graphite
 				Node::SharedPtr nextRefNodePtr = nullptr;
 				for (auto outNodePtr : nodePtr->getOutNodes())
 				{
-					if (nodePtrsMap.find(outNodePtr->getID()) == nodePtrsMap.end())
+					if (outNodePtr.get() == excludedNodePtr || nodePtrsMap.find(outNodePtr->getID()) == nodePtrsMap.end())
 					{
 						continue; // skip removed nodes
 					}
@@ -55,11 +57,11 @@ namespace graphite
 				nodePtr = nextRefNodePtr;
 			}
 
-			for (auto iter : nodePtrsMap)
+			for (auto& iter : nodePtrsMap)
 			{
 				Node::SharedPtr nodePtr = iter.second;
 				auto gsswIter = gsswNodePtrsMap.find(nodePtr->getID());
-				if (gsswIter == gsswNodePtrsMap.end())
+				if (gsswIter == gsswNodePtrsMap.end() || nodePtr.get() == excludedNodePtr)
 				{
 					continue;
 				}
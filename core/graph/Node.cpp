@@ -12,7 +12,10 @@ namespace graphite
 		m_position(pos),
 		m_allele_type(alleleType),
 		m_in_ref_node(nullptr),
-		m_original_sequence("")
+		m_original_sequence(""),
+		m_identical_prefix_length(0),
+		m_identical_suffix_length(0),
+		m_memory_tally(MemoryAccounting::SUBSYSTEM::GRAPH_NODES, sizeof(Node) + m_sequence.size())
 	{
 		setID();
 	}
@@ -22,12 +25,18 @@ namespace graphite
 		m_position(pos),
 		m_allele_type(alleleType),
 		m_in_ref_node(nullptr),
-		m_original_sequence("")
+		m_original_sequence(""),
+		m_identical_prefix_length(0),
+		m_identical_suffix_length(0),
+		m_memory_tally(MemoryAccounting::SUBSYSTEM::GRAPH_NODES, sizeof(Node) + m_sequence.size())
 	{
 		setID();
 	}
 
-	Node::Node()
+	Node::Node() :
+		m_identical_prefix_length(0),
+		m_identical_suffix_length(0),
+		m_memory_tally(MemoryAccounting::SUBSYSTEM::GRAPH_NODES, sizeof(Node))
 	{
 		setID();
 	}
@@ -139,9 +148,9 @@ namespace graphite
 		return this->m_overlapping_allele_ptr_map;
 	}
 
-	Node::SharedPtr Node::mergeNodes(Node::SharedPtr firstNodePtr, Node::SharedPtr secondNodePtr)
+	Node::SharedPtr Node::mergeNodes(Node::SharedPtr firstNodePtr, Node::SharedPtr secondNodePtr, ClusterArena::SharedPtr arenaPtr)
 	{
-		Node::SharedPtr nodePtr = std::make_shared< Node >(std::string(firstNodePtr->m_sequence + secondNodePtr->m_sequence), firstNodePtr->m_position, firstNodePtr->m_allele_type);
+		Node::SharedPtr nodePtr = ClusterArena::makeShared< Node >(arenaPtr, std::string(firstNodePtr->m_sequence + secondNodePtr->m_sequence), firstNodePtr->m_position, firstNodePtr->m_allele_type);
 		nodePtr->m_in_nodes = firstNodePtr->m_in_nodes;
 
 		// make sure to set the in and out ref node pointers
@@ -216,6 +225,7 @@ namespace graphite
 	{
 		this->m_original_sequence = this->m_sequence;
 		this->m_sequence = sequence;
+		this->m_memory_tally.add(sequence.size());
 	}
 
 	std::string Node::getOriginalSequence()
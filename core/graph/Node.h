@@ -3,6 +3,8 @@
 
 #include "core/util/Noncopyable.hpp"
 #include "core/util/Types.h"
+#include "core/util/MemoryAccounting.h"
+#include "core/util/ClusterArena.hpp"
 #include "core/allele/Allele.h"
 #include "core/sample/Sample.h"
 
@@ -51,7 +53,7 @@ namespace graphite
 		std::unordered_set< Allele::SharedPtr > getAllelePtrs() { return this->m_allele_ptrs; }
 		bool hasAllelePtr(Allele::SharedPtr allelePtr) { return (this->m_allele_ptrs.find(allelePtr) != this->m_allele_ptrs.end()); }
 		void clearAllelePtrs() { this->m_allele_ptrs.clear(); };
-		static Node::SharedPtr mergeNodes(Node::SharedPtr firstNodePtr, Node::SharedPtr secondNodePtr);
+		static Node::SharedPtr mergeNodes(Node::SharedPtr firstNodePtr, Node::SharedPtr secondNodePtr, ClusterArena::SharedPtr arenaPtr = nullptr);
 
 		void clearInAndOutNodes();
 
@@ -74,6 +76,7 @@ namespace graphite
 		std::unordered_set< Node::SharedPtr > m_out_nodes;
 		uint32_t m_identical_prefix_length; // the length of sequence that is identical to adjacent sequences
 		uint32_t m_identical_suffix_length; // the length of sequence that is identical to adjacent sequences
+		MemoryAccounting::Tally m_memory_tally; // after the sequence it counts
 
 	};
 }
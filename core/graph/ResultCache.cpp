@@ -0,0 +1,216 @@
+#include "ResultCache.h"
+#include "core/util/Utility.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace graphite
+{
+	static const char RESULT_CACHE_MAGIC[8] = { 'G', 'R', 'A', 'P', 'H', 'R', 'E', 'S' };
+	static const uint32_t RESULT_CACHE_VERSION = 2;
+	static const uint64_t RESULT_CACHE_VERIFICATION_SEED = 0x9e3779b97f4a7c15ULL;
+
+	ResultCache::ResultCache(const std::string& path, uint32_t matchValue, uint32_t mismatchValue, uint32_t gapOpenValue, uint32_t gapExtensionValue) :
+		m_path(path),
+		m_data(nullptr),
+		m_byte_count(0),
+		m_loaded_node_scores(nullptr),
+		m_loaded_node_score_count(0),
+		m_loaded_results(nullptr),
+		m_loaded_result_count(0),
+		m_hit_count(0),
+		m_miss_count(0)
+	{
+		uint32_t scoringValues[] = { RESULT_CACHE_VERSION, matchValue, mismatchValue, gapOpenValue, gapExtensionValue };
+		this->m_scoring_key = hashBytes(reinterpret_cast< const char* >(scoringValues), sizeof(scoringValues));
+	}
+
+	ResultCache::~ResultCache()
+	{
+		if (this->m_data != nullptr)
+		{
+			munmap(const_cast< char* >(this->m_data), this->m_byte_count);
+		}
+	}
+
+	// maps the results of earlier runs, a missing file is an empty cache
+	bool ResultCache::load()
+	{
+		int fileDescriptor = ::open(this->m_path.c_str(), O_RDONLY);
+		if (fileDescriptor < 0)
+		{
+			return true;
+		}
+		struct stat fileStat;
+		size_t byteCount = (fstat(fileDescriptor, &fileStat) == 0) ? fileStat.st_size : 0;
+		void* mapping = (byteCount >= sizeof(Header)) ? mmap(nullptr, byteCount, PROT_READ, MAP_SHARED, fileDescriptor, 0) : MAP_FAILED;
+		close(fileDescriptor);
+		if (mapping == MAP_FAILED)
+		{
+			std::cout << "Not a result cache (or written by another version of graphite): " << this->m_path << std::endl;
+			return false;
+		}
+		this->m_data = static_cast< const char* >(mapping);
+		this->m_byte_count = byteCount;
+
+		Header header;
+		memcpy(&header, this->m_data, sizeof(Header));
+		if (memcmp(header.m_magic, RESULT_CACHE_MAGIC, sizeof(RESULT_CACHE_MAGIC)) != 0 || header.m_version != RESULT_CACHE_VERSION ||
+			header.m_result_offset % sizeof(uint64_t) != 0 || header.m_result_offset < sizeof(Header) || header.m_result_offset > byteCount ||
+			(byteCount - header.m_result_offset) / sizeof(ResultEntry) < header.m_result_count)
+		{
+			std::cout << "Not a result cache (or written by another version of graphite): " << this->m_path << std::endl;
+			return false;
+		}
+		this->m_loaded_node_scores = reinterpret_cast< const NodeScore* >(this->m_data + sizeof(Header));
+		this->m_loaded_node_score_count = (header.m_result_offset - sizeof(Header)) / sizeof(NodeScore);
+		this->m_loaded_results = reinterpret_cast< const ResultEntry* >(this->m_data + header.m_result_offset);
+		this->m_loaded_result_count = header.m_result_count;
+		this->m_loaded_result_hits = std::vector< std::atomic< bool > >(this->m_loaded_result_count);
+		return true;
+	}
+
+	// writes the loaded results this run counted and the added ones, through a temporary file so an interrupted run leaves the old cache
+	bool ResultCache::save()
+	{
+		std::string tmpPath = this->m_path + ".tmp";
+		std::ofstream outFile(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!outFile.is_open())
+		{
+			std::cout << "Unable to open result cache: " << tmpPath << std::endl;
+			return false;
+		}
+		std::lock_guard< std::mutex > lock(this->m_added_results_mutex);
+		Header header;
+		memset(&header, 0, sizeof(Header));
+		outFile.write(reinterpret_cast< const char* >(&header), sizeof(Header));
+
+		// the node scores are written as the results are collected, the results follow sorted by key
+		std::vector< ResultEntry > results;
+		uint64_t nodeScoreOffset = 0;
+		for (auto& addedResult : this->m_added_results)
+		{
+			outFile.write(reinterpret_cast< const char* >(this->m_added_node_scores.data() + addedResult.m_node_score_offset), addedResult.m_node_score_count * sizeof(NodeScore));
+			results.emplace_back(addedResult);
+			results.back().m_node_score_offset = nodeScoreOffset;
+			nodeScoreOffset += addedResult.m_node_score_count;
+		}
+		for (uint64_t i = 0; i < this->m_loaded_result_count; ++i)
+		{
+			auto& loadedResult = this->m_loaded_results[i];
+			if (!this->m_loaded_result_hits[i] || this->m_added_result_indices.find(loadedResult.m_result_key) != this->m_added_result_indices.end())
+			{
+				continue;
+			}
+			outFile.write(reinterpret_cast< const char* >(this->m_loaded_node_scores + loadedResult.m_node_score_offset), loadedResult.m_node_score_count * sizeof(NodeScore));
+			results.emplace_back(loadedResult);
+			results.back().m_node_score_offset = nodeScoreOffset;
+			nodeScoreOffset += loadedResult.m_node_score_count;
+		}
+		std::sort(results.begin(), results.end(), [](const ResultEntry& a, const ResultEntry& b) { return a.m_result_key < b.m_result_key; });
+		outFile.write(reinterpret_cast< const char* >(results.data()), results.size() * sizeof(ResultEntry));
+
+		memcpy(header.m_magic, RESULT_CACHE_MAGIC, sizeof(RESULT_CACHE_MAGIC));
+		header.m_version = RESULT_CACHE_VERSION;
+		header.m_result_count = results.size();
+		header.m_result_offset = sizeof(Header) + nodeScoreOffset * sizeof(NodeScore);
+		outFile.seekp(0);
+		outFile.write(reinterpret_cast< const char* >(&header), sizeof(Header));
+		outFile.close();
+		if (!outFile || std::rename(tmpPath.c_str(), this->m_path.c_str()) != 0)
+		{
+			std::cout << "Unable to write result cache: " << this->m_path << std::endl;
+			std::remove(tmpPath.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	// nullptr when the graph can't be serialized, its reads are then aligned as usual
+	ResultCache::CachedGraph::SharedPtr ResultCache::getCachedGraph(Graph::SharedPtr graphPtr, const std::vector< Variant::SharedPtr >& variantPtrs)
+	{
+		std::string serializedGraph;
+		if (!graphPtr->serialize(serializedGraph, variantPtrs))
+		{
+			return nullptr;
+		}
+		auto cachedGraphPtr = std::make_shared< CachedGraph >();
+		cachedGraphPtr->m_graph_key = hashBytes(serializedGraph.c_str(), serializedGraph.size(), this->m_scoring_key);
+		cachedGraphPtr->m_verification_key = hashBytes(serializedGraph.c_str(), serializedGraph.size(), this->m_scoring_key ^ RESULT_CACHE_VERIFICATION_SEED);
+		cachedGraphPtr->m_node_ptrs = graphPtr->getOrderedNodePtrs(); // the node indices of the serialized graph
+		for (uint32_t i = 0; i < cachedGraphPtr->m_node_ptrs.size(); ++i)
+		{
+			cachedGraphPtr->m_node_indices.emplace(cachedGraphPtr->m_node_ptrs[i].get(), i);
+		}
+		return cachedGraphPtr;
+	}
+
+	// counts the read's cached scores on the graph's alleles, false when the read has to be aligned
+	bool ResultCache::countCachedScores(const CachedGraph& cachedGraph, Alignment::SharedPtr alignmentPtr)
+	{
+		uint64_t resultKey;
+		uint64_t verificationKey;
+		getResultKeys(cachedGraph, alignmentPtr, resultKey, verificationKey);
+		const ResultEntry* resultsEnd = this->m_loaded_results + this->m_loaded_result_count;
+		const ResultEntry* resultIter = std::lower_bound(this->m_loaded_results, resultsEnd, resultKey, [](const ResultEntry& result, uint64_t key) { return result.m_result_key < key; });
+		if (resultIter == resultsEnd || resultIter->m_result_key != resultKey || resultIter->m_verification_key != verificationKey ||
+			resultIter->m_node_score_offset > this->m_loaded_node_score_count || this->m_loaded_node_score_count - resultIter->m_node_score_offset < resultIter->m_node_score_count)
+		{
+			++this->m_miss_count;
+			return false;
+		}
+		for (uint64_t i = resultIter->m_node_score_offset; i < resultIter->m_node_score_offset + resultIter->m_node_score_count; ++i)
+		{
+			auto& nodeScore = this->m_loaded_node_scores[i];
+			if (nodeScore.m_node_index >= cachedGraph.m_node_ptrs.size())
+			{
+				continue;
+			}
+			for (auto nodeAllelePtr : cachedGraph.m_node_ptrs[nodeScore.m_node_index]->getAllelePtrs())
+			{
+				nodeAllelePtr->incrementScoreCount(alignmentPtr, nodeScore.m_score);
+			}
+		}
+		this->m_loaded_result_hits[resultIter - this->m_loaded_results] = true;
+		++this->m_hit_count;
+		return true;
+	}
+
+	void ResultCache::addScores(const CachedGraph& cachedGraph, Alignment::SharedPtr alignmentPtr, const NodeScores& nodeScores)
+	{
+		ResultEntry result;
+		memset(&result, 0, sizeof(ResultEntry));
+		getResultKeys(cachedGraph, alignmentPtr, result.m_result_key, result.m_verification_key);
+		std::lock_guard< std::mutex > lock(this->m_added_results_mutex);
+		if (!this->m_added_result_indices.emplace(result.m_result_key, this->m_added_results.size()).second)
+		{
+			return; // the same read in the same graph, from another sample
+		}
+		result.m_node_score_offset = this->m_added_node_scores.size();
+		for (auto& nodeScore : nodeScores)
+		{
+			auto nodeIndexIter = cachedGraph.m_node_indices.find(nodeScore.first);
+			if (nodeIndexIter != cachedGraph.m_node_indices.end())
+			{
+				this->m_added_node_scores.push_back({ nodeIndexIter->second, nodeScore.second });
+			}
+		}
+		result.m_node_score_count = this->m_added_node_scores.size() - result.m_node_score_offset;
+		this->m_added_results.emplace_back(result);
+	}
+
+	// the read is identified by its bases, they are all the alignment depends on
+	void ResultCache::getResultKeys(const CachedGraph& cachedGraph, Alignment::SharedPtr alignmentPtr, uint64_t& resultKey, uint64_t& verificationKey)
+	{
+		resultKey = hashBytes(alignmentPtr->getSequence(), alignmentPtr->getLength(), cachedGraph.m_graph_key);
+		verificationKey = hashBytes(alignmentPtr->getSequence(), alignmentPtr->getLength(), cachedGraph.m_verification_key);
+	}
+}
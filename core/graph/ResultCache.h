@@ -0,0 +1,101 @@
+#ifndef GRAPHITE_RESULTCACHE_H
+#define GRAPHITE_RESULTCACHE_H
+
+#include "core/util/Noncopyable.hpp"
+#include "core/vcf/Variant.h"
+#include "core/alignment/Alignment.h"
+#include "Graph.h"
+#include "Node.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+
+namespace graphite
+{
+	/*
+	 * What the alignment of a read to a cluster's graph added to the allele
+	 * counts, kept on disk so a later run with the same graph, read and
+	 * scoring values counts the read without aligning it again. A graph is
+	 * identified by a hash of its serialized form, so a cluster that a VCF
+	 * update didn't touch hits the cache even though the VCF changed. Only
+	 * the per node scores that were counted (-1 for an ambiguous node) are
+	 * stored, the cigars they were decided by aren't needed to replay them.
+	 * The cache file is mapped and searched in place, and a save keeps only
+	 * the results this run counted or added so it doesn't grow without bound.
+	 */
+	class ResultCache : private Noncopyable
+	{
+	public:
+		typedef std::shared_ptr< ResultCache > SharedPtr;
+
+		// a cluster's graph as the cache addresses it
+		struct CachedGraph
+		{
+			typedef std::shared_ptr< CachedGraph > SharedPtr;
+			uint64_t m_graph_key;
+			uint64_t m_verification_key; // a second hash of the graph, checked on a hit so a key collision isn't counted
+			std::vector< Node::SharedPtr > m_node_ptrs;
+			std::unordered_map< Node*, uint32_t > m_node_indices;
+		};
+		typedef std::vector< std::pair< Node*, int32_t > > NodeScores; // the nodes a read counted for and the score it counted
+
+		ResultCache(const std::string& path, uint32_t matchValue, uint32_t mismatchValue, uint32_t gapOpenValue, uint32_t gapExtensionValue);
+		~ResultCache();
+
+		bool load();
+		bool save();
+		CachedGraph::SharedPtr getCachedGraph(Graph::SharedPtr graphPtr, const std::vector< Variant::SharedPtr >& variantPtrs);
+		bool countCachedScores(const CachedGraph& cachedGraph, Alignment::SharedPtr alignmentPtr);
+		void addScores(const CachedGraph& cachedGraph, Alignment::SharedPtr alignmentPtr, const NodeScores& nodeScores);
+		uint64_t getHitCount() { return this->m_hit_count; }
+		uint64_t getMissCount() { return this->m_miss_count; }
+
+	private:
+		// the file is the header, the node scores of every result and the results sorted by key
+		struct Header
+		{
+			char m_magic[8];
+			uint32_t m_version;
+			uint32_t m_padding;
+			uint64_t m_result_count;
+			uint64_t m_result_offset;
+		};
+		struct NodeScore
+		{
+			uint32_t m_node_index;
+			int32_t m_score;
+		};
+		struct ResultEntry
+		{
+			uint64_t m_result_key;
+			uint64_t m_verification_key;
+			uint64_t m_node_score_offset; // in node scores
+			uint32_t m_node_score_count;
+			uint32_t m_padding;
+		};
+
+		void getResultKeys(const CachedGraph& cachedGraph, Alignment::SharedPtr alignmentPtr, uint64_t& resultKey, uint64_t& verificationKey);
+
+		std::string m_path;
+		uint64_t m_scoring_key; // the scoring values every key is seeded with
+		const char* m_data; // the mapped cache file, not changed once loaded so it is read without a lock
+		size_t m_byte_count;
+		const NodeScore* m_loaded_node_scores;
+		uint64_t m_loaded_node_score_count;
+		const ResultEntry* m_loaded_results;
+		uint64_t m_loaded_result_count;
+		std::vector< std::atomic< bool > > m_loaded_result_hits; // the loaded results a save keeps
+		std::mutex m_added_results_mutex;
+		std::vector< ResultEntry > m_added_results;
+		std::unordered_map< uint64_t, size_t > m_added_result_indices;
+		std::vector< NodeScore > m_added_node_scores;
+		std::atomic< uint64_t > m_hit_count;
+		std::atomic< uint64_t > m_miss_count;
+	};
+}
+
+#endif //GRAPHITE_RESULTCACHE_H
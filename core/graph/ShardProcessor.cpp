@@ -0,0 +1,85 @@
+#include "ShardProcessor.h"
+
+#include <thread>
+
+namespace graphite
+{
+	ShardProcessor::ShardProcessor(const std::vector< Region::SharedPtr >& shardRegionPtrs, const std::vector< VCFWriter::SharedPtr >& vcfWriterPtrs, uint32_t concurrentShardCount, GraphProcessorFactory graphProcessorFactory) :
+		m_shard_region_ptrs(shardRegionPtrs),
+		m_vcf_writer_ptrs(vcfWriterPtrs),
+		m_concurrent_shard_count((concurrentShardCount > 0) ? concurrentShardCount : 1),
+		m_graph_processor_factory(graphProcessorFactory),
+		m_next_shard_index(0)
+	{
+	}
+
+	ShardProcessor::~ShardProcessor()
+	{
+	}
+
+	// false when a shard couldn't be appended to the output, the shards not started by then are skipped
+	bool ShardProcessor::processShards()
+	{
+		size_t shardCount = this->m_shard_region_ptrs.size();
+		this->m_shard_writer_ptrs.assign(shardCount, std::vector< VCFWriter::SharedPtr >());
+		this->m_shard_finished.assign(shardCount, false);
+		this->m_next_shard_index = 0;
+
+		// shards are started in order so the shard the output is waiting on is always running
+		std::vector< std::thread > shardThreads;
+		for (uint32_t i = 0; i < this->m_concurrent_shard_count && i < shardCount; ++i)
+		{
+			shardThreads.emplace_back([this, shardCount]()
+				{
+					size_t shardIndex;
+					while ((shardIndex = this->m_next_shard_index++) < shardCount)
+					{
+						processShard(shardIndex);
+					}
+				});
+		}
+
+		bool isAppended = true;
+		for (size_t shardIndex = 0; shardIndex < shardCount && isAppended; ++shardIndex)
+		{
+			std::vector< VCFWriter::SharedPtr > shardWriterPtrs;
+			{
+				std::unique_lock< std::mutex > lock(this->m_shard_mutex);
+				this->m_shard_finished_condition.wait(lock, [this, shardIndex] { return this->m_shard_finished[shardIndex]; });
+				shardWriterPtrs.swap(this->m_shard_writer_ptrs[shardIndex]);
+			}
+			for (size_t i = 0; i < this->m_vcf_writer_ptrs.size() && isAppended; ++i)
+			{
+				isAppended = this->m_vcf_writer_ptrs[i]->appendShard(shardWriterPtrs[i]);
+			}
+		}
+		if (!isAppended)
+		{
+			this->m_next_shard_index = shardCount; // the output is cut short, no more shards are started
+		}
+
+		for (auto& shardThread : shardThreads)
+		{
+			shardThread.join();
+		}
+		return isAppended;
+	}
+
+	void ShardProcessor::processShard(size_t shardIndex)
+	{
+		std::vector< VCFWriter::SharedPtr > shardWriterPtrs;
+		for (auto& vcfWriterPtr : this->m_vcf_writer_ptrs)
+		{
+			shardWriterPtrs.emplace_back(vcfWriterPtr->createShardWriter(shardIndex));
+		}
+		{
+			// the readers are released as soon as the shard is done
+			auto graphProcessorPtr = this->m_graph_processor_factory(this->m_shard_region_ptrs[shardIndex], shardWriterPtrs);
+			graphProcessorPtr->processVariants();
+		}
+		std::lock_guard< std::mutex > lock(this->m_shard_mutex);
+		this->m_shard_writer_ptrs[shardIndex] = shardWriterPtrs;
+		this->m_shard_finished[shardIndex] = true;
+		this->m_shard_finished_condition.notify_all();
+	}
+}
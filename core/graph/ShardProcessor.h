@@ -0,0 +1,51 @@
+#ifndef GRAPHITE_SHARDPROCESSOR_H
+#define GRAPHITE_SHARDPROCESSOR_H
+
+#include "core/util/Noncopyable.hpp"
+#include "core/region/Region.h"
+#include "core/vcf/VCFWriter.h"
+#include "GraphProcessor.h"
+
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+namespace graphite
+{
+	/*
+	 * Adjudicates shards of the genome side by side in one process. Each shard
+	 * gets its own GraphProcessor (and with it its own reader cursors) from the
+	 * factory and writes headerless records to its own shard writers. The shard
+	 * outputs are appended to the final writers strictly in shard order as soon
+	 * as each one is done, so the output matches a single run over the regions.
+	 */
+	class ShardProcessor : private Noncopyable
+	{
+	public:
+		typedef std::shared_ptr< ShardProcessor > SharedPtr;
+		typedef std::function< GraphProcessor::SharedPtr (Region::SharedPtr shardRegionPtr, const std::vector< VCFWriter::SharedPtr >& shardWriterPtrs) > GraphProcessorFactory;
+
+		ShardProcessor(const std::vector< Region::SharedPtr >& shardRegionPtrs, const std::vector< VCFWriter::SharedPtr >& vcfWriterPtrs, uint32_t concurrentShardCount, GraphProcessorFactory graphProcessorFactory);
+		~ShardProcessor();
+
+		bool processShards();
+
+	private:
+		void processShard(size_t shardIndex);
+
+		std::vector< Region::SharedPtr > m_shard_region_ptrs;
+		std::vector< VCFWriter::SharedPtr > m_vcf_writer_ptrs;
+		uint32_t m_concurrent_shard_count;
+		GraphProcessorFactory m_graph_processor_factory;
+		std::atomic< size_t > m_next_shard_index;
+		std::vector< std::vector< VCFWriter::SharedPtr > > m_shard_writer_ptrs; // indexed by shard then by vcf
+		std::vector< bool > m_shard_finished;
+		std::mutex m_shard_mutex;
+		std::condition_variable m_shard_finished_condition;
+	};
+}
+
+#endif //GRAPHITE_SHARDPROCESSOR_H
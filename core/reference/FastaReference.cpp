@@ -7,12 +7,21 @@ namespace graphite
 {
 	FastaReference::FastaReference(const std::string& path) :
 		m_current_reference_id(""),
-		m_reference_sequence("")
+		m_reference_sequence(""),
+		m_sequence_offset(0)
 	{
 		m_fasta_reference = std::make_shared< ::FastaReference >();
 		m_fasta_reference->open(path);
 	}
 
+	FastaReference::FastaReference(const std::string& referenceID, position startPosition, const std::string& sequence) :
+		m_fasta_reference(nullptr),
+		m_current_reference_id(referenceID),
+		m_reference_sequence(sequence),
+		m_sequence_offset(startPosition - 1)
+	{
+	}
+
 	FastaReference::~FastaReference()
 	{
 		// m_fasta_reference is closed when its destructor is called so we don't worry about it
@@ -21,6 +30,10 @@ namespace graphite
 	void FastaReference::setReferenceIDAndSequence(Region::SharedPtr regionPtr)
 	{
 		std::string referenceID = regionPtr->getReferenceID();
+		if (this->m_fasta_reference == nullptr) // only the window is held
+		{
+			return;
+		}
 		if (strcmp(referenceID.c_str(), this->m_current_reference_id.c_str()) != 0)
 		{
 			this->m_current_reference_id = referenceID;
@@ -39,7 +52,7 @@ namespace graphite
 			endPosition -= 1;
 		}
 		position length = endPosition - startPosition;
-		std::string seq = std::string(this->m_reference_sequence.c_str() + startPosition, length);
+		std::string seq = std::string(this->m_reference_sequence.c_str() + (startPosition - this->m_sequence_offset), length);
 		std::transform(seq.begin(), seq.end(), seq.begin(), ::toupper);
 		return seq;
 	}
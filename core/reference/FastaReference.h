@@ -15,6 +15,7 @@ namespace graphite
 	public:
 		typedef std::shared_ptr< FastaReference > SharedPtr;
         FastaReference(const std::string& fastaPath);
+		FastaReference(const std::string& referenceID, position startPosition, const std::string& sequence); // a window of one contig held in memory, startPosition is one based
 		~FastaReference();
 
 		std::string getSequenceStringFromRegion(Region::SharedPtr regionPtr);
@@ -24,6 +25,7 @@ namespace graphite
 		std::shared_ptr< ::FastaReference > m_fasta_reference;
 		std::string m_current_reference_id;
 		std::string m_reference_sequence;
+		position m_sequence_offset; // of the window's first base in its contig, 0 when whole contigs are read
 	};
 }
 
@@ -1,12 +1,31 @@
 #include "Sample.h"
 
+#include <mutex>
+#include <unordered_map>
+
 namespace graphite
 {
+	static std::mutex s_sample_indices_mutex;
+	static std::unordered_map< std::string, uint32_t > s_sample_indices;
+
 	Sample::Sample(const std::string& sampleName, const std::string& readGroup, const std::string& samplePath) :
 		m_sample_name(sampleName),
 		m_sample_readgroup(readGroup),
-		m_sample_path(samplePath)
+		m_sample_path(samplePath),
+		m_sample_index(getSampleIndex(sampleName))
+	{
+	}
+
+	// samples are counted by name, so read groups (and BAMs) of one sample share its index
+	uint32_t Sample::getSampleIndex(const std::string& sampleName)
 	{
+		std::lock_guard< std::mutex > lock(s_sample_indices_mutex);
+		auto iter = s_sample_indices.find(sampleName);
+		if (iter == s_sample_indices.end())
+		{
+			iter = s_sample_indices.emplace(sampleName, s_sample_indices.size()).first;
+		}
+		return iter->second;
 	}
 
 	Sample::~Sample()
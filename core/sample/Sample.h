@@ -4,6 +4,7 @@
 #include <iostream>
 #include <string>
 #include <memory>
+#include <cstdint>
 
 #include "core/util/Noncopyable.hpp"
 
@@ -20,11 +21,16 @@ namespace graphite
 		std::string getName();
 		std::string getReadgroup();
 		std::string getPath();
+		uint32_t getIndex() { return this->m_sample_index; }
+
 
 	private:
+		static uint32_t getSampleIndex(const std::string& sampleName);
+
 		std::string m_sample_name;
 		std::string m_sample_readgroup;
 		std::string m_sample_path;
+		uint32_t m_sample_index; // dense, shared by every Sample with this name
 	};
 }
 
@@ -0,0 +1,292 @@
+#include "AsyncFileWriter.h"
+#include "MemoryAccounting.h"
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace graphite
+{
+	AsyncFileWriter::AsyncFileWriter(const std::string& path, size_t bufferSize, size_t maxQueuedBuffers) :
+		m_path(path),
+		m_buffer_size(bufferSize),
+		m_max_queued_buffers((maxQueuedBuffers > 0) ? maxQueuedBuffers : 1),
+		m_is_open(false),
+		m_stop(false),
+		m_failed(false),
+		m_submitted_buffer_count(0),
+		m_written_buffer_count(0),
+		m_flush_requested_count(0),
+		m_flushed_buffer_count(0),
+		m_written_byte_count(0),
+		m_flushed_byte_count(0)
+	{
+	}
+
+	AsyncFileWriter::~AsyncFileWriter()
+	{
+		close();
+	}
+
+	// resumeByteCount is the flushed byte count of the checkpoint a run resumes from, 0 starts the file over
+	bool AsyncFileWriter::open(uint64_t resumeByteCount)
+	{
+		if (this->m_is_open)
+		{
+			return true;
+		}
+		struct stat fileStat;
+		if (resumeByteCount > 0 && (stat(this->m_path.c_str(), &fileStat) != 0 || static_cast< uint64_t >(fileStat.st_size) < resumeByteCount || truncate(this->m_path.c_str(), resumeByteCount) != 0))
+		{
+			std::cout << "Unable to resume output file: " << this->m_path << std::endl;
+			return false;
+		}
+		this->m_written_byte_count = resumeByteCount;
+		this->m_flushed_byte_count = resumeByteCount;
+		if (!openFile(this->m_path))
+		{
+			std::cout << "Unable to open output file: " << this->m_path << std::endl;
+			return false;
+		}
+		this->m_buffer.reserve(this->m_buffer_size);
+		this->m_stop = false;
+		this->m_failed = false;
+		this->m_is_open = true;
+		this->m_output_thread = std::thread(&AsyncFileWriter::run, this);
+		return true;
+	}
+
+	void AsyncFileWriter::writeLine(const std::string& line)
+	{
+		writeLine(line.c_str(), line.size());
+	}
+
+	void AsyncFileWriter::writeLine(const char* line, size_t length)
+	{
+		std::unique_lock< std::mutex > lock(this->m_mutex);
+		this->m_buffer.append(line, length);
+		this->m_buffer.push_back('\n');
+		if (MemoryAccounting::isEnabled())
+		{
+			MemoryAccounting::allocate(MemoryAccounting::SUBSYSTEM::OUTPUT_BUFFERS, length + 1); // until the output thread has written it
+		}
+		if (this->m_buffer.size() >= this->m_buffer_size)
+		{
+			submitBuffer(lock);
+		}
+	}
+
+	// lines must hold whole, newline terminated, lines
+	void AsyncFileWriter::writeLines(const char* lines, size_t length)
+	{
+		std::unique_lock< std::mutex > lock(this->m_mutex);
+		this->m_buffer.append(lines, length);
+		if (MemoryAccounting::isEnabled())
+		{
+			MemoryAccounting::allocate(MemoryAccounting::SUBSYSTEM::OUTPUT_BUFFERS, length);
+		}
+		if (this->m_buffer.size() >= this->m_buffer_size)
+		{
+			submitBuffer(lock);
+		}
+	}
+
+	// copies the lines of another file into this one in buffer sized pieces, the lines are not parsed
+	// false when the file can't be read to its end or this writer already failed
+	bool AsyncFileWriter::appendFile(const std::string& path)
+	{
+		std::ifstream inFile(path, std::ios::in | std::ios::binary);
+		if (!inFile.is_open())
+		{
+			std::cout << "Unable to open file: " << path << std::endl;
+			return false;
+		}
+		std::string block(this->m_buffer_size, '\0');
+		size_t carriedLength = 0; // the start of a line that didn't fit in the last block
+		while (inFile)
+		{
+			inFile.read(&block[carriedLength], block.size() - carriedLength);
+			size_t blockLength = carriedLength + inFile.gcount();
+			const char* blockStart = block.c_str();
+			const char* linesEnd = blockStart + blockLength;
+			while (linesEnd > blockStart && *(linesEnd - 1) != '\n')
+			{
+				--linesEnd;
+			}
+			if (linesEnd == blockStart)
+			{
+				if (blockLength == block.size())
+				{
+					block.resize(block.size() * 2); // a single line longer than the block
+				}
+				carriedLength = blockLength;
+				continue;
+			}
+			size_t linesLength = linesEnd - blockStart;
+			writeLines(blockStart, linesLength);
+			carriedLength = blockLength - linesLength;
+			memmove(&block[0], blockStart + linesLength, carriedLength);
+		}
+		if (inFile.bad())
+		{
+			std::cout << "Unable to read file: " << path << std::endl;
+			return false;
+		}
+		if (carriedLength > 0)
+		{
+			writeLine(block.c_str(), carriedLength);
+		}
+		return !hasFailed();
+	}
+
+	// called with m_mutex held, blocks while the output thread is too far behind
+	void AsyncFileWriter::submitBuffer(std::unique_lock< std::mutex >& lock)
+	{
+		if (this->m_buffer.empty())
+		{
+			return;
+		}
+		this->m_progress_condition.wait(lock, [this] { return this->m_queued_buffers.size() < this->m_max_queued_buffers; });
+		this->m_queued_buffers.emplace_back(std::move(this->m_buffer));
+		++this->m_submitted_buffer_count;
+		this->m_buffer = std::string();
+		this->m_buffer.reserve(this->m_buffer_size);
+		this->m_work_condition.notify_one();
+	}
+
+	// false once anything written so far failed to reach the disk
+	bool AsyncFileWriter::flush()
+	{
+		if (!this->m_is_open)
+		{
+			return !this->m_failed;
+		}
+		std::unique_lock< std::mutex > lock(this->m_mutex);
+		submitBuffer(lock);
+		uint64_t target = this->m_submitted_buffer_count;
+		if (this->m_flushed_buffer_count < target)
+		{
+			this->m_flush_requested_count = target;
+			this->m_work_condition.notify_one();
+			this->m_progress_condition.wait(lock, [this, target] { return this->m_flushed_buffer_count >= target; });
+		}
+		return !this->m_failed;
+	}
+
+	bool AsyncFileWriter::close()
+	{
+		if (!this->m_is_open)
+		{
+			return !this->m_failed;
+		}
+		flush();
+		{
+			std::lock_guard< std::mutex > lock(this->m_mutex);
+			this->m_stop = true;
+		}
+		this->m_work_condition.notify_one();
+		this->m_output_thread.join();
+		if (!closeFile() && !this->m_failed)
+		{
+			std::cout << "Unable to write output file: " << this->m_path << std::endl;
+			this->m_failed = true;
+		}
+		this->m_is_open = false;
+		return !this->m_failed;
+	}
+
+	bool AsyncFileWriter::hasFailed()
+	{
+		std::lock_guard< std::mutex > lock(this->m_mutex);
+		return this->m_failed;
+	}
+
+	uint64_t AsyncFileWriter::getFlushedByteCount()
+	{
+		std::lock_guard< std::mutex > lock(this->m_mutex);
+		return this->m_flushed_byte_count;
+	}
+
+	void AsyncFileWriter::run()
+	{
+		std::unique_lock< std::mutex > lock(this->m_mutex);
+		while (true)
+		{
+			this->m_work_condition.wait(lock, [this] {
+					return this->m_stop || !this->m_queued_buffers.empty() || this->m_flushed_buffer_count < this->m_flush_requested_count;
+				});
+			if (!this->m_queued_buffers.empty())
+			{
+				std::string block = std::move(this->m_queued_buffers.front());
+				this->m_queued_buffers.pop_front();
+				this->m_progress_condition.notify_all(); // there is room in the queue again
+				bool hasFailed = this->m_failed; // nothing is written after a failed block, the file would have a gap
+				lock.unlock();
+				bool isWritten = !hasFailed && writeBlock(block);
+				lock.lock();
+				if (!isWritten && !this->m_failed)
+				{
+					std::cout << "Unable to write output file: " << this->m_path << ": " << strerror(errno) << std::endl;
+					this->m_failed = true;
+				}
+				++this->m_written_buffer_count;
+				this->m_written_byte_count += block.size();
+				if (MemoryAccounting::isEnabled())
+				{
+					MemoryAccounting::release(MemoryAccounting::SUBSYSTEM::OUTPUT_BUFFERS, block.size());
+				}
+			}
+			if (this->m_flushed_buffer_count < this->m_flush_requested_count && this->m_written_buffer_count >= this->m_flush_requested_count)
+			{
+				uint64_t writtenBufferCount = this->m_written_buffer_count;
+				uint64_t writtenByteCount = this->m_written_byte_count;
+				bool hasFailed = this->m_failed;
+				lock.unlock();
+				bool isFlushed = !hasFailed && flushFile();
+				lock.lock();
+				if (!isFlushed && !this->m_failed)
+				{
+					std::cout << "Unable to write output file: " << this->m_path << ": " << strerror(errno) << std::endl;
+					this->m_failed = true;
+				}
+				this->m_flushed_buffer_count = writtenBufferCount;
+				if (isFlushed)
+				{
+					this->m_flushed_byte_count = writtenByteCount; // a checkpoint never points past what reached the disk
+				}
+				this->m_progress_condition.notify_all();
+			}
+			if (this->m_stop && this->m_queued_buffers.empty())
+			{
+				return;
+			}
+		}
+	}
+
+	bool AsyncFileWriter::openFile(const std::string& path)
+	{
+		this->m_out_file.open(path, std::ios::out | std::ios::binary | ((this->m_written_byte_count > 0) ? std::ios::app : std::ios::trunc));
+		return this->m_out_file.is_open();
+	}
+
+	bool AsyncFileWriter::writeBlock(const std::string& block)
+	{
+		this->m_out_file.write(block.c_str(), block.size());
+		return this->m_out_file.good();
+	}
+
+	bool AsyncFileWriter::flushFile()
+	{
+		this->m_out_file.flush();
+		return this->m_out_file.good();
+	}
+
+	bool AsyncFileWriter::closeFile()
+	{
+		this->m_out_file.close();
+		return !this->m_out_file.fail();
+	}
+}
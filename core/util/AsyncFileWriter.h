@@ -0,0 +1,85 @@
+#ifndef GRAPHITE_ASYNCFILEWRITER_H
+#define GRAPHITE_ASYNCFILEWRITER_H
+
+#include "core/util/Noncopyable.hpp"
+
+#include <string>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+
+namespace graphite
+{
+	/*
+	 * Buffers whole lines (records) in memory and hands full buffers off to a
+	 * dedicated output thread. Lines are never split across buffers so the file on
+	 * disk always ends on a record boundary after a flush. The file is only
+	 * flushed when flush() is called (checkpoints) or when the writer is closed.
+	 * A resumed writer cuts the file back to the end of its last checkpoint and
+	 * appends to it. Once a write or flush fails (a full disk) the writer keeps
+	 * taking lines but drops them, and flush() and close() return false.
+	 *
+	 * Subclasses can change how blocks reach the disk by overriding the protected
+	 * file methods. Because those are called from the output thread, subclasses
+	 * must call close() from their own destructor.
+	 */
+	class AsyncFileWriter : private Noncopyable
+	{
+	public:
+		typedef std::shared_ptr< AsyncFileWriter > SharedPtr;
+		AsyncFileWriter(const std::string& path, size_t bufferSize = DEFAULT_BUFFER_SIZE, size_t maxQueuedBuffers = DEFAULT_MAX_QUEUED_BUFFERS);
+		virtual ~AsyncFileWriter();
+
+		bool open(uint64_t resumeByteCount = 0);
+		void writeLine(const std::string& line);
+		void writeLine(const char* line, size_t length);
+		void writeLines(const char* lines, size_t length);
+		bool appendFile(const std::string& path);
+		bool flush();
+		bool close();
+		bool isOpen() { return this->m_is_open; }
+		bool hasFailed();
+		std::string getPath() { return this->m_path; }
+		uint64_t getFlushedByteCount();
+
+		static const size_t DEFAULT_BUFFER_SIZE = 4 * 1024 * 1024;
+		static const size_t DEFAULT_MAX_QUEUED_BUFFERS = 8;
+
+	protected:
+		virtual bool openFile(const std::string& path);
+		virtual bool writeBlock(const std::string& block);
+		virtual bool flushFile();
+		virtual bool closeFile();
+
+	private:
+		void submitBuffer(std::unique_lock< std::mutex >& lock);
+		void run();
+
+		std::string m_path;
+		std::ofstream m_out_file;
+		size_t m_buffer_size;
+		size_t m_max_queued_buffers;
+		bool m_is_open;
+		bool m_stop;
+		bool m_failed; // a write or flush of the file failed, nothing after it reached the disk
+
+		std::string m_buffer; // the buffer producers are currently appending to
+		std::deque< std::string > m_queued_buffers; // full buffers waiting on the output thread
+		uint64_t m_submitted_buffer_count;
+		uint64_t m_written_buffer_count;
+		uint64_t m_flush_requested_count; // flush once this many buffers are written
+		uint64_t m_flushed_buffer_count;
+		uint64_t m_written_byte_count;
+		uint64_t m_flushed_byte_count; // bytes guaranteed to be handed to the OS, always a record boundary
+
+		std::mutex m_mutex;
+		std::condition_variable m_work_condition;
+		std::condition_variable m_progress_condition;
+		std::thread m_output_thread;
+	};
+}
+
+#endif //GRAPHITE_ASYNCFILEWRITER_H
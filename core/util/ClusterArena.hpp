@@ -0,0 +1,152 @@
+#ifndef GRAPHITE_CLUSTERARENA_HPP
+#define GRAPHITE_CLUSTERARENA_HPP
+
+#include "core/util/Noncopyable.hpp"
+
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+
+namespace graphite
+{
+	/*
+	 * A monotonic arena for the small objects of one cluster: the nodes of
+	 * its graph and the reads fetched for it. ClusterArena::makeShared puts
+	 * an object and its shared_ptr control block in one piece of the arena
+	 * instead of the heap. Releasing an object only runs its destructor; the
+	 * arena's blocks go back to the heap all at once, when the cluster is
+	 * written and the last object made from it is gone (every object holds
+	 * the arena through its allocator, so it can't outlive it).
+	 *
+	 * Only the Node and Alignment objects made with makeShared live in the
+	 * arena. The strings and sets they own and the variants, alleles and
+	 * their counts still come from the heap; the traceback scratch is on
+	 * the stack.
+	 *
+	 * The reads of a cluster are fetched on several threads, so a piece is
+	 * taken under a lock. Without an arena makeShared is std::make_shared.
+	 */
+	class ClusterArena : private Noncopyable
+	{
+	public:
+		typedef std::shared_ptr< ClusterArena > SharedPtr;
+		static const size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+		template < typename T >
+		class Allocator
+		{
+		public:
+			typedef T value_type;
+
+			Allocator(ClusterArena::SharedPtr arenaPtr) : m_arena_ptr(arenaPtr)
+			{
+			}
+
+			template < typename U >
+			Allocator(const Allocator< U >& allocator) : m_arena_ptr(allocator.getArenaPtr())
+			{
+			}
+
+			T* allocate(size_t count) { return static_cast< T* >(this->m_arena_ptr->allocate(count * sizeof(T), alignof(T))); }
+			void deallocate(T* ptr, size_t count) {} // the arena frees its blocks together
+			ClusterArena::SharedPtr getArenaPtr() const { return this->m_arena_ptr; }
+
+			template < typename U >
+			bool operator==(const Allocator< U >& allocator) const { return this->m_arena_ptr == allocator.getArenaPtr(); }
+			template < typename U >
+			bool operator!=(const Allocator< U >& allocator) const { return this->m_arena_ptr != allocator.getArenaPtr(); }
+
+		private:
+			ClusterArena::SharedPtr m_arena_ptr;
+		};
+
+		template < typename T, typename... ArgsT >
+		static std::shared_ptr< T > makeShared(const ClusterArena::SharedPtr& arenaPtr, ArgsT&&... args)
+		{
+			if (arenaPtr == nullptr)
+			{
+				return std::make_shared< T >(std::forward< ArgsT >(args)...);
+			}
+			return std::allocate_shared< T >(Allocator< T >(arenaPtr), std::forward< ArgsT >(args)...);
+		}
+
+		ClusterArena(size_t blockByteCount = DEFAULT_BLOCK_SIZE) :
+			m_block_byte_count(blockByteCount),
+			m_position(nullptr),
+			m_end(nullptr),
+			m_allocation_count(0),
+			m_allocated_byte_count(0)
+		{
+		}
+
+		~ClusterArena()
+		{
+			for (auto blockPtr : this->m_block_ptrs)
+			{
+				free(blockPtr);
+			}
+		}
+
+		void* allocate(size_t byteCount, size_t alignment)
+		{
+			std::lock_guard< std::mutex > lock(this->m_mutex);
+			char* alignedPosition = alignUp(this->m_position, alignment);
+			if (this->m_position == nullptr || alignedPosition + byteCount > this->m_end)
+			{
+				size_t blockByteCount = (byteCount + alignment > this->m_block_byte_count) ? byteCount + alignment : this->m_block_byte_count; // an object larger than a block gets a block of its own
+				char* blockPtr = static_cast< char* >(malloc(blockByteCount));
+				if (blockPtr == nullptr)
+				{
+					throw std::bad_alloc();
+				}
+				this->m_block_ptrs.emplace_back(blockPtr);
+				this->m_position = blockPtr;
+				this->m_end = blockPtr + blockByteCount;
+				alignedPosition = alignUp(this->m_position, alignment);
+			}
+			this->m_position = alignedPosition + byteCount;
+			++this->m_allocation_count;
+			this->m_allocated_byte_count += byteCount;
+			return alignedPosition;
+		}
+
+		size_t getBlockCount()
+		{
+			std::lock_guard< std::mutex > lock(this->m_mutex);
+			return this->m_block_ptrs.size();
+		}
+
+		uint64_t getAllocationCount()
+		{
+			std::lock_guard< std::mutex > lock(this->m_mutex);
+			return this->m_allocation_count;
+		}
+
+		uint64_t getAllocatedByteCount()
+		{
+			std::lock_guard< std::mutex > lock(this->m_mutex);
+			return this->m_allocated_byte_count;
+		}
+
+	private:
+		static char* alignUp(char* position, size_t alignment)
+		{
+			uintptr_t address = reinterpret_cast< uintptr_t >(position);
+			return reinterpret_cast< char* >((address + alignment - 1) & ~static_cast< uintptr_t >(alignment - 1));
+		}
+
+		size_t m_block_byte_count;
+		std::vector< char* > m_block_ptrs;
+		char* m_position; // the next free byte of the last block
+		char* m_end;
+		uint64_t m_allocation_count;
+		uint64_t m_allocated_byte_count;
+		std::mutex m_mutex;
+	};
+}
+
+#endif //GRAPHITE_CLUSTERARENA_HPP
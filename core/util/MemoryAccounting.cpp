@@ -0,0 +1,65 @@
+#include "MemoryAccounting.h"
+
+#include <fstream>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace graphite
+{
+	bool MemoryAccounting::s_enabled = false;
+	uint64_t MemoryAccounting::s_soft_limit = 0;
+	std::array< MemoryAccounting::SubsystemCounters, static_cast< size_t >(MemoryAccounting::SUBSYSTEM::END) > MemoryAccounting::s_subsystem_counters;
+
+	void MemoryAccounting::setSoftLimit(uint64_t byteCount)
+	{
+		s_soft_limit = byteCount;
+		if (byteCount > 0)
+		{
+			enable();
+		}
+	}
+
+	uint64_t MemoryAccounting::getLiveByteCount()
+	{
+		uint64_t liveByteCount = 0;
+		for (auto& subsystemCounters : s_subsystem_counters)
+		{
+			liveByteCount += subsystemCounters.m_live_byte_count.load(std::memory_order_relaxed);
+		}
+		return liveByteCount;
+	}
+
+	// the second field of statm is the resident page count, 0 where there is no /proc
+	uint64_t MemoryAccounting::getResidentByteCount()
+	{
+		std::ifstream statmFile("/proc/self/statm");
+		uint64_t pageCount = 0;
+		uint64_t residentPageCount = 0;
+		if (!(statmFile >> pageCount >> residentPageCount))
+		{
+			return 0;
+		}
+		return residentPageCount * static_cast< uint64_t >(sysconf(_SC_PAGESIZE));
+	}
+
+	uint64_t MemoryAccounting::getPeakResidentByteCount()
+	{
+		rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		return static_cast< uint64_t >(usage.ru_maxrss) * 1024; // kilobytes on Linux
+	}
+
+	std::string MemoryAccounting::getSubsystemName(SUBSYSTEM subsystem)
+	{
+		switch (subsystem)
+		{
+		case SUBSYSTEM::GRAPH_NODES: return "graph_nodes";
+		case SUBSYSTEM::ALLELES: return "alleles";
+		case SUBSYSTEM::ALIGNMENTS: return "alignments";
+		case SUBSYSTEM::SUPPORTING_READS: return "supporting_reads";
+		case SUBSYSTEM::OUTPUT_BUFFERS: return "output_buffers";
+		default: return "";
+		}
+	}
+}
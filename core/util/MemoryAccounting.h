@@ -0,0 +1,109 @@
+#ifndef GRAPHITE_MEMORYACCOUNTING_H
+#define GRAPHITE_MEMORYACCOUNTING_H
+
+#include "core/util/Noncopyable.hpp"
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <stdint.h>
+
+namespace graphite
+{
+	/*
+	 * Counts the live and peak bytes held by the objects of the subsystems
+	 * that grow with the input: graph nodes, alleles and their counts,
+	 * alignments, supporting read info and output buffers. An object holds
+	 * a MemoryAccounting::Tally that adds an estimate of its size (the object
+	 * and the strings and table entries it owns) when it is made or grows
+	 * and takes it back when it is destroyed. The figures are estimates of
+	 * what the objects hold, not of what the allocator hands out, and are
+	 * reported next to the process's resident size in the run report and
+	 * the status file. When accounting is off a tally only checks a flag.
+	 *
+	 * An optional soft limit (--memory_limit) makes the GraphProcessors wait
+	 * before they fetch the reads of another cluster while the accounted
+	 * bytes are over it, so fewer clusters and reads are in flight. It is
+	 * soft because a cluster that is already running is never stopped.
+	 */
+	class MemoryAccounting : private Noncopyable
+	{
+	public:
+		enum class SUBSYSTEM { GRAPH_NODES = 0, ALLELES, ALIGNMENTS, SUPPORTING_READS, OUTPUT_BUFFERS, END };
+
+		class Tally : private Noncopyable
+		{
+		public:
+			Tally(SUBSYSTEM subsystem, size_t byteCount = 0) :
+				m_subsystem(subsystem),
+				m_byte_count(0)
+			{
+				add(byteCount);
+			}
+
+			~Tally()
+			{
+				if (this->m_byte_count > 0)
+				{
+					MemoryAccounting::release(this->m_subsystem, this->m_byte_count);
+				}
+			}
+
+			// not thread safe, the owner calls it under its own lock
+			void add(size_t byteCount)
+			{
+				if (s_enabled && byteCount > 0)
+				{
+					this->m_byte_count += byteCount;
+					MemoryAccounting::allocate(this->m_subsystem, byteCount);
+				}
+			}
+
+		private:
+			SUBSYSTEM m_subsystem;
+			size_t m_byte_count;
+		};
+
+		static void enable() { s_enabled = true; } // before any accounted object is made
+		static bool isEnabled() { return s_enabled; }
+		static void setSoftLimit(uint64_t byteCount); // 0 is no limit, a limit turns accounting on
+		static uint64_t getSoftLimit() { return s_soft_limit; }
+		static bool isOverSoftLimit() { return s_soft_limit > 0 && getLiveByteCount() > s_soft_limit; }
+
+		static void allocate(SUBSYSTEM subsystem, size_t byteCount)
+		{
+			auto& subsystemCounters = s_subsystem_counters[static_cast< size_t >(subsystem)];
+			uint64_t liveByteCount = subsystemCounters.m_live_byte_count.fetch_add(byteCount, std::memory_order_relaxed) + byteCount;
+			uint64_t peakByteCount = subsystemCounters.m_peak_byte_count.load(std::memory_order_relaxed);
+			while (liveByteCount > peakByteCount && !subsystemCounters.m_peak_byte_count.compare_exchange_weak(peakByteCount, liveByteCount, std::memory_order_relaxed))
+			{
+			}
+		}
+
+		static void release(SUBSYSTEM subsystem, size_t byteCount)
+		{
+			s_subsystem_counters[static_cast< size_t >(subsystem)].m_live_byte_count.fetch_sub(byteCount, std::memory_order_relaxed);
+		}
+
+		static uint64_t getLiveByteCount(SUBSYSTEM subsystem) { return s_subsystem_counters[static_cast< size_t >(subsystem)].m_live_byte_count.load(std::memory_order_relaxed); }
+		static uint64_t getPeakByteCount(SUBSYSTEM subsystem) { return s_subsystem_counters[static_cast< size_t >(subsystem)].m_peak_byte_count.load(std::memory_order_relaxed); }
+		static uint64_t getLiveByteCount(); // of every subsystem
+		static uint64_t getResidentByteCount(); // the process's resident size now
+		static uint64_t getPeakResidentByteCount();
+		static std::string getSubsystemName(SUBSYSTEM subsystem);
+
+	private:
+		// a cache line each, alignments and supporting reads are counted from every worker
+		struct alignas(64) SubsystemCounters
+		{
+			std::atomic< uint64_t > m_live_byte_count;
+			std::atomic< uint64_t > m_peak_byte_count;
+		};
+
+		static bool s_enabled; // set before any work starts
+		static uint64_t s_soft_limit;
+		static std::array< SubsystemCounters, static_cast< size_t >(SUBSYSTEM::END) > s_subsystem_counters;
+	};
+}
+
+#endif //GRAPHITE_MEMORYACCOUNTING_H
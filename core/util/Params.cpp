@@ -3,8 +3,11 @@
 #include "config/GraphiteConfig.hpp"
 
 #include <string.h>
+#include <stdlib.h>
 #include <thread>
+#include <algorithm>
 #include <iostream>
+#include <fstream>
 
 namespace graphite
 {
@@ -26,7 +29,9 @@ namespace graphite
 			("d,include_duplicates", "Include Duplicate Reads")
 			("v,vcf", "Path to input VCF file[s], separate multiple files by space", cxxopts::value< std::vector< std::string > >())
 			("b,bam", "Path to input SAM/BAM/CRAM file[s], separate multiple files by space", cxxopts::value< std::vector< std::string > >())
-			("r,region", "Region information", cxxopts::value< std::string >())
+			("r,region", "Region information, a region (chr:start-end), a comma separated list of regions or a BED or region list file", cxxopts::value< std::string >())
+			("shard", "Only adjudicate shard i of N (i/N, i counts from 0) so a run can be spread over processes or nodes, the outputs are joined with graphite merge", cxxopts::value< std::string >())
+			("k,shards", "Split the regions into this many shards with about the same number of variants and adjudicate them side by side, 0 is one shard per thread [optional - default is 1]", cxxopts::value< uint32_t >()->default_value("1"))
 			("o,output_directory", "Path to output directory", cxxopts::value< std::string >())
 			("s,sample_name", "Ignore the BAM file's samples and use this passed in value as the sample name", cxxopts::value< std::string >()->default_value(""))
 			("f,fasta", "Path to input FASTA file", cxxopts::value< std::string >())
@@ -35,14 +40,215 @@ namespace graphite
 			("n,sample_limit", "If the number of reads exceed this number then Graphite will randomly sample n reads [optional - default is no sample limit]", cxxopts::value< int32_t >()->default_value("-1"))
 			("x,mismatch_value", "Smith-Waterman MisMatch Value [optional - default is 4]", cxxopts::value< uint32_t >()->default_value("4"))
 			("a,save_supporting_read", "Save Supporting Read Info [optional - default is false]")
+			("z,compress_output", "Write BGZF compressed output VCFs along with their tabix index [optional - default is false]")
+			("y,genotype", "Add GT_NFP, GQ_NFP and PL_NFP genotypes called from the DP4_NFP read counts [optional - default is false]")
 			("g,gap_open_value", "Smith-Waterman Gap Open Value [optional - default is 6]", cxxopts::value< uint32_t >()->default_value("6"))
 			("e,gap_extionsion_value", "Smith-Waterman Gap Extension Value [optional - default is 1]", cxxopts::value< uint32_t >()->default_value("1"))
 			("t,number_of_threads", "Number of threads to consume [optional - default is 2*number of cores]", cxxopts::value< int32_t >()->default_value("-1"))
 			("q,mapping_quality", "Mapping Quality Filter - (0 - 255) Filter reads that are less than or equal to this value [optional - default is no filter (-1)]", cxxopts::value< int32_t >()->default_value("-1"))
+			("c,cluster_buffer_size", "Memory in MB that clusters may hold while they are adjudicated and wait to be written in order [optional - default is 1024]", cxxopts::value< uint32_t >()->default_value("1024"))
+			("graph_store", "Path to a graph store written by graphite build-graphs for these VCFs and FASTA, its graphs are used instead of building them [optional]", cxxopts::value< std::string >())
+			("result_cache", "Path to a file that keeps read alignment results between runs, reads an earlier run aligned to an unchanged graph with the same scoring values aren't aligned again [optional]", cxxopts::value< std::string >())
+			("checkpoint_minutes", "Minutes between checkpoints that let a run that died be continued with --resume, 0 writes none [optional - default is 0, 10 with --resume]", cxxopts::value< uint32_t >()->default_value("0"))
+			("report", "Path of a JSON report with the calls, items, wall and CPU time of every stage of the run [optional]", cxxopts::value< std::string >())
+			("cluster_profile", "Path of a TSV with one row per cluster: its span, graph size, reads fetched and aligned, re-alignments and the time of every stage [optional]", cxxopts::value< std::string >())
+			("capture", "Directory that a snapshot of every slow cluster is written to, graphite replay adjudicates a snapshot again without the input files [optional]", cxxopts::value< std::string >())
+			("capture_seconds", "Seconds a cluster has to take, summed over the threads, to be captured [optional - default is 1]", cxxopts::value< double >()->default_value("1"))
+			("progress", "Seconds between progress lines with the position, variants and reads per second, busy workers, queues and an ETA, 0 prints none [optional - default is 0]", cxxopts::value< uint32_t >()->default_value("0"))
+			("status", "Path of a JSON status file with the same figures as the progress lines, rewritten every progress interval (10 seconds without --progress) [optional]", cxxopts::value< std::string >())
+			("memory_limit", "Soft limit in MB on the memory held by graphs, alleles, reads, supporting read info and output buffers, over it no more clusters are started until the running ones are written, 0 is no limit [optional - default is 0]", cxxopts::value< uint32_t >()->default_value("0"))
+			("resume", "Continue the run from the checkpoint in the output directory, without one the run starts from the beginning [optional - default is false]")
+			("open_alignment_limit", "Most alignment files that are open at once, the least recently used are closed and reopened when they are needed again [optional - default is as many as the open file limit allows]", cxxopts::value< uint32_t >()->default_value("0"))
 			("i,igv_visualization_output", "Output IGV input for visualization [optional - default is false]");
 		this->m_options.parse(argc, argv);
 	}
 
+	void Params::parseMerge(int argc, char** argv)
+	{
+		this->m_options.add_options()
+			("h,help","Print help message")
+			("v,vcf", "Paths to the shard VCFs written by --shard runs, separate multiple files by space", cxxopts::value< std::vector< std::string > >())
+			("o,output", "Path to the merged VCF, a .gz path is written as BGZF with a tabix index", cxxopts::value< std::string >())
+			("t,number_of_threads", "Number of compression threads [optional - default is 2*number of cores]", cxxopts::value< int32_t >()->default_value("-1"));
+		this->m_options.parse(argc, argv);
+	}
+
+	void Params::parseCombine(int argc, char** argv)
+	{
+		this->m_options.add_options()
+			("h,help","Print help message")
+			("v,vcf", "Paths to the sorted graphite VCFs to combine, separate multiple files by space", cxxopts::value< std::vector< std::string > >())
+			("l,vcf_list", "Path to a file with one VCF path per line, for more VCFs than fit on a command line", cxxopts::value< std::string >())
+			("o,output", "Path to the combined VCF, a .gz path is written as BGZF with a tabix index", cxxopts::value< std::string >())
+			("t,number_of_threads", "Number of compression threads [optional - default is 2*number of cores]", cxxopts::value< int32_t >()->default_value("-1"));
+		this->m_options.parse(argc, argv);
+	}
+
+	void Params::parseBuildGraphs(int argc, char** argv)
+	{
+		this->m_options.add_options()
+			("h,help","Print help message")
+			("v,vcf", "Path to input VCF file[s] in the order they will be adjudicated, separate multiple files by space", cxxopts::value< std::vector< std::string > >())
+			("f,fasta", "Path to input FASTA file", cxxopts::value< std::string >())
+			("b,bam", "Path to SAM/BAM/CRAM file[s] with the read length of the samples that will be adjudicated, the graph spacing comes from it", cxxopts::value< std::vector< std::string > >())
+			("graph_spacing", "Graph spacing, the longest read length of the samples that will be adjudicated [optional - default is taken from the alignment files]", cxxopts::value< uint32_t >()->default_value("0"))
+			("o,output", "Path to the graph store", cxxopts::value< std::string >())
+			("t,number_of_threads", "Number of threads to consume [optional - default is 2*number of cores]", cxxopts::value< int32_t >()->default_value("-1"));
+		this->m_options.parse(argc, argv);
+	}
+
+	void Params::parseServe(int argc, char** argv)
+	{
+		this->m_options.add_options()
+			("h,help","Print help message")
+			("socket", "Path of the UNIX domain socket the server listens on", cxxopts::value< std::string >())
+			("f,fasta", "Path to input FASTA file", cxxopts::value< std::string >())
+			("b,bam", "Path to input SAM/BAM/CRAM file[s], separate multiple files by space", cxxopts::value< std::vector< std::string > >())
+			("v,vcf", "Path to VCF file[s] that region requests adjudicate the records of, separate multiple files by space [optional]", cxxopts::value< std::vector< std::string > >())
+			("m,match_value", "Smith-Waterman Match Value [optional - default is 1]", cxxopts::value< uint32_t >()->default_value("1"))
+			("x,mismatch_value", "Smith-Waterman MisMatch Value [optional - default is 4]", cxxopts::value< uint32_t >()->default_value("4"))
+			("g,gap_open_value", "Smith-Waterman Gap Open Value [optional - default is 6]", cxxopts::value< uint32_t >()->default_value("6"))
+			("e,gap_extionsion_value", "Smith-Waterman Gap Extension Value [optional - default is 1]", cxxopts::value< uint32_t >()->default_value("1"))
+			("q,mapping_quality", "Mapping Quality Filter - (0 - 255) Filter reads that are less than or equal to this value [optional - default is no filter (-1)]", cxxopts::value< int32_t >()->default_value("-1"))
+			("n,sample_limit", "If the number of reads exceed this number then Graphite will randomly sample n reads [optional - default is no sample limit]", cxxopts::value< int32_t >()->default_value("-1"))
+			("y,genotype", "Add GT_NFP, GQ_NFP and PL_NFP genotypes called from the DP4_NFP read counts [optional - default is false]")
+			("c,cluster_buffer_size", "Memory in MB that clusters may hold while they are adjudicated and wait to be written in order [optional - default is 1024]", cxxopts::value< uint32_t >()->default_value("1024"))
+			("t,number_of_threads", "Number of threads to consume [optional - default is 2*number of cores]", cxxopts::value< int32_t >()->default_value("-1"));
+		this->m_options.parse(argc, argv);
+	}
+
+	void Params::parseReplay(int argc, char** argv)
+	{
+		this->m_options.add_options()
+			("h,help","Print help message")
+			("i,snapshot", "Path of a cluster snapshot written by a run with --capture", cxxopts::value< std::string >())
+			("repeat", "Times the cluster is adjudicated [optional - default is 1]", cxxopts::value< uint32_t >()->default_value("1"))
+			("report", "Path of a JSON report with the calls, items, wall and CPU time of every stage of the replay [optional]", cxxopts::value< std::string >())
+			("t,number_of_threads", "Number of threads to consume [optional - default is 2*number of cores]", cxxopts::value< int32_t >()->default_value("-1"));
+		this->m_options.parse(argc, argv);
+	}
+
+	bool Params::validateReplayRequired()
+	{
+		if (!m_options.count("i"))
+		{
+			std::cout << "There was a problem parsing commands" << std::endl;
+			std::cout << "a snapshot path is required" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	std::string Params::getSnapshotPath()
+	{
+		auto snapshotPath = m_options["i"].as< std::string >();
+		std::vector< std::string > snapshotPaths = {snapshotPath};
+		validateFilePaths(snapshotPaths, true);
+		return snapshotPath;
+	}
+
+	uint32_t Params::getRepeatCount()
+	{
+		return std::max< uint32_t >(1, m_options["repeat"].as< uint32_t >());
+	}
+
+	bool Params::validateServeRequired()
+	{
+		if (!m_options.count("socket") || !m_options.count("f") || !m_options.count("b"))
+		{
+			std::cout << "There was a problem parsing commands" << std::endl;
+			std::cout << "a socket path, a fasta path and alignment paths are required" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// the -v VCFs are optional for a server, without them only requests with records are served
+	std::vector< std::string > Params::getServeVCFPaths()
+	{
+		std::vector< std::string > vcfPaths;
+		if (m_options.count("v"))
+		{
+			vcfPaths = getInVCFPaths();
+		}
+		return vcfPaths;
+	}
+
+	std::string Params::getSocketPath()
+	{
+		return m_options["socket"].as< std::string >();
+	}
+
+	bool Params::validateBuildGraphsRequired()
+	{
+		if (!m_options.count("v") || !m_options.count("f") || !m_options.count("o") || (!m_options.count("b") && getGraphSpacing() == 0))
+		{
+			std::cout << "There was a problem parsing commands" << std::endl;
+			std::cout << "vcf paths, a fasta path, an output path and alignment paths (or a graph spacing) are required" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// 0 when it comes from the alignment files
+	uint32_t Params::getGraphSpacing()
+	{
+		return m_options["graph_spacing"].as< uint32_t >();
+	}
+
+	bool Params::validateCombineRequired()
+	{
+		if ((!m_options.count("v") && !m_options.count("l")) || !m_options.count("o"))
+		{
+			std::cout << "There was a problem parsing commands" << std::endl;
+			std::cout << "vcf paths (or a vcf list) and an output path are required" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	std::vector< std::string > Params::getCombineVCFPaths()
+	{
+		std::vector< std::string > vcfPaths;
+		if (m_options.count("v"))
+		{
+			vcfPaths = m_options["v"].as< std::vector< std::string > >();
+		}
+		if (m_options.count("l"))
+		{
+			auto vcfListPath = m_options["l"].as< std::string >();
+			fileExists(vcfListPath, true);
+			std::ifstream vcfListFile(vcfListPath);
+			std::string line;
+			while (std::getline(vcfListFile, line))
+			{
+				if (line.size() > 0)
+				{
+					vcfPaths.emplace_back(line);
+				}
+			}
+		}
+		validateFilePaths(vcfPaths, true);
+		return vcfPaths;
+	}
+
+	bool Params::validateMergeRequired()
+	{
+		if (!m_options.count("v") || !m_options.count("o"))
+		{
+			std::cout << "There was a problem parsing commands" << std::endl;
+			std::cout << "shard vcf paths and an output path are required" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// the output file of merge, combine and build-graphs
+	std::string Params::getOutputFilePath()
+	{
+		return m_options["o"].as< std::string >();
+	}
+
 	void Params::parsePathTrace(int argc, char** argv)
 	{
 
@@ -138,13 +344,82 @@ namespace graphite
 		return m_options["s"].as< std::string >();
 	}
 
-	Region::SharedPtr Params::getRegion()
+	std::vector< Region::SharedPtr > Params::getRegionPtrs()
+	{
+		std::vector< Region::SharedPtr > regionPtrs;
+		if (!m_options.count("r"))
+		{
+			return regionPtrs;
+		}
+		auto regionArgument = m_options["r"].as< std::string >();
+		if (fileExists(regionArgument, false))
+		{
+			// BED files are zero based and half open, region lists hold one region string per line
+			bool isBed = (regionArgument.substr(regionArgument.find_last_of(".") + 1) == "bed");
+			std::ifstream regionFile(regionArgument);
+			std::string line;
+			while (std::getline(regionFile, line))
+			{
+				if (line.size() == 0 || line[0] == '#' || line.compare(0, 5, "track") == 0 || line.compare(0, 7, "browser") == 0)
+				{
+					continue;
+				}
+				if (isBed)
+				{
+					std::vector< std::string > columns;
+					split(line, '\t', columns);
+					if (columns.size() < 3)
+					{
+						std::cout << "Invalid BED line: " << line << std::endl;
+						exit(EXIT_FAILURE);
+					}
+					regionPtrs.emplace_back(std::make_shared< Region >(columns[0], std::stoul(columns[1]) + 1, std::stoul(columns[2]), Region::BASED::ONE));
+				}
+				else
+				{
+					regionPtrs.emplace_back(std::make_shared< Region >(line, Region::BASED::ONE));
+				}
+			}
+		}
+		else
+		{
+			std::vector< std::string > regionStrings;
+			split(regionArgument, ',', regionStrings);
+			if (regionStrings.size() == 0)
+			{
+				regionStrings.emplace_back(regionArgument);
+			}
+			for (auto& regionString : regionStrings)
+			{
+				regionPtrs.emplace_back(std::make_shared< Region >(regionString, Region::BASED::ONE));
+			}
+		}
+		return regionPtrs;
+	}
+
+	// false when the run isn't limited to one shard
+	bool Params::getShard(uint32_t& shardIndex, uint32_t& shardCount)
 	{
-		if (m_options.count("r"))
+		if (!m_options.count("shard"))
+		{
+			return false;
+		}
+		auto shardString = m_options["shard"].as< std::string >();
+		char* countStart = nullptr;
+		shardIndex = strtoul(shardString.c_str(), &countStart, 10);
+		shardCount = (*countStart == '/') ? strtoul(countStart + 1, nullptr, 10) : 0;
+		if (countStart == shardString.c_str() || shardCount == 0 || shardIndex >= shardCount)
 		{
-			return std::make_shared< Region >(m_options["r"].as< std::string >(), Region::BASED::ONE);
+			std::cout << "Invalid shard, please provide it as i/N with 0 <= i < N: " << shardString << std::endl;
+			exit(EXIT_FAILURE);
 		}
-		return nullptr;
+		return true;
+	}
+
+	uint32_t Params::getShardCount()
+	{
+		auto shardCount = m_options["k"].as< uint32_t >();
+		return (shardCount == 0) ? getThreadCount() : shardCount;
 	}
 
 	uint32_t Params::getThreadCount()
@@ -212,4 +487,95 @@ namespace graphite
 		return m_options["a"].as< bool >();
 	}
 
+	size_t Params::getClusterBufferByteCount()
+	{
+		return static_cast< size_t >(m_options["c"].as< uint32_t >()) * 1024 * 1024;
+	}
+
+	// 0 when the limit should come from the open file limit
+	uint32_t Params::getOpenAlignmentLimit()
+	{
+		return m_options["open_alignment_limit"].as< uint32_t >();
+	}
+
+	// empty when graphs are built from the FASTA
+	std::string Params::getGraphStorePath()
+	{
+		return (m_options.count("graph_store")) ? m_options["graph_store"].as< std::string >() : "";
+	}
+
+	// 0 when no checkpoints are written
+	uint32_t Params::getCheckpointMinutes()
+	{
+		uint32_t checkpointMinutes = m_options["checkpoint_minutes"].as< uint32_t >();
+		return (checkpointMinutes == 0 && resumeRun()) ? 10 : checkpointMinutes; // a resumed run keeps checkpointing
+	}
+
+	bool Params::resumeRun()
+	{
+		return m_options.count("resume");
+	}
+
+	// empty when every read is aligned
+	std::string Params::getResultCachePath()
+	{
+		return (m_options.count("result_cache")) ? m_options["result_cache"].as< std::string >() : "";
+	}
+
+	std::string Params::getReportPath()
+	{
+		return (m_options.count("report")) ? m_options["report"].as< std::string >() : "";
+	}
+
+	std::string Params::getClusterProfilePath()
+	{
+		return (m_options.count("cluster_profile")) ? m_options["cluster_profile"].as< std::string >() : "";
+	}
+
+	// empty when no clusters are captured
+	std::string Params::getCaptureDirectory()
+	{
+		if (!m_options.count("capture"))
+		{
+			return "";
+		}
+		auto captureDirectory = m_options["capture"].as< std::string >();
+		std::vector< std::string > captureDirectories = {captureDirectory};
+		validateFolderPaths(captureDirectories, true);
+		return captureDirectory;
+	}
+
+	double Params::getCaptureSeconds()
+	{
+		return m_options["capture_seconds"].as< double >();
+	}
+
+	// 0 when no progress lines are printed
+	uint32_t Params::getProgressSeconds()
+	{
+		return m_options["progress"].as< uint32_t >();
+	}
+
+	// empty when no status file is written
+	std::string Params::getStatusPath()
+	{
+		return (m_options.count("status")) ? m_options["status"].as< std::string >() : "";
+	}
+
+	// 0 when there is no limit
+	uint64_t Params::getMemoryLimitByteCount()
+	{
+		return static_cast< uint64_t >(m_options["memory_limit"].as< uint32_t >()) * 1024 * 1024;
+	}
+
+	bool Params::compressOutput()
+	{
+		return m_options["z"].as< bool >();
+	}
+
+	bool Params::genotypeSamples()
+	{
+		return m_options["y"].as< bool >();
+	}
+
 }
@@ -20,6 +20,23 @@ namespace graphite
 
 		void parseGSSW(int argc, char** argv);
 		void parsePathTrace(int argc, char** argv);
+		void parseMerge(int argc, char** argv);
+		bool validateMergeRequired();
+		void parseCombine(int argc, char** argv);
+		bool validateCombineRequired();
+		std::vector< std::string > getCombineVCFPaths();
+		void parseBuildGraphs(int argc, char** argv);
+		bool validateBuildGraphsRequired();
+		uint32_t getGraphSpacing();
+		void parseServe(int argc, char** argv);
+		bool validateServeRequired();
+		std::vector< std::string > getServeVCFPaths();
+		std::string getSocketPath();
+		void parseReplay(int argc, char** argv);
+		bool validateReplayRequired();
+		std::string getSnapshotPath();
+		uint32_t getRepeatCount();
+		std::string getOutputFilePath();
 		bool showHelp();
 		void printHelp();
 		bool validateRequired();
@@ -29,7 +46,9 @@ namespace graphite
 		std::vector< std::string > getAlignmentPaths();
 		std::string getOutputDirectory();
 		std::string getOverwrittenSampleName();
-		Region::SharedPtr getRegion();
+		std::vector< Region::SharedPtr > getRegionPtrs();
+		uint32_t getShardCount();
+		bool getShard(uint32_t& shardIndex, uint32_t& shardCount);
         bool getIncludeDuplicates();
 		uint32_t getPercent();
 		uint32_t getThreadCount();
@@ -42,6 +61,21 @@ namespace graphite
 		bool outputVisualizationFiles();
 		int32_t getReadSampleNumber();
 		bool saveSupportingReadInformation();
+		bool compressOutput();
+		uint32_t getOpenAlignmentLimit();
+		std::string getGraphStorePath();
+		std::string getResultCachePath();
+		std::string getReportPath();
+		std::string getClusterProfilePath();
+		std::string getCaptureDirectory();
+		double getCaptureSeconds();
+		uint32_t getProgressSeconds();
+		std::string getStatusPath();
+		uint64_t getMemoryLimitByteCount();
+		uint32_t getCheckpointMinutes();
+		bool resumeRun();
+		bool genotypeSamples();
+		size_t getClusterBufferByteCount();
 	private:
 		void validateFolderPaths(const std::vector< std::string >& paths, bool exitOnFailure);
 		void validateFilePaths(const std::vector< std::string >& paths, bool exitOnFailure);
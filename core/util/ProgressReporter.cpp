@@ -0,0 +1,217 @@
+#include "ProgressReporter.h"
+#include "MemoryAccounting.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace graphite
+{
+	static const uint32_t SAMPLE_MILLISECONDS = 100; // between two samples of the busy workers
+	static const double BYTES_PER_MB = 1024.0 * 1024.0;
+
+	ProgressReporter::ProgressReporter(uint32_t printIntervalSeconds, const std::string& statusPath) :
+		m_print_interval_seconds(printIntervalSeconds),
+		m_report_interval_seconds((printIntervalSeconds > 0) ? printIntervalSeconds : 10),
+		m_status_path(statusPath),
+		m_thread_pool_ptr(nullptr),
+		m_total_variant_count(0),
+		m_started_position(0),
+		m_written_position(0),
+		m_variant_count(0),
+		m_read_count(0),
+		m_started_cluster_count(0),
+		m_written_cluster_count(0),
+		m_busy_sample_sum(0),
+		m_sample_count(0),
+		m_reported_variant_count(0),
+		m_reported_read_count(0),
+		m_stopped(true)
+	{
+	}
+
+	ProgressReporter::~ProgressReporter()
+	{
+		stop();
+	}
+
+	void ProgressReporter::start()
+	{
+		this->m_start_time = std::chrono::steady_clock::now();
+		this->m_written_time = this->m_start_time;
+		this->m_reported_time = this->m_start_time;
+		this->m_stopped = false;
+		this->m_thread = std::thread(&ProgressReporter::run, this);
+	}
+
+	void ProgressReporter::stop()
+	{
+		{
+			std::lock_guard< std::mutex > lock(this->m_stop_mutex);
+			if (this->m_stopped)
+			{
+				return;
+			}
+			this->m_stopped = true;
+		}
+		this->m_stop_condition.notify_all();
+		this->m_thread.join();
+		report(true);
+	}
+
+	void ProgressReporter::clusterStarted(const std::string& contig, position startPosition)
+	{
+		this->m_started_cluster_count.fetch_add(1, std::memory_order_relaxed);
+		std::lock_guard< std::mutex > lock(this->m_position_mutex);
+		this->m_started_contig = contig;
+		this->m_started_position = startPosition;
+	}
+
+	void ProgressReporter::clusterWritten(const std::string& contig, position startPosition, uint64_t variantCount)
+	{
+		this->m_variant_count.fetch_add(variantCount, std::memory_order_relaxed);
+		this->m_written_cluster_count.fetch_add(1, std::memory_order_relaxed);
+		std::lock_guard< std::mutex > lock(this->m_position_mutex);
+		this->m_written_contig = contig;
+		this->m_written_position = startPosition;
+		this->m_written_time = std::chrono::steady_clock::now();
+	}
+
+	void ProgressReporter::run()
+	{
+		auto nextReportTime = this->m_start_time + std::chrono::seconds(this->m_report_interval_seconds);
+		std::unique_lock< std::mutex > lock(this->m_stop_mutex);
+		while (!this->m_stop_condition.wait_for(lock, std::chrono::milliseconds(SAMPLE_MILLISECONDS), [this]() { return this->m_stopped; }))
+		{
+			if (this->m_thread_pool_ptr != nullptr)
+			{
+				this->m_busy_sample_sum += this->m_thread_pool_ptr->getRunningCount();
+				++this->m_sample_count;
+			}
+			if (std::chrono::steady_clock::now() >= nextReportTime)
+			{
+				report(false);
+				nextReportTime += std::chrono::seconds(this->m_report_interval_seconds);
+			}
+		}
+	}
+
+	void ProgressReporter::report(bool isFinished)
+	{
+		auto now = std::chrono::steady_clock::now();
+		double elapsedSeconds = std::chrono::duration< double >(now - this->m_start_time).count();
+		double intervalSeconds = std::max(std::chrono::duration< double >(now - this->m_reported_time).count(), 1e-9);
+		uint64_t variantCount = this->m_variant_count.load(std::memory_order_relaxed);
+		uint64_t readCount = this->m_read_count.load(std::memory_order_relaxed);
+		double variantsPerSecond = (isFinished) ? variantCount / std::max(elapsedSeconds, 1e-9) : (variantCount - this->m_reported_variant_count) / intervalSeconds;
+		double readsPerSecond = (isFinished) ? readCount / std::max(elapsedSeconds, 1e-9) : (readCount - this->m_reported_read_count) / intervalSeconds;
+		uint64_t clustersInFlight = this->m_started_cluster_count.load(std::memory_order_relaxed) - this->m_written_cluster_count.load(std::memory_order_relaxed);
+		size_t threadCount = (this->m_thread_pool_ptr != nullptr) ? this->m_thread_pool_ptr->getThreadCount() : 0;
+		size_t queuedTaskCount = (this->m_thread_pool_ptr != nullptr) ? this->m_thread_pool_ptr->getQueuedCount() : 0;
+		double busyWorkers = (this->m_sample_count > 0) ? static_cast< double >(this->m_busy_sample_sum) / this->m_sample_count : 0.0;
+		this->m_reported_variant_count = variantCount;
+		this->m_reported_read_count = readCount;
+		this->m_reported_time = now;
+		this->m_busy_sample_sum = 0;
+		this->m_sample_count = 0;
+
+		std::string startedContig;
+		position startedPosition;
+		std::string writtenContig;
+		position writtenPosition;
+		double writtenSecondsAgo;
+		{
+			std::lock_guard< std::mutex > lock(this->m_position_mutex);
+			startedContig = this->m_started_contig;
+			startedPosition = this->m_started_position;
+			writtenContig = this->m_written_contig;
+			writtenPosition = this->m_written_position;
+			writtenSecondsAgo = std::chrono::duration< double >(now - this->m_written_time).count();
+		}
+
+		double fractionDone = 1.0;
+		if (!isFinished)
+		{
+			fractionDone = (this->m_total_variant_count > 0) ? static_cast< double >(variantCount) / this->m_total_variant_count : ((this->m_progress_source) ? this->m_progress_source() : 0.0);
+			fractionDone = std::min(std::max(fractionDone, 0.0), 1.0);
+		}
+		double etaSeconds = (fractionDone > 0.0) ? elapsedSeconds * (1.0 - fractionDone) / fractionDone : -1.0; // -1 until something is done
+		bool isMemoryAccounted = MemoryAccounting::isEnabled();
+		uint64_t accountedByteCount = (isMemoryAccounted) ? MemoryAccounting::getLiveByteCount() : 0;
+		uint64_t residentByteCount = MemoryAccounting::getResidentByteCount();
+
+		if (this->m_print_interval_seconds > 0)
+		{
+			std::ostringstream line;
+			line << std::fixed << std::setprecision(1);
+			line << "[progress " << formatSeconds(elapsedSeconds) << "] ";
+			if (isFinished)
+			{
+				line << "finished";
+			}
+			else
+			{
+				line << "at " << ((startedContig.size() > 0) ? startedContig + ":" + std::to_string(startedPosition) : "-");
+				line << ", written to " << ((writtenContig.size() > 0) ? writtenContig + ":" + std::to_string(writtenPosition) : "-") << " " << writtenSecondsAgo << "s ago";
+			}
+			line << ", " << variantCount << " variants (" << variantsPerSecond << "/s), " << readCount << " reads (" << readsPerSecond << "/s)";
+			if (!isFinished)
+			{
+				line << ", workers " << busyWorkers << "/" << threadCount << " busy, " << queuedTaskCount << " tasks queued, " << clustersInFlight << " clusters in flight";
+				line << ", " << (fractionDone * 100.0) << "% done, ETA " << ((etaSeconds >= 0.0) ? formatSeconds(etaSeconds) : "-");
+			}
+			line << ", memory ";
+			if (isMemoryAccounted)
+			{
+				line << (accountedByteCount / BYTES_PER_MB) << "MB accounted, ";
+			}
+			line << (residentByteCount / BYTES_PER_MB) << "MB resident";
+			std::cout << line.str() << std::endl;
+		}
+
+		if (this->m_status_path.size() > 0)
+		{
+			// written beside the status file and renamed over it, so a reader never sees half of it
+			std::string temporaryPath = this->m_status_path + ".tmp";
+			std::ofstream statusFile(temporaryPath);
+			statusFile << std::fixed << std::setprecision(3);
+			statusFile << "{\n";
+			statusFile << "  \"finished\": " << ((isFinished) ? "true" : "false") << ",\n";
+			statusFile << "  \"elapsed_seconds\": " << elapsedSeconds << ",\n";
+			statusFile << "  \"contig\": \"" << startedContig << "\",\n";
+			statusFile << "  \"position\": " << startedPosition << ",\n";
+			statusFile << "  \"written_contig\": \"" << writtenContig << "\",\n";
+			statusFile << "  \"written_position\": " << writtenPosition << ",\n";
+			statusFile << "  \"seconds_since_write\": " << writtenSecondsAgo << ",\n";
+			statusFile << "  \"variants\": " << variantCount << ",\n";
+			statusFile << "  \"reads\": " << readCount << ",\n";
+			statusFile << "  \"variants_per_second\": " << variantsPerSecond << ",\n";
+			statusFile << "  \"reads_per_second\": " << readsPerSecond << ",\n";
+			statusFile << "  \"threads\": " << threadCount << ",\n";
+			statusFile << "  \"busy_workers\": " << busyWorkers << ",\n";
+			statusFile << "  \"queued_tasks\": " << queuedTaskCount << ",\n";
+			statusFile << "  \"clusters_in_flight\": " << clustersInFlight << ",\n";
+			statusFile << "  \"accounted_bytes\": " << ((isMemoryAccounted) ? std::to_string(accountedByteCount) : "null") << ",\n";
+			statusFile << "  \"resident_bytes\": " << residentByteCount << ",\n";
+			statusFile << "  \"fraction_done\": " << fractionDone << ",\n";
+			statusFile << "  \"eta_seconds\": " << etaSeconds << "\n";
+			statusFile << "}\n";
+			statusFile.close();
+			if (!statusFile || std::rename(temporaryPath.c_str(), this->m_status_path.c_str()) != 0)
+			{
+				std::cout << "Unable to write the status file: " << this->m_status_path << std::endl;
+			}
+		}
+	}
+
+	std::string ProgressReporter::formatSeconds(double seconds)
+	{
+		uint64_t wholeSeconds = static_cast< uint64_t >(seconds);
+		char formatted[32];
+		snprintf(formatted, sizeof(formatted), "%llu:%02llu:%02llu", static_cast< unsigned long long >(wholeSeconds / 3600), static_cast< unsigned long long >((wholeSeconds / 60) % 60), static_cast< unsigned long long >(wholeSeconds % 60));
+		return formatted;
+	}
+}
@@ -0,0 +1,88 @@
+#ifndef GRAPHITE_PROGRESSREPORTER_H
+#define GRAPHITE_PROGRESSREPORTER_H
+
+#include "core/util/Noncopyable.hpp"
+#include "core/util/Types.h"
+#include "core/util/ThreadPool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace graphite
+{
+	/*
+	 * Reports how far a run has come while it runs (--progress, --status):
+	 * the cluster being adjudicated and the last one written, variants and
+	 * reads per second since the last report, how busy the thread pool's
+	 * workers were, the tasks waiting for them, the clusters in flight, the
+	 * accounted and resident memory and an ETA. The GraphProcessors tell it
+	 * about every cluster they start and write, nothing is counted per read.
+	 * Its own thread samples the pool ten times a second and prints a line
+	 * and rewrites the status file on every interval. The fraction done
+	 * comes from the variant count when the run knows it (sharded runs),
+	 * otherwise from how much of the VCFs was read.
+	 */
+	class ProgressReporter : private Noncopyable
+	{
+	public:
+		typedef std::shared_ptr< ProgressReporter > SharedPtr;
+		typedef std::function< double () > ProgressSource; // the fraction of the input that was read, 0 to 1
+		ProgressReporter(uint32_t printIntervalSeconds, const std::string& statusPath);
+		~ProgressReporter();
+
+		void setThreadPool(std::shared_ptr< ThreadPool > threadPoolPtr) { this->m_thread_pool_ptr = threadPoolPtr; }
+		void setTotalVariantCount(uint64_t totalVariantCount) { this->m_total_variant_count = totalVariantCount; }
+		void setProgressSource(ProgressSource progressSource) { this->m_progress_source = progressSource; }
+		void start();
+		void stop(); // reports once more as finished
+
+		// once per cluster, from the GraphProcessors
+		void clusterStarted(const std::string& contig, position startPosition);
+		void addFetchedReads(uint64_t readCount) { this->m_read_count.fetch_add(readCount, std::memory_order_relaxed); }
+		void clusterWritten(const std::string& contig, position startPosition, uint64_t variantCount);
+
+	private:
+		void run();
+		void report(bool isFinished);
+		static std::string formatSeconds(double seconds);
+
+		uint32_t m_print_interval_seconds; // 0 prints no lines
+		uint32_t m_report_interval_seconds;
+		std::string m_status_path; // empty writes no status file
+		std::shared_ptr< ThreadPool > m_thread_pool_ptr;
+		uint64_t m_total_variant_count; // 0 when it isn't known
+		ProgressSource m_progress_source;
+		std::chrono::steady_clock::time_point m_start_time;
+
+		std::mutex m_position_mutex;
+		std::string m_started_contig;
+		position m_started_position;
+		std::string m_written_contig;
+		position m_written_position;
+		std::chrono::steady_clock::time_point m_written_time;
+		std::atomic< uint64_t > m_variant_count;
+		std::atomic< uint64_t > m_read_count;
+		std::atomic< uint64_t > m_started_cluster_count;
+		std::atomic< uint64_t > m_written_cluster_count;
+
+		// only touched by the reporting thread
+		uint64_t m_busy_sample_sum;
+		uint64_t m_sample_count;
+		uint64_t m_reported_variant_count;
+		uint64_t m_reported_read_count;
+		std::chrono::steady_clock::time_point m_reported_time;
+
+		std::thread m_thread;
+		std::mutex m_stop_mutex;
+		std::condition_variable m_stop_condition;
+		bool m_stopped;
+	};
+}
+
+#endif //GRAPHITE_PROGRESSREPORTER_H
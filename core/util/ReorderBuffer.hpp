@@ -0,0 +1,192 @@
+#ifndef GRAPHITE_REORDERBUFFER_HPP
+#define GRAPHITE_REORDERBUFFER_HPP
+
+#include "core/util/Noncopyable.hpp"
+
+#include <map>
+#include <cstdint>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+
+namespace graphite
+{
+	/*
+	 * Hands items to a consumer in sequence order even though they complete in
+	 * any order. A producer reserves a sequence number (and an estimate of the
+	 * memory the item will hold until it is consumed) before the item's work is
+	 * started and completes it from whichever thread finishes the work. Items
+	 * are consumed by the thread that completes the head of the line, one at a
+	 * time and strictly in order.
+	 *
+	 * reserve blocks while the reserved memory is over the cap, so the number
+	 * of items that are running or waiting on the head of the line stays
+	 * bounded. A single item larger than the cap is still let through once
+	 * everything ahead of it has been consumed.
+	 *
+	 * waitWhile lets a producer hold off on starting more work for a reason
+	 * of its own (a memory limit) for as long as items are in flight.
+	 */
+	template < typename T >
+	class ReorderBuffer : private Noncopyable
+	{
+	public:
+		typedef std::function< void (T&) > Consumer;
+
+		ReorderBuffer(size_t maxReservedBytes, Consumer consumer) :
+			m_max_reserved_bytes(maxReservedBytes),
+			m_consumer(consumer),
+			m_next_reserved_sequence(0),
+			m_next_consumed_sequence(0),
+			m_reserved_bytes(0),
+			m_draining(false),
+			m_max_buffered_count(0),
+			m_stalled(false),
+			m_head_of_line_stall_time(0),
+			m_reserve_wait_time(0),
+			m_throttle_wait_time(0)
+		{
+		}
+
+		~ReorderBuffer()
+		{
+		}
+
+		uint64_t reserve(size_t byteCount)
+		{
+			std::unique_lock< std::mutex > lock(this->m_mutex);
+			if (this->m_reserved_bytes > 0 && this->m_reserved_bytes + byteCount > this->m_max_reserved_bytes)
+			{
+				auto waitStart = std::chrono::steady_clock::now();
+				this->m_consumed_condition.wait(lock, [this, byteCount] {
+						return this->m_reserved_bytes == 0 || this->m_reserved_bytes + byteCount <= this->m_max_reserved_bytes;
+					});
+				this->m_reserve_wait_time += std::chrono::steady_clock::now() - waitStart;
+			}
+			this->m_reserved_bytes += byteCount;
+			this->m_reserved_byte_counts.emplace(this->m_next_reserved_sequence, byteCount);
+			return this->m_next_reserved_sequence++;
+		}
+
+		// blocks while isThrottled returns true and something is still in flight, which is checked on every
+		// consumed item and every few milliseconds, for conditions that also change outside this buffer
+		void waitWhile(std::function< bool () > isThrottled)
+		{
+			std::unique_lock< std::mutex > lock(this->m_mutex);
+			if (this->m_next_consumed_sequence == this->m_next_reserved_sequence || !isThrottled())
+			{
+				return;
+			}
+			auto waitStart = std::chrono::steady_clock::now();
+			while (this->m_next_consumed_sequence < this->m_next_reserved_sequence && isThrottled())
+			{
+				this->m_consumed_condition.wait_for(lock, std::chrono::milliseconds(10));
+			}
+			this->m_throttle_wait_time += std::chrono::steady_clock::now() - waitStart;
+		}
+
+		void complete(uint64_t sequence, T item)
+		{
+			std::unique_lock< std::mutex > lock(this->m_mutex);
+			this->m_buffered_items.emplace(sequence, std::move(item));
+			if (this->m_buffered_items.size() > this->m_max_buffered_count)
+			{
+				this->m_max_buffered_count = this->m_buffered_items.size();
+			}
+			if (this->m_stalled && sequence == this->m_next_consumed_sequence)
+			{
+				this->m_head_of_line_stall_time += std::chrono::steady_clock::now() - this->m_stall_start;
+				this->m_stalled = false;
+			}
+			if (this->m_draining)
+			{
+				return; // the thread that is draining will pick this item up
+			}
+			this->m_draining = true;
+			auto iter = this->m_buffered_items.begin();
+			while (iter != this->m_buffered_items.end() && iter->first == this->m_next_consumed_sequence)
+			{
+				T headItem = std::move(iter->second);
+				this->m_buffered_items.erase(iter);
+				lock.unlock();
+				this->m_consumer(headItem);
+				lock.lock();
+				auto byteCountIter = this->m_reserved_byte_counts.find(this->m_next_consumed_sequence);
+				this->m_reserved_bytes -= byteCountIter->second;
+				this->m_reserved_byte_counts.erase(byteCountIter);
+				++this->m_next_consumed_sequence;
+				this->m_consumed_condition.notify_all();
+				iter = this->m_buffered_items.begin();
+			}
+			if (!this->m_buffered_items.empty() && !this->m_stalled) // completed items are now waiting on the head of the line
+			{
+				this->m_stalled = true;
+				this->m_stall_start = std::chrono::steady_clock::now();
+			}
+			this->m_draining = false;
+		}
+
+		// blocks until every reserved item has been completed and consumed
+		void waitForAll()
+		{
+			std::unique_lock< std::mutex > lock(this->m_mutex);
+			this->m_consumed_condition.wait(lock, [this] { return this->m_next_consumed_sequence == this->m_next_reserved_sequence; });
+		}
+
+		size_t getMaxBufferedCount()
+		{
+			std::lock_guard< std::mutex > lock(this->m_mutex);
+			return this->m_max_buffered_count;
+		}
+
+		// seconds completed items spent waiting on an unfinished head of the line
+		double getHeadOfLineStallSeconds()
+		{
+			std::lock_guard< std::mutex > lock(this->m_mutex);
+			return std::chrono::duration< double >(this->m_head_of_line_stall_time).count();
+		}
+
+		// seconds reserve spent blocked on the memory cap
+		double getReserveWaitSeconds()
+		{
+			std::lock_guard< std::mutex > lock(this->m_mutex);
+			return std::chrono::duration< double >(this->m_reserve_wait_time).count();
+		}
+
+		// seconds waitWhile spent blocked
+		double getThrottleWaitSeconds()
+		{
+			std::lock_guard< std::mutex > lock(this->m_mutex);
+			return std::chrono::duration< double >(this->m_throttle_wait_time).count();
+		}
+
+		uint64_t getConsumedCount()
+		{
+			std::lock_guard< std::mutex > lock(this->m_mutex);
+			return this->m_next_consumed_sequence;
+		}
+
+	private:
+		size_t m_max_reserved_bytes;
+		Consumer m_consumer;
+		uint64_t m_next_reserved_sequence;
+		uint64_t m_next_consumed_sequence;
+		size_t m_reserved_bytes;
+		bool m_draining;
+		std::map< uint64_t, T > m_buffered_items; // completed items waiting on the head of the line
+		std::map< uint64_t, size_t > m_reserved_byte_counts;
+
+		size_t m_max_buffered_count;
+		bool m_stalled;
+		std::chrono::steady_clock::time_point m_stall_start;
+		std::chrono::steady_clock::duration m_head_of_line_stall_time;
+		std::chrono::steady_clock::duration m_reserve_wait_time;
+		std::chrono::steady_clock::duration m_throttle_wait_time;
+
+		std::mutex m_mutex;
+		std::condition_variable m_consumed_condition;
+	};
+}
+
+#endif //GRAPHITE_REORDERBUFFER_HPP
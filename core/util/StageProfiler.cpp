@@ -0,0 +1,93 @@
+#include "StageProfiler.h"
+#include "MemoryAccounting.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include <sys/resource.h>
+
+namespace graphite
+{
+	bool StageProfiler::s_enabled = false;
+	std::chrono::steady_clock::time_point StageProfiler::s_start_time;
+	std::array< StageProfiler::StageCounters, static_cast< size_t >(StageProfiler::STAGE::END) > StageProfiler::s_stage_counters;
+
+	void StageProfiler::enable()
+	{
+		s_start_time = std::chrono::steady_clock::now();
+		s_enabled = true;
+	}
+
+	std::string StageProfiler::getStageName(STAGE stage)
+	{
+		switch (stage)
+		{
+		case STAGE::VCF_PARSE: return "vcf_parse";
+		case STAGE::GRAPH_CONSTRUCTION: return "graph_construction";
+		case STAGE::READ_FETCH: return "read_fetch";
+		case STAGE::ALIGNMENT: return "alignment";
+		case STAGE::AMBIGUITY_REALIGNMENT: return "ambiguity_realignment";
+		case STAGE::COUNTING: return "counting";
+		case STAGE::OUTPUT: return "output";
+		default: return "";
+		}
+	}
+
+	// the run's wall and CPU time next to every stage's counters, a stage's CPU time is estimated from its sampled calls
+	bool StageProfiler::writeReport(const std::string& path, uint32_t threadCount)
+	{
+		rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		double runCPUSeconds = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+		double runWallSeconds = std::chrono::duration_cast< std::chrono::duration< double > >(std::chrono::steady_clock::now() - s_start_time).count();
+
+		std::ofstream outFile(path);
+		if (!outFile.is_open())
+		{
+			std::cout << "Unable to write the run report: " << path << std::endl;
+			return false;
+		}
+		outFile << std::fixed << std::setprecision(6);
+		outFile << "{\n";
+		outFile << "  \"threads\": " << threadCount << ",\n";
+		outFile << "  \"wall_seconds\": " << runWallSeconds << ",\n";
+		outFile << "  \"cpu_seconds\": " << runCPUSeconds << ",\n";
+		outFile << "  \"max_resident_kilobytes\": " << usage.ru_maxrss << ",\n";
+		if (MemoryAccounting::isEnabled())
+		{
+			outFile << "  \"memory\": {\"soft_limit_bytes\": " << MemoryAccounting::getSoftLimit() << ", \"subsystems\": [\n";
+			for (size_t i = 0; i < static_cast< size_t >(MemoryAccounting::SUBSYSTEM::END); ++i)
+			{
+				auto subsystem = static_cast< MemoryAccounting::SUBSYSTEM >(i);
+				outFile << "    {\"name\": \"" << MemoryAccounting::getSubsystemName(subsystem) << "\"";
+				outFile << ", \"live_bytes\": " << MemoryAccounting::getLiveByteCount(subsystem);
+				outFile << ", \"peak_bytes\": " << MemoryAccounting::getPeakByteCount(subsystem);
+				outFile << "}" << ((i + 1 < static_cast< size_t >(MemoryAccounting::SUBSYSTEM::END)) ? "," : "") << "\n";
+			}
+			outFile << "  ]},\n";
+		}
+		outFile << "  \"stages\": [\n";
+		for (size_t i = 0; i < s_stage_counters.size(); ++i)
+		{
+			auto& stageCounters = s_stage_counters[i];
+			outFile << "    {\"name\": \"" << getStageName(static_cast< STAGE >(i)) << "\"";
+			outFile << ", \"calls\": " << stageCounters.m_call_count.load();
+			outFile << ", \"items\": " << stageCounters.m_item_count.load();
+			outFile << ", \"wall_seconds\": " << stageCounters.m_wall_nanoseconds.load() / 1e9;
+			uint64_t sampledWallNanoseconds = stageCounters.m_sampled_wall_nanoseconds.load();
+			double cpuShare = (sampledWallNanoseconds > 0) ? static_cast< double >(stageCounters.m_sampled_cpu_nanoseconds.load()) / sampledWallNanoseconds : 0.0;
+			outFile << ", \"cpu_seconds\": " << stageCounters.m_wall_nanoseconds.load() * cpuShare / 1e9;
+			outFile << "}" << ((i + 1 < s_stage_counters.size()) ? "," : "") << "\n";
+		}
+		outFile << "  ]\n";
+		outFile << "}\n";
+		outFile.close();
+		if (!outFile)
+		{
+			std::cout << "Unable to write the run report: " << path << std::endl;
+			return false;
+		}
+		return true;
+	}
+}
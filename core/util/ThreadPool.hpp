@@ -10,6 +10,8 @@
 #include <future>
 #include <functional>
 #include <stdexcept>
+#include <atomic>
+#include <chrono>
 
 namespace graphite
 {
@@ -24,6 +26,15 @@ namespace graphite
 		~ThreadPool();
 
 		void join();
+
+		// for progress reports, the counts can change as soon as they are read
+		size_t getThreadCount() { return workers.size(); }
+		size_t getRunningCount() { return m_running_processes; }
+		size_t getQueuedCount()
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex);
+			return tasks.size();
+		}
 	private:
 		// need to keep track of threads so we can join them
 		std::vector< std::thread > workers;
@@ -57,8 +68,8 @@ namespace graphite
 								return;
 							task = std::move(this->tasks.front());
 							this->tasks.pop();
+							m_running_processes += 1; // counted under the lock so join never sees an idle pool mid hand-off
 						}
-						m_running_processes += 1;
 						task();
 						m_running_processes -= 1;
 					}
@@ -83,8 +94,15 @@ namespace graphite
 
 	inline void ThreadPool::join()
 	{
-		while (m_running_processes > 0)
+		while (true)
 		{
+			{
+				std::unique_lock<std::mutex> lock(queue_mutex);
+				if (this->tasks.empty() && m_running_processes == 0)
+				{
+					break;
+				}
+			}
 			std::this_thread::sleep_for(std::chrono::milliseconds(10));
 		}
 		/*
@@ -9,6 +9,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <sys/resource.h>
 
 namespace graphite
 {
@@ -70,4 +71,50 @@ namespace graphite
 		return (iter != path.size() - ending.size());
 	}
 
+	// raises the soft limit on open files towards requiredFileCount (as far as the hard limit allows) and returns the limit
+	uint64_t raiseOpenFileLimit(uint64_t requiredFileCount)
+	{
+		struct rlimit fileLimit;
+		if (getrlimit(RLIMIT_NOFILE, &fileLimit) != 0)
+		{
+			return requiredFileCount;
+		}
+		if (fileLimit.rlim_cur != RLIM_INFINITY && fileLimit.rlim_cur < requiredFileCount && fileLimit.rlim_cur < fileLimit.rlim_max)
+		{
+			fileLimit.rlim_cur = (fileLimit.rlim_max == RLIM_INFINITY || requiredFileCount < fileLimit.rlim_max) ? requiredFileCount : fileLimit.rlim_max;
+			setrlimit(RLIMIT_NOFILE, &fileLimit);
+			getrlimit(RLIMIT_NOFILE, &fileLimit);
+		}
+		return (fileLimit.rlim_cur == RLIM_INFINITY) ? requiredFileCount : fileLimit.rlim_cur;
+	}
+
+	// 64 bit FNV-1a, pass the previous hash as the seed to continue it over more bytes
+	uint64_t hashBytes(const char* data, size_t byteCount, uint64_t seed)
+	{
+		uint64_t hash = seed;
+		for (size_t i = 0; i < byteCount; ++i)
+		{
+			hash ^= static_cast< unsigned char >(data[i]);
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	// the hash of a file's bytes, 0 when it can't be read
+	uint64_t hashFile(const std::string& path, uint64_t seed)
+	{
+		std::ifstream inFile(path, std::ios::binary);
+		if (!inFile.is_open())
+		{
+			return 0;
+		}
+		uint64_t hash = seed;
+		std::vector< char > buffer(1 << 20);
+		while (inFile)
+		{
+			inFile.read(buffer.data(), buffer.size());
+			hash = hashBytes(buffer.data(), inFile.gcount(), hash);
+		}
+		return hash;
+	}
 }
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <stdint.h>
 
 namespace graphite
 {
@@ -10,6 +11,25 @@ namespace graphite
 	bool fileExists(const std::string& name, bool exitOnFailure);
 	bool folderExists(const std::string& path, bool exitOnFailure);
 	bool endsWith(const std::string& path, const std::string& ending);
+	uint64_t raiseOpenFileLimit(uint64_t requiredFileCount);
+	uint64_t hashBytes(const char* data, size_t byteCount, uint64_t seed = 14695981039346656037ULL);
+	uint64_t hashFile(const std::string& path, uint64_t seed);
+
+	// appends the decimal representation of value to buffer without a temporary string
+	inline void appendUnsignedInteger(std::string& buffer, uint64_t value)
+	{
+		char digits[20];
+		int digitCount = 0;
+		do
+		{
+			digits[digitCount++] = '0' + (value % 10);
+			value /= 10;
+		} while (value > 0);
+		while (digitCount > 0)
+		{
+			buffer.push_back(digits[--digitCount]);
+		}
+	}
 }
 
 #endif //GRAPHITE_CORE_UTIL_UTILITY_H
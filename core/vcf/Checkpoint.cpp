@@ -0,0 +1,121 @@
+#include "Checkpoint.h"
+#include "core/util/Utility.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+namespace graphite
+{
+	static const std::string CHECKPOINT_HEADER = "##graphite_checkpoint=2";
+
+	Checkpoint::Checkpoint(const std::string& path, const std::vector< std::string >& vcfPaths, uint32_t intervalSeconds) :
+		m_path(path),
+		m_vcf_paths(vcfPaths),
+		m_interval(std::chrono::seconds(intervalSeconds)),
+		m_last_write_time(std::chrono::steady_clock::now()),
+		m_resume_points(vcfPaths.size())
+	{
+	}
+
+	Checkpoint::~Checkpoint()
+	{
+	}
+
+	// reads the checkpoint of an earlier run, without one the run starts from the beginning
+	// false when the checkpoint is from a run with other inputs or its outputs are gone
+	bool Checkpoint::load()
+	{
+		std::ifstream inFile(this->m_path);
+		if (!inFile.is_open())
+		{
+			std::cout << "No checkpoint at " << this->m_path << ", the run starts from the beginning" << std::endl;
+			return true;
+		}
+		std::string line;
+		std::vector< std::string > columns;
+		bool isValid = std::getline(inFile, line) && line == CHECKPOINT_HEADER;
+		for (size_t i = 0; isValid && i < this->m_vcf_paths.size(); ++i)
+		{
+			isValid = (bool)std::getline(inFile, line);
+			columns.clear(); // split appends
+			split(line, '\t', columns);
+			if (!isValid || columns.size() != 6 || columns[0] != this->m_vcf_paths[i])
+			{
+				isValid = false;
+				break;
+			}
+			auto& resumePoint = this->m_resume_points[i];
+			resumePoint.m_record_count = strtoull(columns[2].c_str(), nullptr, 10);
+			resumePoint.m_record_offset = strtoull(columns[3].c_str(), nullptr, 10);
+			resumePoint.m_byte_count = strtoull(columns[4].c_str(), nullptr, 10);
+			resumePoint.m_supporting_read_byte_count = strtoull(columns[5].c_str(), nullptr, 10);
+			std::ifstream outputFile(columns[1], std::ios::binary | std::ios::ate);
+			if (!outputFile.is_open() || static_cast< uint64_t >(outputFile.tellg()) < resumePoint.m_byte_count)
+			{
+				std::cout << "The output " << columns[1] << " is shorter than its checkpoint, it can't be resumed" << std::endl;
+				return false;
+			}
+		}
+		if (!isValid || std::getline(inFile, line))
+		{
+			std::cout << "The checkpoint " << this->m_path << " is from a run with other VCFs, it can't be resumed" << std::endl;
+			return false;
+		}
+		for (size_t i = 0; i < this->m_vcf_paths.size(); ++i)
+		{
+			std::cout << "Resuming " << this->m_vcf_paths[i] << " after " << this->m_resume_points[i].m_record_count << " written records" << std::endl;
+		}
+		return true;
+	}
+
+	// called after every written cluster, writes a checkpoint once the interval has passed
+	void Checkpoint::update()
+	{
+		if (std::chrono::steady_clock::now() - this->m_last_write_time >= this->m_interval)
+		{
+			write();
+		}
+	}
+
+	// the outputs are flushed first, the file is replaced in one rename so it always describes flushed output
+	bool Checkpoint::write()
+	{
+		this->m_last_write_time = std::chrono::steady_clock::now();
+		std::string tmpPath = this->m_path + ".tmp";
+		std::ofstream outFile(tmpPath, std::ios::trunc);
+		if (!outFile.is_open())
+		{
+			std::cout << "Unable to write checkpoint: " << tmpPath << std::endl;
+			return false;
+		}
+		outFile << CHECKPOINT_HEADER << "\n";
+		for (size_t i = 0; i < this->m_vcf_writer_ptrs.size(); ++i)
+		{
+			auto resumePoint = this->m_vcf_writer_ptrs[i]->getResumePoint();
+			if (this->m_vcf_writer_ptrs[i]->hasFailed())
+			{
+				std::cout << "The output " << this->m_vcf_writer_ptrs[i]->getOutputPath() << " failed to write, no checkpoint is written" << std::endl;
+				outFile.close();
+				std::remove(tmpPath.c_str());
+				return false;
+			}
+			outFile << this->m_vcf_paths[i] << "\t" << this->m_vcf_writer_ptrs[i]->getOutputPath() << "\t" << resumePoint.m_record_count << "\t" << resumePoint.m_record_offset << "\t" << resumePoint.m_byte_count << "\t" << resumePoint.m_supporting_read_byte_count << "\n";
+		}
+		outFile.close();
+		if (!outFile || std::rename(tmpPath.c_str(), this->m_path.c_str()) != 0)
+		{
+			std::cout << "Unable to write checkpoint: " << this->m_path << std::endl;
+			std::remove(tmpPath.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	// a finished run has nothing to resume
+	void Checkpoint::remove()
+	{
+		std::remove(this->m_path.c_str());
+	}
+}
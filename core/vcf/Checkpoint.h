@@ -0,0 +1,49 @@
+#ifndef GRAPHITE_CHECKPOINT_H
+#define GRAPHITE_CHECKPOINT_H
+
+#include "core/util/Noncopyable.hpp"
+#include "VCFWriter.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+
+namespace graphite
+{
+	/*
+	 * Records how far a run's output VCFs (and supporting read files) have
+	 * been written so a run that died can be resumed with --resume. A
+	 * checkpoint is taken between two written clusters once the interval has
+	 * passed: the outputs are flushed and, per input VCF, the number of
+	 * records written, the input offset after the last of them and the
+	 * flushed byte counts are written to a small text file next to the
+	 * outputs. A resumed run cuts the outputs back to those byte counts and
+	 * seeks the VCFs to those offsets, the reads are fetched by region so the
+	 * BAMs need no seeking.
+	 */
+	class Checkpoint : private Noncopyable
+	{
+	public:
+		typedef std::shared_ptr< Checkpoint > SharedPtr;
+		Checkpoint(const std::string& path, const std::vector< std::string >& vcfPaths, uint32_t intervalSeconds);
+		~Checkpoint();
+
+		bool load();
+		VCFWriter::ResumePoint getResumePoint(size_t vcfIndex) { return this->m_resume_points[vcfIndex]; }
+		void setVCFWriters(const std::vector< VCFWriter::SharedPtr >& vcfWriterPtrs) { this->m_vcf_writer_ptrs = vcfWriterPtrs; }
+		void update();
+		bool write();
+		void remove();
+
+	private:
+		std::string m_path;
+		std::vector< std::string > m_vcf_paths;
+		std::chrono::steady_clock::duration m_interval;
+		std::chrono::steady_clock::time_point m_last_write_time;
+		std::vector< VCFWriter::ResumePoint > m_resume_points; // indexed like m_vcf_paths
+		std::vector< VCFWriter::SharedPtr > m_vcf_writer_ptrs; // indexed like m_vcf_paths
+	};
+}
+
+#endif //GRAPHITE_CHECKPOINT_H
@@ -0,0 +1,149 @@
+#include "Genotyper.h"
+#include "core/util/Utility.h"
+
+#include <cmath>
+
+namespace graphite
+{
+	constexpr double Genotyper::DEFAULT_ERROR_RATE;
+	static const size_t MAX_PRECOMPUTED_ALLELE_COUNT = 8; // tables for sites with more alleles are built when they are needed
+	static const double BIALLELIC_ALT_PROBABILITIES[3] = { 0.01, 0.5, 0.9 }; // P(alt read) under 0/0, 0/1 and 1/1, the p_alt of scripts/bayesgt.py
+
+	Genotyper::Genotyper(double errorRate) :
+		m_error_rate(errorRate)
+	{
+		this->m_log_probabilities.resize(MAX_PRECOMPUTED_ALLELE_COUNT + 1);
+		for (size_t alleleCount = 1; alleleCount <= MAX_PRECOMPUTED_ALLELE_COUNT; ++alleleCount)
+		{
+			computeLogProbabilities(alleleCount, this->m_log_probabilities[alleleCount]);
+		}
+	}
+
+	Genotyper::~Genotyper()
+	{
+	}
+
+	const std::string& Genotyper::getFormatKeys()
+	{
+		static const std::string formatKeys = "GT_NFP:GQ_NFP:PL_NFP";
+		return formatKeys;
+	}
+
+	const std::vector< std::string >& Genotyper::getFormatHeaderLines()
+	{
+		static const std::vector< std::string > formatHeaderLines = {
+			"##FORMAT=<ID=GT_NFP,Number=1,Type=String,Description=\"Genotype called from the reads at 95 percent Smith Waterman score or above\">",
+			"##FORMAT=<ID=GQ_NFP,Number=1,Type=Integer,Description=\"Phred scaled quality of GT_NFP\">",
+			"##FORMAT=<ID=PL_NFP,Number=G,Type=Integer,Description=\"Phred scaled likelihoods of every genotype, from the same reads as GT_NFP\">"
+		};
+		return formatHeaderLines;
+	}
+
+	// log10 P(read supports allele k | genotype g), row g, column k with genotypes in VCF order
+	void Genotyper::computeLogProbabilities(size_t alleleCount, std::vector< double >& logProbabilities)
+	{
+		size_t genotypeCount = alleleCount * (alleleCount + 1) / 2;
+		if (alleleCount == 2)
+		{
+			logProbabilities.resize(genotypeCount * alleleCount);
+			for (size_t g = 0; g < genotypeCount; ++g)
+			{
+				logProbabilities[g * alleleCount] = std::log10(1.0 - BIALLELIC_ALT_PROBABILITIES[g]);
+				logProbabilities[g * alleleCount + 1] = std::log10(BIALLELIC_ALT_PROBABILITIES[g]);
+			}
+			return;
+		}
+		double matchProbability = (alleleCount > 1) ? 1.0 - this->m_error_rate : 1.0;
+		double errorProbability = (alleleCount > 1) ? this->m_error_rate / (alleleCount - 1) : 0.0;
+		logProbabilities.resize(genotypeCount * alleleCount);
+		size_t genotypeIndex = 0;
+		for (size_t b = 0; b < alleleCount; ++b)
+		{
+			for (size_t a = 0; a <= b; ++a)
+			{
+				for (size_t k = 0; k < alleleCount; ++k)
+				{
+					double probability = 0.5 * (((k == a) ? matchProbability : errorProbability) + ((k == b) ? matchProbability : errorProbability));
+					logProbabilities[genotypeIndex * alleleCount + k] = std::log10(probability);
+				}
+				++genotypeIndex;
+			}
+		}
+	}
+
+	void Genotyper::appendGenotype(std::string& buffer, const uint32_t* alleleCounts, size_t alleleCount)
+	{
+		uint64_t totalCount = 0;
+		for (size_t k = 0; k < alleleCount; ++k)
+		{
+			totalCount += alleleCounts[k];
+		}
+		if (totalCount == 0)
+		{
+			buffer += "./.:.:.";
+			return;
+		}
+
+		static thread_local std::vector< double > largeLogProbabilities;
+		static thread_local std::vector< double > logLikelihoods;
+		const std::vector< double >* logProbabilitiesPtr = &largeLogProbabilities;
+		if (alleleCount < this->m_log_probabilities.size())
+		{
+			logProbabilitiesPtr = &this->m_log_probabilities[alleleCount];
+		}
+		else
+		{
+			computeLogProbabilities(alleleCount, largeLogProbabilities);
+		}
+		const double* logProbabilities = logProbabilitiesPtr->data();
+		size_t genotypeCount = alleleCount * (alleleCount + 1) / 2;
+		logLikelihoods.resize(genotypeCount);
+		size_t bestGenotypeIndex = 0;
+		for (size_t g = 0; g < genotypeCount; ++g)
+		{
+			const double* genotypeLogProbabilities = logProbabilities + (g * alleleCount);
+			double logLikelihood = 0.0;
+			for (size_t k = 0; k < alleleCount; ++k)
+			{
+				logLikelihood += alleleCounts[k] * genotypeLogProbabilities[k];
+			}
+			logLikelihoods[g] = logLikelihood;
+			if (logLikelihood > logLikelihoods[bestGenotypeIndex])
+			{
+				bestGenotypeIndex = g;
+			}
+		}
+
+		// GT, the genotype index is b(b+1)/2 + a
+		size_t b = 0;
+		while ((b + 1) * (b + 2) / 2 <= bestGenotypeIndex)
+		{
+			++b;
+		}
+		appendUnsignedInteger(buffer, bestGenotypeIndex - (b * (b + 1) / 2));
+		buffer.push_back('/');
+		appendUnsignedInteger(buffer, b);
+
+		// PL is relative to the called genotype and GQ is the next best PL
+		static thread_local std::string phredLikelihoods;
+		phredLikelihoods.clear();
+		uint32_t genotypeQuality = MAX_GENOTYPE_QUALITY;
+		for (size_t g = 0; g < genotypeCount; ++g)
+		{
+			uint32_t phredLikelihood = static_cast< uint32_t >(std::lround(-10.0 * (logLikelihoods[g] - logLikelihoods[bestGenotypeIndex])));
+			if (g > 0)
+			{
+				phredLikelihoods.push_back(',');
+			}
+			appendUnsignedInteger(phredLikelihoods, phredLikelihood);
+			if (g != bestGenotypeIndex && phredLikelihood < genotypeQuality)
+			{
+				genotypeQuality = phredLikelihood;
+			}
+		}
+		buffer.push_back(':');
+		appendUnsignedInteger(buffer, genotypeQuality);
+		buffer.push_back(':');
+		buffer += phredLikelihoods;
+	}
+}
@@ -0,0 +1,51 @@
+#ifndef GRAPHITE_GENOTYPER_H
+#define GRAPHITE_GENOTYPER_H
+
+#include "core/util/Noncopyable.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace graphite
+{
+	/*
+	 * Diploid genotypes from graphite's allele counts, computed while a record
+	 * is formatted. Every read is an independent draw that supports allele k
+	 * with a probability that depends on the genotype. Biallelic sites use the
+	 * binomial model of scripts/bayesgt.py: an alt read has probability 0.01,
+	 * 0.5 and 0.9 under 0/0, 0/1 and 1/1. Sites with more alleles have no
+	 * counterpart there, a genotype a/b gives allele k the probability
+	 * (P(k|a) + P(k|b)) / 2, where P(k|a) is 1 - e when k is a and
+	 * e / (allele count - 1) otherwise. The multinomial coefficient is the
+	 * same for every genotype so it drops out of PL and GQ. That leaves the
+	 * log10 likelihood of a genotype as the sum of count[k] * log10
+	 * P(k|genotype), the log probabilities are precomputed per allele count
+	 * so a sample is one small matrix vector product.
+	 */
+	class Genotyper : private Noncopyable
+	{
+	public:
+		typedef std::shared_ptr< Genotyper > SharedPtr;
+		Genotyper(double errorRate = DEFAULT_ERROR_RATE);
+		~Genotyper();
+
+		// appends GT:GQ:PL for a sample with alleleCounts[k] reads supporting allele k (0 is the reference)
+		void appendGenotype(std::string& buffer, const uint32_t* alleleCounts, size_t alleleCount);
+
+		static const std::string& getFormatKeys();
+		static const std::vector< std::string >& getFormatHeaderLines();
+
+		static constexpr double DEFAULT_ERROR_RATE = 0.01;
+		static const uint32_t MAX_GENOTYPE_QUALITY = 99;
+
+	private:
+		void computeLogProbabilities(size_t alleleCount, std::vector< double >& logProbabilities);
+
+		double m_error_rate;
+		std::vector< std::vector< double > > m_log_probabilities; // per allele count, a genotype (VCF order) by allele matrix
+	};
+}
+
+#endif //GRAPHITE_GENOTYPER_H
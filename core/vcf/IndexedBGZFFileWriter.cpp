@@ -0,0 +1,358 @@
+#include "IndexedBGZFFileWriter.h"
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <future>
+
+#include <zlib.h>
+
+namespace graphite
+{
+	static const int TBI_MIN_SHIFT = 14;
+	static const int TBI_LEVEL_COUNT = 5;
+	static const int TBI_MAX_SHIFT = 29; // a .tbi can't index positions past 2^29
+	static const int CSI_MAX_SHIFT = 31;
+	static const size_t BGZF_BLOCK_SIZE = 0xff00; // uncompressed bytes per block, the same as htslib so a block always compresses to under 64KB
+	static const size_t BGZF_MAX_BLOCK_SIZE = 0x10000;
+	static const size_t BGZF_HEADER_SIZE = 18;
+	static const size_t BGZF_FOOTER_SIZE = 8;
+	static const uint8_t BGZF_HEADER[BGZF_HEADER_SIZE] = { 0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0, 0 }; // the last two bytes are the block size - 1
+	static const uint8_t BGZF_EOF[28] = { 0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0x1b, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+	static void writeLittleEndian(uint8_t* buffer, uint32_t value, size_t byteCount)
+	{
+		for (size_t i = 0; i < byteCount; ++i)
+		{
+			buffer[i] = (value >> (8 * i)) & 0xff;
+		}
+	}
+
+	// one BGZF block: a gzip member with the BC extra field holding its size, empty on failure
+	static std::string compressBlock(const std::string& block)
+	{
+		std::string compressedBlock(BGZF_MAX_BLOCK_SIZE, '\0');
+		uint8_t* buffer = reinterpret_cast< uint8_t* >(&compressedBlock[0]);
+		z_stream stream;
+		memset(&stream, 0, sizeof(stream));
+		if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) // raw deflate, the gzip framing is written here
+		{
+			return "";
+		}
+		stream.next_in = reinterpret_cast< Bytef* >(const_cast< char* >(block.c_str()));
+		stream.avail_in = block.size();
+		stream.next_out = buffer + BGZF_HEADER_SIZE;
+		stream.avail_out = BGZF_MAX_BLOCK_SIZE - BGZF_HEADER_SIZE - BGZF_FOOTER_SIZE;
+		int status = deflate(&stream, Z_FINISH);
+		size_t compressedLength = stream.total_out;
+		deflateEnd(&stream);
+		if (status != Z_STREAM_END)
+		{
+			return "";
+		}
+		size_t blockLength = BGZF_HEADER_SIZE + compressedLength + BGZF_FOOTER_SIZE;
+		memcpy(buffer, BGZF_HEADER, BGZF_HEADER_SIZE);
+		writeLittleEndian(buffer + 16, blockLength - 1, 2);
+		writeLittleEndian(buffer + BGZF_HEADER_SIZE + compressedLength, crc32(crc32(0L, Z_NULL, 0), reinterpret_cast< const Bytef* >(block.c_str()), block.size()), 4);
+		writeLittleEndian(buffer + BGZF_HEADER_SIZE + compressedLength + 4, block.size(), 4);
+		compressedBlock.resize(blockLength);
+		return compressedBlock;
+	}
+
+	IndexedBGZFFileWriter::IndexedBGZFFileWriter(const std::string& path, uint32_t compressionThreadCount) :
+		AsyncFileWriter(path),
+		m_file(nullptr),
+		m_idx(nullptr),
+		m_index_format(HTS_FMT_TBI),
+		m_index_valid(true),
+		m_write_failed(false),
+		m_compression_thread_count(compressionThreadCount),
+		m_thread_pool_ptr(nullptr),
+		m_written_block_count(0),
+		m_file_offset(0),
+		m_index_started(false),
+		m_index_start_block_index(0),
+		m_index_start_block_offset(0),
+		m_max_reference_length(0)
+	{
+	}
+
+	IndexedBGZFFileWriter::~IndexedBGZFFileWriter()
+	{
+		close(); // the base class can't call our closeFile from its destructor
+	}
+
+	std::string IndexedBGZFFileWriter::getIndexPath()
+	{
+		return getPath() + ((this->m_index_format == HTS_FMT_CSI) ? ".csi" : ".tbi");
+	}
+
+	// the blocks and the index aren't checkpointed, so a compressed output is always written from its start
+	bool IndexedBGZFFileWriter::openFile(const std::string& path)
+	{
+		if (getFlushedByteCount() > 0)
+		{
+			std::cout << "A compressed output can't be resumed: " << path << std::endl;
+			return false;
+		}
+		this->m_file = fopen(path.c_str(), "wb");
+		if (this->m_file == nullptr)
+		{
+			return false;
+		}
+		if (this->m_compression_thread_count > 1)
+		{
+			this->m_thread_pool_ptr = std::make_shared< ThreadPool >(this->m_compression_thread_count);
+		}
+		this->m_block.reserve(BGZF_BLOCK_SIZE);
+		return true;
+	}
+
+	bool IndexedBGZFFileWriter::writeBlock(const std::string& block)
+	{
+		const char* line = block.c_str();
+		const char* blockEnd = line + block.size();
+		while (line < blockEnd)
+		{
+			const char* lineEnd = static_cast< const char* >(memchr(line, '\n', blockEnd - line));
+			size_t length = (lineEnd == nullptr) ? (blockEnd - line) : (lineEnd - line + 1);
+			if (line[0] != '#' && !this->m_index_started) // the index starts at the first record, everything before it is header
+			{
+				this->m_index_started = true;
+				this->m_index_start_block_index = this->m_written_block_count + this->m_finished_blocks.size();
+				this->m_index_start_block_offset = this->m_block.size();
+			}
+			append(line, length);
+			if (line[0] != '#')
+			{
+				indexRecord(line, length);
+			}
+			line += length;
+		}
+		writeBlocks();
+		return !this->m_write_failed;
+	}
+
+	bool IndexedBGZFFileWriter::flushFile()
+	{
+		finishBlock();
+		writeBlocks();
+		if (fflush(this->m_file) != 0)
+		{
+			this->m_write_failed = true;
+		}
+		return !this->m_write_failed;
+	}
+
+	bool IndexedBGZFFileWriter::closeFile()
+	{
+		if (this->m_file == nullptr)
+		{
+			return !this->m_write_failed;
+		}
+		finishBlock();
+		writeBlocks();
+		if (!this->m_index_started)
+		{
+			initIndex(this->m_file_offset << 16); // a VCF without records still gets an (empty) index
+		}
+		hts_idx_finish(this->m_idx, this->m_file_offset << 16);
+		if (fwrite(BGZF_EOF, 1, sizeof(BGZF_EOF), this->m_file) != sizeof(BGZF_EOF) || fclose(this->m_file) != 0)
+		{
+			this->m_write_failed = true;
+		}
+		this->m_file = nullptr;
+		this->m_thread_pool_ptr = nullptr;
+		bool isIndexSaved = saveIndex();
+		hts_idx_destroy(this->m_idx);
+		this->m_idx = nullptr;
+		return !this->m_write_failed && isIndexSaved;
+	}
+
+	// fills the open block and starts a new one once it is full, the same cut bgzf_write makes
+	void IndexedBGZFFileWriter::append(const char* data, size_t length)
+	{
+		while (length > 0)
+		{
+			size_t copyLength = std::min(length, BGZF_BLOCK_SIZE - this->m_block.size());
+			this->m_block.append(data, copyLength);
+			data += copyLength;
+			length -= copyLength;
+			if (this->m_block.size() == BGZF_BLOCK_SIZE)
+			{
+				finishBlock();
+			}
+		}
+	}
+
+	void IndexedBGZFFileWriter::finishBlock()
+	{
+		if (this->m_block.empty())
+		{
+			return;
+		}
+		this->m_finished_blocks.emplace_back(std::move(this->m_block));
+		this->m_block = std::string();
+		this->m_block.reserve(BGZF_BLOCK_SIZE);
+	}
+
+	// compresses the finished blocks side by side, writes them in order and pushes the records whose offsets are now known
+	void IndexedBGZFFileWriter::writeBlocks()
+	{
+		std::vector< std::string > compressedBlocks(this->m_finished_blocks.size());
+		if (this->m_thread_pool_ptr != nullptr && this->m_finished_blocks.size() > 1)
+		{
+			std::vector< std::future< void > > compressionFutures;
+			for (size_t i = 0; i < this->m_finished_blocks.size(); ++i)
+			{
+				compressionFutures.emplace_back(this->m_thread_pool_ptr->enqueue([this, &compressedBlocks, i]() { compressedBlocks[i] = compressBlock(this->m_finished_blocks[i]); }));
+			}
+			for (auto& compressionFuture : compressionFutures)
+			{
+				compressionFuture.wait();
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < this->m_finished_blocks.size(); ++i)
+			{
+				compressedBlocks[i] = compressBlock(this->m_finished_blocks[i]);
+			}
+		}
+
+		// the file offsets of the written blocks and of the block after them
+		uint64_t firstBlockIndex = this->m_written_block_count;
+		std::vector< uint64_t > blockFileOffsets;
+		blockFileOffsets.reserve(compressedBlocks.size() + 1);
+		for (auto& compressedBlock : compressedBlocks)
+		{
+			blockFileOffsets.emplace_back(this->m_file_offset);
+			if (compressedBlock.empty() || fwrite(compressedBlock.c_str(), 1, compressedBlock.size(), this->m_file) != compressedBlock.size())
+			{
+				this->m_write_failed = true;
+			}
+			this->m_file_offset += compressedBlock.size();
+		}
+		blockFileOffsets.emplace_back(this->m_file_offset);
+		this->m_written_block_count += compressedBlocks.size();
+		this->m_finished_blocks.clear();
+
+		auto getVirtualOffset = [&blockFileOffsets, firstBlockIndex](uint64_t blockIndex, uint32_t blockOffset)
+			{
+				return (blockFileOffsets[blockIndex - firstBlockIndex] << 16) | blockOffset;
+			};
+		if (this->m_index_started && this->m_idx == nullptr)
+		{
+			initIndex(getVirtualOffset(this->m_index_start_block_index, this->m_index_start_block_offset));
+		}
+		for (auto& pendingRecord : this->m_pending_records)
+		{
+			if (this->m_index_valid && hts_idx_push(this->m_idx, pendingRecord.m_contig_id, pendingRecord.m_begin, pendingRecord.m_end, getVirtualOffset(pendingRecord.m_block_index, pendingRecord.m_block_offset), 1) < 0)
+			{
+				std::cout << "Output VCF is not sorted, no index will be written for: " << getPath() << std::endl;
+				this->m_index_valid = false;
+			}
+		}
+		this->m_pending_records.clear();
+	}
+
+	void IndexedBGZFFileWriter::initIndex(uint64_t startVirtualOffset)
+	{
+		int minShift = TBI_MIN_SHIFT;
+		int levelCount = TBI_LEVEL_COUNT;
+		this->m_index_format = HTS_FMT_TBI;
+		if (this->m_max_reference_length >= (1ULL << TBI_MAX_SHIFT))
+		{
+			this->m_index_format = HTS_FMT_CSI;
+			levelCount = (CSI_MAX_SHIFT - minShift + 2) / 3;
+			while ((1ULL << (minShift + 3 * levelCount)) < this->m_max_reference_length)
+			{
+				++levelCount;
+			}
+		}
+		this->m_idx = hts_idx_init(0, this->m_index_format, startVirtualOffset, minShift, levelCount);
+	}
+
+	// called right after the record is appended, so the open block and its size are where the record ends
+	void IndexedBGZFFileWriter::indexRecord(const char* record, size_t length)
+	{
+		if (!this->m_index_valid)
+		{
+			return;
+		}
+		// pull CHROM, POS, REF and INFO without copying the rest of the record
+		const char* columns[8] = { nullptr };
+		size_t columnLengths[8] = { 0 };
+		const char* columnStart = record;
+		const char* recordEnd = record + length;
+		for (int i = 0; i < 8 && columnStart < recordEnd; ++i)
+		{
+			const char* columnEnd = columnStart;
+			while (columnEnd < recordEnd && *columnEnd != '\t' && *columnEnd != '\n')
+			{
+				++columnEnd;
+			}
+			columns[i] = columnStart;
+			columnLengths[i] = columnEnd - columnStart;
+			columnStart = columnEnd + 1;
+		}
+		if (columns[3] == nullptr)
+		{
+			std::cout << "Unable to index malformed VCF record, no index will be written for: " << getPath() << std::endl;
+			this->m_index_valid = false;
+			return;
+		}
+		std::string contig(columns[0], columnLengths[0]);
+		int64_t begin = strtoll(columns[1], nullptr, 10) - 1;
+		int64_t end = begin + columnLengths[3];
+		if (columns[7] != nullptr) // symbolic alleles carry their extent in INFO/END
+		{
+			std::string info(columns[7], columnLengths[7]);
+			size_t endPosition = (info.compare(0, 4, "END=") == 0) ? 0 : info.find(";END=");
+			if (endPosition != std::string::npos)
+			{
+				endPosition += (endPosition == 0) ? 4 : 5;
+				int64_t infoEnd = strtoll(info.c_str() + endPosition, nullptr, 10);
+				if (infoEnd > begin)
+				{
+					end = infoEnd;
+				}
+			}
+		}
+
+		auto iter = this->m_contig_ids.find(contig);
+		if (iter == this->m_contig_ids.end())
+		{
+			iter = this->m_contig_ids.emplace(contig, (int)this->m_contig_names.size()).first;
+			this->m_contig_names.emplace_back(contig);
+		}
+		this->m_pending_records.push_back({ iter->second, begin, end, this->m_written_block_count + this->m_finished_blocks.size(), static_cast< uint32_t >(this->m_block.size()) });
+	}
+
+	// the tabix meta block: the VCF preset followed by the NUL separated contig names
+	// false when the index can't be written, an output without an index (unsorted records) is not a failure
+	bool IndexedBGZFFileWriter::saveIndex()
+	{
+		if (!this->m_index_valid || this->m_write_failed)
+		{
+			return true;
+		}
+		std::string names;
+		for (auto& contigName : this->m_contig_names)
+		{
+			names.append(contigName);
+			names.push_back('\0');
+		}
+		uint32_t conf[7] = { 2 /* TBX_VCF */, 1, 2, 0, '#', 0, (uint32_t)names.size() };
+		uint8_t* meta = (uint8_t*)malloc(sizeof(conf) + names.size());
+		memcpy(meta, conf, sizeof(conf));
+		memcpy(meta + sizeof(conf), names.c_str(), names.size());
+		hts_idx_set_meta(this->m_idx, sizeof(conf) + names.size(), meta, 0); // the index takes ownership of meta
+		if (hts_idx_save(this->m_idx, getPath().c_str(), this->m_index_format) < 0)
+		{
+			std::cout << "Unable to write index: " << getIndexPath() << std::endl;
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,86 @@
+#ifndef GRAPHITE_INDEXEDBGZFFILEWRITER_H
+#define GRAPHITE_INDEXEDBGZFFILEWRITER_H
+
+#include "core/util/AsyncFileWriter.h"
+#include "core/util/ThreadPool.hpp"
+
+#include "htslib/hts.h"
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <cstdio>
+
+namespace graphite
+{
+	/*
+	 * Writes VCF records as BGZF and builds the tabix index while the records
+	 * are written, so no separate bgzip/tabix pass is needed. When the header
+	 * declares a contig longer than a .tbi can address a .csi index is written
+	 * instead.
+	 *
+	 * The writer cuts the blocks itself and compresses each batch of them on
+	 * its own compression threads. A record's virtual offset is its block's
+	 * file offset and its offset in the block, so a record is only pushed to
+	 * the index once the blocks before it are written and their compressed
+	 * sizes are known. (bgzf_tell can't be used with htslib's BGZF threads,
+	 * it lags behind the blocks that are still being compressed.)
+	 */
+	class IndexedBGZFFileWriter : public AsyncFileWriter
+	{
+	public:
+		typedef std::shared_ptr< IndexedBGZFFileWriter > SharedPtr;
+		IndexedBGZFFileWriter(const std::string& path, uint32_t compressionThreadCount);
+		~IndexedBGZFFileWriter();
+
+		void setMaxReferenceLength(uint64_t maxReferenceLength) { this->m_max_reference_length = maxReferenceLength; }
+		std::string getIndexPath();
+
+	protected:
+		virtual bool openFile(const std::string& path);
+		virtual bool writeBlock(const std::string& block);
+		virtual bool flushFile();
+		virtual bool closeFile();
+
+	private:
+		// where a record ends, as the index of its block in the file and the offset in that block
+		struct PendingRecord
+		{
+			int m_contig_id;
+			int64_t m_begin;
+			int64_t m_end;
+			uint64_t m_block_index;
+			uint32_t m_block_offset;
+		};
+
+		void append(const char* data, size_t length);
+		void finishBlock();
+		void writeBlocks();
+		void initIndex(uint64_t startVirtualOffset);
+		void indexRecord(const char* record, size_t length);
+		bool saveIndex();
+
+		FILE* m_file;
+		hts_idx_t* m_idx;
+		int m_index_format;
+		bool m_index_valid;
+		bool m_write_failed;
+		uint32_t m_compression_thread_count;
+		std::shared_ptr< ThreadPool > m_thread_pool_ptr; // set when more than one compression thread is used
+		std::string m_block; // the block being filled
+		std::vector< std::string > m_finished_blocks; // filled but not yet written
+		uint64_t m_written_block_count;
+		uint64_t m_file_offset; // of the next block
+		std::vector< PendingRecord > m_pending_records;
+		bool m_index_started;
+		uint64_t m_index_start_block_index; // where the first record starts
+		uint32_t m_index_start_block_offset;
+		std::atomic< uint64_t > m_max_reference_length;
+		std::unordered_map< std::string, int > m_contig_ids;
+		std::vector< std::string > m_contig_names;
+	};
+}
+
+#endif //GRAPHITE_INDEXEDBGZFFILEWRITER_H
@@ -0,0 +1,211 @@
+#include "ShardMerger.h"
+#include "IndexedBGZFFileWriter.h"
+#include "VCFWriter.h"
+#include "core/util/Utility.h"
+#include "core/util/gzstream.h"
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+
+namespace graphite
+{
+	ShardMerger::ShardMerger(const std::vector< std::string >& shardPaths, const std::string& outputPath, uint32_t compressionThreadCount) :
+		m_shard_paths(shardPaths),
+		m_output_path(outputPath),
+		m_compression_thread_count(compressionThreadCount)
+	{
+	}
+
+	ShardMerger::~ShardMerger()
+	{
+	}
+
+	std::string ShardMerger::getShardNameSuffix(uint32_t shardIndex, uint32_t shardCount)
+	{
+		return ".shard_" + std::to_string(shardIndex) + "_of_" + std::to_string(shardCount);
+	}
+
+	bool ShardMerger::merge()
+	{
+		if (this->m_shard_paths.size() == 0)
+		{
+			std::cout << "No shards to merge" << std::endl;
+			return false;
+		}
+		return sortShardPaths() && mergeVCFs() && mergeSupportingReadFiles();
+	}
+
+	// puts the paths in shard order when they all carry a shard suffix and makes sure none are missing
+	bool ShardMerger::sortShardPaths()
+	{
+		std::vector< std::pair< uint32_t, std::string > > indexedPaths;
+		uint32_t shardCount = 0;
+		for (auto& shardPath : this->m_shard_paths)
+		{
+			size_t suffixPosition = shardPath.rfind(".shard_");
+			if (suffixPosition == std::string::npos)
+			{
+				return true; // not named by --shard, keep the order we were given
+			}
+			char* countStart = nullptr;
+			uint32_t shardIndex = strtoul(shardPath.c_str() + suffixPosition + 7, &countStart, 10);
+			if (strncmp(countStart, "_of_", 4) != 0)
+			{
+				return true;
+			}
+			uint32_t pathShardCount = strtoul(countStart + 4, nullptr, 10);
+			if (shardCount != 0 && pathShardCount != shardCount)
+			{
+				std::cout << "Shards from runs with a different shard count can't be merged: " << shardPath << std::endl;
+				return false;
+			}
+			shardCount = pathShardCount;
+			indexedPaths.emplace_back(shardIndex, shardPath);
+		}
+		std::sort(indexedPaths.begin(), indexedPaths.end());
+		for (uint32_t i = 0; i < shardCount; ++i)
+		{
+			if (i >= indexedPaths.size() || indexedPaths[i].first != i)
+			{
+				std::cout << "Missing shard " << i << " of " << shardCount << std::endl;
+				return false;
+			}
+		}
+		if (indexedPaths.size() != shardCount)
+		{
+			std::cout << "More than one file was given for a shard" << std::endl;
+			return false;
+		}
+		for (size_t i = 0; i < indexedPaths.size(); ++i)
+		{
+			this->m_shard_paths[i] = indexedPaths[i].second;
+		}
+		return true;
+	}
+
+	std::shared_ptr< std::istream > ShardMerger::openFile(const std::string& path)
+	{
+		if (path.substr(path.find_last_of(".") + 1) == "gz")
+		{
+			auto igzstreamPtr = std::make_shared< igzstream >();
+			igzstreamPtr->open(path.c_str());
+			return igzstreamPtr;
+		}
+		return std::make_shared< std::ifstream >(path, std::fstream::in);
+	}
+
+	bool ShardMerger::mergeVCFs()
+	{
+		bool compressOutput = (this->m_output_path.substr(this->m_output_path.find_last_of(".") + 1) == "gz");
+		IndexedBGZFFileWriter::SharedPtr bgzfFileWriterPtr = nullptr;
+		AsyncFileWriter::SharedPtr fileWriterPtr;
+		if (compressOutput)
+		{
+			bgzfFileWriterPtr = std::make_shared< IndexedBGZFFileWriter >(this->m_output_path, this->m_compression_thread_count);
+			fileWriterPtr = bgzfFileWriterPtr;
+		}
+		else
+		{
+			fileWriterPtr = std::make_shared< AsyncFileWriter >(this->m_output_path);
+		}
+		if (!fileWriterPtr->open())
+		{
+			return false;
+		}
+
+		std::string columnHeader;
+		std::string line;
+		for (size_t i = 0; i < this->m_shard_paths.size(); ++i)
+		{
+			auto& shardPath = this->m_shard_paths[i];
+			fileExists(shardPath, true);
+			auto fileStreamPtr = openFile(shardPath);
+			std::vector< std::string > headerLines;
+			bool hasLine;
+			while ((hasLine = (bool)std::getline(*fileStreamPtr, line)) && (line.size() == 0 || line[0] == '#'))
+			{
+				if (line.size() > 0)
+				{
+					headerLines.emplace_back(line);
+				}
+			}
+			if (headerLines.size() == 0 || headerLines.back().compare(0, 6, "#CHROM") != 0)
+			{
+				std::cout << "Shard is missing its VCF header: " << shardPath << std::endl;
+				return false;
+			}
+			if (i == 0)
+			{
+				if (bgzfFileWriterPtr != nullptr)
+				{
+					bgzfFileWriterPtr->setMaxReferenceLength(VCFWriter::getMaxReferenceLength(headerLines));
+				}
+				for (auto& headerLine : headerLines)
+				{
+					fileWriterPtr->writeLine(headerLine);
+				}
+				columnHeader = headerLines.back();
+			}
+			else if (headerLines.back() != columnHeader)
+			{
+				std::cout << "Shard columns don't match the first shard: " << shardPath << std::endl;
+				return false;
+			}
+			// line holds the first record unless the shard is empty
+			while (hasLine)
+			{
+				if (line.size() > 0)
+				{
+					fileWriterPtr->writeLine(line);
+				}
+				hasLine = (bool)std::getline(*fileStreamPtr, line);
+			}
+		}
+		return fileWriterPtr->close();
+	}
+
+	bool ShardMerger::mergeSupportingReadFiles()
+	{
+		std::vector< std::string > supportingReadPaths;
+		for (auto& shardPath : this->m_shard_paths)
+		{
+			auto supportingReadPath = VCFWriter::getSupportingReadPath(shardPath);
+			if (fileExists(supportingReadPath, false))
+			{
+				supportingReadPaths.emplace_back(supportingReadPath);
+			}
+		}
+		if (supportingReadPaths.size() == 0)
+		{
+			return true;
+		}
+		if (supportingReadPaths.size() != this->m_shard_paths.size())
+		{
+			std::cout << "Only some shards have supporting read files, they were not merged" << std::endl;
+			return false;
+		}
+		AsyncFileWriter fileWriter(VCFWriter::getSupportingReadPath(this->m_output_path));
+		if (!fileWriter.open())
+		{
+			return false;
+		}
+		std::string line;
+		for (size_t i = 0; i < supportingReadPaths.size(); ++i)
+		{
+			std::ifstream inFile(supportingReadPaths[i]);
+			bool isHeader = true;
+			while (std::getline(inFile, line))
+			{
+				if (!isHeader || i == 0) // every shard starts with the same column header
+				{
+					fileWriter.writeLine(line);
+				}
+				isHeader = false;
+			}
+		}
+		return fileWriter.close();
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef GRAPHITE_SHARDMERGER_H
+#define GRAPHITE_SHARDMERGER_H
+
+#include "core/util/Noncopyable.hpp"
+#include "core/util/AsyncFileWriter.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <istream>
+
+namespace graphite
+{
+	/*
+	 * Concatenates the output of `graphite --shard i/N` runs into one VCF in a
+	 * single streaming pass. The header comes from the first shard, the other
+	 * shards must carry the same #CHROM line and only their records are
+	 * copied. When every shard has a supporting read file those are merged
+	 * the same way. Shard outputs are put in shard order by the .shard_i_of_N
+	 * part of their names, so a shell glob can be passed in as is.
+	 */
+	class ShardMerger : private Noncopyable
+	{
+	public:
+		typedef std::shared_ptr< ShardMerger > SharedPtr;
+		ShardMerger(const std::vector< std::string >& shardPaths, const std::string& outputPath, uint32_t compressionThreadCount);
+		~ShardMerger();
+
+		bool merge();
+
+		static std::string getShardNameSuffix(uint32_t shardIndex, uint32_t shardCount);
+
+	private:
+		bool sortShardPaths();
+		bool mergeVCFs();
+		bool mergeSupportingReadFiles();
+		std::shared_ptr< std::istream > openFile(const std::string& path);
+
+		std::vector< std::string > m_shard_paths;
+		std::string m_output_path;
+		uint32_t m_compression_thread_count;
+	};
+}
+
+#endif //GRAPHITE_SHARDMERGER_H
@@ -0,0 +1,415 @@
+#include "VCFCombiner.h"
+#include "IndexedBGZFFileWriter.h"
+#include "VCFWriter.h"
+#include "core/util/Utility.h"
+#include "core/util/gzstream.h"
+
+#include <queue>
+#include <algorithm>
+#include <tuple>
+#include <functional>
+#include <unordered_set>
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+
+namespace graphite
+{
+	static const char* FIXED_COLUMN_HEADER = "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO";
+	static const size_t FORMAT_COLUMN = 8;
+
+	// like split but always fills fields, even when there is no delimiter
+	static void splitFields(const std::string& value, char delimiter, std::vector< std::string >& fields)
+	{
+		fields.clear();
+		size_t fieldStart = 0;
+		size_t fieldEnd;
+		while ((fieldEnd = value.find(delimiter, fieldStart)) != std::string::npos)
+		{
+			fields.emplace_back(value, fieldStart, fieldEnd - fieldStart);
+			fieldStart = fieldEnd + 1;
+		}
+		fields.emplace_back(value, fieldStart, std::string::npos);
+	}
+
+	// the number of sample fields that are not missing (".")
+	static int32_t countFilledFields(const std::string& sampleValue)
+	{
+		int32_t filledCount = 0;
+		size_t fieldStart = 0;
+		while (fieldStart <= sampleValue.size())
+		{
+			size_t fieldEnd = sampleValue.find(':', fieldStart);
+			if (fieldEnd == std::string::npos)
+			{
+				fieldEnd = sampleValue.size();
+			}
+			size_t fieldLength = fieldEnd - fieldStart;
+			if (fieldLength > 0 && !(fieldLength == 1 && sampleValue[fieldStart] == '.'))
+			{
+				++filledCount;
+			}
+			fieldStart = fieldEnd + 1;
+		}
+		return filledCount;
+	}
+
+	VCFCombiner::VCFCombiner(const std::vector< std::string >& vcfPaths, const std::string& outputPath, uint32_t compressionThreadCount) :
+		m_vcf_paths(vcfPaths),
+		m_output_path(outputPath),
+		m_compression_thread_count(compressionThreadCount)
+	{
+	}
+
+	VCFCombiner::~VCFCombiner()
+	{
+	}
+
+	bool VCFCombiner::combine()
+	{
+		if (this->m_vcf_paths.size() == 0)
+		{
+			std::cout << "No VCFs to combine" << std::endl;
+			return false;
+		}
+		if (!openInputs())
+		{
+			return false;
+		}
+
+		bool compressOutput = (this->m_output_path.substr(this->m_output_path.find_last_of(".") + 1) == "gz");
+		if (compressOutput)
+		{
+			auto bgzfFileWriterPtr = std::make_shared< IndexedBGZFFileWriter >(this->m_output_path, this->m_compression_thread_count);
+			bgzfFileWriterPtr->setMaxReferenceLength(VCFWriter::getMaxReferenceLength(this->m_header_lines));
+			this->m_file_writer_ptr = bgzfFileWriterPtr;
+		}
+		else
+		{
+			this->m_file_writer_ptr = std::make_shared< AsyncFileWriter >(this->m_output_path);
+		}
+		if (!this->m_file_writer_ptr->open())
+		{
+			std::cout << "Unable to open output file: " << this->m_output_path << std::endl;
+			return false;
+		}
+		for (auto& headerLine : this->m_header_lines)
+		{
+			this->m_file_writer_ptr->writeLine(headerLine);
+		}
+		std::string line = FIXED_COLUMN_HEADER;
+		if (this->m_sample_names.size() > 0)
+		{
+			line += "\tFORMAT";
+		}
+		for (auto& sampleName : this->m_sample_names)
+		{
+			line.push_back('\t');
+			line += sampleName;
+		}
+		this->m_file_writer_ptr->writeLine(line);
+
+		// the inputs are ordered by their next record, ties go to the earlier input
+		typedef std::tuple< uint32_t, uint32_t, size_t > HeapEntry;
+		std::priority_queue< HeapEntry, std::vector< HeapEntry >, std::greater< HeapEntry > > inputHeap;
+		for (size_t i = 0; i < this->m_inputs.size(); ++i)
+		{
+			if (this->m_inputs[i].m_line.size() > 0)
+			{
+				inputHeap.emplace(this->m_inputs[i].m_contig_rank, this->m_inputs[i].m_position, i);
+			}
+		}
+		std::vector< size_t > positionInputIndices;
+		std::vector< RecordGroup > recordGroups;
+		std::vector< std::string > columns;
+		while (!inputHeap.empty())
+		{
+			uint32_t contigRank = std::get< 0 >(inputHeap.top());
+			uint32_t position = std::get< 1 >(inputHeap.top());
+			positionInputIndices.clear();
+			while (!inputHeap.empty() && std::get< 0 >(inputHeap.top()) == contigRank && std::get< 1 >(inputHeap.top()) == position)
+			{
+				positionInputIndices.emplace_back(std::get< 2 >(inputHeap.top()));
+				inputHeap.pop();
+			}
+
+			// group every record at this position by its alleles
+			recordGroups.clear();
+			for (auto inputIndex : positionInputIndices)
+			{
+				auto& input = this->m_inputs[inputIndex];
+				do
+				{
+					columns.clear();
+					split(input.m_line, '\t', columns);
+					if (columns.size() < FORMAT_COLUMN)
+					{
+						std::cout << "Malformed VCF record in " << input.m_path << ": " << input.m_line << std::endl;
+						return false;
+					}
+					if (columns.size() == FORMAT_COLUMN)
+					{
+						columns.emplace_back(""); // sites only
+					}
+					std::string alleleKey = columns[3] + "\t" + columns[4];
+					// an input with the same alleles twice at a position keeps them as separate records
+					auto groupIter = recordGroups.begin();
+					while (groupIter != recordGroups.end() && (groupIter->m_allele_key != alleleKey || groupIter->m_records.back().first == inputIndex))
+					{
+						++groupIter;
+					}
+					if (groupIter == recordGroups.end())
+					{
+						recordGroups.emplace_back();
+						groupIter = recordGroups.end() - 1;
+						groupIter->m_allele_key = alleleKey;
+					}
+					groupIter->m_records.emplace_back(inputIndex, std::move(columns));
+					if (!readNextRecord(inputIndex))
+					{
+						return false;
+					}
+				} while (input.m_line.size() > 0 && input.m_contig_rank == contigRank && input.m_position == position);
+				if (input.m_line.size() > 0)
+				{
+					inputHeap.emplace(input.m_contig_rank, input.m_position, inputIndex);
+				}
+			}
+			for (auto& recordGroup : recordGroups)
+			{
+				writeRecordGroup(recordGroup, line);
+			}
+		}
+		return this->m_file_writer_ptr->close();
+	}
+
+	// reads every header, builds the output header and leaves each input on its first record
+	bool VCFCombiner::openInputs()
+	{
+		raiseOpenFileLimit(this->m_vcf_paths.size() + 64); // every input stays open for the whole merge
+		std::unordered_set< std::string > seenHeaderLines;
+		std::unordered_map< std::string, uint32_t > sampleIndices;
+		std::vector< std::string > columns;
+		this->m_inputs.resize(this->m_vcf_paths.size());
+		for (size_t i = 0; i < this->m_vcf_paths.size(); ++i)
+		{
+			auto& input = this->m_inputs[i];
+			input.m_path = this->m_vcf_paths[i];
+			fileExists(input.m_path, true);
+			if (input.m_path.substr(input.m_path.find_last_of(".") + 1) == "gz")
+			{
+				auto igzstreamPtr = std::make_shared< igzstream >();
+				igzstreamPtr->open(input.m_path.c_str());
+				input.m_stream_ptr = igzstreamPtr;
+			}
+			else
+			{
+				input.m_stream_ptr = std::make_shared< std::ifstream >(input.m_path, std::fstream::in);
+			}
+			if (!input.m_stream_ptr->good())
+			{
+				std::cout << "Unable to open VCF (check the open file limit): " << input.m_path << std::endl;
+				return false;
+			}
+			bool hasColumnHeader = false;
+			input.m_line.clear();
+			while (std::getline(*input.m_stream_ptr, input.m_line) && (input.m_line.size() == 0 || input.m_line[0] == '#'))
+			{
+				if (input.m_line.compare(0, 6, "#CHROM") == 0)
+				{
+					columns.clear();
+					split(input.m_line, '\t', columns);
+					for (size_t j = FORMAT_COLUMN + 1; j < columns.size(); ++j)
+					{
+						auto sampleIter = sampleIndices.find(columns[j]);
+						if (sampleIter == sampleIndices.end())
+						{
+							sampleIter = sampleIndices.emplace(columns[j], this->m_sample_names.size()).first;
+							this->m_sample_names.emplace_back(columns[j]);
+						}
+						input.m_output_sample_indices.emplace_back(sampleIter->second);
+					}
+					hasColumnHeader = true;
+				}
+				else if (input.m_line.size() > 0 && seenHeaderLines.emplace(input.m_line).second)
+				{
+					this->m_header_lines.emplace_back(input.m_line);
+				}
+				input.m_line.clear();
+			}
+			if (!hasColumnHeader)
+			{
+				std::cout << "VCF is missing its #CHROM line: " << input.m_path << std::endl;
+				return false;
+			}
+		}
+
+		// contigs are merged in the order of the ##contig lines
+		for (auto& headerLine : this->m_header_lines)
+		{
+			if (headerLine.compare(0, 13, "##contig=<ID=") == 0)
+			{
+				getContigRank(headerLine.substr(13, headerLine.find_first_of(",>", 13) - 13));
+			}
+		}
+		for (size_t i = 0; i < this->m_inputs.size(); ++i)
+		{
+			auto& input = this->m_inputs[i];
+			input.m_contig_rank = 0;
+			input.m_position = 0;
+			if (input.m_line.size() > 0)
+			{
+				std::string firstRecord = input.m_line;
+				input.m_line.clear();
+				if (!readNextRecord(i, firstRecord))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// moves the input on to its next record, false when the input turns out not to be sorted
+	bool VCFCombiner::readNextRecord(size_t inputIndex, const std::string& pendingLine)
+	{
+		auto& input = this->m_inputs[inputIndex];
+		input.m_line = pendingLine;
+		while (input.m_line.size() == 0 && std::getline(*input.m_stream_ptr, input.m_line))
+		{
+		}
+		if (input.m_line.size() == 0)
+		{
+			return true; // done
+		}
+		size_t contigEnd = input.m_line.find('\t');
+		uint32_t contigRank = getContigRank(input.m_line.substr(0, contigEnd));
+		uint32_t position = (contigEnd == std::string::npos) ? 0 : strtoul(input.m_line.c_str() + contigEnd + 1, nullptr, 10);
+		if (contigRank < input.m_contig_rank || (contigRank == input.m_contig_rank && position < input.m_position))
+		{
+			std::cout << "VCF is not sorted (in the order of the ##contig lines): " << input.m_path << " at " << input.m_line.substr(0, contigEnd) << ":" << position << std::endl;
+			return false;
+		}
+		input.m_contig_rank = contigRank;
+		input.m_position = position;
+		return true;
+	}
+
+	// contigs without a ##contig line are ranked in the order they show up
+	uint32_t VCFCombiner::getContigRank(const std::string& contig)
+	{
+		auto iter = this->m_contig_ranks.find(contig);
+		if (iter == this->m_contig_ranks.end())
+		{
+			iter = this->m_contig_ranks.emplace(contig, this->m_contig_ranks.size()).first;
+		}
+		return iter->second;
+	}
+
+	void VCFCombiner::writeRecordGroup(RecordGroup& recordGroup, std::string& line)
+	{
+		auto& formatKeys = this->m_format_keys;
+		auto& recordFormatKeys = this->m_record_format_keys;
+		auto& recordFields = this->m_record_fields;
+		auto& sampleValues = this->m_sample_values;
+		auto& sampleFilledCounts = this->m_sample_filled_counts;
+
+		// the output FORMAT is the union of the record FORMATs, in the order they are first seen
+		auto& firstColumns = recordGroup.m_records[0].second;
+		std::string format = firstColumns[FORMAT_COLUMN];
+		bool formatsMatch = true;
+		for (auto& record : recordGroup.m_records)
+		{
+			formatsMatch &= (record.second[FORMAT_COLUMN] == format);
+		}
+		splitFields(format, ':', formatKeys);
+		if (!formatsMatch)
+		{
+			for (auto& record : recordGroup.m_records)
+			{
+				splitFields(record.second[FORMAT_COLUMN], ':', recordFormatKeys);
+				for (auto& key : recordFormatKeys)
+				{
+					if (std::find(formatKeys.begin(), formatKeys.end(), key) == formatKeys.end())
+					{
+						formatKeys.emplace_back(key);
+						format += ":" + key;
+					}
+				}
+			}
+		}
+
+		sampleValues.resize(this->m_sample_names.size());
+		sampleFilledCounts.assign(this->m_sample_names.size(), -1);
+		for (auto& record : recordGroup.m_records)
+		{
+			auto& columns = record.second;
+			auto& outputSampleIndices = this->m_inputs[record.first].m_output_sample_indices;
+			bool remapFields = (columns[FORMAT_COLUMN] != format);
+			if (remapFields)
+			{
+				splitFields(columns[FORMAT_COLUMN], ':', recordFormatKeys);
+			}
+			for (size_t i = 0; i < outputSampleIndices.size() && FORMAT_COLUMN + 1 + i < columns.size(); ++i)
+			{
+				auto& sampleValue = columns[FORMAT_COLUMN + 1 + i];
+				int32_t filledCount = countFilledFields(sampleValue);
+				uint32_t sampleIndex = outputSampleIndices[i];
+				if (filledCount <= sampleFilledCounts[sampleIndex])
+				{
+					continue;
+				}
+				sampleFilledCounts[sampleIndex] = filledCount;
+				if (!remapFields)
+				{
+					sampleValues[sampleIndex].swap(sampleValue);
+					continue;
+				}
+				splitFields(sampleValue, ':', recordFields);
+				auto& outputValue = sampleValues[sampleIndex];
+				outputValue.clear();
+				for (size_t j = 0; j < formatKeys.size(); ++j)
+				{
+					if (j > 0)
+					{
+						outputValue.push_back(':');
+					}
+					auto keyIter = std::find(recordFormatKeys.begin(), recordFormatKeys.end(), formatKeys[j]);
+					size_t fieldIndex = keyIter - recordFormatKeys.begin();
+					outputValue += (keyIter != recordFormatKeys.end() && fieldIndex < recordFields.size()) ? recordFields[fieldIndex] : ".";
+				}
+			}
+		}
+
+		line.clear();
+		for (size_t i = 0; i < FORMAT_COLUMN; ++i)
+		{
+			if (i > 0)
+			{
+				line.push_back('\t');
+			}
+			line += firstColumns[i];
+		}
+		if (sampleValues.size() > 0)
+		{
+			line.push_back('\t');
+			line += format;
+		}
+		for (size_t i = 0; i < sampleValues.size(); ++i)
+		{
+			line.push_back('\t');
+			if (sampleFilledCounts[i] < 0) // the sample isn't in any input that has this record
+			{
+				for (size_t j = 0; j < formatKeys.size(); ++j)
+				{
+					line += (j > 0) ? ":." : ".";
+				}
+			}
+			else
+			{
+				line += sampleValues[i];
+			}
+		}
+		this->m_file_writer_ptr->writeLine(line);
+	}
+}
@@ -0,0 +1,72 @@
+#ifndef GRAPHITE_VCFCOMBINER_H
+#define GRAPHITE_VCFCOMBINER_H
+
+#include "core/util/Noncopyable.hpp"
+#include "core/util/AsyncFileWriter.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <istream>
+#include <unordered_map>
+
+namespace graphite
+{
+	/*
+	 * Joins sorted graphite VCFs (usually one per sample) into a single VCF
+	 * with the sample columns of all of them. The inputs are streamed side by
+	 * side with a k-way merge on (contig, position) so only the current
+	 * position of every input is held in memory. Records with the same
+	 * position, REF and ALT become one output record. A sample that shows up
+	 * in more than one input takes the value that has the most fields filled
+	 * in, which is the input where the sample's reads were adjudicated.
+	 */
+	class VCFCombiner : private Noncopyable
+	{
+	public:
+		typedef std::shared_ptr< VCFCombiner > SharedPtr;
+		VCFCombiner(const std::vector< std::string >& vcfPaths, const std::string& outputPath, uint32_t compressionThreadCount);
+		~VCFCombiner();
+
+		bool combine();
+
+	private:
+		struct InputVCF
+		{
+			std::string m_path;
+			std::shared_ptr< std::istream > m_stream_ptr;
+			std::vector< uint32_t > m_output_sample_indices; // output column of every sample in this input
+			std::string m_line; // the next record, empty once the input is done
+			uint32_t m_contig_rank;
+			uint32_t m_position;
+		};
+		struct RecordGroup
+		{
+			std::string m_allele_key; // REF and ALT
+			std::vector< std::pair< size_t, std::vector< std::string > > > m_records; // input index and columns
+		};
+
+		bool openInputs();
+		bool readNextRecord(size_t inputIndex, const std::string& pendingLine = "");
+		uint32_t getContigRank(const std::string& contig);
+		void writeRecordGroup(RecordGroup& recordGroup, std::string& line);
+
+		std::vector< std::string > m_vcf_paths;
+		std::string m_output_path;
+		uint32_t m_compression_thread_count;
+		std::vector< InputVCF > m_inputs;
+		std::vector< std::string > m_header_lines;
+		std::vector< std::string > m_sample_names;
+		std::unordered_map< std::string, uint32_t > m_contig_ranks;
+		AsyncFileWriter::SharedPtr m_file_writer_ptr;
+
+		// reused for every record group
+		std::vector< std::string > m_format_keys;
+		std::vector< std::string > m_record_format_keys;
+		std::vector< std::string > m_record_fields;
+		std::vector< std::string > m_sample_values;
+		std::vector< int32_t > m_sample_filled_counts;
+	};
+}
+
+#endif //GRAPHITE_VCFCOMBINER_H
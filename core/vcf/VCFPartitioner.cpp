@@ -0,0 +1,234 @@
+#include "VCFPartitioner.h"
+#include "core/util/gzstream.h"
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <memory>
+
+namespace graphite
+{
+	VCFPartitioner::VCFPartitioner(const std::vector< std::string >& vcfPaths, uint32_t graphSpacing) :
+		m_graph_spacing(graphSpacing),
+		m_variant_count(0),
+		m_partitioned_variant_count(0)
+	{
+		for (auto& vcfPath : vcfPaths)
+		{
+			readPositions(vcfPath);
+		}
+		for (auto& contigPositions : this->m_contig_positions)
+		{
+			std::sort(contigPositions.second.begin(), contigPositions.second.end()); // more than one VCF interleaves positions
+		}
+	}
+
+	VCFPartitioner::~VCFPartitioner()
+	{
+	}
+
+	// only CHROM and POS are read, the rest of each record is skipped
+	void VCFPartitioner::readPositions(const std::string& vcfPath)
+	{
+		std::shared_ptr< std::istream > fileStreamPtr;
+		if (vcfPath.substr(vcfPath.find_last_of(".") + 1) == "gz")
+		{
+			auto igzstreamPtr = std::make_shared< igzstream >();
+			igzstreamPtr->open(vcfPath.c_str());
+			fileStreamPtr = igzstreamPtr;
+		}
+		else
+		{
+			fileStreamPtr = std::make_shared< std::ifstream >(vcfPath, std::fstream::in);
+		}
+		std::string line;
+		std::string contig;
+		std::vector< position >* positions = nullptr;
+		while (std::getline(*fileStreamPtr, line))
+		{
+			if (line.size() == 0 || line[0] == '#')
+			{
+				continue;
+			}
+			size_t contigLength = line.find('\t');
+			if (contigLength == std::string::npos)
+			{
+				continue;
+			}
+			if (positions == nullptr || line.compare(0, contigLength, contig) != 0 || contigLength != contig.size())
+			{
+				contig = line.substr(0, contigLength);
+				auto iter = this->m_contig_positions.find(contig);
+				if (iter == this->m_contig_positions.end())
+				{
+					iter = this->m_contig_positions.emplace(contig, std::vector< position >()).first;
+					this->m_contig_order.emplace_back(contig);
+				}
+				positions = &iter->second;
+			}
+			positions->emplace_back(strtoul(line.c_str() + contigLength + 1, nullptr, 10));
+			++this->m_variant_count;
+		}
+	}
+
+	// the regions in VCF contig order with overlapping regions merged, regions on contigs without variants are dropped
+	std::vector< Region::SharedPtr > VCFPartitioner::getSortedRegions(const std::vector< Region::SharedPtr >& regionPtrs)
+	{
+		std::unordered_map< std::string, size_t > contigIndices;
+		for (auto& contig : this->m_contig_order)
+		{
+			contigIndices.emplace(contig, contigIndices.size());
+		}
+		std::vector< Region::SharedPtr > sortedRegionPtrs;
+		if (regionPtrs.size() == 0)
+		{
+			for (auto& contig : this->m_contig_order)
+			{
+				sortedRegionPtrs.emplace_back(std::make_shared< Region >(contig, 1, MAX_POSITION, Region::BASED::ONE));
+			}
+			return sortedRegionPtrs;
+		}
+		std::vector< Region::SharedPtr > knownRegionPtrs;
+		for (auto& regionPtr : regionPtrs)
+		{
+			if (contigIndices.find(regionPtr->getReferenceID()) != contigIndices.end())
+			{
+				knownRegionPtrs.emplace_back(regionPtr);
+			}
+		}
+		std::sort(knownRegionPtrs.begin(), knownRegionPtrs.end(), [&contigIndices](const Region::SharedPtr& a, const Region::SharedPtr& b)
+				  {
+					  size_t aIndex = contigIndices[a->getReferenceID()];
+					  size_t bIndex = contigIndices[b->getReferenceID()];
+					  return (aIndex == bIndex) ? a->getStartPosition() < b->getStartPosition() : aIndex < bIndex;
+				  });
+		for (auto& regionPtr : knownRegionPtrs)
+		{
+			if (sortedRegionPtrs.size() > 0 && sortedRegionPtrs.back()->getReferenceID() == regionPtr->getReferenceID() && regionPtr->getStartPosition() <= sortedRegionPtrs.back()->getEndPosition())
+			{
+				auto& lastRegionPtr = sortedRegionPtrs.back();
+				lastRegionPtr->setEndPosition(std::max(lastRegionPtr->getEndPosition(), regionPtr->getEndPosition()));
+				continue;
+			}
+			sortedRegionPtrs.emplace_back(std::make_shared< Region >(regionPtr->getReferenceID(), regionPtr->getStartPosition(), regionPtr->getEndPosition(), Region::BASED::ONE));
+		}
+		return sortedRegionPtrs;
+	}
+
+	// the variant positions inside each region, returns the number of variants in all of them
+	uint64_t VCFPartitioner::getPositionRanges(const std::vector< Region::SharedPtr >& sortedRegionPtrs, std::vector< PositionRange >& positionRanges)
+	{
+		uint64_t variantCount = 0;
+		positionRanges.clear();
+		for (auto& regionPtr : sortedRegionPtrs)
+		{
+			auto& positions = this->m_contig_positions[regionPtr->getReferenceID()];
+			auto first = std::lower_bound(positions.begin(), positions.end(), regionPtr->getStartPosition());
+			auto last = std::upper_bound(first, positions.end(), regionPtr->getEndPosition());
+			positionRanges.emplace_back(first, last);
+			variantCount += (last - first);
+		}
+		return variantCount;
+	}
+
+	std::vector< Region::SharedPtr > VCFPartitioner::partition(const std::vector< Region::SharedPtr >& regionPtrs, uint32_t shardCount)
+	{
+		auto sortedRegionPtrs = getSortedRegions(regionPtrs);
+		std::vector< PositionRange > regionPositions;
+		uint64_t variantCount = getPositionRanges(sortedRegionPtrs, regionPositions);
+		this->m_partitioned_variant_count = variantCount;
+		shardCount = (shardCount > 0) ? shardCount : 1;
+		uint64_t shardVariantCount = (variantCount + shardCount - 1) / shardCount;
+
+		std::vector< Region::SharedPtr > shardRegionPtrs;
+		for (size_t i = 0; i < sortedRegionPtrs.size(); ++i)
+		{
+			auto& regionPtr = sortedRegionPtrs[i];
+			auto first = regionPositions[i].first;
+			auto last = regionPositions[i].second;
+			if (first == last)
+			{
+				continue; // nothing to adjudicate in this region
+			}
+			position shardStartPosition = regionPtr->getStartPosition();
+			uint64_t currentShardVariantCount = 0;
+			for (auto iter = first; iter != last; ++iter)
+			{
+				++currentShardVariantCount;
+				auto next = iter + 1;
+				// a gap of at least the graph spacing means the next variant starts a new cluster
+				if (currentShardVariantCount >= shardVariantCount && next != last && (*next - *iter) >= this->m_graph_spacing)
+				{
+					shardRegionPtrs.emplace_back(std::make_shared< Region >(regionPtr->getReferenceID(), shardStartPosition, *iter, Region::BASED::ONE));
+					shardStartPosition = *next;
+					currentShardVariantCount = 0;
+				}
+			}
+			shardRegionPtrs.emplace_back(std::make_shared< Region >(regionPtr->getReferenceID(), shardStartPosition, regionPtr->getEndPosition(), Region::BASED::ONE));
+		}
+		return shardRegionPtrs;
+	}
+
+	/*
+	 * The regions of one shard out of shardCount when the work is spread over
+	 * separate processes. All variants in the regions are numbered in order and
+	 * shard i starts at the first valid cut at or after i * variantCount / shardCount,
+	 * so every process agrees on the boundaries and the shards can span contigs.
+	 */
+	std::vector< Region::SharedPtr > VCFPartitioner::scatter(const std::vector< Region::SharedPtr >& regionPtrs, uint32_t shardIndex, uint32_t shardCount)
+	{
+		auto sortedRegionPtrs = getSortedRegions(regionPtrs);
+		std::vector< PositionRange > regionPositions;
+		uint64_t variantCount = getPositionRanges(sortedRegionPtrs, regionPositions);
+		std::vector< uint64_t > regionOffsets; // the number of the first variant in each region
+		uint64_t offset = 0;
+		for (auto& positionRange : regionPositions)
+		{
+			regionOffsets.emplace_back(offset);
+			offset += (positionRange.second - positionRange.first);
+		}
+
+		// a cut before variant number n is valid at a region boundary or at a gap of at least the graph spacing
+		auto getValidCut = [&](uint64_t variantNumber)
+			{
+				for (size_t i = 0; i < regionPositions.size(); ++i)
+				{
+					uint64_t regionVariantCount = regionPositions[i].second - regionPositions[i].first;
+					if (variantNumber > regionOffsets[i] + regionVariantCount || regionVariantCount == 0)
+					{
+						continue;
+					}
+					for (uint64_t j = variantNumber - regionOffsets[i]; j < regionVariantCount; ++j)
+					{
+						if (j == 0 || (*(regionPositions[i].first + j) - *(regionPositions[i].first + j - 1)) >= this->m_graph_spacing)
+						{
+							return regionOffsets[i] + j;
+						}
+					}
+					return regionOffsets[i] + regionVariantCount;
+				}
+				return variantCount;
+			};
+		shardCount = (shardCount > 0) ? shardCount : 1;
+		uint64_t firstVariant = getValidCut((variantCount * shardIndex) / shardCount);
+		uint64_t lastVariant = getValidCut((variantCount * (shardIndex + 1)) / shardCount);
+
+		std::vector< Region::SharedPtr > shardRegionPtrs;
+		for (size_t i = 0; i < sortedRegionPtrs.size(); ++i)
+		{
+			auto& regionPtr = sortedRegionPtrs[i];
+			uint64_t regionVariantCount = regionPositions[i].second - regionPositions[i].first;
+			uint64_t first = std::max(firstVariant, regionOffsets[i]);
+			uint64_t last = std::min(lastVariant, regionOffsets[i] + regionVariantCount);
+			if (first >= last)
+			{
+				continue;
+			}
+			position startPosition = (first == regionOffsets[i]) ? regionPtr->getStartPosition() : *(regionPositions[i].first + (first - regionOffsets[i]));
+			position endPosition = (last == regionOffsets[i] + regionVariantCount) ? regionPtr->getEndPosition() : *(regionPositions[i].first + (last - regionOffsets[i] - 1));
+			shardRegionPtrs.emplace_back(std::make_shared< Region >(regionPtr->getReferenceID(), startPosition, endPosition, Region::BASED::ONE));
+		}
+		return shardRegionPtrs;
+	}
+}
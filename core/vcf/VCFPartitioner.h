@@ -0,0 +1,46 @@
+#ifndef GRAPHITE_VCFPARTITIONER_H
+#define GRAPHITE_VCFPARTITIONER_H
+
+#include "core/util/Noncopyable.hpp"
+#include "core/util/Types.h"
+#include "core/region/Region.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace graphite
+{
+	/*
+	 * Splits the input VCFs into shards that can be adjudicated independently.
+	 * Shards never cross contigs and are only cut between two variants that are
+	 * at least a graph spacing apart, so every shard sees exactly the clusters
+	 * a single run over the same region would. Within those cut points the
+	 * shards hold about the same number of variants.
+	 */
+	class VCFPartitioner : private Noncopyable
+	{
+	public:
+		VCFPartitioner(const std::vector< std::string >& vcfPaths, uint32_t graphSpacing);
+		~VCFPartitioner();
+
+		std::vector< Region::SharedPtr > partition(const std::vector< Region::SharedPtr >& regionPtrs, uint32_t shardCount);
+		std::vector< Region::SharedPtr > scatter(const std::vector< Region::SharedPtr >& regionPtrs, uint32_t shardIndex, uint32_t shardCount);
+		uint64_t getVariantCount() { return this->m_variant_count; }
+		uint64_t getPartitionedVariantCount() { return this->m_partitioned_variant_count; } // in the regions of the last partition
+
+	private:
+		void readPositions(const std::string& vcfPath);
+		typedef std::pair< std::vector< position >::iterator, std::vector< position >::iterator > PositionRange;
+		std::vector< Region::SharedPtr > getSortedRegions(const std::vector< Region::SharedPtr >& regionPtrs);
+		uint64_t getPositionRanges(const std::vector< Region::SharedPtr >& sortedRegionPtrs, std::vector< PositionRange >& positionRanges);
+
+		uint32_t m_graph_spacing;
+		uint64_t m_variant_count;
+		uint64_t m_partitioned_variant_count;
+		std::vector< std::string > m_contig_order; // contigs in the order the VCFs list them
+		std::unordered_map< std::string, std::vector< position > > m_contig_positions;
+	};
+}
+
+#endif //GRAPHITE_VCFPARTITIONER_H
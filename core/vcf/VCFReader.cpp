@@ -1,41 +1,89 @@
 #include "VCFReader.h"
 #include "core/util/Utility.h"
+#include "core/util/StageProfiler.h"
+
+#include "htslib/tbx.h"
 
 #include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <limits>
 #include <cstring>
+#include <cstdlib>
+
+#include <sys/stat.h>
 
 
 namespace graphite
 {
-	VCFReader::VCFReader(const std::string& filename, std::vector< graphite::Sample::SharedPtr >& bamSamplePtrs, Region::SharedPtr regionPtr, VCFWriter::SharedPtr vcfWriter) :
+	VCFReader::VCFReader(const std::string& filename, std::vector< graphite::Sample::SharedPtr >& bamSamplePtrs, Region::SharedPtr regionPtr, VCFWriter::SharedPtr vcfWriter, bool seeksRecords) :
 		m_filename(filename),
 		m_region_ptr(nullptr),
 		m_file_stream_ptr(nullptr),
+		m_bgzf_file(nullptr),
+		m_bgzf_line(),
+		m_is_compressed(false),
+		m_file_byte_count(0),
+		m_line_byte_count(0),
+		m_read_byte_count(0),
 		m_preloaded_variant(nullptr),
 		m_vcf_writer(vcfWriter)
 	{
-		openFile(); // open the vcf
+		openFile(regionPtr != nullptr || seeksRecords); // open the vcf
 		processHeader(bamSamplePtrs); // read the header
 		setRegion(regionPtr);
 	}
 
+	// reads VCF lines that are already in memory, such as the records of a server request
+	VCFReader::VCFReader(std::shared_ptr< std::istream > streamPtr, std::vector< graphite::Sample::SharedPtr >& bamSamplePtrs, VCFWriter::SharedPtr vcfWriter) :
+		m_filename(""),
+		m_region_ptr(nullptr),
+		m_file_stream_ptr(streamPtr),
+		m_bgzf_file(nullptr),
+		m_bgzf_line(),
+		m_is_compressed(false),
+		m_file_byte_count(0),
+		m_line_byte_count(0),
+		m_read_byte_count(0),
+		m_preloaded_variant(nullptr),
+		m_vcf_writer(vcfWriter)
+	{
+		processHeader(bamSamplePtrs);
+	}
+
 	VCFReader::~VCFReader()
 	{
-		if (this->m_filename.substr(this->m_filename.find_last_of(".") + 1) == "gz")
+		if (this->m_bgzf_file != nullptr)
+		{
+			bgzf_close(this->m_bgzf_file);
+			free(this->m_bgzf_line.s);
+		}
+		else if (this->m_filename.substr(this->m_filename.find_last_of(".") + 1) == "gz")
 		{
 			std::static_pointer_cast< igzstream >(m_file_stream_ptr)->close();
 		}
-		else
+		else if (this->m_filename.size() > 0)
 		{
 			std::static_pointer_cast< std::ifstream >(m_file_stream_ptr)->close();
 		}
 	}
 
-	void VCFReader::openFile()
+	void VCFReader::openFile(bool seeksFile)
 	{
-		if (this->m_filename.substr(this->m_filename.find_last_of(".") + 1) == "gz")
+		struct stat fileStat;
+		this->m_file_byte_count = (stat(this->m_filename.c_str(), &fileStat) == 0) ? fileStat.st_size : 0;
+		this->m_is_compressed = (this->m_filename.substr(this->m_filename.find_last_of(".") + 1) == "gz");
+		// a region of a bgzipped VCF with a tabix (or csi) index is sought through the index, see seekRegion
+		// a checkpointed run reads it through BGZF for its virtual offsets, see resume
+		if (this->m_is_compressed && seeksFile)
+		{
+			this->m_bgzf_file = bgzf_open(this->m_filename.c_str(), "r");
+			if (this->m_bgzf_file != nullptr)
+			{
+				return;
+			}
+		}
+		if (this->m_is_compressed)
 		{
 			auto igzstreamPtr = std::make_shared< igzstream >();
 			igzstreamPtr->open(this->m_filename.c_str());
@@ -54,27 +102,69 @@ namespace graphite
 			return;
 		}
 		this->m_region_ptr = regionPtr;
+		if (this->m_bgzf_file != nullptr && (fileExists(this->m_filename + ".tbi", false) || fileExists(this->m_filename + ".csi", false)))
+		{
+			seekRegion(); // the first record it finds can be a deletion that starts before the region, the scan below skips it
+		}
+		if (this->m_preloaded_variant == nullptr ||
+			(this->m_region_ptr->getReferenceID() == this->m_preloaded_variant->getChromosome() &&
+			 this->m_region_ptr->getStartPosition() <= this->m_preloaded_variant->getPosition() &&
+			 this->m_preloaded_variant->getPosition() <= this->m_region_ptr->getEndPosition()))
+		{
+			return;
+		}
+		// skip ahead using only CHROM and POS, building a Variant for every skipped line is expensive for regions deep in the file
+		// without an index every shard of a run reads the VCF from its start up to its region
 		std::string nextLine;
-		while (this->m_preloaded_variant != nullptr)
+		const std::string& referenceID = this->m_region_ptr->getReferenceID();
+		this->m_preloaded_variant = nullptr; // if we reach the eof the variant stays nullptr
+		while (getNextLine(nextLine))
 		{
-			// as soon as we are inside the region then break out
-			if (this->m_region_ptr->getReferenceID() == this->m_preloaded_variant->getChromosome() &&
-				  this->m_region_ptr->getStartPosition() <= this->m_preloaded_variant->getPosition() &&
-				  this->m_preloaded_variant->getPosition() <= this->m_region_ptr->getEndPosition())
+			size_t chromosomeLength = nextLine.find('\t');
+			if (chromosomeLength == referenceID.size() && nextLine.compare(0, chromosomeLength, referenceID) == 0)
 			{
-				break;
+				position linePosition = strtoul(nextLine.c_str() + chromosomeLength + 1, nullptr, 10);
+				if (this->m_region_ptr->getStartPosition() <= linePosition && linePosition <= this->m_region_ptr->getEndPosition())
+				{
+					this->m_preloaded_variant = createVariant(nextLine);
+					break;
+				}
 			}
-			if (!getNextLine(nextLine)) // if we are at the eof then set the variant to nullptr
+		}
+	}
+
+	// preloads the first record that overlaps the region, the index points at the block it is in
+	// false when the index can't be loaded, the reader is then left where it was
+	bool VCFReader::seekRegion()
+	{
+		tbx_t* tbx = tbx_index_load(this->m_filename.c_str());
+		if (tbx == nullptr)
+		{
+			std::cout << "Unable to load the index of " << this->m_filename << ", the VCF is read from its start" << std::endl;
+			return false;
+		}
+		this->m_preloaded_variant = nullptr; // contigs without records are not in the index
+		int contigID = tbx_name2id(tbx, this->m_region_ptr->getReferenceID().c_str());
+		if (contigID >= 0)
+		{
+			int endPosition = static_cast< int >(std::min< uint64_t >(this->m_region_ptr->getEndPosition(), std::numeric_limits< int >::max()));
+			hts_itr_t* itr = tbx_itr_queryi(tbx, contigID, this->m_region_ptr->getStartPosition() - 1, endPosition);
+			if (itr != nullptr && hts_itr_next(this->m_bgzf_file, itr, &this->m_bgzf_line, tbx) >= 0)
 			{
-				this->m_preloaded_variant = nullptr;
-				break;
+				this->m_preloaded_variant = createVariant(std::string(this->m_bgzf_line.s, this->m_bgzf_line.l));
+			}
+			if (itr != nullptr)
+			{
+				tbx_itr_destroy(itr);
 			}
-			this->m_preloaded_variant = std::make_shared< Variant >(nextLine, this->m_vcf_writer);
 		}
+		tbx_destroy(tbx);
+		return true;
 	}
 
 	bool VCFReader::getNextVariants(std::vector< Variant::SharedPtr >& variantPtrs, uint32_t spacing)
 	{
+		StageProfiler::Timer timer(StageProfiler::STAGE::VCF_PARSE);
 		variantPtrs.clear();
 		std::string nextLine;
 		while (this->m_preloaded_variant != nullptr)
@@ -97,11 +187,75 @@ namespace graphite
 				this->m_preloaded_variant = nullptr;
 				break;
 			}
-			this->m_preloaded_variant = std::make_shared< Variant >(nextLine, this->m_vcf_writer);
+			this->m_preloaded_variant = createVariant(nextLine);
 		}
+		timer.setItemCount(variantPtrs.size());
+		uint64_t readByteCount = this->m_line_byte_count;
+		if (this->m_bgzf_file != nullptr)
+		{
+			readByteCount = bgzf_tell(this->m_bgzf_file) >> 16; // the file offset of the current block
+		}
+		else if (this->m_is_compressed)
+		{
+			readByteCount = std::static_pointer_cast< igzstream >(this->m_file_stream_ptr)->rdbuf()->compressed_offset();
+		}
+		this->m_read_byte_count.store(readByteCount, std::memory_order_relaxed);
 		return variantPtrs.size() > 0;
 	}
 
+	// compressed files are measured by their compressed bytes, the total of the uncompressed ones isn't known
+	double VCFReader::getReadFraction()
+	{
+		return (this->m_file_byte_count > 0) ? static_cast< double >(this->m_read_byte_count.load(std::memory_order_relaxed)) / this->m_file_byte_count : 0.0;
+	}
+
+	// continues after the last record a checkpointed run wrote by seeking to the offset stored with it
+	// a gzipped VCF that isn't BGZF can't be sought, the records that were written are read past instead
+	void VCFReader::resume(const VCFWriter::ResumePoint& resumePoint)
+	{
+		if (resumePoint.m_record_count == 0)
+		{
+			return;
+		}
+		bool isSought = false;
+		if (resumePoint.m_record_offset > 0 && this->m_bgzf_file != nullptr)
+		{
+			isSought = bgzf_seek(this->m_bgzf_file, resumePoint.m_record_offset, SEEK_SET) >= 0;
+		}
+		else if (resumePoint.m_record_offset > 0 && !this->m_is_compressed)
+		{
+			this->m_file_stream_ptr->clear();
+			isSought = (bool)this->m_file_stream_ptr->seekg(resumePoint.m_record_offset);
+			this->m_line_byte_count = resumePoint.m_record_offset;
+		}
+		if (!isSought)
+		{
+			skipRecords(resumePoint.m_record_count);
+			return;
+		}
+		std::string nextLine;
+		this->m_preloaded_variant = (getNextLine(nextLine)) ? createVariant(nextLine) : nullptr;
+	}
+
+	// drops the next recordCount records without parsing them
+	void VCFReader::skipRecords(uint64_t recordCount)
+	{
+		if (recordCount == 0 || this->m_preloaded_variant == nullptr)
+		{
+			return;
+		}
+		std::string nextLine;
+		for (uint64_t i = 1; i < recordCount; ++i) // the preloaded variant is the first of them
+		{
+			if (!getNextLine(nextLine))
+			{
+				this->m_preloaded_variant = nullptr;
+				return;
+			}
+		}
+		this->m_preloaded_variant = (getNextLine(nextLine)) ? createVariant(nextLine) : nullptr;
+	}
+
 	void VCFReader::processHeader(std::vector< graphite::Sample::SharedPtr >& bamSamplePtrs)
 	{
 		// for each line read and write it to the VCFWriter
@@ -126,7 +280,7 @@ namespace graphite
 		this->m_vcf_writer->writeHeader(headerLines);
 		if (line.size() > 0)
 		{
-			this->m_preloaded_variant = std::make_shared< Variant >(line, m_vcf_writer);
+			this->m_preloaded_variant = createVariant(line);
 		}
 	}
 
@@ -9,7 +9,11 @@
 #include "Variant.h"
 #include "VCFWriter.h"
 
+#include "htslib/bgzf.h"
+#include "htslib/kstring.h"
+
 #include <memory>
+#include <atomic>
 
 #include <istream>
 
@@ -20,21 +24,59 @@ namespace graphite
 	{
 	public:
 		typedef std::shared_ptr< VCFReader > SharedPtr;
-		VCFReader(const std::string& filename, std::vector< graphite::Sample::SharedPtr >& bamSamplePtrs, Region::SharedPtr regionPtr, VCFWriter::SharedPtr vcfWriter);
+		VCFReader(const std::string& filename, std::vector< graphite::Sample::SharedPtr >& bamSamplePtrs, Region::SharedPtr regionPtr, VCFWriter::SharedPtr vcfWriter, bool seeksRecords = false);
+		VCFReader(std::shared_ptr< std::istream > streamPtr, std::vector< graphite::Sample::SharedPtr >& bamSamplePtrs, VCFWriter::SharedPtr vcfWriter);
 		~VCFReader();
 		bool getNextVariants(std::vector< Variant::SharedPtr >& variantPtrs, uint32_t spacing);
+		void resume(const VCFWriter::ResumePoint& resumePoint);
+		double getReadFraction(); // of the file's bytes, as of the last cluster
 
 	private:
-		void openFile();
+		void openFile(bool seeksFile);
 		void processHeader(std::vector< graphite::Sample::SharedPtr >& bamSamplePtrs);
 		Variant::SharedPtr getNextVariant();
 		void setRegion(Region::SharedPtr regionPtr);
+		bool seekRegion();
+		void skipRecords(uint64_t recordCount);
+
+		// the variant of the line just read, it keeps where the next record starts so a checkpoint can seek past it
+		inline Variant::SharedPtr createVariant(const std::string& line)
+		{
+			auto variantPtr = std::make_shared< Variant >(line, this->m_vcf_writer);
+			if (this->m_bgzf_file != nullptr)
+			{
+				variantPtr->setNextRecordOffset(bgzf_tell(this->m_bgzf_file));
+			}
+			else if (!this->m_is_compressed)
+			{
+				variantPtr->setNextRecordOffset(this->m_line_byte_count);
+			}
+			return variantPtr;
+		}
 
 		std::string setSamplePtrs(const std::string& columnLine, std::vector< graphite::Sample::SharedPtr >& bamSamplePtrs);
 
 		inline bool getNextLine(std::string& line)
 		{
-			return (bool)std::getline(*this->m_file_stream_ptr, line);
+			bool isRead;
+			if (this->m_bgzf_file != nullptr)
+			{
+				isRead = bgzf_getline(this->m_bgzf_file, '\n', &this->m_bgzf_line) >= 0;
+				if (isRead)
+				{
+					line.assign(this->m_bgzf_line.s, this->m_bgzf_line.l);
+				}
+				else
+				{
+					line.clear();
+				}
+			}
+			else
+			{
+				isRead = (bool)std::getline(*this->m_file_stream_ptr, line);
+			}
+			this->m_line_byte_count += line.size() + 1;
+			return isRead;
 		}
 
 		Variant::SharedPtr m_preloaded_variant;
@@ -42,6 +84,12 @@ namespace graphite
 		Region::SharedPtr m_region_ptr;
 		std::string m_filename;
 		std::shared_ptr< std::istream > m_file_stream_ptr;
+		BGZF* m_bgzf_file; // read instead of m_file_stream_ptr when a compressed VCF is sought, by region or on resume
+		kstring_t m_bgzf_line;
+		bool m_is_compressed;
+		uint64_t m_file_byte_count;
+		uint64_t m_line_byte_count; // uncompressed
+		std::atomic< uint64_t > m_read_byte_count; // set once per cluster, progress reports read it from their own thread
         std::unordered_map< std::string, Sample::SharedPtr > m_sample_ptrs_map;
 	};
 }
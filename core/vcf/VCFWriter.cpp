@@ -4,18 +4,21 @@
 #include "core/allele/Allele.h"
 
 #include <algorithm>
+#include <cstdio>
 
 namespace graphite
 {
-	VCFWriter::VCFWriter(const std::string& filename, std::vector< graphite::Sample::SharedPtr >& bamSamplePtrs, const std::string& outputDirectory, bool saveSupportingReadInfo) :
+	VCFWriter::VCFWriter(const std::string& filename, std::vector< graphite::Sample::SharedPtr >& bamSamplePtrs, const std::string& outputDirectory, bool saveSupportingReadInfo, bool compressOutput, uint32_t compressionThreadCount, const std::string& outputNameSuffix, const ResumePoint& resumePoint) :
 		m_bam_sample_ptrs(bamSamplePtrs),
+		m_out_bgzf_file_ptr(nullptr),
 		m_black_format_string(nullptr),
-		m_save_supporting_read_info(saveSupportingReadInfo)
+		m_save_supporting_read_info(saveSupportingReadInfo),
+		m_is_shard_writer(false),
+		m_is_resumed(resumePoint.m_byte_count > 0),
+		m_record_count(resumePoint.m_record_count),
+		m_next_record_offset(resumePoint.m_record_offset)
 	{
-		for (auto samplePtr : m_bam_sample_ptrs)
-		{
-			m_bam_sample_ptrs_map.emplace(samplePtr->getName(), samplePtr);
-		}
+		setBamSamplePtrs(bamSamplePtrs);
 
 		// let's remove any gz from the filename
 		std::string baseFilename = filename.substr(filename.find_last_of("/\\") + 1);
@@ -29,34 +32,186 @@ namespace graphite
 				baseFilename += ".vcf";
 			}
 		}
+		if (outputNameSuffix.size() > 0)
+		{
+			// keep the extension last so a shard of in.vcf is still a .vcf
+			size_t extensionPosition = baseFilename.find_last_of(".");
+			baseFilename.insert((extensionPosition == std::string::npos) ? baseFilename.size() : extensionPosition, outputNameSuffix);
+		}
 		std::string path(outputDirectory + "/" + baseFilename);
-		this->m_out_file.open(path);
+		this->m_base_output_path = path;
+		if (compressOutput)
+		{
+			this->m_out_bgzf_file_ptr = std::make_shared< IndexedBGZFFileWriter >(path + ".gz", compressionThreadCount);
+			this->m_out_file_ptr = this->m_out_bgzf_file_ptr;
+		}
+		else
+		{
+			this->m_out_file_ptr = std::make_shared< AsyncFileWriter >(path);
+		}
+		this->m_out_path = this->m_out_file_ptr->getPath();
+		this->m_out_file_ptr->open(resumePoint.m_byte_count);
 		if (m_save_supporting_read_info)
 		{
 			baseFilename = baseFilename.substr(0, baseFilename.size() - filenameExtension.size() - 1);
-			std::string saveSupportingReadPath = outputDirectory + "/" + baseFilename + ".graphite_supporting_read_info.txt";
-			this->m_out_supporting_read_file.open(saveSupportingReadPath);
-			std::string token = "\t";
-			this->m_out_supporting_read_file << "Chrom" << token << "Pos" << "Allele" << token << SupportingReadInfo::getHeader(token) << std::endl;
+			this->m_out_supporting_read_path = outputDirectory + "/" + baseFilename + ".graphite_supporting_read_info.txt";
+			this->m_out_supporting_read_file_ptr = std::make_shared< AsyncFileWriter >(this->m_out_supporting_read_path);
+			this->m_out_supporting_read_file_ptr->open(resumePoint.m_supporting_read_byte_count);
+			if (!this->m_is_resumed)
+			{
+				std::string token = "\t";
+				writeSupportingReadLine("Chrom" + token + "Pos" + "Allele" + token + SupportingReadInfo::getHeader(token));
+			}
 		}
 	}
 
+	// a headerless writer for one shard of the output, see createShardWriter
+	VCFWriter::VCFWriter(const std::string& shardPath, std::vector< graphite::Sample::SharedPtr >& bamSamplePtrs, bool saveSupportingReadInfo) :
+		m_base_output_path(shardPath),
+		m_out_path(shardPath),
+		m_bam_sample_ptrs(bamSamplePtrs),
+		m_out_bgzf_file_ptr(nullptr),
+		m_black_format_string(nullptr),
+		m_save_supporting_read_info(saveSupportingReadInfo),
+		m_is_shard_writer(true),
+		m_is_resumed(false),
+		m_record_count(0),
+		m_next_record_offset(0)
+	{
+		setBamSamplePtrs(bamSamplePtrs);
+		this->m_out_file_ptr = std::make_shared< AsyncFileWriter >(this->m_out_path);
+		this->m_out_file_ptr->open();
+		if (m_save_supporting_read_info)
+		{
+			this->m_out_supporting_read_path = shardPath + ".graphite_supporting_read_info";
+			this->m_out_supporting_read_file_ptr = std::make_shared< AsyncFileWriter >(this->m_out_supporting_read_path);
+			this->m_out_supporting_read_file_ptr->open();
+		}
+	}
+
+	// a writer on an output that is already open, the server streams the records of a request to its client this way
+	VCFWriter::VCFWriter(AsyncFileWriter::SharedPtr outFilePtr, std::vector< graphite::Sample::SharedPtr >& bamSamplePtrs) :
+		m_base_output_path(outFilePtr->getPath()),
+		m_out_path(outFilePtr->getPath()),
+		m_bam_sample_ptrs(bamSamplePtrs),
+		m_out_file_ptr(outFilePtr),
+		m_out_bgzf_file_ptr(nullptr),
+		m_black_format_string(nullptr),
+		m_save_supporting_read_info(false),
+		m_is_shard_writer(false),
+		m_is_resumed(false),
+		m_record_count(0),
+		m_next_record_offset(0)
+	{
+		setBamSamplePtrs(bamSamplePtrs);
+	}
+
 	VCFWriter::~VCFWriter()
 	{
-		this->m_out_file.close();
+		close();
+	}
+
+	void VCFWriter::setBamSamplePtrs(std::vector< graphite::Sample::SharedPtr >& bamSamplePtrs)
+	{
+		for (auto samplePtr : bamSamplePtrs)
+		{
+			m_bam_sample_ptrs_map.emplace(samplePtr->getName(), samplePtr);
+		}
+	}
+
+	// false when any of the output failed to reach the disk
+	bool VCFWriter::close()
+	{
+		bool isClosed = this->m_out_file_ptr->close();
+		if (m_save_supporting_read_info)
+		{
+			isClosed = this->m_out_supporting_read_file_ptr->close() && isClosed;
+		}
+		return isClosed;
+	}
+
+	// shard writers write next to the final output and are appended to it in shard order
+	VCFWriter::SharedPtr VCFWriter::createShardWriter(size_t shardIndex)
+	{
+		std::string shardPath = this->m_base_output_path + ".shard" + std::to_string(shardIndex) + ".tmp";
+		auto shardWriterPtr = std::make_shared< VCFWriter >(shardPath, this->m_bam_sample_ptrs, this->m_save_supporting_read_info);
+		shardWriterPtr->setGenotyper(this->m_genotyper_ptr);
+		return shardWriterPtr;
+	}
+
+	// the shard's files are only removed once their lines reached the disk, on failure they are kept
+	bool VCFWriter::appendShard(VCFWriter::SharedPtr shardWriterPtr)
+	{
+		bool isAppended = shardWriterPtr->close() && this->m_out_file_ptr->appendFile(shardWriterPtr->m_out_path);
+		if (m_save_supporting_read_info)
+		{
+			isAppended = isAppended && this->m_out_supporting_read_file_ptr->appendFile(shardWriterPtr->m_out_supporting_read_path);
+		}
+		if (!isAppended || !flush())
+		{
+			std::cout << "Unable to append shard: " << shardWriterPtr->m_out_path << std::endl;
+			return false;
+		}
+		std::remove(shardWriterPtr->m_out_path.c_str());
 		if (m_save_supporting_read_info)
 		{
-			this->m_out_supporting_read_file.close();
+			std::remove(shardWriterPtr->m_out_supporting_read_path.c_str());
 		}
+		return true;
 	}
 
 	void VCFWriter::writeLine(const std::string& line)
 	{
-		this->m_out_file << line.c_str() << std::endl;
+		this->m_out_file_ptr->writeLine(line);
+	}
+
+	void VCFWriter::writeRecord(const std::string& line, uint64_t nextRecordOffset)
+	{
+		this->m_out_file_ptr->writeLine(line);
+		++this->m_record_count;
+		this->m_next_record_offset = nextRecordOffset;
+	}
+
+	void VCFWriter::writeSupportingReadLine(const std::string& line)
+	{
+		this->m_out_supporting_read_file_ptr->writeLine(line);
+	}
+
+	// blocks until every record written so far is on disk, use this for checkpoints
+	bool VCFWriter::flush()
+	{
+		bool isFlushed = this->m_out_file_ptr->flush();
+		if (m_save_supporting_read_info)
+		{
+			isFlushed = this->m_out_supporting_read_file_ptr->flush() && isFlushed;
+		}
+		return isFlushed;
+	}
+
+	bool VCFWriter::hasFailed()
+	{
+		return this->m_out_file_ptr->hasFailed() || (m_save_supporting_read_info && this->m_out_supporting_read_file_ptr->hasFailed());
+	}
+
+	// flushes the output, the returned point is where a resumed run continues from
+	VCFWriter::ResumePoint VCFWriter::getResumePoint()
+	{
+		flush();
+		ResumePoint resumePoint;
+		resumePoint.m_record_count = this->m_record_count;
+		resumePoint.m_record_offset = this->m_next_record_offset;
+		resumePoint.m_byte_count = this->m_out_file_ptr->getFlushedByteCount();
+		resumePoint.m_supporting_read_byte_count = (m_save_supporting_read_info) ? this->m_out_supporting_read_file_ptr->getFlushedByteCount() : 0;
+		return resumePoint;
 	}
 
 	void VCFWriter::writeHeader(const std::vector< std::string >& headerLines)
 	{
+		bool writesHeader = !this->m_is_shard_writer && !this->m_is_resumed;
+		if (this->m_out_bgzf_file_ptr != nullptr)
+		{
+			this->m_out_bgzf_file_ptr->setMaxReferenceLength(getMaxReferenceLength(headerLines)); // the index type depends on the longest contig
+		}
 		m_vcf_column_names.clear();
 		m_sample_names.clear();
 		// we need to add the graphite format rows in the header.
@@ -77,6 +232,10 @@ namespace graphite
 				{
 					lines.emplace_back(std::get< 1 >(formatTuple));
 				}
+				if (this->m_genotyper_ptr != nullptr)
+				{
+					lines.insert(lines.end(), Genotyper::getFormatHeaderLines().begin(), Genotyper::getFormatHeaderLines().end());
+				}
 				formatWritten = true;
 			}
 			if (!isHeaderCols)
@@ -87,7 +246,7 @@ namespace graphite
 		std::unordered_set< std::string > writtenLines;
 		for (auto line : lines)
 		{
-			if (writtenLines.find(line) == writtenLines.end())
+			if (writesHeader && writtenLines.find(line) == writtenLines.end())
 			{
 				writeLine(line);
 				writtenLines.emplace(line);
@@ -143,7 +302,52 @@ namespace graphite
 			}
 			first = false;
 		}
-		writeLine(headerLine);
+		this->m_sample_column_flags.clear();
+		this->m_column_sample_indices.clear();
+		for (auto& columnName : this->m_vcf_column_names)
+		{
+			this->m_sample_column_flags.emplace_back(STANDARD_VCF_COLUMN_NAMES_SET.find(columnName) == STANDARD_VCF_COLUMN_NAMES_SET.end());
+			auto sampleIter = this->m_bam_sample_ptrs_map.find(columnName);
+			this->m_column_sample_indices.emplace_back((this->m_sample_column_flags.back() && sampleIter != this->m_bam_sample_ptrs_map.end()) ? (int32_t)sampleIter->second->getIndex() : -1);
+		}
+		if (writesHeader)
+		{
+			writeLine(headerLine);
+		}
+	}
+
+	uint64_t VCFWriter::getMaxReferenceLength(const std::vector< std::string >& headerLines)
+	{
+		uint64_t maxReferenceLength = 0;
+		for (auto& line : headerLines)
+		{
+			if (line.compare(0, 9, "##contig=") != 0)
+			{
+				continue;
+			}
+			auto lengthPosition = line.find("length=");
+			if (lengthPosition != std::string::npos)
+			{
+				uint64_t referenceLength = strtoull(line.c_str() + lengthPosition + 7, nullptr, 10);
+				maxReferenceLength = (referenceLength > maxReferenceLength) ? referenceLength : maxReferenceLength;
+			}
+		}
+		return maxReferenceLength;
+	}
+
+	// the supporting read file that goes with an output VCF, in.vcf.gz goes with in.graphite_supporting_read_info.txt
+	std::string VCFWriter::getSupportingReadPath(const std::string& vcfPath)
+	{
+		std::string path = vcfPath;
+		if (path.size() > 3 && path.compare(path.size() - 3, 3, ".gz") == 0)
+		{
+			path.resize(path.size() - 3);
+		}
+		if (path.size() > 4 && path.compare(path.size() - 4, 4, ".vcf") == 0)
+		{
+			path.resize(path.size() - 4);
+		}
+		return path + ".graphite_supporting_read_info.txt";
 	}
 
 	Sample::SharedPtr VCFWriter::getSamplePtr(const std::string& sampleName)
@@ -151,38 +355,22 @@ namespace graphite
 		return this->m_bam_sample_ptrs_map.find(sampleName)->second;
 	}
 
-	std::vector< std::string > VCFWriter::getSampleNames()
+	const std::vector< std::string >& VCFWriter::getSampleNames()
 	{
 		return m_sample_names;
 	}
 
 	bool VCFWriter::isSampleNameInOriginalVCF(const std::string& sampleName)
 	{
-		for (std::string tmpSampleName : this->m_original_vcf_sample_names)
-		{
-			if (sampleName.compare(tmpSampleName) == 0)
-			{
-				return true;
-			}
-		}
-		return false;
+		return (this->m_original_vcf_sample_names.find(sampleName) != this->m_original_vcf_sample_names.end());
 	}
 
 	bool VCFWriter::isSampleNameInBam(const std::string& sampleName)
 	{
-		for (auto iter : m_bam_sample_ptrs_map)
-		{
-			std::string tmpSampleName = iter.first;
-			if (sampleName.compare(tmpSampleName) == 0)
-			{
-				return true;
-			}
-		}
-		return false;
-		// return (m_bam_sample_ptrs_map.find(sampleName) != m_bam_sample_ptrs_map.end());
+		return (this->m_bam_sample_ptrs_map.find(sampleName) != this->m_bam_sample_ptrs_map.end());
 	}
 
-	std::vector< std::string > VCFWriter::getColumnNames()
+	const std::vector< std::string >& VCFWriter::getColumnNames()
 	{
 		return this->m_vcf_column_names;
 	}
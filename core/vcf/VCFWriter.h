@@ -4,6 +4,9 @@
 #define GRAPHITE_VCFWRITER_H
 
 #include "core/util/Noncopyable.hpp"
+#include "core/util/AsyncFileWriter.h"
+#include "IndexedBGZFFileWriter.h"
+#include "Genotyper.h"
 #include "core/sample/Sample.h"
 
 #include <memory>
@@ -20,34 +23,75 @@ namespace graphite
 	{
 	public:
 		typedef std::shared_ptr< VCFWriter > SharedPtr;
-		VCFWriter(const std::string& filename, std::vector< graphite::Sample::SharedPtr >& bamSamplePtrs, const std::string& outputDirectory, bool saveSupportingReadInfo);
+
+		// how far the output had been written at a checkpoint, all 0 for a fresh output
+		struct ResumePoint
+		{
+			ResumePoint() : m_record_count(0), m_record_offset(0), m_byte_count(0), m_supporting_read_byte_count(0) {}
+			uint64_t m_record_count;
+			uint64_t m_record_offset; // in the input VCF, where the record after the last written one starts
+			uint64_t m_byte_count;
+			uint64_t m_supporting_read_byte_count;
+		};
+
+		VCFWriter(const std::string& filename, std::vector< graphite::Sample::SharedPtr >& bamSamplePtrs, const std::string& outputDirectory, bool saveSupportingReadInfo, bool compressOutput, uint32_t compressionThreadCount, const std::string& outputNameSuffix = "", const ResumePoint& resumePoint = ResumePoint());
+		VCFWriter(const std::string& shardPath, std::vector< graphite::Sample::SharedPtr >& bamSamplePtrs, bool saveSupportingReadInfo);
+		VCFWriter(AsyncFileWriter::SharedPtr outFilePtr, std::vector< graphite::Sample::SharedPtr >& bamSamplePtrs);
 		~VCFWriter();
 
+		VCFWriter::SharedPtr createShardWriter(size_t shardIndex);
+		bool appendShard(VCFWriter::SharedPtr shardWriterPtr);
+		bool close();
 		void writeLine(const std::string& line);
+		void writeRecord(const std::string& line, uint64_t nextRecordOffset = 0);
+		void writeSupportingReadLine(const std::string& line);
+		bool flush();
+		bool hasFailed();
+		ResumePoint getResumePoint();
+		std::string getOutputPath() { return this->m_out_path; }
+		uint64_t getRecordCount() { return this->m_record_count; }
         void writeHeader(const std::vector< std::string >& headerLines);
 		Sample::SharedPtr getSamplePtr(const std::string& sampleName);
-		std::vector< std::string > getSampleNames();
-		std::vector< std::string > getColumnNames();
+		const std::vector< std::string >& getSampleNames();
+		const std::vector< std::string >& getColumnNames();
+		bool isSampleColumn(size_t columnIndex) { return columnIndex < this->m_sample_column_flags.size() && this->m_sample_column_flags[columnIndex]; }
+		int32_t getColumnSampleIndex(size_t columnIndex) { return this->m_column_sample_indices[columnIndex]; } // -1 unless the column is a BAM sample
 		bool isSampleNameInOriginalVCF(const std::string& sampleName);
 		bool isSampleNameInBam(const std::string& sampleName);
 		void setBlankFormatString(const std::string& blankFormatString);
 		std::shared_ptr< std::string > getBlankFormatStringPtr();
 		bool getSaveSupportingReadInfo() { return this->m_save_supporting_read_info; }
-		std::ofstream* getSupportingReadOutputStream() { return &this->m_out_supporting_read_file; }
+		void setGenotyper(Genotyper::SharedPtr genotyperPtr) { this->m_genotyper_ptr = genotyperPtr; } // before the header is written
+		Genotyper::SharedPtr getGenotyperPtr() { return this->m_genotyper_ptr; }
         void setOriginalVCFSampleNames(const std::string& headerLine);
 
+		static std::string getSupportingReadPath(const std::string& vcfPath);
+		static uint64_t getMaxReferenceLength(const std::vector< std::string >& headerLines);
+
 	private:
+		void setBamSamplePtrs(std::vector< graphite::Sample::SharedPtr >& bamSamplePtrs);
+
 		std::unordered_set< std::string > m_original_vcf_sample_names;
 		std::string m_base_output_path;
+		std::string m_out_path;
+		std::string m_out_supporting_read_path;
 		bool m_save_supporting_read_info;
+		bool m_is_shard_writer; // shard writers only hold records, the header is written by the writer they are appended to
+		bool m_is_resumed; // the header is already in the output
+		uint64_t m_record_count; // records written, including those of the run this one resumes
+		uint64_t m_next_record_offset; // of the last written record
 		std::vector< Sample::SharedPtr > m_bam_sample_ptrs;
 		std::unordered_map< std::string, bool > m_sample_name_in_vcf;
 		std::vector< std::string > m_vcf_column_names;
+		std::vector< bool > m_sample_column_flags; // indexed like m_vcf_column_names
+		std::vector< int32_t > m_column_sample_indices; // indexed like m_vcf_column_names
 		std::vector< std::string > m_sample_names;
-		std::ofstream m_out_file;
-		std::ofstream m_out_supporting_read_file;
+		AsyncFileWriter::SharedPtr m_out_file_ptr;
+		IndexedBGZFFileWriter::SharedPtr m_out_bgzf_file_ptr; // set when the output is compressed, shares m_out_file_ptr
+		AsyncFileWriter::SharedPtr m_out_supporting_read_file_ptr;
 		std::shared_ptr< std::string > m_black_format_string;
 		std::unordered_map< std::string, Sample::SharedPtr > m_bam_sample_ptrs_map;
+		Genotyper::SharedPtr m_genotyper_ptr; // set when records carry genotypes
 		std::vector< std::tuple< std::string, std::string > > m_format = {std::make_tuple("ID=DP_NFP", "##FORMAT=<ID=DP_NFP,Number=1,Type=Integer,Description=\"Read count at 95 percent Smith Waterman score or above\">"),
 																		  std::make_tuple("ID=DP_NP", "##FORMAT=<ID=DP_NP,Number=1,Type=Integer,Description=\"Read count between 90 and 94 percent Smith Waterman score\">"),
 																		  std::make_tuple("ID=DP_EP", "##FORMAT=<ID=DP_EP,Number=1,Type=Integer,Description=\"Read count between 80 and 89 percent Smith Waterman score\">"),
@@ -11,83 +11,119 @@ namespace graphite
 	Variant::Variant(const std::string& variantLine, VCFWriter::SharedPtr vcfWriterPtr) :
 		m_variant_line(variantLine),
 		m_vcf_writer_ptr(vcfWriterPtr),
-		m_skip_adjudication(false)
+		m_skip_adjudication(false),
+		m_next_record_offset(0)
 	{
 		parseColumns();
 		setAlleles();
 	}
 
+	// a record that isn't read from or written to a VCF, it only carries what adjudication needs
+	Variant::Variant(const std::string& chromosome, position variantPosition, const std::string& referenceSequence, const std::vector< std::string >& alternateSequences) :
+		m_vcf_writer_ptr(nullptr),
+		m_chrom(chromosome),
+		m_position(variantPosition),
+		m_skip_adjudication(false),
+		m_next_record_offset(0)
+	{
+		std::string alternateColumn;
+		for (auto& alternateSequence : alternateSequences)
+		{
+			alternateColumn += ((alternateColumn.size() > 0) ? "," : "") + alternateSequence;
+		}
+		this->m_columns.emplace("#CHROM", chromosome);
+		this->m_columns.emplace("POS", std::to_string(variantPosition));
+		this->m_columns.emplace("REF", referenceSequence);
+		this->m_columns.emplace("ALT", alternateColumn);
+		setAlleles();
+	}
+
 	Variant::~Variant()
 	{
 	}
 
 	void Variant::writeVariant()
 	{
-		std::string vcfLine = "";
-		auto columnNames = m_vcf_writer_ptr->getColumnNames();
-		processSampleColumns();
+		static thread_local std::string vcfLine; // reused for every record this thread writes
+		vcfLine.clear();
+		const std::string& formatColumn = m_columns["FORMAT"];
+		size_t colonCount = std::count(formatColumn.begin(), formatColumn.end(), ':');
+		const char* divider = (formatColumn.size() > 0) ? ":" : "";
+		const auto& columnNames = m_vcf_writer_ptr->getColumnNames();
+		auto genotyperPtr = this->m_vcf_writer_ptr->getGenotyperPtr();
 		for (auto i = 0; i < columnNames.size(); ++i)
 		{
 			if (i > 0)
 			{
-				vcfLine += "\t";
+				vcfLine.push_back('\t');
 			}
-			auto columnName = columnNames[i];
+			const std::string& columnName = columnNames[i];
 			vcfLine += m_columns[columnName];
+			if (this->m_vcf_writer_ptr->isSampleColumn(i))
+			{
+				if (!this->m_vcf_writer_ptr->isSampleNameInOriginalVCF(columnName))
+				{
+					if (formatColumn.size() > 0)
+					{
+						vcfLine += ".:";
+					}
+					for (auto j = 0; j < colonCount; ++j)
+					{
+						vcfLine += ".:";
+					}
+				}
+				else
+				{
+					vcfLine += divider;
+				}
+				int32_t sampleIndex = this->m_vcf_writer_ptr->getColumnSampleIndex(i);
+				if (sampleIndex >= 0) // the sample's reads were adjudicated
+				{
+					appendSampleCounts(vcfLine, sampleIndex);
+					if (genotyperPtr != nullptr)
+					{
+						vcfLine.push_back(':');
+						appendGenotype(vcfLine, sampleIndex, genotyperPtr);
+					}
+				}
+				else
+				{
+					vcfLine += m_blank_graphite_format;
+					if (genotyperPtr != nullptr)
+					{
+						vcfLine += ":./.:.:."; // a missing diploid genotype, the same as an adjudicated sample without reads
+					}
+				}
+			}
+			else if (columnName.compare("FORMAT") == 0)
+			{
+				vcfLine += divider;
+				vcfLine += "DP_NFP:DP4_NFP:DP_NP:DP4_NP:DP_EP:DP4_EP:DP_SP:DP4_SP:DP_LP:DP4_LP:DP_AP:DP2_AP:SEM";
+				if (genotyperPtr != nullptr)
+				{
+					vcfLine.push_back(':');
+					vcfLine += Genotyper::getFormatKeys();
+				}
+			}
 		}
 		if (this->m_vcf_writer_ptr->getSaveSupportingReadInfo())
 		{
-			std::ofstream* outPtr = this->m_vcf_writer_ptr->getSupportingReadOutputStream();
 			std::string token = "\t";
 			std::string variantInfo = this->m_chrom + token + std::to_string(this->m_position);
 			for (auto refAlleleSupportingReadInfo : this->m_reference_allele_ptr->getSupportingReadInfoPtrs())
 			{
-				(*outPtr) << variantInfo << token << this->m_reference_allele_ptr->getSequence() << token << refAlleleSupportingReadInfo->toString(token) << std::endl;
+				this->m_vcf_writer_ptr->writeSupportingReadLine(variantInfo + token + this->m_reference_allele_ptr->getSequence() + token + refAlleleSupportingReadInfo->toString(token));
 			}
 			for (auto altAllelePtr : this->m_alternate_allele_ptrs)
 			{
-				// (*outPtr) << "" << this->m_chrom << "\t" << this->m_position << "\t" << altAllelePtr->getSequence() << std::endl;
 				for (auto altAlleleSupportingReadInfo : altAllelePtr->getSupportingReadInfoPtrs())
 				{
-					// (*outPtr) << altAlleleSupportingReadInfo->toString("\t") << std::endl;
-					(*outPtr) << variantInfo << token << altAllelePtr->getSequence() << token << altAlleleSupportingReadInfo->toString(token) << std::endl;
+					this->m_vcf_writer_ptr->writeSupportingReadLine(variantInfo + token + altAllelePtr->getSequence() + token + altAlleleSupportingReadInfo->toString(token));
 				}
 			}
 		}
 
-		this->m_vcf_writer_ptr->writeLine(vcfLine);
-	}
-
-	void Variant::processSampleColumns()
-	{
-		size_t colonCount = std::count(m_columns["FORMAT"].begin(), m_columns["FORMAT"].end(), ':');
-		std::string divider = "";
-		std::string missingSamplePrefix = "";
-		if (m_columns["FORMAT"].size() > 0)
-		{
-			divider = ":";
-			missingSamplePrefix = ".:";
-		}
-		for (auto i = 0; i < colonCount; ++i)
-		{
-			missingSamplePrefix += ".:";
-		}
-		m_columns["FORMAT"] += divider + "DP_NFP:DP4_NFP:DP_NP:DP4_NP:DP_EP:DP4_EP:DP_SP:DP4_SP:DP_LP:DP4_LP:DP_AP:DP2_AP:SEM";
-		for (auto& sampleName : this->m_vcf_writer_ptr->getSampleNames())
-		{
-			std::string column = m_columns[sampleName];
-			std::string graphiteCounts = (this->m_vcf_writer_ptr->isSampleNameInBam(sampleName)) ? getSampleCounts(sampleName) : m_blank_graphite_format;
-			if (!this->m_vcf_writer_ptr->isSampleNameInOriginalVCF(sampleName))
-			{
-				column += missingSamplePrefix;
-			}
-			else
-			{
-				column += divider;
-			}
-			column += graphiteCounts;
-			m_columns[sampleName] = column;
-		}
+		this->m_vcf_writer_ptr->writeRecord(vcfLine, this->m_next_record_offset);
 	}
 
 	void Variant::parseColumns()
@@ -95,7 +131,7 @@ namespace graphite
 		m_columns.clear();
 		std::vector< std::string > columns;
 		split(this->m_variant_line, '\t', columns);
-		auto columnNames = this->m_vcf_writer_ptr->getColumnNames();
+		const auto& columnNames = this->m_vcf_writer_ptr->getColumnNames();
 		int columnDiff = columns.size() - columnNames.size();
 		for (auto i = 0; i < columnNames.size(); ++i)
 		{
@@ -145,80 +181,102 @@ namespace graphite
 		}
 	}
 
-	std::string Variant::getSampleCounts(const std::string& sampleName)
+	// appends DP_NFP:DP4_NFP:...:DP2_AP:SEM for the sample straight onto the record buffer
+	void Variant::appendSampleCounts(std::string& buffer, uint32_t sampleIndex)
 	{
-		std::string semanticString = "{";
-		std::string graphiteCountsString = "";
+		static thread_local std::string semanticString;
+		semanticString.clear();
+		semanticString.push_back('{');
 		AlleleCountType alleleCountType = AlleleCountType::NinteyFivePercent;
+		bool first = true;
 		while (alleleCountType != AlleleCountType::EndEnum)
 		{
-			uint32_t totalCounter = 0;
-			std::unordered_set< std::string > forwardScoreCount;
-			std::unordered_set< std::string > reverseScoreCount;
-			std::unordered_set< std::string > forwardScoreCountTmp = this->m_reference_allele_ptr->getScoreCountFromAlleleCountType(sampleName, alleleCountType, true);
-			std::unordered_set< std::string > reverseScoreCountTmp = this->m_reference_allele_ptr->getScoreCountFromAlleleCountType(sampleName, alleleCountType, false);
-			forwardScoreCount.insert(forwardScoreCountTmp.begin(), forwardScoreCountTmp.end());
-			reverseScoreCount.insert(reverseScoreCountTmp.begin(), reverseScoreCountTmp.end());
-			totalCounter += forwardScoreCount.size() + reverseScoreCount.size();
-			std::string tmpCountsString = std::to_string(forwardScoreCount.size()) + "," + std::to_string(reverseScoreCount.size());
-			uint32_t ambiguousForwardCount = 0;
-			uint32_t ambiguousReverseCount = 0;
-			if (alleleCountType == AlleleCountType::Ambiguous)
+			uint32_t referenceForwardCount = this->m_reference_allele_ptr->getScoreCount(sampleIndex, alleleCountType, true);
+			uint32_t referenceReverseCount = this->m_reference_allele_ptr->getScoreCount(sampleIndex, alleleCountType, false);
+			uint32_t totalCounter = referenceForwardCount + referenceReverseCount;
+			uint32_t ambiguousForwardCount = referenceForwardCount;
+			uint32_t ambiguousReverseCount = referenceReverseCount;
+			for (auto& allelePtr : this->m_alternate_allele_ptrs)
 			{
-				ambiguousForwardCount = forwardScoreCount.size();
-				ambiguousReverseCount = reverseScoreCount.size();
-			}
-			for (auto allelePtr : this->m_alternate_allele_ptrs)
-			{
-				forwardScoreCount = allelePtr->getScoreCountFromAlleleCountType(sampleName, alleleCountType, true);
-				reverseScoreCount = allelePtr->getScoreCountFromAlleleCountType(sampleName, alleleCountType, false);
-				if (alleleCountType == AlleleCountType::Ambiguous)
-				{
-					ambiguousForwardCount += forwardScoreCount.size();
-					ambiguousReverseCount += reverseScoreCount.size();
-				}
-				tmpCountsString += ",";
-				tmpCountsString += std::to_string(forwardScoreCount.size()) + "," + std::to_string(reverseScoreCount.size());
-				totalCounter += forwardScoreCount.size() + reverseScoreCount.size();
-				for (auto semanticIter : allelePtr->getSemanticLocations())
+				uint32_t forwardCount = allelePtr->getScoreCount(sampleIndex, alleleCountType, true);
+				uint32_t reverseCount = allelePtr->getScoreCount(sampleIndex, alleleCountType, false);
+				ambiguousForwardCount += forwardCount;
+				ambiguousReverseCount += reverseCount;
+				totalCounter += forwardCount + reverseCount;
+				for (auto& semanticIter : allelePtr->getSemanticLocations())
 				{
 					if (this->m_printed_semantics.find(semanticIter.first) != this->m_printed_semantics.end())
 					{
 						continue;
 					}
 					this->m_printed_semantics.emplace(semanticIter.first);
-					semanticString += std::to_string(semanticIter.first) + "(";
+					appendUnsignedInteger(semanticString, semanticIter.first);
+					semanticString.push_back('(');
 					int semanticCount = 0;
-					for (auto semanticSequenceIter : semanticIter.second)
+					for (auto& semanticSequence : semanticIter.second)
 					{
-						std::vector< std::string > alleles;
-						split(semanticSequenceIter, ':', alleles);
-						std::string sequences = alleles[0] + "=>" + alleles[1];
-						semanticString += (semanticCount++ == 0) ? sequences : "," + sequences;
+						if (semanticCount++ > 0)
+						{
+							semanticString.push_back(',');
+						}
+						size_t separator = semanticSequence.find(':');
+						semanticString.append(semanticSequence, 0, separator);
+						semanticString += "=>";
+						semanticString.append(semanticSequence, separator + 1, std::string::npos);
 					}
-					semanticString += ")";
+					semanticString.push_back(')');
 				}
 			}
-			if (!graphiteCountsString.empty())
+			if (!first)
 			{
-				graphiteCountsString += ":";
+				buffer.push_back(':');
 			}
-			if (alleleCountType == AlleleCountType::Ambiguous)
+			first = false;
+			appendUnsignedInteger(buffer, totalCounter);
+			buffer.push_back(':');
+			if (alleleCountType == AlleleCountType::Ambiguous) // ambiguous reads are reported as a single forward,reverse pair
+			{
+				appendUnsignedInteger(buffer, ambiguousForwardCount);
+				buffer.push_back(',');
+				appendUnsignedInteger(buffer, ambiguousReverseCount);
+			}
+			else
 			{
-				tmpCountsString = std::to_string(ambiguousForwardCount) + "," + std::to_string(ambiguousReverseCount);
+				appendUnsignedInteger(buffer, referenceForwardCount);
+				buffer.push_back(',');
+				appendUnsignedInteger(buffer, referenceReverseCount);
+				for (auto& allelePtr : this->m_alternate_allele_ptrs)
+				{
+					buffer.push_back(',');
+					appendUnsignedInteger(buffer, allelePtr->getScoreCount(sampleIndex, alleleCountType, true));
+					buffer.push_back(',');
+					appendUnsignedInteger(buffer, allelePtr->getScoreCount(sampleIndex, alleleCountType, false));
+				}
 			}
-			graphiteCountsString += std::to_string(totalCounter) + ":" + tmpCountsString;
 			alleleCountType = (AlleleCountType)((uint32_t)alleleCountType + 1);
 		}
+		buffer.push_back(':');
 		if (semanticString.size() == 1) // if we didn't set any semantic alleles above
 		{
-			semanticString = ".";
+			buffer.push_back('.');
 		}
 		else
 		{
-			semanticString += "}";
+			buffer += semanticString;
+			buffer.push_back('}');
+		}
+	}
+
+	// GT_NFP:GQ_NFP:PL_NFP from the same reads that are counted in DP4_NFP
+	void Variant::appendGenotype(std::string& buffer, uint32_t sampleIndex, Genotyper::SharedPtr genotyperPtr)
+	{
+		static thread_local std::vector< uint32_t > alleleCounts;
+		alleleCounts.clear();
+		alleleCounts.emplace_back(this->m_reference_allele_ptr->getScoreCount(sampleIndex, AlleleCountType::NinteyFivePercent, true) + this->m_reference_allele_ptr->getScoreCount(sampleIndex, AlleleCountType::NinteyFivePercent, false));
+		for (auto& allelePtr : this->m_alternate_allele_ptrs)
+		{
+			alleleCounts.emplace_back(allelePtr->getScoreCount(sampleIndex, AlleleCountType::NinteyFivePercent, true) + allelePtr->getScoreCount(sampleIndex, AlleleCountType::NinteyFivePercent, false));
 		}
-		graphiteCountsString += ":" + semanticString;
-		return graphiteCountsString;
+		genotyperPtr->appendGenotype(buffer, alleleCounts.data(), alleleCounts.size());
 	}
 }
@@ -17,6 +17,7 @@ namespace graphite
 	public:
 		typedef std::shared_ptr< Variant > SharedPtr;
 		Variant(const std::string& variantLine, VCFWriter::SharedPtr vcfWriterPtr);
+		Variant(const std::string& chromosome, position variantPosition, const std::string& referenceSequence, const std::vector< std::string >& alternateSequences);
 		~Variant();
 
 		std::string getChromosome() { return m_chrom; }
@@ -25,12 +26,13 @@ namespace graphite
 		std::vector< Allele::SharedPtr > getAlternateAllelePtrs() { return this->m_alternate_allele_ptrs; }
 
 		void writeVariant();
+		void setNextRecordOffset(uint64_t nextRecordOffset) { this->m_next_record_offset = nextRecordOffset; } // where the VCF's next record starts, see VCFReader::resume
 
 	private:
-		void processSampleColumns();
 		void parseColumns();
 		void setAlleles();
-		std::string getSampleCounts(const std::string& sampleName);
+		void appendSampleCounts(std::string& buffer, uint32_t sampleIndex);
+		void appendGenotype(std::string& buffer, uint32_t sampleIndex, Genotyper::SharedPtr genotyperPtr);
 		/* std::vector< Node::SharedPtr > getReferenceNodePtrs(); */
 
 		VCFWriter::SharedPtr m_vcf_writer_ptr;
@@ -42,6 +44,7 @@ namespace graphite
 		Allele::SharedPtr m_reference_allele_ptr; // make sure to figure out  a way to keep track of breaking up the alleles
 		std::vector< Allele::SharedPtr > m_alternate_allele_ptrs;
 		bool m_skip_adjudication;
+		uint64_t m_next_record_offset;
 		std::unordered_set< int > m_printed_semantics;
 
 	};
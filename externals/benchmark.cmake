@@ -0,0 +1,54 @@
+#  For more information, please see: http://software.sci.utah.edu
+# 
+#  The MIT License
+# 
+#  Copyright (c) 2015 Scientific Computing and Imaging Institute,
+#  University of Utah.
+# 
+#  
+#  Permission is hereby granted, free of charge, to any person obtaining a
+#  copy of this software and associated documentation files (the "Software"),
+#  to deal in the Software without restriction, including without limitation
+#  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+#  and/or sell copies of the Software, and to permit persons to whom the
+#  Software is furnished to do so, subject to the following conditions:
+# 
+#  The above copyright notice and this permission notice shall be included
+#  in all copies or substantial portions of the Software. 
+# 
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+#  OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+#  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+#  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+#  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+#  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+#  DEALINGS IN THE SOFTWARE.
+
+# Setting up external library gtest, we don't build it because we only need the include directories
+# Setting up external library google benchmark, only used by the graphite_bench microbenchmarks
+
+SET_PROPERTY(DIRECTORY PROPERTY "EP_BASE" ${ep_base})
+
+SET(BENCHMARK_PROJECT benchmark_project CACHE INTERNAL "benchmark project name")
+SET(BENCHMARK_DIR ${CMAKE_BINARY_DIR}/externals/benchmark CACHE INTERNAL "benchmark project directory")
+SET(BENCHMARK_LIB)
+ExternalProject_Add(${BENCHMARK_PROJECT}
+	GIT_REPOSITORY https://github.com/google/benchmark.git
+	GIT_TAG v1.5.0 #lock in the release so this doesn't break in the future, it is the last one that builds with C++11 compilers we support
+	INSTALL_COMMAND ""
+	UPDATE_COMMAND ""
+	PREFIX ${BENCHMARK_DIR}
+    CMAKE_CACHE_ARGS
+        -DCMAKE_C_COMPILER:STRING=${CMAKE_C_COMPILER}
+        -DCMAKE_CXX_COMPILER:STRING=${CMAKE_CXX_COMPILER}
+        -DCMAKE_BUILD_TYPE:STRING=Release
+        -DBENCHMARK_ENABLE_TESTING:BOOL=OFF
+        -DBENCHMARK_ENABLE_GTEST_TESTS:BOOL=OFF
+)
+
+ExternalProject_Get_Property(${BENCHMARK_PROJECT} INSTALL_DIR)
+ExternalProject_Get_Property(${BENCHMARK_PROJECT} SOURCE_DIR)
+ExternalProject_Get_Property(${BENCHMARK_PROJECT} BINARY_DIR)
+
+SET(BENCHMARK_LIB ${BINARY_DIR}/src/libbenchmark.a CACHE INTERNAL "BENCHMARK Lib")
+SET(BENCHMARK_INCLUDE ${SOURCE_DIR}/include/ CACHE INTERNAL "BENCHMARK Include")
@@ -0,0 +1,246 @@
+"""
+Compares the outputs of two graphite runs field by field, to check that a
+change to the adjudication path (the aligner, the counting, the threading)
+didn't change the read counts. Either two existing output directories (or
+two VCFs) are compared, or with --graphite_a and --graphite_b both builds
+are run on the same arguments first. VCF records are matched on
+CHROM/POS/REF/ALT, in file order when a VCF repeats a record, and their
+INFO and sample fields are compared key by key. Supporting read files are
+compared per variant allele without regard to line order, since reads are
+written in the order their tasks finish. Both files are read side by side
+a position at a time, so outputs that match are compared in little memory.
+Differences are grouped into clusters of nearby records and the first
+clusters are reported.
+"""
+import sys, os, argparse, subprocess, gzip, glob
+from collections import Counter, OrderedDict
+
+
+def open_text(path):
+    return gzip.open(path, 'rt') if path.endswith('.gz') else open(path)
+
+
+def read_vcf_groups(path):
+    # yields the records of one position at a time, as (CHROM, POS) and a list of ((REF, ALT), fields) in file order
+    samples = []
+    group_key = None
+    group = []
+    with open_text(path) as vcf_file:
+        for line in vcf_file:
+            line = line.rstrip('\n')
+            if line.startswith('##'):
+                continue
+            columns = line.split('\t')
+            if line.startswith('#'):
+                samples = columns[9:]
+                continue
+            format_keys = columns[8].split(':') if len(columns) > 8 else []
+            fields = OrderedDict()
+            fields['QUAL'] = columns[5]
+            fields['FILTER'] = columns[6]
+            for entry in columns[7].split(';'):
+                key, _, value = entry.partition('=')
+                fields['INFO/' + key] = value
+            for sample, sample_column in zip(samples, columns[9:]):
+                for key, value in zip(format_keys, sample_column.split(':')):
+                    fields[sample + '/' + key] = value
+            key = (columns[0], int(columns[1]))
+            if key != group_key and len(group) > 0:
+                yield group_key, group
+                group = []
+            group_key = key
+            group.append(((columns[3], columns[4]), fields))
+    if len(group) > 0:
+        yield group_key, group
+
+
+def read_supporting_read_groups(path):
+    # yields the reads of one position at a time, graphite writes a variant's reads together
+    group_key = None
+    group = {}
+    with open(path) as supporting_read_file:
+        next(supporting_read_file, None) # the header
+        for line in supporting_read_file:
+            columns = line.rstrip('\n').split('\t')
+            key = (columns[0], int(columns[1]))
+            if key != group_key and len(group) > 0:
+                yield group_key, group
+                group = {}
+            group_key = key
+            group.setdefault(columns[2], Counter())['\t'.join(columns[3:])] += 1
+    if len(group) > 0:
+        yield group_key, group
+
+
+def match_groups(groups_a, groups_b, diff_groups):
+    # walks both files side by side, a position is held only until the other file reaches it so matching outputs take little memory
+    pending_a = {}
+    pending_b = {}
+    differences = []
+    group_counts = [0, 0]
+    iterators = [iter(groups_a), iter(groups_b)]
+    while iterators[0] is not None or iterators[1] is not None:
+        for side, (pending, other_pending) in enumerate(((pending_a, pending_b), (pending_b, pending_a))):
+            if iterators[side] is None:
+                continue
+            group_key, group = next(iterators[side], (None, None))
+            if group_key is None:
+                iterators[side] = None
+                continue
+            group_counts[side] += 1
+            if group_key in pending: # the same position further down the file
+                pending[group_key] = merge_groups(pending[group_key], group)
+            elif group_key in other_pending:
+                other_group = other_pending.pop(group_key)
+                group_a, group_b = (group, other_group) if side == 0 else (other_group, group)
+                differences.extend(diff_groups(group_key, group_a, group_b))
+            else:
+                pending[group_key] = group
+    for group_key, group in pending_a.items():
+        differences.extend(diff_groups(group_key, group, type(group)()))
+    for group_key, group in pending_b.items():
+        differences.extend(diff_groups(group_key, type(group)(), group))
+    return differences
+
+
+def merge_groups(group, other_group):
+    if isinstance(group, list):
+        return group + other_group
+    for allele, reads in other_group.items():
+        group.setdefault(allele, Counter()).update(reads)
+    return group
+
+
+def diff_vcf_groups(group_key, records_a, records_b, ignored_keys):
+    # records with the same CHROM/POS/REF/ALT are matched in file order
+    chrom, position = group_key
+    alleles_a = OrderedDict()
+    alleles_b = OrderedDict()
+    for alleles, records in ((alleles_a, records_a), (alleles_b, records_b)):
+        for allele_key, fields in records:
+            alleles.setdefault(allele_key, []).append(fields)
+    differences = []
+    for allele_key in list(alleles_a) + [allele_key for allele_key in alleles_b if allele_key not in alleles_a]:
+        fields_list_a = alleles_a.get(allele_key, [])
+        fields_list_b = alleles_b.get(allele_key, [])
+        for fields_a, fields_b in zip(fields_list_a, fields_list_b):
+            for field in list(fields_a) + [field for field in fields_b if field not in fields_a]:
+                if field.split('/')[-1] in ignored_keys:
+                    continue
+                if fields_a.get(field) != fields_b.get(field):
+                    differences.append((chrom, position, '%s>%s %s: %s != %s' % (allele_key[0], allele_key[1], field, fields_a.get(field), fields_b.get(field))))
+        if len(fields_list_a) != len(fields_list_b):
+            extra_count = abs(len(fields_list_a) - len(fields_list_b))
+            differences.append((chrom, position, '%s>%s %s only in %s' % (allele_key[0], allele_key[1], 'once' if extra_count == 1 else '%d times' % extra_count, 'a' if len(fields_list_a) > len(fields_list_b) else 'b')))
+    return differences
+
+
+def diff_vcfs(path_a, path_b, ignored_keys):
+    record_count = [0]
+    def count_records(groups):
+        for group_key, group in groups:
+            record_count[0] += len(group)
+            yield group_key, group
+    differences = match_groups(count_records(read_vcf_groups(path_a)), read_vcf_groups(path_b), lambda group_key, group_a, group_b: diff_vcf_groups(group_key, group_a, group_b, ignored_keys))
+    return record_count[0], differences
+
+
+def diff_supporting_read_groups(group_key, alleles_a, alleles_b):
+    differences = []
+    for allele in sorted(set(alleles_a) | set(alleles_b)):
+        reads_a = alleles_a.get(allele, Counter())
+        reads_b = alleles_b.get(allele, Counter())
+        only_a = reads_a - reads_b
+        only_b = reads_b - reads_a
+        if len(only_a) > 0 or len(only_b) > 0:
+            example = next(iter(only_a or only_b)).split('\t')
+            differences.append((group_key[0], group_key[1], '%s supporting reads: %d only in a, %d only in b (e.g. %s in %s)' % (allele, sum(only_a.values()), sum(only_b.values()), example[1] if len(example) > 1 else example[0], 'a' if only_a else 'b')))
+    return differences
+
+
+def diff_supporting_reads(path_a, path_b):
+    return match_groups(read_supporting_read_groups(path_a), read_supporting_read_groups(path_b), diff_supporting_read_groups)
+
+
+def report_clusters(name, differences, cluster_distance, max_clusters):
+    # differences within cluster_distance of each other were most likely adjudicated in the same graph
+    clusters = []
+    for chrom, position, description in sorted(differences, key=lambda difference: (difference[0], difference[1])):
+        if len(clusters) > 0 and clusters[-1]['chrom'] == chrom and position - clusters[-1]['end'] <= cluster_distance:
+            clusters[-1]['end'] = position
+            clusters[-1]['descriptions'].append(description)
+        else:
+            clusters.append({'chrom': chrom, 'start': position, 'end': position, 'descriptions': [description]})
+    print('%s: %d differences in %d clusters' % (name, len(differences), len(clusters)))
+    for cluster in clusters[:max_clusters]:
+        print('  %s:%d-%d (%d differences)' % (cluster['chrom'], cluster['start'], cluster['end'], len(cluster['descriptions'])))
+        for description in cluster['descriptions'][:3]:
+            print('    ' + description)
+    if len(clusters) > max_clusters:
+        print('  ... %d more clusters' % (len(clusters) - max_clusters))
+
+
+def get_supporting_read_path(vcf_path):
+    path = vcf_path[:-3] if vcf_path.endswith('.gz') else vcf_path
+    path = path[:-4] if path.endswith('.vcf') else path
+    return path + '.graphite_supporting_read_info.txt'
+
+
+def get_output_vcf_paths(path):
+    if not os.path.isdir(path):
+        return {os.path.basename(path): path}
+    vcf_paths = glob.glob(os.path.join(path, '*.vcf')) + glob.glob(os.path.join(path, '*.vcf.gz'))
+    return dict((os.path.basename(vcf_path), vcf_path) for vcf_path in vcf_paths)
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description='Compare the output VCFs and supporting read files of two graphite runs, other arguments are passed on to graphite', add_help=True)
+    parser.add_argument('--output_a', action="store", dest="a", required=True, help="Output directory (or VCF) of the first run, written to when --graphite_a is given")
+    parser.add_argument('--output_b', action="store", dest="b", required=True, help="Output directory (or VCF) of the second run, written to when --graphite_b is given")
+    parser.add_argument('--graphite_a', action="store", dest="graphite_a", help="Run this graphite binary with the remaining arguments into --output_a first")
+    parser.add_argument('--graphite_b', action="store", dest="graphite_b", help="Run this graphite binary with the remaining arguments into --output_b first")
+    parser.add_argument('--ignore', action="store", dest="ignore", default='', help="Comma separated INFO and FORMAT keys that are not compared, e.g. SEM")
+    parser.add_argument('--cluster_distance', action="store", dest="cluster_distance", type=int, default=150, help="Differences closer than this are reported as one cluster, about the read length")
+    parser.add_argument('--max_clusters', action="store", dest="max_clusters", type=int, default=10, help="Clusters reported per file")
+    results, graphite_args = parser.parse_known_args(argv)
+
+    for graphite, output_directory in ((results.graphite_a, results.a), (results.graphite_b, results.b)):
+        if graphite is not None:
+            if not os.path.isdir(output_directory):
+                os.makedirs(output_directory)
+            subprocess.check_call([graphite] + graphite_args + ['-o', output_directory])
+
+    ignored_keys = set(key for key in results.ignore.split(',') if len(key) > 0)
+    vcf_paths_a = get_output_vcf_paths(results.a)
+    vcf_paths_b = get_output_vcf_paths(results.b)
+    if not os.path.isdir(results.a) and not os.path.isdir(results.b): # two files are compared whatever their names
+        vcf_paths_b = {os.path.basename(results.a): results.b}
+    is_equal = len(vcf_paths_a) > 0 and set(vcf_paths_a) == set(vcf_paths_b)
+    for name in sorted(set(vcf_paths_a) ^ set(vcf_paths_b)):
+        print('%s: only in %s' % (name, 'a' if name in vcf_paths_a else 'b'))
+    for name in sorted(set(vcf_paths_a) & set(vcf_paths_b)):
+        record_count, differences = diff_vcfs(vcf_paths_a[name], vcf_paths_b[name], ignored_keys)
+        if len(differences) > 0:
+            report_clusters(name, differences, results.cluster_distance, results.max_clusters)
+            is_equal = False
+        else:
+            print('%s: %d records match' % (name, record_count))
+        supporting_read_path_a = get_supporting_read_path(vcf_paths_a[name])
+        supporting_read_path_b = get_supporting_read_path(vcf_paths_b[name])
+        if os.path.exists(supporting_read_path_a) != os.path.exists(supporting_read_path_b):
+            print('%s: only in %s' % (os.path.basename(supporting_read_path_a), 'a' if os.path.exists(supporting_read_path_a) else 'b'))
+            is_equal = False
+        elif os.path.exists(supporting_read_path_a):
+            differences = diff_supporting_reads(supporting_read_path_a, supporting_read_path_b)
+            if len(differences) > 0:
+                report_clusters(os.path.basename(supporting_read_path_a), differences, results.cluster_distance, results.max_clusters)
+                is_equal = False
+            else:
+                print('%s: supporting reads match' % os.path.basename(supporting_read_path_a))
+    if not is_equal:
+        sys.exit('the outputs differ')
+    print('the outputs match')
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
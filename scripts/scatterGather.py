@@ -0,0 +1,60 @@
+"""
+Runs graphite as N --shard processes on this machine and joins them with
+graphite merge, the same scatter/gather a cluster run does. With --compare
+an unsharded run is made as well and the two outputs are compared.
+"""
+import sys, os, argparse, subprocess, filecmp, glob
+
+
+def run_shards(graphite, graphite_args, shard_count, output_directory):
+    processes = []
+    for shard_index in range(shard_count):
+        command = [graphite] + graphite_args + ['-o', output_directory, '--shard', '%d/%d' % (shard_index, shard_count)]
+        processes.append(subprocess.Popen(command))
+    failed = [shard_index for shard_index, process in enumerate(processes) if process.wait() != 0]
+    if len(failed) > 0:
+        sys.exit('shard runs failed: %s' % failed)
+
+
+def merge_shards(graphite, vcf_path, shard_count, output_directory, merged_path):
+    vcf_name = os.path.basename(vcf_path)
+    if vcf_name.endswith('.gz'):
+        vcf_name = vcf_name[:-3]
+    stem = vcf_name[:-4] if vcf_name.endswith('.vcf') else vcf_name
+    shard_paths = glob.glob(os.path.join(output_directory, stem + '.shard_*_of_%d.vcf*' % shard_count))
+    shard_paths = [p for p in shard_paths if not p.endswith('.tbi') and not p.endswith('.csi')]
+    subprocess.check_call([graphite, 'merge', '-o', merged_path, '-v'] + shard_paths)
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description='Run graphite as local shard processes and merge them', add_help=True)
+    parser.add_argument('-g', '--graphite', action="store", dest="graphite", default='graphite', help="Path to the graphite binary")
+    parser.add_argument('-n', '--shard_count', action="store", dest="shard_count", type=int, required=True, help="Number of shard processes")
+    parser.add_argument('-v', '--vcf', action="store", dest="vcf", required=True, help="Input VCF, passed on to graphite")
+    parser.add_argument('-o', '--output_directory', action="store", dest="output_directory", required=True)
+    parser.add_argument('--compare', action="store_true", dest="compare", help="Also run graphite unsharded and compare the outputs")
+    results, graphite_args = parser.parse_known_args(argv)
+    graphite_args = ['-v', results.vcf] + graphite_args
+
+    shard_directory = os.path.join(results.output_directory, 'shards')
+    if not os.path.isdir(shard_directory):
+        os.makedirs(shard_directory)
+    run_shards(results.graphite, graphite_args, results.shard_count, shard_directory)
+    merged_path = os.path.join(results.output_directory, 'merged.vcf')
+    merge_shards(results.graphite, results.vcf, results.shard_count, shard_directory, merged_path)
+    print('merged: ' + merged_path)
+
+    if results.compare:
+        single_directory = os.path.join(results.output_directory, 'single')
+        if not os.path.isdir(single_directory):
+            os.makedirs(single_directory)
+        subprocess.check_call([results.graphite] + graphite_args + ['-o', single_directory])
+        single_path = glob.glob(os.path.join(single_directory, '*.vcf'))[0]
+        if filecmp.cmp(single_path, merged_path, shallow=False):
+            print('merged output matches the unsharded run')
+        else:
+            sys.exit('merged output differs from the unsharded run: %s %s' % (single_path, merged_path))
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
@@ -0,0 +1,92 @@
+"""
+Runs graphite end to end on synthetic datasets written by graphite_simulate
+at several thread counts and reports variants/sec, reads/sec and peak RSS
+of every run, read from graphite's --report. Strong scaling runs the same
+dataset at every thread count, weak scaling grows the dataset with the
+thread count (one set of contigs per thread). Datasets are kept in the work
+directory and reused by later runs with the same options.
+"""
+import sys, os, argparse, subprocess, json
+
+
+def simulate(results, contig_count):
+    dataset_directory = os.path.join(results.work_directory, 'data_%dx%d_d%s_c%s_r%d_s%d' % (contig_count, results.contig_length, results.density, results.coverage, results.read_length, results.seed))
+    if not os.path.exists(os.path.join(dataset_directory, 'sample.bam.bai')):
+        subprocess.check_call([results.simulate, '-o', dataset_directory, '--contigs', str(contig_count), '--contig_length', str(results.contig_length),
+                               '--density', str(results.density), '--coverage', str(results.coverage), '--read_length', str(results.read_length), '--seed', str(results.seed)])
+    return dataset_directory
+
+
+def run_graphite(results, dataset_directory, thread_count, run_name):
+    output_directory = os.path.join(results.work_directory, 'runs', run_name)
+    if not os.path.isdir(output_directory):
+        os.makedirs(output_directory)
+    report_path = os.path.join(output_directory, 'report.json')
+    command = [results.graphite, '-f', os.path.join(dataset_directory, 'reference.fa'), '-b', os.path.join(dataset_directory, 'sample.bam'),
+               '-v', os.path.join(dataset_directory, 'variants.vcf'), '-o', output_directory, '-t', str(thread_count), '--report', report_path]
+    best = None
+    for repeat in range(results.repeats): # the fastest repeat is kept, the others are noise from the machine
+        with open(os.devnull, 'w') as devnull:
+            subprocess.check_call(command, stdout=devnull)
+        with open(report_path) as report_file:
+            report = json.load(report_file)
+        if best is None or report['wall_seconds'] < best['wall_seconds']:
+            best = report
+    stages = dict((stage['name'], stage) for stage in best['stages'])
+    return {'threads': thread_count,
+            'wall_seconds': best['wall_seconds'],
+            'variants': stages['vcf_parse']['items'],
+            'reads': stages['read_fetch']['items'],
+            'max_resident_kilobytes': best['max_resident_kilobytes']}
+
+
+def print_curve(name, runs, is_weak, tsv_file):
+    base_threads = runs[0]['threads']
+    base_seconds = runs[0]['wall_seconds']
+    print('%s scaling' % name)
+    print('threads\twall_seconds\tvariants/sec\treads/sec\tpeak_rss_mb\tspeedup\tefficiency')
+    for run in runs:
+        seconds = max(run['wall_seconds'], 1e-9)
+        if is_weak: # the work grows with the threads, ideal is a flat wall time
+            efficiency = base_seconds / seconds
+            speedup = efficiency * run['threads'] / base_threads
+        else: # the same work, ideal is a wall time that falls with the threads
+            speedup = base_seconds / seconds
+            efficiency = speedup * base_threads / run['threads']
+        row = [name, run['threads'], '%.3f' % run['wall_seconds'], '%.1f' % (run['variants'] / seconds), '%.1f' % (run['reads'] / seconds), '%.1f' % (run['max_resident_kilobytes'] / 1024.0), '%.2f' % speedup, '%.2f' % efficiency]
+        print('\t'.join(str(value) for value in row[1:]))
+        tsv_file.write('\t'.join(str(value) for value in row) + '\n')
+    print('')
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description='Measure graphite throughput and scaling on synthetic data', add_help=True)
+    parser.add_argument('-g', '--graphite', action="store", dest="graphite", default='graphite', help="Path to the graphite binary")
+    parser.add_argument('-s', '--simulate', action="store", dest="simulate", default='graphite_simulate', help="Path to the graphite_simulate binary")
+    parser.add_argument('-o', '--work_directory', action="store", dest="work_directory", required=True, help="Directory for the datasets, the runs and scaling.tsv")
+    parser.add_argument('-t', '--threads', action="store", dest="threads", default='1,2,4,8', help="Comma separated thread counts")
+    parser.add_argument('--contig_length', action="store", dest="contig_length", type=int, default=1000000, help="Length of the strong scaling dataset and of every weak scaling contig")
+    parser.add_argument('--density', action="store", dest="density", type=float, default=1.0, help="Variants per kilobase")
+    parser.add_argument('--coverage', action="store", dest="coverage", type=float, default=30.0)
+    parser.add_argument('--read_length', action="store", dest="read_length", type=int, default=150)
+    parser.add_argument('--seed', action="store", dest="seed", type=int, default=1)
+    parser.add_argument('--repeats', action="store", dest="repeats", type=int, default=1, help="Runs of every thread count, the fastest is reported")
+    parser.add_argument('--no_weak', action="store_true", dest="no_weak", help="Only measure strong scaling")
+    results = parser.parse_args(argv)
+    thread_counts = sorted(set(int(thread_count) for thread_count in results.threads.split(',')))
+
+    if not os.path.isdir(results.work_directory):
+        os.makedirs(results.work_directory)
+    with open(os.path.join(results.work_directory, 'scaling.tsv'), 'w') as tsv_file:
+        tsv_file.write('scaling\tthreads\twall_seconds\tvariants_per_second\treads_per_second\tpeak_rss_mb\tspeedup\tefficiency\n')
+        dataset_directory = simulate(results, 1)
+        strong_runs = [run_graphite(results, dataset_directory, thread_count, 'strong_t%d' % thread_count) for thread_count in thread_counts]
+        print_curve('strong', strong_runs, False, tsv_file)
+        if not results.no_weak:
+            weak_runs = [run_graphite(results, simulate(results, thread_count), thread_count, 'weak_t%d' % thread_count) for thread_count in thread_counts]
+            print_curve('weak', weak_runs, True, tsv_file)
+    print('scaling: ' + os.path.join(results.work_directory, 'scaling.tsv'))
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
@@ -0,0 +1,120 @@
+#ifndef GRAPHITE_TESTS_CLUSTERLIFETIME_HPP
+#define GRAPHITE_TESTS_CLUSTERLIFETIME_HPP
+
+#include "core/graph/Graph.h"
+#include "core/graph/GraphProcessor.h"
+#include "core/reference/FastaReference.h"
+#include "core/alignment/Alignment.h"
+#include "core/sample/Sample.h"
+#include "core/util/MemoryAccounting.h"
+#include "core/util/ClusterArena.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+// runs clusters of three variants and four reads through a GraphProcessor, which releases a cluster's graph, reads and alleles in writeVariants once it is written, returns the written cluster count
+static uint64_t adjudicateSyntheticClusters(uint64_t clusterCount, uint32_t seed)
+{
+	std::mt19937 randomGenerator(seed);
+	std::string referenceSequence;
+	for (uint32_t i = 0; i < 1000; ++i)
+	{
+		referenceSequence.push_back("ACGT"[randomGenerator() % 4]);
+	}
+	auto fastaReferencePtr = std::make_shared< graphite::FastaReference >("1", 1, referenceSequence);
+	auto samplePtr = std::make_shared< graphite::Sample >("sample", "1", "sample.bam");
+	std::vector< graphite::AlignmentReader::SharedPtr > noAlignmentReaderPtrs;
+	std::vector< graphite::VCFReader::SharedPtr > noVCFReaderPtrs;
+	graphite::GraphProcessor graphProcessor(fastaReferencePtr, noAlignmentReaderPtrs, noVCFReaderPtrs, 1, 4, 6, 1, false, 0, 1000, 2, 64 * 1024 * 1024);
+	graphProcessor.setGraphSpacing(100);
+
+	uint64_t sourcedClusterCount = 0;
+	graphite::position variantPosition = 0;
+	graphProcessor.setClusterSource([&](std::vector< graphite::Variant::SharedPtr >& variantPtrs, uint32_t graphSpacing)
+		{
+			if (sourcedClusterCount == clusterCount)
+			{
+				return false;
+			}
+			++sourcedClusterCount;
+			variantPosition = 300 + (randomGenerator() % 300);
+			std::string insertion = referenceSequence.substr(variantPosition + 19, 1) + "ACGTACGT";
+			variantPtrs.emplace_back(std::make_shared< graphite::Variant >("1", variantPosition, referenceSequence.substr(variantPosition - 1, 1), std::vector< std::string >{ "A", "T" }));
+			variantPtrs.emplace_back(std::make_shared< graphite::Variant >("1", variantPosition + 10, referenceSequence.substr(variantPosition + 9, 1), std::vector< std::string >{ "G" }));
+			variantPtrs.emplace_back(std::make_shared< graphite::Variant >("1", variantPosition + 20, referenceSequence.substr(variantPosition + 19, 1), std::vector< std::string >{ insertion }));
+			return true;
+		});
+	// the source and the reads are asked for on the same thread, one cluster after the other
+	graphProcessor.setAlignmentSource([&](std::vector< graphite::Alignment::SharedPtr >& alignmentPtrs, const std::vector< graphite::Region::SharedPtr >& regionPtrs)
+		{
+			for (uint32_t i = 0; i < 4; ++i)
+			{
+				alignmentPtrs.emplace_back(std::make_shared< graphite::Alignment >(referenceSequence.substr(variantPosition - 50, 100), "read" + std::to_string(sourcedClusterCount) + "_" + std::to_string(i), (i % 2) == 0, true, 60, samplePtr));
+			}
+		});
+	uint64_t writtenClusterCount = 0;
+	graphProcessor.setClusterCallback([&writtenClusterCount](const std::vector< graphite::Variant::SharedPtr >& variantPtrs)
+		{
+			++writtenClusterCount;
+		});
+	graphProcessor.processVariants();
+	return writtenClusterCount;
+}
+
+TEST(ClusterLifetimeTest, WrittenClustersReleaseTheirNodesAllelesAndReads)
+{
+	graphite::MemoryAccounting::enable();
+	auto nodeByteCount = graphite::MemoryAccounting::getLiveByteCount(graphite::MemoryAccounting::SUBSYSTEM::GRAPH_NODES);
+	auto alleleByteCount = graphite::MemoryAccounting::getLiveByteCount(graphite::MemoryAccounting::SUBSYSTEM::ALLELES);
+	auto alignmentByteCount = graphite::MemoryAccounting::getLiveByteCount(graphite::MemoryAccounting::SUBSYSTEM::ALIGNMENTS);
+	ASSERT_EQ(adjudicateSyntheticClusters(100, 7), 100);
+	EXPECT_EQ(graphite::MemoryAccounting::getLiveByteCount(graphite::MemoryAccounting::SUBSYSTEM::GRAPH_NODES), nodeByteCount);
+	EXPECT_EQ(graphite::MemoryAccounting::getLiveByteCount(graphite::MemoryAccounting::SUBSYSTEM::ALLELES), alleleByteCount);
+	EXPECT_EQ(graphite::MemoryAccounting::getLiveByteCount(graphite::MemoryAccounting::SUBSYSTEM::ALIGNMENTS), alignmentByteCount);
+	EXPECT_GT(graphite::MemoryAccounting::getPeakByteCount(graphite::MemoryAccounting::SUBSYSTEM::GRAPH_NODES), nodeByteCount);
+	EXPECT_GT(graphite::MemoryAccounting::getPeakByteCount(graphite::MemoryAccounting::SUBSYSTEM::ALIGNMENTS), alignmentByteCount);
+}
+
+TEST(ClusterLifetimeTest, ClusterArenaIsReleasedWithItsGraphAndReads)
+{
+	std::mt19937 randomGenerator(5);
+	std::string referenceSequence;
+	for (uint32_t i = 0; i < 1000; ++i)
+	{
+		referenceSequence.push_back("ACGT"[randomGenerator() % 4]);
+	}
+	auto fastaReferencePtr = std::make_shared< graphite::FastaReference >("1", 1, referenceSequence);
+	auto samplePtr = std::make_shared< graphite::Sample >("sample", "1", "sample.bam");
+	std::vector< graphite::Variant::SharedPtr > variantPtrs;
+	variantPtrs.emplace_back(std::make_shared< graphite::Variant >("1", 400, referenceSequence.substr(399, 1), std::vector< std::string >{ "A", "T" }));
+	variantPtrs.emplace_back(std::make_shared< graphite::Variant >("1", 420, referenceSequence.substr(419, 1), std::vector< std::string >{ referenceSequence.substr(419, 1) + "ACGT" }));
+
+	auto heapGraphPtr = std::make_shared< graphite::Graph >(fastaReferencePtr, variantPtrs, 100, false);
+	auto arenaPtr = std::make_shared< graphite::ClusterArena >();
+	std::weak_ptr< graphite::ClusterArena > arenaWeakPtr = arenaPtr;
+	auto arenaGraphPtr = std::make_shared< graphite::Graph >(fastaReferencePtr, variantPtrs, 100, false, arenaPtr);
+	auto alignmentPtr = graphite::ClusterArena::makeShared< graphite::Alignment >(arenaPtr, referenceSequence.substr(350, 100), "read", true, true, 60, samplePtr);
+	ASSERT_EQ(heapGraphPtr->getNodePtrsMap().size(), arenaGraphPtr->getNodePtrsMap().size());
+	EXPECT_GT(arenaPtr->getAllocationCount(), arenaGraphPtr->getNodePtrsMap().size());
+
+	heapGraphPtr->clearResources();
+	alignmentPtr = nullptr;
+	arenaPtr = nullptr;
+	EXPECT_FALSE(arenaWeakPtr.expired()); // the graph's nodes still hold it
+	arenaGraphPtr->clearResources();
+	arenaGraphPtr = nullptr;
+	EXPECT_TRUE(arenaWeakPtr.expired());
+}
+
+// takes minutes so it isn't part of the default run: graphite_tests --gtest_also_run_disabled_tests --gtest_filter=*MillionClusters
+TEST(ClusterLifetimeTest, DISABLED_ResidentSizeStaysFlatOverAMillionClusters)
+{
+	ASSERT_EQ(adjudicateSyntheticClusters(10000, 11), 10000); // the allocator's pools settle first
+	uint64_t settledResidentByteCount = graphite::MemoryAccounting::getResidentByteCount();
+	ASSERT_EQ(adjudicateSyntheticClusters(1000000, 13), 1000000);
+	uint64_t residentByteCount = graphite::MemoryAccounting::getResidentByteCount();
+	EXPECT_LT(residentByteCount, settledResidentByteCount + 16 * 1024 * 1024); // a leaked cluster is several KB, a million of them would be GBs
+}
+
+#endif //GRAPHITE_TESTS_CLUSTERLIFETIME_HPP
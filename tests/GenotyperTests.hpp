@@ -0,0 +1,68 @@
+#ifndef GRAPHITE_TESTS_GENOTYPER_HPP
+#define GRAPHITE_TESTS_GENOTYPER_HPP
+
+#include "core/vcf/Genotyper.h"
+#include "core/util/Utility.h"
+
+#include <string>
+#include <vector>
+
+TEST(GenotyperTest, CallsBiallelicGenotypes)
+{
+	graphite::Genotyper genotyper;
+	uint32_t homozygousReference[] = { 30, 0 };
+	uint32_t heterozygous[] = { 15, 15 };
+	uint32_t homozygousAlternate[] = { 0, 30 };
+	std::string genotype;
+	genotyper.appendGenotype(genotype, homozygousReference, 2);
+	EXPECT_EQ(genotype.substr(0, 4), "0/0:");
+	genotype.clear();
+	genotyper.appendGenotype(genotype, heterozygous, 2);
+	EXPECT_EQ(genotype.substr(0, 4), "0/1:");
+	genotype.clear();
+	genotyper.appendGenotype(genotype, homozygousAlternate, 2);
+	EXPECT_EQ(genotype.substr(0, 4), "1/1:");
+}
+
+TEST(GenotyperTest, MatchesBayesgtOnBiallelicSites)
+{
+	graphite::Genotyper genotyper;
+	uint32_t counts[] = { 4, 16 }; // scripts/bayesgt.py calls this 1/1, its alt read probability is 0.9 under 1/1
+	std::string genotype;
+	genotyper.appendGenotype(genotype, counts, 2);
+	EXPECT_EQ(genotype, "1/1:13:273,13,0");
+}
+
+TEST(GenotyperTest, NoReadsIsMissing)
+{
+	graphite::Genotyper genotyper;
+	uint32_t noReads[] = { 0, 0, 0 };
+	std::string genotype;
+	genotyper.appendGenotype(genotype, noReads, 3);
+	EXPECT_EQ(genotype, "./.:.:.");
+}
+
+TEST(GenotyperTest, PhredLikelihoodsAreRelativeToTheCall)
+{
+	graphite::Genotyper genotyper;
+	uint32_t counts[] = { 10, 0, 10 }; // a 0/2 call out of six genotypes
+	std::string genotype;
+	genotyper.appendGenotype(genotype, counts, 3);
+	EXPECT_EQ(genotype.substr(0, 4), "0/2:");
+	std::vector< std::string > phredLikelihoods;
+	graphite::split(genotype.substr(genotype.rfind(':') + 1), ',', phredLikelihoods);
+	ASSERT_EQ(phredLikelihoods.size(), 6);
+	EXPECT_EQ(phredLikelihoods[3], "0"); // 0/2 is the fourth genotype in VCF order
+}
+
+TEST(GenotyperTest, ComputesSitesWithManyAlleles)
+{
+	graphite::Genotyper genotyper;
+	uint32_t counts[12] = { 0 };
+	counts[11] = 20;
+	std::string genotype;
+	genotyper.appendGenotype(genotype, counts, 12);
+	EXPECT_EQ(genotype.substr(0, 8), "11/11:60");
+}
+
+#endif //GRAPHITE_TESTS_GENOTYPER_HPP
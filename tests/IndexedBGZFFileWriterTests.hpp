@@ -0,0 +1,96 @@
+#ifndef GRAPHITE_TESTS_INDEXEDBGZFFILEWRITER_HPP
+#define GRAPHITE_TESTS_INDEXEDBGZFFILEWRITER_HPP
+
+#include "core/vcf/IndexedBGZFFileWriter.h"
+
+#include "htslib/hts.h"
+#include "htslib/tbx.h"
+#include "htslib/kstring.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+static const uint32_t BGZF_TEST_RECORD_COUNT = 20000; // per contig, enough for dozens of blocks
+
+static std::string getBGZFTestRecord(uint32_t contig, uint32_t index)
+{
+	return std::to_string(contig) + "\t" + std::to_string(index * 10 + 1) + "\t.\tA\tT\t.\tPASS\tX=" + std::string(index % 97, 'x'); // uneven lengths so records cross block boundaries
+}
+
+// the positions tabix returns for a region of one contig
+static std::vector< int64_t > queryBGZFTestRegion(htsFile* htsFilePtr, tbx_t* tbxPtr, const std::string& region)
+{
+	std::vector< int64_t > positions;
+	hts_itr_t* iterPtr = tbx_itr_querys(tbxPtr, region.c_str());
+	if (iterPtr == nullptr)
+	{
+		return positions;
+	}
+	kstring_t line = { 0, 0, nullptr };
+	while (tbx_itr_next(htsFilePtr, tbxPtr, iterPtr, &line) >= 0)
+	{
+		std::string record(line.s, line.l);
+		size_t positionStart = record.find('\t') + 1;
+		positions.emplace_back(strtoll(record.c_str() + positionStart, nullptr, 10));
+	}
+	free(line.s);
+	tbx_itr_destroy(iterPtr);
+	return positions;
+}
+
+TEST(IndexedBGZFFileWriterTest, MultithreadedOutputIsReadBackThroughItsIndex)
+{
+	char pathTemplate[] = "/tmp/graphite_bgzf_XXXXXX";
+	int fileDescriptor = mkstemp(pathTemplate);
+	ASSERT_GE(fileDescriptor, 0);
+	::close(fileDescriptor);
+	std::remove(pathTemplate);
+	std::string path = std::string(pathTemplate) + ".vcf.gz";
+	{
+		graphite::IndexedBGZFFileWriter writer(path, 4);
+		ASSERT_TRUE(writer.open());
+		writer.writeLine("##fileformat=VCFv4.2");
+		writer.writeLine("#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO");
+		for (uint32_t contig = 1; contig <= 3; ++contig)
+		{
+			for (uint32_t i = 0; i < BGZF_TEST_RECORD_COUNT; ++i)
+			{
+				writer.writeLine(getBGZFTestRecord(contig, i));
+				if (i == BGZF_TEST_RECORD_COUNT / 2)
+				{
+					writer.flush(); // a checkpoint cuts a short block
+				}
+			}
+		}
+	}
+
+	tbx_t* tbxPtr = tbx_index_load(path.c_str());
+	ASSERT_NE(tbxPtr, nullptr);
+	htsFile* htsFilePtr = hts_open(path.c_str(), "r");
+	ASSERT_NE(htsFilePtr, nullptr);
+	std::vector< std::pair< uint32_t, std::pair< int64_t, int64_t > > > regions = { { 1, { 1, 50 } }, { 2, { 100001, 100500 } }, { 2, { 99995, 100005 } }, { 3, { 190001, 200000 } }, { 3, { 5, 9 } } };
+	for (auto& region : regions)
+	{
+		std::vector< int64_t > expectedPositions;
+		for (uint32_t i = 0; i < BGZF_TEST_RECORD_COUNT; ++i)
+		{
+			int64_t position = i * 10 + 1;
+			if (position >= region.second.first && position <= region.second.second)
+			{
+				expectedPositions.emplace_back(position);
+			}
+		}
+		std::string regionString = std::to_string(region.first) + ":" + std::to_string(region.second.first) + "-" + std::to_string(region.second.second);
+		EXPECT_EQ(queryBGZFTestRegion(htsFilePtr, tbxPtr, regionString), expectedPositions) << regionString;
+	}
+	hts_close(htsFilePtr);
+	tbx_destroy(tbxPtr);
+	std::remove((path + ".tbi").c_str());
+	std::remove(path.c_str());
+}
+
+#endif //GRAPHITE_TESTS_INDEXEDBGZFFILEWRITER_HPP
@@ -0,0 +1,52 @@
+#ifndef GRAPHITE_TESTS_REORDERBUFFER_HPP
+#define GRAPHITE_TESTS_REORDERBUFFER_HPP
+
+#include "core/util/ReorderBuffer.hpp"
+#include "core/util/ThreadPool.hpp"
+
+#include <vector>
+
+TEST(ReorderBufferTest, ConsumesInSequenceOrder)
+{
+	std::vector< int > consumed;
+	graphite::ReorderBuffer< int > reorderBuffer(100, [&consumed](int& item) { consumed.emplace_back(item); });
+	auto first = reorderBuffer.reserve(1);
+	auto second = reorderBuffer.reserve(1);
+	auto third = reorderBuffer.reserve(1);
+	reorderBuffer.complete(third, 3);
+	reorderBuffer.complete(second, 2);
+	EXPECT_EQ(consumed.size(), 0);
+	reorderBuffer.complete(first, 1);
+	ASSERT_EQ(consumed.size(), 3);
+	EXPECT_EQ(consumed[0], 1);
+	EXPECT_EQ(consumed[1], 2);
+	EXPECT_EQ(consumed[2], 3);
+	EXPECT_EQ(reorderBuffer.getMaxBufferedCount(), 3);
+}
+
+TEST(ReorderBufferTest, ConsumesInSequenceOrderFromThreads)
+{
+	std::vector< int > consumed;
+	graphite::ReorderBuffer< int > reorderBuffer(64, [&consumed](int& item) { consumed.emplace_back(item); });
+	{
+		graphite::ThreadPool threadPool(4);
+		for (int i = 0; i < 1000; ++i)
+		{
+			auto sequence = reorderBuffer.reserve(1); // the cap keeps at most 64 items in flight
+			threadPool.enqueue([&reorderBuffer, sequence, i]() {
+					std::this_thread::sleep_for(std::chrono::microseconds((i % 5) * 50));
+					reorderBuffer.complete(sequence, i);
+				});
+		}
+		reorderBuffer.waitForAll();
+		threadPool.join();
+	}
+	ASSERT_EQ(consumed.size(), 1000);
+	for (int i = 0; i < 1000; ++i)
+	{
+		EXPECT_EQ(consumed[i], i);
+	}
+	EXPECT_LE(reorderBuffer.getMaxBufferedCount(), 64);
+}
+
+#endif //GRAPHITE_TESTS_REORDERBUFFER_HPP
@@ -1,17 +1,11 @@
 #include "gtest/gtest.h"
 
-#include "IntegrationTests.hpp"
-#include "VCFFileTests.hpp"
-#include "BamAlignmentReaderTests.hpp"
+// the other headers in this directory test classes that no longer exist
 #include "RegionTests.hpp"
-#include "FileTests.hpp"
-#include "VCFFileTests.hpp"
-#include "GSSWTests.hpp"
-#include "GSSWGraphTests.hpp"
-#include "AlleleTests.hpp"
-#include "VariantsTest.hpp"
-#include "CompoundVariantTests.hpp"
-#include "FastaReferenceTests.hpp"
+#include "ReorderBufferTests.hpp"
+#include "GenotyperTests.hpp"
+#include "ClusterLifetimeTests.hpp"
+#include "IndexedBGZFFileWriterTests.hpp"
 
 GTEST_API_ int main(int argc, char** argv)
 {
@@ -5,14 +5,234 @@
 #include "core/vcf/VCFReader.h"
 #include "core/vcf/VCFWriter.h"
 #include "core/alignment/AlignmentReader.h"
+#include "core/vcf/VCFPartitioner.h"
+#include "core/vcf/ShardMerger.h"
+#include "core/vcf/VCFCombiner.h"
 #include "core/graph/GraphProcessor.h"
+#include "core/graph/ShardProcessor.h"
+#include "core/graph/GraphStore.h"
+#include "core/graph/ResultCache.h"
+#include "core/graph/AdjudicationServer.h"
+#include "core/graph/ClusterSnapshot.h"
+#include "core/vcf/Checkpoint.h"
+#include "core/util/StageProfiler.h"
+#include "core/util/MemoryAccounting.h"
+#include "core/util/ProgressReporter.h"
 
 #include <string>
 #include <iostream>
 #include <stdlib.h>
+#include <algorithm>
+#include <future>
+#include <chrono>
+
+// opening a reader loads its index, with many sample files that is worth doing side by side
+std::vector< graphite::AlignmentReader::SharedPtr > createAlignmentReaders(const std::vector< std::string >& alignmentPaths, const std::string& fastaPath, uint32_t threadCount)
+{
+	std::vector< std::future< graphite::AlignmentReader::SharedPtr > > alignmentReaderFutures;
+	{
+		graphite::ThreadPool threadPool(std::max< size_t >(1, std::min< size_t >(threadCount, alignmentPaths.size())));
+		for (auto& alignmentPath : alignmentPaths)
+		{
+			alignmentReaderFutures.emplace_back(threadPool.enqueue([&alignmentPath, &fastaPath]() { return std::make_shared< graphite::AlignmentReader >(alignmentPath, fastaPath); }));
+		}
+	}
+	std::vector< graphite::AlignmentReader::SharedPtr > alignmentReaderPtrs;
+	for (auto& alignmentReaderFuture : alignmentReaderFutures)
+	{
+		alignmentReaderPtrs.emplace_back(alignmentReaderFuture.get());
+	}
+	return alignmentReaderPtrs;
+}
+
+// graphite merge, joins the outputs of --shard runs
+int merge(int argc, char** argv)
+{
+	graphite::Params params;
+	params.parseMerge(argc, argv);
+	if (params.showHelp() || !params.validateMergeRequired())
+	{
+		params.printHelp();
+		return 0;
+	}
+	graphite::ShardMerger shardMerger(params.getInVCFPaths(), params.getOutputFilePath(), params.getThreadCount());
+	return shardMerger.merge() ? 0 : 1;
+}
+
+// graphite combine, joins the sample columns of graphite VCFs
+int combine(int argc, char** argv)
+{
+	graphite::Params params;
+	params.parseCombine(argc, argv);
+	if (params.showHelp() || !params.validateCombineRequired())
+	{
+		params.printHelp();
+		return 0;
+	}
+	graphite::VCFCombiner vcfCombiner(params.getCombineVCFPaths(), params.getOutputFilePath(), params.getThreadCount());
+	return vcfCombiner.combine() ? 0 : 1;
+}
+
+// graphite build-graphs, stores the graphs of a VCF's clusters for later runs
+int buildGraphs(int argc, char** argv)
+{
+	graphite::Params params;
+	params.parseBuildGraphs(argc, argv);
+	if (params.showHelp() || !params.validateBuildGraphsRequired())
+	{
+		params.printHelp();
+		return 0;
+	}
+	auto fastaPath = params.getFastaPath();
+	auto threadCount = params.getThreadCount();
+	auto graphSpacing = params.getGraphSpacing();
+	if (graphSpacing == 0)
+	{
+		graphSpacing = graphite::GraphProcessor::getGraphSpacing(createAlignmentReaders(params.getAlignmentPaths(), fastaPath, threadCount));
+	}
+	return graphite::GraphStore::build(params.getOutputFilePath(), params.getInVCFPaths(), fastaPath, graphSpacing, threadCount) ? 0 : 1;
+}
+
+// graphite serve, adjudicates requests over a socket with the FASTA, alignments and threads kept loaded
+int serve(int argc, char** argv)
+{
+	graphite::Params params;
+	params.parseServe(argc, argv);
+	if (params.showHelp() || !params.validateServeRequired())
+	{
+		params.printHelp();
+		return 0;
+	}
+	auto fastaPath = params.getFastaPath();
+	auto threadCount = params.getThreadCount();
+	auto vcfPaths = params.getServeVCFPaths();
+	auto fastaReferencePtr = std::make_shared< graphite::FastaReference >(fastaPath);
+	auto alignmentReaderPtrs = createAlignmentReaders(params.getAlignmentPaths(), fastaPath, threadCount);
+	std::vector< graphite::Sample::SharedPtr > alignmentSamplePtrs;
+	for (auto& alignmentReaderPtr : alignmentReaderPtrs)
+	{
+		for (auto iter : alignmentReaderPtr->getSamplePtrs())
+		{
+			alignmentSamplePtrs.emplace_back(iter.second);
+		}
+	}
+	graphite::AdjudicationServer adjudicationServer(params.getSocketPath(), fastaReferencePtr, alignmentReaderPtrs, alignmentSamplePtrs, vcfPaths, params.getMatchValue(), params.getMisMatchValue(), params.getGapOpenValue(), params.getGapExtensionValue(), params.getMappingQualityFilter(), params.getReadSampleNumber(), threadCount, params.getClusterBufferByteCount());
+	if (params.genotypeSamples())
+	{
+		adjudicationServer.setGenotyper(std::make_shared< graphite::Genotyper >());
+	}
+	return adjudicationServer.serve() ? 0 : 1;
+}
+
+// graphite replay, adjudicates a cluster captured with --capture again without the input files
+int replay(int argc, char** argv)
+{
+	graphite::Params params;
+	params.parseReplay(argc, argv);
+	if (params.showHelp() || !params.validateReplayRequired())
+	{
+		params.printHelp();
+		return 0;
+	}
+	auto reportPath = params.getReportPath();
+	if (reportPath.size() > 0)
+	{
+		graphite::StageProfiler::enable();
+		graphite::MemoryAccounting::enable();
+	}
+	auto snapshotPtr = graphite::ClusterSnapshot::read(params.getSnapshotPath());
+	if (snapshotPtr == nullptr)
+	{
+		return 1;
+	}
+	auto threadCount = params.getThreadCount();
+	auto alignmentPtrs = snapshotPtr->getAlignmentPtrs();
+	std::vector< graphite::Sample::SharedPtr > samplePtrs;
+	for (auto& alignmentPtr : alignmentPtrs)
+	{
+		if (std::find(samplePtrs.begin(), samplePtrs.end(), alignmentPtr->getSample()) == samplePtrs.end())
+		{
+			samplePtrs.emplace_back(alignmentPtr->getSample());
+		}
+	}
+	std::cout << "Replaying " << snapshotPtr->getRegionString() << " with " << alignmentPtrs.size() << " reads, captured at " << (snapshotPtr->getCapturedNanoseconds() / 1e9) << " seconds summed over the threads" << std::endl;
+
+	// every repeat starts from new variants so the counts don't add up
+	auto threadPoolPtr = std::make_shared< graphite::ThreadPool >(threadCount);
+	std::vector< graphite::Variant::SharedPtr > adjudicatedVariantPtrs;
+	for (uint32_t i = 0; i < params.getRepeatCount(); ++i)
+	{
+		bool isQueued = false;
+		auto graphProcessorPtr = std::make_shared< graphite::GraphProcessor >(snapshotPtr->createFastaReference(), std::vector< graphite::AlignmentReader::SharedPtr >(), std::vector< graphite::VCFReader::SharedPtr >(), snapshotPtr->getMatchValue(), snapshotPtr->getMismatchValue(), snapshotPtr->getGapOpenValue(), snapshotPtr->getGapExtensionValue(), false, -1, -1, threadPoolPtr, static_cast< size_t >(1024) * 1024 * 1024);
+		graphProcessorPtr->setGraphSpacing(snapshotPtr->getGraphSpacing());
+		graphProcessorPtr->setClusterSource([&isQueued, &snapshotPtr](std::vector< graphite::Variant::SharedPtr >& variantPtrs, uint32_t graphSpacing)
+			{
+				if (!isQueued)
+				{
+					variantPtrs = snapshotPtr->createVariantPtrs();
+					isQueued = true;
+				}
+				return variantPtrs.size() > 0;
+			});
+		graphProcessorPtr->setAlignmentSource([&alignmentPtrs](std::vector< graphite::Alignment::SharedPtr >& regionAlignmentPtrs, const std::vector< graphite::Region::SharedPtr >& regionPtrs)
+			{
+				regionAlignmentPtrs.insert(regionAlignmentPtrs.end(), alignmentPtrs.begin(), alignmentPtrs.end());
+			});
+		graphProcessorPtr->setClusterCallback([&adjudicatedVariantPtrs](const std::vector< graphite::Variant::SharedPtr >& variantPtrs) { adjudicatedVariantPtrs = variantPtrs; });
+		auto startTime = std::chrono::steady_clock::now();
+		graphProcessorPtr->processVariants();
+		std::chrono::duration< double > elapsed = std::chrono::steady_clock::now() - startTime;
+		std::cout << "Repeat " << (i + 1) << ": " << elapsed.count() << " seconds" << std::endl;
+	}
+
+	// the NFP read counts of the last repeat, to check the replay against the run's VCF
+	for (auto& variantPtr : adjudicatedVariantPtrs)
+	{
+		std::cout << variantPtr->getChromosome() << "\t" << variantPtr->getPosition() << "\t" << variantPtr->getReferenceAllelePtr()->getSequence();
+		for (auto& samplePtr : samplePtrs)
+		{
+			std::cout << "\t" << samplePtr->getName() << ":";
+			std::vector< graphite::Allele::SharedPtr > allelePtrs = { variantPtr->getReferenceAllelePtr() };
+			auto alternateAllelePtrs = variantPtr->getAlternateAllelePtrs();
+			allelePtrs.insert(allelePtrs.end(), alternateAllelePtrs.begin(), alternateAllelePtrs.end());
+			for (size_t j = 0; j < allelePtrs.size(); ++j)
+			{
+				auto sampleIndex = samplePtr->getIndex();
+				std::cout << ((j > 0) ? "," : "") << (allelePtrs[j]->getScoreCount(sampleIndex, graphite::AlleleCountType::NinteyFivePercent, true) + allelePtrs[j]->getScoreCount(sampleIndex, graphite::AlleleCountType::NinteyFivePercent, false));
+			}
+		}
+		std::cout << std::endl;
+	}
+	if (reportPath.size() > 0 && !graphite::StageProfiler::writeReport(reportPath, threadCount))
+	{
+		return 1;
+	}
+	return 0;
+}
 
 int main(int argc, char** argv)
 {
+	if (argc > 1 && std::string(argv[1]) == "merge")
+	{
+		return merge(argc - 1, argv + 1);
+	}
+	if (argc > 1 && std::string(argv[1]) == "combine")
+	{
+		return combine(argc - 1, argv + 1);
+	}
+	if (argc > 1 && std::string(argv[1]) == "build-graphs")
+	{
+		return buildGraphs(argc - 1, argv + 1);
+	}
+	if (argc > 1 && std::string(argv[1]) == "serve")
+	{
+		return serve(argc - 1, argv + 1);
+	}
+	if (argc > 1 && std::string(argv[1]) == "replay")
+	{
+		return replay(argc - 1, argv + 1);
+	}
+
 	// get all param properties
 	graphite::Params params;
 	params.parseGSSW(argc, argv);
@@ -21,11 +241,23 @@ int main(int argc, char** argv)
 		params.printHelp();
 		return 0;
 	}
+	auto reportPath = params.getReportPath();
+	if (reportPath.size() > 0)
+	{
+		graphite::StageProfiler::enable();
+	}
+	// the report, progress lines and status file show what the subsystems hold, a soft limit turns it on as well
+	graphite::MemoryAccounting::setSoftLimit(params.getMemoryLimitByteCount());
+	if (reportPath.size() > 0 || params.getProgressSeconds() > 0 || params.getStatusPath().size() > 0)
+	{
+		graphite::MemoryAccounting::enable();
+	}
 	auto alignmentPaths = params.getAlignmentPaths();
 	auto fastaPath = params.getFastaPath();
 	auto vcfPaths = params.getInVCFPaths();
 	auto outputDirectory = params.getOutputDirectory();
-	auto paramRegionPtr = params.getRegion();
+	auto regionPtrs = params.getRegionPtrs();
+	auto shardCount = params.getShardCount();
 	auto matchValue = params.getMatchValue();
 	auto misMatchValue = params.getMisMatchValue();
 	auto gapOpenValue = params.getGapOpenValue();
@@ -37,18 +269,29 @@ int main(int argc, char** argv)
 	auto overwriteSampleName = params.getOverwrittenSampleName();
 	auto threadCount = params.getThreadCount();
 	auto saveSupportingReadInfo = params.saveSupportingReadInformation();
+	auto compressOutput = params.compressOutput();
+	auto clusterBufferByteCount = params.getClusterBufferByteCount();
+	auto genotyperPtr = (params.genotypeSamples()) ? std::make_shared< graphite::Genotyper >() : nullptr;
+	uint32_t scatterShardIndex = 0;
+	uint32_t scatterShardCount = 0;
+	auto isScatterShard = params.getShard(scatterShardIndex, scatterShardCount);
+	auto outputNameSuffix = (isScatterShard) ? graphite::ShardMerger::getShardNameSuffix(scatterShardIndex, scatterShardCount) : "";
 
     // create reference reader
 	auto fastaReferencePtr = std::make_shared< graphite::FastaReference >(fastaPath);
 
 	// track samples from alignment files
 	std::vector< graphite::Sample::SharedPtr > alignmentSamplePtrs;
+	std::vector< graphite::Sample::SharedPtr > overwriteSamplePtrs;
 
-	// create alignment readers
-    std::vector< graphite::AlignmentReader::SharedPtr > alignmentReaderPtrs;
-	for (auto alignmentPath : alignmentPaths)
+	// create alignment readers, with thousands of samples their handles are opened and closed as they are needed
+	auto openAlignmentLimit = params.getOpenAlignmentLimit();
+	graphite::AlignmentReader::setMaxOpenReaderCount((openAlignmentLimit > 0) ? openAlignmentLimit : graphite::AlignmentReader::getDefaultMaxOpenReaderCount());
+	auto alignmentReaderPtrs = createAlignmentReaders(alignmentPaths, fastaPath, threadCount);
+	for (size_t i = 0; i < alignmentReaderPtrs.size(); ++i)
 	{
-		auto alignmentReaderPtr = std::make_shared< graphite::AlignmentReader >(alignmentPath, fastaPath);
+		auto alignmentPath = alignmentPaths[i];
+		auto alignmentReaderPtr = alignmentReaderPtrs[i];
 		if (overwriteSampleName.length() == 0)
 		{
 			for (auto iter : alignmentReaderPtr->getSamplePtrs())
@@ -60,25 +303,252 @@ int main(int argc, char** argv)
 		{
 			auto samplePtr = std::make_shared< graphite::Sample >(overwriteSampleName, "1", alignmentPath);
 			alignmentSamplePtrs.emplace_back(samplePtr);
+			overwriteSamplePtrs.emplace_back(samplePtr);
 			alignmentReaderPtr->overwriteSample(samplePtr);
 		}
-		alignmentReaderPtrs.emplace_back(alignmentReaderPtr);
 	}
 
-	// create VCF readers
-	// create VCF writers
-	std::vector< graphite::VCFReader::SharedPtr > vcfReaderPtrs;
-	for (auto vcfPath : vcfPaths)
+	// graphs from graphite build-graphs, the clusters it doesn't have are built from the FASTA
+	graphite::GraphStore::SharedPtr graphStorePtr = nullptr;
+	auto graphStorePath = params.getGraphStorePath();
+	if (graphStorePath.size() > 0)
 	{
-		auto vcfWriterPtr = std::make_shared< graphite::VCFWriter >(vcfPath, alignmentSamplePtrs, outputDirectory, saveSupportingReadInfo);
-		auto vcfReaderPtr = std::make_shared< graphite::VCFReader >(vcfPath, alignmentSamplePtrs, paramRegionPtr, vcfWriterPtr);
-		vcfReaderPtrs.emplace_back(vcfReaderPtr);
+		graphStorePtr = std::make_shared< graphite::GraphStore >(graphStorePath);
+		if (!graphStorePtr->open(vcfPaths, fastaPath, graphite::GraphProcessor::getGraphSpacing(alignmentReaderPtrs)))
+		{
+			graphStorePtr = nullptr;
+		}
+	}
+
+	// read alignments of earlier runs, the cache isn't touched when it can't be read
+	graphite::ResultCache::SharedPtr resultCachePtr = nullptr;
+	auto resultCachePath = params.getResultCachePath();
+	if (resultCachePath.size() > 0)
+	{
+		resultCachePtr = std::make_shared< graphite::ResultCache >(resultCachePath, matchValue, misMatchValue, gapOpenValue, gapExtensionValue);
+		if (!resultCachePtr->load())
+		{
+			resultCachePtr = nullptr;
+		}
+	}
+
+	// one row per cluster, to find the regions that dominate the run
+	graphite::ClusterProfiler::SharedPtr clusterProfilerPtr = nullptr;
+	auto clusterProfilePath = params.getClusterProfilePath();
+	if (clusterProfilePath.size() > 0)
+	{
+		clusterProfilerPtr = std::make_shared< graphite::ClusterProfiler >(clusterProfilePath);
+		if (!clusterProfilerPtr->open())
+		{
+			return 1;
+		}
+	}
+
+	// snapshots of the slow clusters for graphite replay
+	auto captureDirectory = params.getCaptureDirectory();
+	auto captureSeconds = params.getCaptureSeconds();
+
+	// progress lines and a status file while the run goes on
+	graphite::ProgressReporter::SharedPtr progressReporterPtr = nullptr;
+	auto statusPath = params.getStatusPath();
+	if (params.getProgressSeconds() > 0 || statusPath.size() > 0)
+	{
+		progressReporterPtr = std::make_shared< graphite::ProgressReporter >(params.getProgressSeconds(), statusPath);
+	}
+
+	auto checkpointMinutes = params.getCheckpointMinutes();
+	if (!isScatterShard && shardCount <= 1 && regionPtrs.size() <= 1)
+	{
+		auto paramRegionPtr = (regionPtrs.size() > 0) ? regionPtrs[0] : nullptr;
+
+		// checkpoints of the outputs, a resumed run continues after the last one
+		graphite::Checkpoint::SharedPtr checkpointPtr = nullptr;
+		if (checkpointMinutes > 0 && compressOutput)
+		{
+			std::cout << "Checkpoints are not written for compressed output, the run starts from the beginning" << std::endl;
+		}
+		else if (checkpointMinutes > 0)
+		{
+			checkpointPtr = std::make_shared< graphite::Checkpoint >(outputDirectory + "/graphite.checkpoint", vcfPaths, checkpointMinutes * 60);
+			if (params.resumeRun() && !checkpointPtr->load())
+			{
+				return 1;
+			}
+		}
+
+		// create VCF readers
+		// create VCF writers
+		std::vector< graphite::VCFReader::SharedPtr > vcfReaderPtrs;
+		std::vector< graphite::VCFWriter::SharedPtr > vcfWriterPtrs;
+		for (size_t i = 0; i < vcfPaths.size(); ++i)
+		{
+			auto vcfPath = vcfPaths[i];
+			auto resumePoint = (checkpointPtr != nullptr) ? checkpointPtr->getResumePoint(i) : graphite::VCFWriter::ResumePoint();
+			auto vcfWriterPtr = std::make_shared< graphite::VCFWriter >(vcfPath, alignmentSamplePtrs, outputDirectory, saveSupportingReadInfo, compressOutput, threadCount, "", resumePoint);
+			vcfWriterPtr->setGenotyper(genotyperPtr);
+			auto vcfReaderPtr = std::make_shared< graphite::VCFReader >(vcfPath, alignmentSamplePtrs, paramRegionPtr, vcfWriterPtr, checkpointPtr != nullptr);
+			vcfReaderPtr->resume(resumePoint);
+			vcfReaderPtrs.emplace_back(vcfReaderPtr);
+			vcfWriterPtrs.emplace_back(vcfWriterPtr);
+		}
+		if (checkpointPtr != nullptr)
+		{
+			checkpointPtr->setVCFWriters(vcfWriterPtrs);
+		}
+
+		// create graph processor
+		// call process on processor
+		auto threadPoolPtr = std::make_shared< graphite::ThreadPool >(threadCount);
+		auto graphProcessorPtr = std::make_shared< graphite::GraphProcessor >(fastaReferencePtr, alignmentReaderPtrs, vcfReaderPtrs, matchValue, misMatchValue, gapOpenValue, gapExtensionValue, outputVisualizationFiles, mappingQuality, readSampleLimit, threadPoolPtr, clusterBufferByteCount);
+		graphProcessorPtr->setGraphStore(graphStorePtr);
+		graphProcessorPtr->setResultCache(resultCachePtr);
+		graphProcessorPtr->setCheckpoint(checkpointPtr);
+		graphProcessorPtr->setClusterProfiler(clusterProfilerPtr);
+		if (captureDirectory.size() > 0)
+		{
+			graphProcessorPtr->setClusterCapture(captureDirectory, captureSeconds);
+		}
+		if (progressReporterPtr != nullptr)
+		{
+			// the fraction of the VCFs' bytes read stands in for the fraction of the variants
+			progressReporterPtr->setThreadPool(threadPoolPtr);
+			progressReporterPtr->setProgressSource([vcfReaderPtrs]()
+				{
+					double readFraction = 0.0;
+					for (auto& vcfReaderPtr : vcfReaderPtrs)
+					{
+						readFraction += vcfReaderPtr->getReadFraction() / vcfReaderPtrs.size();
+					}
+					return readFraction;
+				});
+			graphProcessorPtr->setProgressReporter(progressReporterPtr);
+			progressReporterPtr->start();
+		}
+		graphProcessorPtr->processVariants();
+		if (progressReporterPtr != nullptr)
+		{
+			progressReporterPtr->stop();
+		}
+		// a full disk leaves the output cut short, the run fails and its checkpoint is kept
+		bool isWritten = true;
+		for (auto& vcfWriterPtr : vcfWriterPtrs)
+		{
+			isWritten = vcfWriterPtr->close() && isWritten;
+		}
+		if (!isWritten)
+		{
+			return 1;
+		}
+		if (checkpointPtr != nullptr)
+		{
+			checkpointPtr->remove();
+		}
 	}
+	else
+	{
+		if (checkpointMinutes > 0)
+		{
+			std::cout << "Checkpoints are not written for sharded runs or runs over several regions, the run starts from the beginning" << std::endl;
+		}
 
-	// create graph processor
-	// call process on processor
-	auto graphProcessorPtr = std::make_shared< graphite::GraphProcessor >(fastaReferencePtr, alignmentReaderPtrs, vcfReaderPtrs, matchValue, misMatchValue, gapOpenValue, gapExtensionValue, outputVisualizationFiles, mappingQuality, readSampleLimit, threadCount);
-	graphProcessorPtr->processVariants();
+		// the final writers get their header from a reader that is otherwise unused, the records come from the shards
+		std::vector< graphite::VCFWriter::SharedPtr > vcfWriterPtrs;
+		for (auto vcfPath : vcfPaths)
+		{
+			auto vcfWriterPtr = std::make_shared< graphite::VCFWriter >(vcfPath, alignmentSamplePtrs, outputDirectory, saveSupportingReadInfo, compressOutput, threadCount, outputNameSuffix);
+			vcfWriterPtr->setGenotyper(genotyperPtr); // shard writers take it from here
+			std::make_shared< graphite::VCFReader >(vcfPath, alignmentSamplePtrs, nullptr, vcfWriterPtr);
+			vcfWriterPtrs.emplace_back(vcfWriterPtr);
+		}
 
+		graphite::VCFPartitioner vcfPartitioner(vcfPaths, graphite::GraphProcessor::getGraphSpacing(alignmentReaderPtrs));
+		std::vector< graphite::Region::SharedPtr > shardRegionPtrs;
+		if (isScatterShard)
+		{
+			// this process only covers its part of the regions, which it still splits into shards of its own
+			auto scatterRegionPtrs = vcfPartitioner.scatter(regionPtrs, scatterShardIndex, scatterShardCount);
+			if (scatterRegionPtrs.size() > 0)
+			{
+				shardRegionPtrs = vcfPartitioner.partition(scatterRegionPtrs, shardCount);
+			}
+		}
+		else
+		{
+			shardRegionPtrs = vcfPartitioner.partition(regionPtrs, shardCount);
+		}
+		uint32_t concurrentShardCount = std::max< uint32_t >(1, std::min< uint32_t >(shardRegionPtrs.size(), threadCount));
+		size_t shardClusterBufferByteCount = clusterBufferByteCount / concurrentShardCount;
+		auto threadPoolPtr = std::make_shared< graphite::ThreadPool >(threadCount);
+
+		// every shard reads through its own reference, alignment and vcf cursors
+		auto graphProcessorFactory = [&](graphite::Region::SharedPtr shardRegionPtr, const std::vector< graphite::VCFWriter::SharedPtr >& shardWriterPtrs)
+			{
+				auto shardFastaReferencePtr = std::make_shared< graphite::FastaReference >(fastaPath);
+				auto shardAlignmentReaderPtrs = createAlignmentReaders(alignmentPaths, fastaPath, threadCount / concurrentShardCount);
+				for (size_t i = 0; i < shardAlignmentReaderPtrs.size(); ++i)
+				{
+					if (overwriteSampleName.length() > 0)
+					{
+						shardAlignmentReaderPtrs[i]->overwriteSample(overwriteSamplePtrs[i]);
+					}
+				}
+				std::vector< graphite::VCFReader::SharedPtr > shardVCFReaderPtrs;
+				for (size_t i = 0; i < vcfPaths.size(); ++i)
+				{
+					shardVCFReaderPtrs.emplace_back(std::make_shared< graphite::VCFReader >(vcfPaths[i], alignmentSamplePtrs, shardRegionPtr, shardWriterPtrs[i]));
+				}
+				auto graphProcessorPtr = std::make_shared< graphite::GraphProcessor >(shardFastaReferencePtr, shardAlignmentReaderPtrs, shardVCFReaderPtrs, matchValue, misMatchValue, gapOpenValue, gapExtensionValue, outputVisualizationFiles, mappingQuality, readSampleLimit, threadPoolPtr, shardClusterBufferByteCount);
+				graphProcessorPtr->setGraphStore(graphStorePtr);
+				graphProcessorPtr->setResultCache(resultCachePtr);
+				graphProcessorPtr->setClusterProfiler(clusterProfilerPtr);
+				if (captureDirectory.size() > 0)
+				{
+					graphProcessorPtr->setClusterCapture(captureDirectory, captureSeconds);
+				}
+				graphProcessorPtr->setProgressReporter(progressReporterPtr);
+				return graphProcessorPtr;
+			};
+		if (progressReporterPtr != nullptr)
+		{
+			progressReporterPtr->setThreadPool(threadPoolPtr);
+			progressReporterPtr->setTotalVariantCount(vcfPartitioner.getPartitionedVariantCount());
+			progressReporterPtr->start();
+		}
+		graphite::ShardProcessor shardProcessor(shardRegionPtrs, vcfWriterPtrs, concurrentShardCount, graphProcessorFactory);
+		bool isWritten = shardProcessor.processShards();
+		if (progressReporterPtr != nullptr)
+		{
+			progressReporterPtr->stop();
+		}
+		for (auto& vcfWriterPtr : vcfWriterPtrs)
+		{
+			isWritten = vcfWriterPtr->close() && isWritten;
+		}
+		if (!isWritten)
+		{
+			return 1;
+		}
+	}
+
+	if (graphStorePtr != nullptr && graphStorePtr->getMissedCount() > 0)
+	{
+		std::cout << "Graphs loaded from the graph store: " << graphStorePtr->getLoadedCount() << ", built from the FASTA: " << graphStorePtr->getMissedCount() << std::endl;
+	}
+	if (resultCachePtr != nullptr)
+	{
+		std::cout << "Reads counted from the result cache: " << resultCachePtr->getHitCount() << ", aligned: " << resultCachePtr->getMissCount() << std::endl;
+		if (!resultCachePtr->save())
+		{
+			return 1;
+		}
+	}
+	if (clusterProfilerPtr != nullptr && !clusterProfilerPtr->close())
+	{
+		return 1;
+	}
+	if (reportPath.size() > 0 && !graphite::StageProfiler::writeReport(reportPath, threadCount))
+	{
+		return 1;
+	}
 	return 0;
 }